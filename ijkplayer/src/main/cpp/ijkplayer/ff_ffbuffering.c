@@ -0,0 +1,226 @@
+/*
+ * ff_ffbuffering.c
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "ff_ffbuffering.h"
+#include <math.h>
+#include <string.h>
+#include "libavutil/common.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+
+/* ladder: first -> next -> doubling up to last, every time the cache fills */
+
+static void ladder_reset(FFBufferingController *ctrl)
+{
+    ctrl->hwm_ms       = ctrl->first_hwm_ms;
+    ctrl->stall_eta_ms = -1;
+}
+
+static void ladder_on_filled(FFBufferingController *ctrl, const FFBufferingSample *sample)
+{
+    (void)sample;
+    int hwm_ms = ctrl->hwm_ms;
+    if (hwm_ms < ctrl->next_hwm_ms) {
+        hwm_ms = ctrl->next_hwm_ms;
+    } else {
+        hwm_ms *= 2;
+    }
+
+    if (hwm_ms > ctrl->last_hwm_ms)
+        hwm_ms = ctrl->last_hwm_ms;
+
+    ctrl->hwm_ms = hwm_ms;
+}
+
+static const FFBufferingPolicy g_ladder_policy = {
+    .name           = FFP_BUFFERING_POLICY_LADDER,
+    .priv_size      = 0,
+    .func_reset     = ladder_reset,
+    .func_update    = NULL,
+    .func_on_filled = ladder_on_filled,
+};
+
+/*
+ * bandwidth: the cache drains by (1 - throughput / byte rate) ms per ms played,
+ * so the time until the next stall is cached / drain, and the cache needed to
+ * get through BANDWIDTH_HORIZON_MS without a stall is BANDWIDTH_HORIZON_MS * drain.
+ * Throughput is the lower of a fast and a slow moving average so a short burst
+ * doesn't hide a poor link, and a short dip isn't forgotten too quickly.
+ */
+
+#define BANDWIDTH_FAST_HALF_LIFE_MS     (2 * 1000)
+#define BANDWIDTH_SLOW_HALF_LIFE_MS     (10 * 1000)
+#define BANDWIDTH_HORIZON_MS            (30 * 1000)
+#define BANDWIDTH_SAFETY_PERCENT        (15)
+
+typedef struct BandwidthPriv {
+    int64_t last_ms;
+    double  fast;
+    double  slow;
+    int     has_throughput;
+    /* whether the last update could predict, the ladder runs otherwise */
+    int     predicting;
+} BandwidthPriv;
+
+static double bandwidth_byte_rate(const FFBufferingSample *sample)
+{
+    if (sample->bit_rate > 0)
+        return sample->bit_rate / 8.0;
+    if (sample->cached_duration_ms > 0 && sample->cached_bytes > 0)
+        return sample->cached_bytes * 1000.0 / sample->cached_duration_ms;
+    return 0;
+}
+
+static double bandwidth_ewma_alpha(int64_t elapsed_ms, int half_life_ms)
+{
+    return 1.0 - pow(0.5, (double)elapsed_ms / half_life_ms);
+}
+
+static void bandwidth_reset(FFBufferingController *ctrl)
+{
+    BandwidthPriv *priv = ctrl->priv;
+
+    // the link is the same after a seek, keep what was learnt about it
+    ladder_reset(ctrl);
+    priv->predicting = 0;
+}
+
+static void bandwidth_update(FFBufferingController *ctrl, const FFBufferingSample *sample)
+{
+    BandwidthPriv *priv = ctrl->priv;
+    int64_t elapsed_ms  = priv->last_ms > 0 ? sample->now_ms - priv->last_ms : 0;
+
+    priv->last_ms = sample->now_ms;
+    // a throttled reader says nothing about the link, an unthrottled one reading nothing says it is down
+    if (!sample->read_throttled && (sample->throughput > 0 || priv->has_throughput)) {
+        if (!priv->has_throughput) {
+            priv->fast = sample->throughput;
+            priv->slow = sample->throughput;
+            priv->has_throughput = 1;
+        } else if (elapsed_ms > 0) {
+            priv->fast += (sample->throughput - priv->fast) * bandwidth_ewma_alpha(elapsed_ms, BANDWIDTH_FAST_HALF_LIFE_MS);
+            priv->slow += (sample->throughput - priv->slow) * bandwidth_ewma_alpha(elapsed_ms, BANDWIDTH_SLOW_HALF_LIFE_MS);
+        }
+    }
+
+    double byte_rate = bandwidth_byte_rate(sample);
+    if (!priv->has_throughput || byte_rate <= 0) {
+        priv->predicting   = 0;
+        ctrl->stall_eta_ms = -1;
+        return;
+    }
+    priv->predicting = 1;
+
+    double throughput = FFMIN(priv->fast, priv->slow);
+    double drain      = 1.0 - throughput * 100 / (byte_rate * (100 + BANDWIDTH_SAFETY_PERCENT));
+    if (drain <= 0) {
+        ctrl->hwm_ms       = ctrl->first_hwm_ms;
+        ctrl->stall_eta_ms = -1;
+        return;
+    }
+
+    int64_t horizon_ms = BANDWIDTH_HORIZON_MS;
+    if (sample->remaining_ms >= 0)
+        horizon_ms = FFMIN(horizon_ms, sample->remaining_ms);
+
+    ctrl->stall_eta_ms = (int64_t)(FFMAX(sample->cached_duration_ms, 0) / drain);
+    ctrl->hwm_ms       = (int)av_clip64((int64_t)(horizon_ms * drain), ctrl->first_hwm_ms, ctrl->last_hwm_ms);
+}
+
+static void bandwidth_on_filled(FFBufferingController *ctrl, const FFBufferingSample *sample)
+{
+    BandwidthPriv *priv = ctrl->priv;
+
+    if (!priv->predicting)
+        ladder_on_filled(ctrl, sample);
+}
+
+static const FFBufferingPolicy g_bandwidth_policy = {
+    .name           = FFP_BUFFERING_POLICY_BANDWIDTH,
+    .priv_size      = sizeof(BandwidthPriv),
+    .func_reset     = bandwidth_reset,
+    .func_update    = bandwidth_update,
+    .func_on_filled = bandwidth_on_filled,
+};
+
+static const FFBufferingPolicy *g_buffering_policies[] = {
+    &g_ladder_policy,
+    &g_bandwidth_policy,
+};
+
+static const FFBufferingPolicy *ffbuffering_find_policy(const char *name)
+{
+    if (name) {
+        for (size_t i = 0; i < sizeof(g_buffering_policies) / sizeof(g_buffering_policies[0]); i++) {
+            if (!strcmp(g_buffering_policies[i]->name, name))
+                return g_buffering_policies[i];
+        }
+        av_log(NULL, AV_LOG_WARNING, "unknown buffering policy %s, using %s\n", name, g_ladder_policy.name);
+    }
+    return &g_ladder_policy;
+}
+
+FFBufferingController *ffbuffering_create(const char *policy_name, int first_hwm_ms, int next_hwm_ms, int last_hwm_ms)
+{
+    FFBufferingController *ctrl = (FFBufferingController *)av_mallocz(sizeof(FFBufferingController));
+    if (!ctrl)
+        return NULL;
+
+    ctrl->policy = ffbuffering_find_policy(policy_name);
+    if (ctrl->policy->priv_size > 0) {
+        ctrl->priv = av_mallocz(ctrl->policy->priv_size);
+        if (!ctrl->priv) {
+            av_free(ctrl);
+            return NULL;
+        }
+    }
+    ctrl->first_hwm_ms = first_hwm_ms;
+    ctrl->next_hwm_ms  = next_hwm_ms;
+    ctrl->last_hwm_ms  = last_hwm_ms;
+    ffbuffering_reset(ctrl);
+    return ctrl;
+}
+
+void ffbuffering_freep(FFBufferingController **ctrl)
+{
+    if (!ctrl || !*ctrl)
+        return;
+
+    av_freep(&(*ctrl)->priv);
+    av_freep(ctrl);
+}
+
+void ffbuffering_reset(FFBufferingController *ctrl)
+{
+    ctrl->policy->func_reset(ctrl);
+}
+
+void ffbuffering_update(FFBufferingController *ctrl, const FFBufferingSample *sample)
+{
+    if (ctrl->policy->func_update)
+        ctrl->policy->func_update(ctrl, sample);
+}
+
+void ffbuffering_on_filled(FFBufferingController *ctrl, const FFBufferingSample *sample)
+{
+    ctrl->policy->func_on_filled(ctrl, sample);
+}
@@ -0,0 +1,92 @@
+/*
+ * ff_ffbuffering.h
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * buffering controller: decides how much media has to be cached before
+ * playback resumes after a stall, startup or seek
+ */
+
+#ifndef FFPLAY__FF_FFBUFFERING_H
+#define FFPLAY__FF_FFBUFFERING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FFP_BUFFERING_POLICY_LADDER     "ladder"
+#define FFP_BUFFERING_POLICY_BANDWIDTH  "bandwidth"
+
+/* how often read_thread calls ffp_check_buffering_l(), fast until the first frame */
+#define BUFFERING_CHECK_PER_MILLISECONDS        (500)
+#define FAST_BUFFERING_CHECK_PER_MILLISECONDS   (50)
+
+/* what ffp_check_buffering_l() sees on every check */
+typedef struct FFBufferingSample {
+    int64_t now_ms;
+    int64_t cached_duration_ms;     // -1 when no stream has a usable time base
+    int64_t cached_bytes;
+    int64_t remaining_ms;           // media left after the cached part, -1 when unknown
+    int64_t throughput;             // network bytes per second, 0 when nothing was read lately or unknown
+    int64_t bit_rate;               // stream bits per second, 0 when unknown
+    int     buffering;              // playback is stalled waiting for data
+    int     read_throttled;         // read_thread stopped reading since its queues are full
+} FFBufferingSample;
+
+typedef struct FFBufferingController FFBufferingController;
+
+typedef struct FFBufferingPolicy {
+    const char *name;
+    size_t      priv_size;
+
+    /* startup and seek, the cache is empty again */
+    void (*func_reset)    (FFBufferingController *ctrl);
+    /* every check, before the cache is compared with hwm_ms; optional */
+    void (*func_update)   (FFBufferingController *ctrl, const FFBufferingSample *sample);
+    /* the cache reached hwm_ms */
+    void (*func_on_filled)(FFBufferingController *ctrl, const FFBufferingSample *sample);
+} FFBufferingPolicy;
+
+struct FFBufferingController {
+    const FFBufferingPolicy *policy;
+    void *priv;
+
+    int first_hwm_ms;
+    int next_hwm_ms;
+    int last_hwm_ms;
+
+    /* cache duration playback waits for */
+    int     hwm_ms;
+    /* predicted time until the cache runs dry, -1 when no stall is expected or known */
+    int64_t stall_eta_ms;
+};
+
+/**
+ * @param policy_name NULL or unknown names fall back to FFP_BUFFERING_POLICY_LADDER
+ */
+FFBufferingController *ffbuffering_create(const char *policy_name, int first_hwm_ms, int next_hwm_ms, int last_hwm_ms);
+void ffbuffering_freep(FFBufferingController **ctrl);
+
+void ffbuffering_reset(FFBufferingController *ctrl);
+void ffbuffering_update(FFBufferingController *ctrl, const FFBufferingSample *sample);
+void ffbuffering_on_filled(FFBufferingController *ctrl, const FFBufferingSample *sample);
+
+#endif
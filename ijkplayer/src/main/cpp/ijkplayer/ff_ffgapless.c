@@ -0,0 +1,269 @@
+/*
+ * ff_ffgapless.c
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "ff_ffgapless.h"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include "libavutil/audio_fifo.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/mem.h"
+#include "libswresample/swresample.h"
+
+/* samples per frame ffcrossfade_drain() hands out */
+#define CROSSFADE_DRAIN_SAMPLES 1024
+
+struct FFCrossfade {
+    AVAudioFifo *tail;          // planar float, NULL while nothing is held
+    int          rate;
+    int          channels;
+    int64_t      layout;
+    int64_t      tail_pts;      // 1/rate, of the first sample in tail
+    int          total;         // samples held when mixing started, 0 before
+    int          mixed;
+
+    SwrContext  *swr;           // from the frames of one source into the format of tail
+    int          swr_format;
+    int          swr_rate;
+    int64_t      swr_layout;
+};
+
+int ffgapless_read_itunsmpb(AVFormatContext *ic, int stream_index, int64_t *delay, int64_t *end)
+{
+    AVStream *st = ic->streams[stream_index];
+    AVDictionaryEntry *t = av_dict_get(st->metadata, "iTunSMPB", NULL, 0);
+    unsigned int zero, priming, padding;
+    unsigned long long samples;
+
+    if (!t)
+        t = av_dict_get(ic->metadata, "iTunSMPB", NULL, 0);
+    if (!t || st->codecpar->codec_type != AVMEDIA_TYPE_AUDIO || st->codecpar->sample_rate <= 0 ||
+        sscanf(t->value, "%x %x %x %llx", &zero, &priming, &padding, &samples) != 4 || !samples)
+        return AVERROR(ENOENT);
+    // an edit list shifts the priming before 0, a LAME header sets the skip itself
+    if ((st->start_time != AV_NOPTS_VALUE && st->start_time < 0) ||
+        st->skip_samples > 0 || st->start_skip_samples > 0 || st->first_discard_sample > 0)
+        return AVERROR(ENOENT);
+
+    *delay = priming;
+    *end   = priming + samples;
+    av_log(NULL, AV_LOG_DEBUG, "iTunSMPB: stream %d delay %u, %llu samples, padding %u\n",
+           stream_index, priming, samples, padding);
+    return 0;
+}
+
+int ffgapless_trim_packet(AVStream *st, AVPacket *pkt, int64_t delay, int64_t end)
+{
+    int rate = st->codecpar->sample_rate;
+    int64_t first, duration, skip, discard;
+    uint8_t *side;
+
+    if (pkt->pts == AV_NOPTS_VALUE || pkt->duration <= 0 || rate <= 0)
+        return 0;
+    first    = av_rescale_q(pkt->pts, st->time_base, (AVRational){1, rate});
+    duration = av_rescale_q(pkt->duration, st->time_base, (AVRational){1, rate});
+    skip     = av_clip64(delay - first, 0, duration);
+    discard  = av_clip64(first + duration - end, 0, duration);
+    if (!skip && !discard)
+        return 0;
+
+    side = av_packet_new_side_data(pkt, AV_PKT_DATA_SKIP_SAMPLES, 10);
+    if (!side)
+        return AVERROR(ENOMEM);
+    AV_WL32(side, (uint32_t)skip);
+    AV_WL32(side + 4, (uint32_t)discard);
+    return 0;
+}
+
+FFCrossfade *ffcrossfade_create(void)
+{
+    return (FFCrossfade *)av_mallocz(sizeof(FFCrossfade));
+}
+
+void ffcrossfade_reset(FFCrossfade *xf)
+{
+    if (!xf)
+        return;
+    av_audio_fifo_free(xf->tail);
+    xf->tail  = NULL;
+    xf->total = 0;
+    xf->mixed = 0;
+    swr_free(&xf->swr);
+}
+
+void ffcrossfade_freep(FFCrossfade **xf)
+{
+    if (!xf || !*xf)
+        return;
+    ffcrossfade_reset(*xf);
+    av_freep(xf);
+}
+
+static int64_t frame_layout(const AVFrame *frame)
+{
+    return frame->channel_layout && av_get_channel_layout_nb_channels(frame->channel_layout) == frame->channels ?
+           frame->channel_layout : av_get_default_channel_layout(frame->channels);
+}
+
+/* frame converted into out, planar float in the format of tail; flush appends what swr still buffers */
+static int crossfade_convert(FFCrossfade *xf, const AVFrame *frame, AVFrame *out, int flush)
+{
+    int64_t layout = frame_layout(frame);
+    int max, ret, n;
+
+    if (!xf->swr || xf->swr_format != frame->format || xf->swr_rate != frame->sample_rate || xf->swr_layout != layout) {
+        swr_free(&xf->swr);
+        xf->swr = swr_alloc_set_opts(NULL, xf->layout, AV_SAMPLE_FMT_FLTP, xf->rate,
+                                     layout, frame->format, frame->sample_rate, 0, NULL);
+        if (!xf->swr || (ret = swr_init(xf->swr)) < 0) {
+            swr_free(&xf->swr);
+            return AVERROR(EINVAL);
+        }
+        xf->swr_format = frame->format;
+        xf->swr_rate   = frame->sample_rate;
+        xf->swr_layout = layout;
+    }
+
+    max = swr_get_out_samples(xf->swr, frame->nb_samples) + (flush ? 256 : 0);
+    out->format         = AV_SAMPLE_FMT_FLTP;
+    out->sample_rate    = xf->rate;
+    out->channels       = xf->channels;
+    out->channel_layout = xf->layout;
+    out->nb_samples     = max;
+    if ((ret = av_frame_get_buffer(out, 0)) < 0)
+        return ret;
+    ret = swr_convert(xf->swr, out->extended_data, max, (const uint8_t **)frame->extended_data, frame->nb_samples);
+    if (ret < 0)
+        return ret;
+    n = ret;
+    if (flush) {
+        uint8_t *planes[AV_NUM_DATA_POINTERS];
+        for (int ch = 0; ch < xf->channels && ch < AV_NUM_DATA_POINTERS; ch++)
+            planes[ch] = out->extended_data[ch] + n * sizeof(float);
+        ret = swr_convert(xf->swr, planes, max - n, NULL, 0);
+        if (ret > 0)
+            n += ret;
+    }
+    out->nb_samples = n;
+    return 0;
+}
+
+int ffcrossfade_hold(FFCrossfade *xf, const AVFrame *frame)
+{
+    AVFrame *out;
+    int ret;
+
+    if (!xf->tail) {
+        xf->rate     = frame->sample_rate;
+        xf->channels = frame->channels;
+        xf->layout   = frame_layout(frame);
+        xf->tail_pts = frame->pts;
+        xf->tail     = av_audio_fifo_alloc(AV_SAMPLE_FMT_FLTP, xf->channels, frame->nb_samples);
+        if (!xf->tail)
+            return AVERROR(ENOMEM);
+    }
+    if (!(out = av_frame_alloc()))
+        return AVERROR(ENOMEM);
+    ret = crossfade_convert(xf, frame, out, 0);
+    if (ret >= 0 && av_audio_fifo_write(xf->tail, (void **)out->extended_data, out->nb_samples) < out->nb_samples)
+        ret = AVERROR(ENOMEM);
+    av_frame_free(&out);
+    return ret;
+}
+
+int ffcrossfade_mix(FFCrossfade *xf, AVFrame *frame)
+{
+    AVFrame *out, *tail;
+    int n, ret;
+
+    if (!xf->tail || av_audio_fifo_size(xf->tail) <= 0)
+        return 0;
+    if (!xf->total)
+        xf->total = av_audio_fifo_size(xf->tail);
+
+    out  = av_frame_alloc();
+    tail = av_frame_alloc();
+    if (!out || !tail) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    // the held samples this frame covers, the last mixed frame takes what swr still has
+    ret = crossfade_convert(xf, frame, out, av_rescale(frame->nb_samples, xf->rate, frame->sample_rate) >=
+                                            av_audio_fifo_size(xf->tail));
+    if (ret < 0)
+        goto end;
+    n = FFMIN(out->nb_samples, av_audio_fifo_size(xf->tail));
+    tail->format         = AV_SAMPLE_FMT_FLTP;
+    tail->channels       = xf->channels;
+    tail->channel_layout = xf->layout;
+    tail->nb_samples     = FFMAX(n, 1);
+    if ((ret = av_frame_get_buffer(tail, 0)) < 0)
+        goto end;
+    if (av_audio_fifo_read(xf->tail, (void **)tail->extended_data, n) < n) {
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+
+    for (int ch = 0; ch < xf->channels; ch++) {
+        float *dst = (float *)out->extended_data[ch];
+        const float *src = (const float *)tail->extended_data[ch];
+        for (int i = 0; i < n; i++) {
+            double t = (xf->mixed + i + 0.5) / xf->total;
+            dst[i] = (float)(src[i] * cos(t * M_PI_2) + dst[i] * sin(t * M_PI_2));
+        }
+    }
+    xf->mixed    += n;
+    xf->tail_pts += n;
+
+    out->pts     = frame->pts == AV_NOPTS_VALUE ? AV_NOPTS_VALUE : av_rescale(frame->pts, xf->rate, frame->sample_rate);
+    out->pkt_pos = frame->pkt_pos;
+    av_frame_unref(frame);
+    av_frame_move_ref(frame, out);
+    ret = av_audio_fifo_size(xf->tail) > 0;
+end:
+    av_frame_free(&out);
+    av_frame_free(&tail);
+    return ret;
+}
+
+int ffcrossfade_drain(FFCrossfade *xf, AVFrame *frame)
+{
+    int n = xf->tail ? FFMIN(av_audio_fifo_size(xf->tail), CROSSFADE_DRAIN_SAMPLES) : 0;
+    int ret;
+
+    if (n <= 0)
+        return 0;
+    frame->format         = AV_SAMPLE_FMT_FLTP;
+    frame->sample_rate    = xf->rate;
+    frame->channels       = xf->channels;
+    frame->channel_layout = xf->layout;
+    frame->nb_samples     = n;
+    if ((ret = av_frame_get_buffer(frame, 0)) < 0)
+        return ret;
+    if (av_audio_fifo_read(xf->tail, (void **)frame->extended_data, n) < n)
+        return AVERROR(EINVAL);
+    frame->pts    = xf->tail_pts;
+    xf->tail_pts += n;
+    return 1;
+}
@@ -0,0 +1,78 @@
+/*
+ * ff_ffgapless.h
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * gapless audio: the encoder delay and padding an iTunSMPB tag declares, and
+ * the crossfade of the end of one source into the start of the next one
+ */
+
+#ifndef FFPLAY__FF_FFGAPLESS_H
+#define FFPLAY__FF_FFGAPLESS_H
+
+#include "libavformat/avformat.h"
+#include "libavutil/frame.h"
+
+/**
+ * The encoder delay and padding of an audio stream from the iTunSMPB tag of
+ * iTunes encoded files. LAME/Xing headers and edit lists are handled by the
+ * demuxers already, a stream they set up gets no values here.
+ * @param delay receives the samples before the audio starts
+ * @param end   receives the first sample of the padding after it
+ * @return 0 when found, AVERROR(ENOENT) without a usable tag
+ */
+int ffgapless_read_itunsmpb(AVFormatContext *ic, int stream_index, int64_t *delay, int64_t *end);
+
+/**
+ * Mark the samples of pkt outside [delay, end) for the decoder to skip, pkt
+ * still in the time base of st.
+ */
+int ffgapless_trim_packet(AVStream *st, AVPacket *pkt, int64_t delay, int64_t end);
+
+typedef struct FFCrossfade FFCrossfade;
+
+FFCrossfade *ffcrossfade_create(void);
+void         ffcrossfade_freep(FFCrossfade **xf);
+/* drops what is held */
+void         ffcrossfade_reset(FFCrossfade *xf);
+
+/**
+ * Hold a decoded frame of the source ending, its pts in 1/sample_rate.
+ * The held frames are kept as planar float in the format of the first one.
+ */
+int          ffcrossfade_hold(FFCrossfade *xf, const AVFrame *frame);
+
+/**
+ * Mix a decoded frame of the next source into the held end, with an equal
+ * power curve. frame is replaced by the mix, in the format of the held frames
+ * with its pts rescaled accordingly.
+ * @return 1 while held samples are left, 0 once the crossfade is complete
+ */
+int          ffcrossfade_mix(FFCrossfade *xf, AVFrame *frame);
+
+/**
+ * The held frames unmixed, when the next source did not come.
+ * @return 1 for a frame, 0 once nothing is held anymore
+ */
+int          ffcrossfade_drain(FFCrossfade *xf, AVFrame *frame);
+
+#endif
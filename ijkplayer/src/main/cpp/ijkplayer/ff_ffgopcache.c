@@ -0,0 +1,514 @@
+/*
+ * ff_ffgopcache.c
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "ff_ffgopcache.h"
+#include <errno.h>
+#include <string.h>
+#include "libavcodec/avcodec.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "../ijksdl/ijksdl_mutex.h"
+#include "../ijksdl/ijksdl_thread.h"
+
+/* unused frames kept for the next GOP instead of being freed */
+#define GOPCACHE_MAX_POOLED_FRAMES  32
+/* how far before the target the first retry seeks when a seek lands after it */
+#define GOPCACHE_SEEK_BACK_STEP     (AV_TIME_BASE / 2)
+
+/* the decoded frames of one GOP, or of its tail when the GOP didn't fit */
+typedef struct GopSegment {
+    AVFrame **frames;       // by pts
+    int64_t  *pts;          // AV_TIME_BASE
+    int       nb_frames;
+    int       capacity;
+    int64_t   bytes;
+    /* every frame with lo <= pts < hi is here */
+    int64_t   lo;
+    int64_t   hi;
+} GopSegment;
+
+struct FFGopCache {
+    SDL_mutex       *mutex;
+    SDL_cond        *cond;
+    SDL_Thread      *tid;
+    SDL_Thread       _tid;
+    volatile int     abort;
+
+    char            *url;
+    AVInputFormat   *iformat;
+    AVDictionary    *format_opts;
+    int              stream_index;
+    int64_t          segment_max_bytes;
+
+    /* worker side */
+    AVFormatContext *ic;
+    AVCodecContext  *avctx;
+    AVPacket        *pkt;
+    AVFrame        **pool;
+    int              nb_pool;
+
+    /* protected by mutex */
+    GopSegment       segments[FFGOPCACHE_SEGMENTS];
+    int64_t          job_hi;        // GOP to decode next: the one ending before job_hi
+    int64_t          busy_hi;       // GOP being decoded
+    int64_t          last_req;
+    int64_t          start_pts;     // nothing comes before it
+    int              error;
+};
+
+static int64_t frame_bytes(const AVFrame *frame)
+{
+    int64_t bytes = 0;
+
+    for (int i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i]; i++)
+        bytes += frame->buf[i]->size;
+    return bytes;
+}
+
+static AVFrame *gopcache_frame_get(FFGopCache *cache)
+{
+    if (cache->nb_pool > 0)
+        return cache->pool[--cache->nb_pool];
+    return av_frame_alloc();
+}
+
+/* the buffers go back to the decoder's pool with the unref */
+static void gopcache_frame_put(FFGopCache *cache, AVFrame *frame)
+{
+    if (!frame)
+        return;
+    av_frame_unref(frame);
+    if (cache->nb_pool < GOPCACHE_MAX_POOLED_FRAMES)
+        cache->pool[cache->nb_pool++] = frame;
+    else
+        av_frame_free(&frame);
+}
+
+static void segment_drop_front(FFGopCache *cache, GopSegment *seg)
+{
+    seg->bytes -= frame_bytes(seg->frames[0]);
+    gopcache_frame_put(cache, seg->frames[0]);
+    memmove(seg->frames, seg->frames + 1, (seg->nb_frames - 1) * sizeof(*seg->frames));
+    memmove(seg->pts, seg->pts + 1, (seg->nb_frames - 1) * sizeof(*seg->pts));
+    seg->nb_frames--;
+}
+
+static void segment_clear(FFGopCache *cache, GopSegment *seg)
+{
+    for (int i = 0; i < seg->nb_frames; i++)
+        gopcache_frame_put(cache, seg->frames[i]);
+    av_freep(&seg->frames);
+    av_freep(&seg->pts);
+    memset(seg, 0, sizeof(*seg));
+}
+
+/* takes over frame; the lowest frames go once the segment is over its budget */
+static int segment_add(FFGopCache *cache, GopSegment *seg, AVFrame *frame, int64_t pts)
+{
+    int i;
+
+    if (seg->nb_frames == seg->capacity) {
+        int capacity = seg->capacity ? seg->capacity * 2 : 32;
+        AVFrame **frames = av_realloc_array(seg->frames, capacity, sizeof(*frames));
+        if (!frames)
+            goto fail;
+        seg->frames = frames;
+        int64_t *ptss = av_realloc_array(seg->pts, capacity, sizeof(*ptss));
+        if (!ptss)
+            goto fail;
+        seg->pts = ptss;
+        seg->capacity = capacity;
+    }
+
+    // decoders output in pts order, except around broken streams
+    for (i = seg->nb_frames; i > 0 && seg->pts[i - 1] > pts; i--) {
+        seg->frames[i] = seg->frames[i - 1];
+        seg->pts[i]    = seg->pts[i - 1];
+    }
+    seg->frames[i] = frame;
+    seg->pts[i]    = pts;
+    seg->nb_frames++;
+    seg->bytes += frame_bytes(frame);
+
+    while (seg->nb_frames > 1 && seg->bytes > cache->segment_max_bytes)
+        segment_drop_front(cache, seg);
+    return 0;
+fail:
+    gopcache_frame_put(cache, frame);
+    return AVERROR(ENOMEM);
+}
+
+static int gopcache_interrupt_cb(void *opaque)
+{
+    FFGopCache *cache = opaque;
+    return cache->abort;
+}
+
+static int gopcache_open_input(FFGopCache *cache)
+{
+    const AVCodec *codec;
+    AVStream *st;
+    int ret;
+
+    cache->ic = avformat_alloc_context();
+    if (!cache->ic)
+        return AVERROR(ENOMEM);
+    cache->ic->interrupt_callback.callback = gopcache_interrupt_cb;
+    cache->ic->interrupt_callback.opaque   = cache;
+    ret = avformat_open_input(&cache->ic, cache->url, cache->iformat, &cache->format_opts);
+    if (ret < 0)
+        return ret;
+    ret = avformat_find_stream_info(cache->ic, NULL);
+    if (ret < 0)
+        return ret;
+    if (cache->stream_index < 0 || cache->stream_index >= (int)cache->ic->nb_streams)
+        return AVERROR_STREAM_NOT_FOUND;
+    for (unsigned int i = 0; i < cache->ic->nb_streams; i++)
+        cache->ic->streams[i]->discard = (int)i == cache->stream_index ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+
+    st = cache->ic->streams[cache->stream_index];
+    codec = avcodec_find_decoder(st->codecpar->codec_id);
+    if (!codec)
+        return AVERROR_DECODER_NOT_FOUND;
+    cache->avctx = avcodec_alloc_context3(codec);
+    if (!cache->avctx)
+        return AVERROR(ENOMEM);
+    ret = avcodec_parameters_to_context(cache->avctx, st->codecpar);
+    if (ret < 0)
+        return ret;
+    cache->avctx->pkt_timebase = st->time_base;
+    ret = avcodec_open2(cache->avctx, codec, NULL);
+    if (ret < 0)
+        return ret;
+
+    cache->pkt  = av_packet_alloc();
+    cache->pool = av_malloc_array(GOPCACHE_MAX_POOLED_FRAMES, sizeof(*cache->pool));
+    if (!cache->pkt || !cache->pool)
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
+static int gopcache_receive_frames(FFGopCache *cache, GopSegment *seg, int64_t kf_pts, int64_t hi)
+{
+    AVStream *st = cache->ic->streams[cache->stream_index];
+    int ret;
+
+    for (;;) {
+        AVFrame *frame = gopcache_frame_get(cache);
+        if (!frame)
+            return AVERROR(ENOMEM);
+        ret = avcodec_receive_frame(cache->avctx, frame);
+        if (ret < 0) {
+            gopcache_frame_put(cache, frame);
+            return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+        }
+
+        int64_t ts = frame->best_effort_timestamp;
+        int64_t pts = ts == AV_NOPTS_VALUE ? AV_NOPTS_VALUE : av_rescale_q(ts, st->time_base, AV_TIME_BASE_Q);
+        // leading frames of an open GOP belong to the one before
+        if (pts == AV_NOPTS_VALUE || pts >= hi || (kf_pts != AV_NOPTS_VALUE && pts < kf_pts)) {
+            gopcache_frame_put(cache, frame);
+            continue;
+        }
+        if ((ret = segment_add(cache, seg, frame, pts)) < 0)
+            return ret;
+    }
+}
+
+/* decode from the keyframe the demuxer is at up to hi */
+static int gopcache_decode_range(FFGopCache *cache, GopSegment *seg, int64_t hi)
+{
+    AVStream *st   = cache->ic->streams[cache->stream_index];
+    AVPacket *pkt  = cache->pkt;
+    int64_t kf_pts = AV_NOPTS_VALUE;
+    int started    = 0;
+    int ret        = 0;
+
+    avcodec_flush_buffers(cache->avctx);
+    while (!cache->abort) {
+        ret = av_read_frame(cache->ic, pkt);
+        if (ret < 0)
+            break;
+        if (pkt->stream_index != cache->stream_index || (!started && !(pkt->flags & AV_PKT_FLAG_KEY))) {
+            av_packet_unref(pkt);
+            continue;
+        }
+
+        int64_t ts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+        // no frame before hi decodes after a packet past it
+        if (ts != AV_NOPTS_VALUE && av_rescale_q(ts, st->time_base, AV_TIME_BASE_Q) >= hi) {
+            av_packet_unref(pkt);
+            break;
+        }
+        if (!started) {
+            started = 1;
+            if (pkt->pts != AV_NOPTS_VALUE)
+                kf_pts = av_rescale_q(pkt->pts, st->time_base, AV_TIME_BASE_Q);
+        }
+
+        ret = avcodec_send_packet(cache->avctx, pkt);
+        if (ret == AVERROR(EAGAIN)) {
+            if ((ret = gopcache_receive_frames(cache, seg, kf_pts, hi)) >= 0)
+                ret = avcodec_send_packet(cache->avctx, pkt);
+        }
+        av_packet_unref(pkt);
+        // a broken packet costs a frame, not the GOP
+        if (ret < 0 && ret != AVERROR_INVALIDDATA)
+            return ret;
+        if ((ret = gopcache_receive_frames(cache, seg, kf_pts, hi)) < 0)
+            return ret;
+    }
+    if (cache->abort)
+        return AVERROR_EXIT;
+    if (ret < 0 && ret != AVERROR_EOF)
+        return ret;
+
+    avcodec_send_packet(cache->avctx, NULL);
+    ret = gopcache_receive_frames(cache, seg, kf_pts, hi);
+    avcodec_flush_buffers(cache->avctx);
+    if (ret < 0)
+        return ret;
+
+    if (seg->nb_frames > 0) {
+        seg->lo = seg->pts[0];
+        seg->hi = hi;
+    }
+    return 0;
+}
+
+/* decode the GOP holding the frame before hi */
+static int gopcache_decode(FFGopCache *cache, GopSegment *seg, int64_t hi)
+{
+    AVStream *st = cache->ic->streams[cache->stream_index];
+    int64_t start_time = cache->ic->start_time != AV_NOPTS_VALUE ? cache->ic->start_time : 0;
+    int64_t step = 0;
+    int ret;
+
+    for (;;) {
+        int64_t target = FFMAX(hi - 1 - step, start_time);
+        int64_t ts = av_rescale_q(target, AV_TIME_BASE_Q, st->time_base);
+
+        ret = avformat_seek_file(cache->ic, cache->stream_index, INT64_MIN, ts, ts, 0);
+        if (ret < 0)
+            return ret;
+        if ((ret = gopcache_decode_range(cache, seg, hi)) < 0)
+            return ret;
+        if (seg->nb_frames > 0)
+            return 0;
+        // the seek landed after the target, or at the start with nothing before hi
+        if (target <= start_time)
+            return AVERROR_EOF;
+        step = step ? step * 2 : GOPCACHE_SEEK_BACK_STEP;
+    }
+}
+
+static GopSegment *gopcache_find_l(FFGopCache *cache, int64_t pts_us)
+{
+    for (int i = 0; i < FFGOPCACHE_SEGMENTS; i++) {
+        GopSegment *seg = &cache->segments[i];
+        if (seg->nb_frames > 0 && seg->lo < pts_us && pts_us <= seg->hi)
+            return seg;
+    }
+    return NULL;
+}
+
+static int gopcache_has_hi_l(FFGopCache *cache, int64_t hi)
+{
+    for (int i = 0; i < FFGOPCACHE_SEGMENTS; i++) {
+        if (cache->segments[i].nb_frames > 0 && cache->segments[i].hi == hi)
+            return 1;
+    }
+    return cache->busy_hi == hi || cache->job_hi == hi;
+}
+
+/* the free slot, or the one farthest from what was asked for last */
+static GopSegment *gopcache_victim_l(FFGopCache *cache)
+{
+    GopSegment *victim = NULL;
+    int64_t victim_distance = -1;
+
+    for (int i = 0; i < FFGOPCACHE_SEGMENTS; i++) {
+        GopSegment *seg = &cache->segments[i];
+        int64_t distance;
+        if (seg->nb_frames == 0)
+            return seg;
+        distance = cache->last_req < seg->lo ? seg->lo - cache->last_req :
+                   cache->last_req > seg->hi ? cache->last_req - seg->hi : 0;
+        if (distance > victim_distance) {
+            victim = seg;
+            victim_distance = distance;
+        }
+    }
+    return victim;
+}
+
+static int gopcache_thread(void *arg)
+{
+    FFGopCache *cache = arg;
+    int ret;
+
+    SDL_LockMutex(cache->mutex);
+    for (;;) {
+        while (!cache->abort && cache->job_hi == AV_NOPTS_VALUE)
+            SDL_CondWait(cache->cond, cache->mutex);
+        if (cache->abort)
+            break;
+        int64_t hi = cache->job_hi;
+        cache->job_hi  = AV_NOPTS_VALUE;
+        cache->busy_hi = hi;
+        SDL_UnlockMutex(cache->mutex);
+
+        GopSegment seg;
+        memset(&seg, 0, sizeof(seg));
+        ret = cache->ic ? 0 : gopcache_open_input(cache);
+        if (ret >= 0)
+            ret = gopcache_decode(cache, &seg, hi);
+
+        SDL_LockMutex(cache->mutex);
+        cache->busy_hi = AV_NOPTS_VALUE;
+        if (ret >= 0) {
+            GopSegment *victim = gopcache_victim_l(cache);
+            segment_clear(cache, victim);
+            *victim = seg;
+            av_log(NULL, AV_LOG_DEBUG, "gopcache: %d frames [%"PRId64", %"PRId64")\n", seg.nb_frames, seg.lo, seg.hi);
+        } else {
+            segment_clear(cache, &seg);
+            if (ret == AVERROR_EOF)
+                cache->start_pts = FFMAX(cache->start_pts, hi);
+            else if (ret != AVERROR_EXIT)
+                cache->error = ret;
+        }
+        SDL_CondBroadcast(cache->cond);
+    }
+    SDL_UnlockMutex(cache->mutex);
+    return 0;
+}
+
+FFGopCache *ffgopcache_open(const char *url, AVInputFormat *iformat, AVDictionary *format_opts,
+                            int stream_index, int64_t max_bytes)
+{
+    FFGopCache *cache = (FFGopCache *)av_mallocz(sizeof(FFGopCache));
+    if (!cache)
+        return NULL;
+
+    cache->url               = av_strdup(url);
+    cache->iformat           = iformat;
+    cache->stream_index      = stream_index;
+    cache->segment_max_bytes = max_bytes / FFGOPCACHE_SEGMENTS;
+    cache->job_hi            = AV_NOPTS_VALUE;
+    cache->busy_hi           = AV_NOPTS_VALUE;
+    cache->last_req          = AV_NOPTS_VALUE;
+    cache->start_pts         = INT64_MIN;
+    av_dict_copy(&cache->format_opts, format_opts, 0);
+    cache->mutex = SDL_CreateMutex();
+    cache->cond  = SDL_CreateCond();
+    if (!cache->url || !cache->mutex || !cache->cond)
+        goto fail;
+    cache->tid = SDL_CreateThreadEx(&cache->_tid, gopcache_thread, cache, "ff_gopcache");
+    if (!cache->tid)
+        goto fail;
+    return cache;
+fail:
+    ffgopcache_closep(&cache);
+    return NULL;
+}
+
+void ffgopcache_abort(FFGopCache *cache)
+{
+    if (!cache)
+        return;
+    SDL_LockMutex(cache->mutex);
+    cache->abort = 1;
+    SDL_CondBroadcast(cache->cond);
+    SDL_UnlockMutex(cache->mutex);
+}
+
+void ffgopcache_closep(FFGopCache **pcache)
+{
+    FFGopCache *cache = pcache ? *pcache : NULL;
+    if (!cache)
+        return;
+
+    if (cache->tid) {
+        ffgopcache_abort(cache);
+        SDL_WaitThread(cache->tid, NULL);
+        cache->tid = NULL;
+    }
+    for (int i = 0; i < FFGOPCACHE_SEGMENTS; i++)
+        segment_clear(cache, &cache->segments[i]);
+    for (int i = 0; i < cache->nb_pool; i++)
+        av_frame_free(&cache->pool[i]);
+    av_freep(&cache->pool);
+    av_packet_free(&cache->pkt);
+    avcodec_free_context(&cache->avctx);
+    avformat_close_input(&cache->ic);
+    av_dict_free(&cache->format_opts);
+    av_freep(&cache->url);
+    SDL_DestroyCond(cache->cond);
+    SDL_DestroyMutex(cache->mutex);
+    av_freep(pcache);
+}
+
+int ffgopcache_get_prev(FFGopCache *cache, int64_t pts_us, AVFrame *frame, int64_t *frame_pts_us)
+{
+    GopSegment *seg;
+    int ret;
+
+    SDL_LockMutex(cache->mutex);
+    cache->last_req = pts_us;
+    for (;;) {
+        if (cache->abort) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+        if ((seg = gopcache_find_l(cache, pts_us))) {
+            int i = seg->nb_frames - 1;
+            while (i > 0 && seg->pts[i] >= pts_us)
+                i--;
+            ret = av_frame_ref(frame, seg->frames[i]);
+            if (frame_pts_us)
+                *frame_pts_us = seg->pts[i];
+            // the GOP before is decoded while this one is presented
+            if (seg->lo > cache->start_pts && !gopcache_has_hi_l(cache, seg->lo)) {
+                cache->job_hi = seg->lo;
+                SDL_CondBroadcast(cache->cond);
+            }
+            break;
+        }
+        if (pts_us <= cache->start_pts) {
+            ret = AVERROR_EOF;
+            break;
+        }
+        if (cache->error) {
+            ret = cache->error;
+            cache->error = 0;
+            break;
+        }
+        if (cache->busy_hi != pts_us && cache->job_hi != pts_us) {
+            cache->job_hi = pts_us;
+            SDL_CondBroadcast(cache->cond);
+        }
+        SDL_CondWait(cache->cond, cache->mutex);
+    }
+    SDL_UnlockMutex(cache->mutex);
+    return ret;
+}
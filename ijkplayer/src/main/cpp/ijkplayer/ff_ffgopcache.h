@@ -0,0 +1,64 @@
+/*
+ * ff_ffgopcache.h
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * decoded GOP cache for backward stepping and reverse playback: the GOP
+ * before a position is decoded on a second demuxer/decoder pair into a
+ * bounded set of frames, and the GOP before that one is prefetched while
+ * the frames are presented
+ */
+
+#ifndef FFPLAY__FF_FFGOPCACHE_H
+#define FFPLAY__FF_FFGOPCACHE_H
+
+#include <stdint.h>
+#include "libavformat/avformat.h"
+#include "libavutil/frame.h"
+
+/* decoded GOPs kept at once, the one being presented and the prefetched one */
+#define FFGOPCACHE_SEGMENTS     2
+
+typedef struct FFGopCache FFGopCache;
+
+/**
+ * @param format_opts  copied, the caller keeps ownership
+ * @param stream_index video stream of url to decode
+ * @param max_bytes    memory for decoded frames, shared by the FFGOPCACHE_SEGMENTS GOPs
+ * @return the cache, its worker opens url on the first request
+ */
+FFGopCache *ffgopcache_open(const char *url, AVInputFormat *iformat, AVDictionary *format_opts,
+                            int stream_index, int64_t max_bytes);
+void ffgopcache_closep(FFGopCache **cache);
+
+/* makes a blocked ffgopcache_get_prev() return AVERROR_EXIT, for good */
+void ffgopcache_abort(FFGopCache *cache);
+
+/**
+ * Get the frame shown before pts_us, decoding its GOP when it isn't cached yet.
+ * @param frame        receives a reference
+ * @param frame_pts_us pts of the frame in AV_TIME_BASE
+ * @return 0, AVERROR_EOF when nothing comes before pts_us, another negative AVERROR on failure
+ */
+int  ffgopcache_get_prev(FFGopCache *cache, int64_t pts_us, AVFrame *frame, int64_t *frame_pts_us);
+
+#endif
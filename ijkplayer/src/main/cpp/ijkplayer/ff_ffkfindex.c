@@ -0,0 +1,378 @@
+/*
+ * ff_ffkfindex.c
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "ff_ffkfindex.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
+#include "../ijksdl/ijksdl_mutex.h"
+#include "../ijksdl/ijksdl_thread.h"
+
+#define KFINDEX_MAGIC               "IJKKFIDX"
+#define KFINDEX_VERSION             1
+#define KFINDEX_SUFFIX              ".kfindex"
+#define KFINDEX_MAX_ENTRIES         (1 << 20)
+
+/* no keyframe exists between the previous entry and this one */
+#define KFINDEX_ENTRY_CONTIGUOUS    0x1
+/* every keyframe of the file is in the index */
+#define KFINDEX_COMPLETE            0x1
+
+typedef struct FFKeyframeEntry {
+    int64_t pts_us;
+    int64_t pos;
+    int32_t flags;
+    int32_t reserved;
+} FFKeyframeEntry;
+
+typedef struct FFKeyframeIndexHeader {
+    char    magic[8];
+    int32_t version;
+    int32_t flags;
+    int64_t file_size;
+    int32_t nb_entries;
+    int32_t reserved;
+} FFKeyframeIndexHeader;
+
+struct FFKeyframeIndex {
+    SDL_mutex       *mutex;
+    FFKeyframeEntry *entries;
+    int              nb_entries;
+    int              capacity;
+    int              complete;
+    int              dirty;
+
+    char            *path;
+    int64_t          file_size;
+
+    SDL_Thread      *prepass_tid;
+    SDL_Thread       _prepass_tid;
+    volatile int     prepass_abort;
+    char            *prepass_url;
+    AVInputFormat   *prepass_iformat;
+    AVDictionary    *prepass_opts;
+};
+
+static char *kfindex_path(const char *dir, const char *url)
+{
+    // FNV-1a, the file size stored in the header tells apart files reusing a url
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char *p = (const unsigned char *)url; *p; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+    }
+    return av_asprintf("%s/%016llx%s", dir, (unsigned long long)hash, KFINDEX_SUFFIX);
+}
+
+static int kfindex_load(FFKeyframeIndex *index)
+{
+    FFKeyframeIndexHeader header;
+    FILE *fp = fopen(index->path, "rb");
+    if (!fp)
+        return AVERROR(ENOENT);
+
+    int ret = AVERROR_INVALIDDATA;
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        memcmp(header.magic, KFINDEX_MAGIC, sizeof(header.magic)) ||
+        header.version != KFINDEX_VERSION ||
+        header.file_size != index->file_size ||
+        header.nb_entries <= 0 || header.nb_entries > KFINDEX_MAX_ENTRIES)
+        goto end;
+
+    index->entries = av_malloc_array(header.nb_entries, sizeof(FFKeyframeEntry));
+    if (!index->entries) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if (fread(index->entries, sizeof(FFKeyframeEntry), header.nb_entries, fp) != (size_t)header.nb_entries) {
+        av_freep(&index->entries);
+        goto end;
+    }
+    for (int i = 1; i < header.nb_entries; i++) {
+        if (index->entries[i].pts_us <= index->entries[i - 1].pts_us) {
+            av_freep(&index->entries);
+            goto end;
+        }
+    }
+    index->nb_entries = header.nb_entries;
+    index->capacity   = header.nb_entries;
+    index->complete   = !!(header.flags & KFINDEX_COMPLETE);
+    ret = 0;
+end:
+    fclose(fp);
+    if (ret == AVERROR_INVALIDDATA)
+        av_log(NULL, AV_LOG_WARNING, "kfindex: ignore stale or broken %s\n", index->path);
+    return ret;
+}
+
+static int kfindex_save_l(FFKeyframeIndex *index)
+{
+    if (!index->path || !index->dirty || index->nb_entries <= 0)
+        return 0;
+
+    char *tmp_path = av_asprintf("%s.tmp", index->path);
+    if (!tmp_path)
+        return AVERROR(ENOMEM);
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp) {
+        av_free(tmp_path);
+        return AVERROR(errno);
+    }
+
+    FFKeyframeIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, KFINDEX_MAGIC, sizeof(header.magic));
+    header.version    = KFINDEX_VERSION;
+    header.flags      = index->complete ? KFINDEX_COMPLETE : 0;
+    header.file_size  = index->file_size;
+    header.nb_entries = index->nb_entries;
+
+    int ok = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+             fwrite(index->entries, sizeof(FFKeyframeEntry), index->nb_entries, fp) == (size_t)index->nb_entries;
+    ok = (fclose(fp) == 0) && ok;
+    // write aside and rename, a crash never leaves a torn index behind
+    if (!ok || rename(tmp_path, index->path) != 0) {
+        remove(tmp_path);
+        av_free(tmp_path);
+        return AVERROR(EIO);
+    }
+    av_free(tmp_path);
+    index->dirty = 0;
+    return 0;
+}
+
+FFKeyframeIndex *ffkfindex_open(const char *dir, const char *url, int64_t file_size)
+{
+    FFKeyframeIndex *index = (FFKeyframeIndex *)av_mallocz(sizeof(FFKeyframeIndex));
+    if (!index)
+        return NULL;
+
+    index->mutex = SDL_CreateMutex();
+    if (!index->mutex) {
+        av_free(index);
+        return NULL;
+    }
+    index->file_size = file_size;
+    if (dir && strlen(dir) > 0 && url && file_size > 0) {
+        index->path = kfindex_path(dir, url);
+        if (index->path && kfindex_load(index) == 0)
+            av_log(NULL, AV_LOG_INFO, "kfindex: %d keyframes from %s%s\n", index->nb_entries, index->path,
+                   index->complete ? ", complete" : "");
+    }
+    return index;
+}
+
+void ffkfindex_closep(FFKeyframeIndex **pindex)
+{
+    if (!pindex || !*pindex)
+        return;
+
+    FFKeyframeIndex *index = *pindex;
+    if (index->prepass_tid) {
+        index->prepass_abort = 1;
+        SDL_WaitThread(index->prepass_tid, NULL);
+        index->prepass_tid = NULL;
+    }
+    SDL_LockMutex(index->mutex);
+    kfindex_save_l(index);
+    SDL_UnlockMutex(index->mutex);
+
+    av_freep(&index->prepass_url);
+    av_dict_free(&index->prepass_opts);
+    av_freep(&index->entries);
+    av_freep(&index->path);
+    SDL_DestroyMutexP(&index->mutex);
+    av_freep(pindex);
+}
+
+/* first entry with pts_us >= pts_us */
+static int kfindex_lower_bound_l(FFKeyframeIndex *index, int64_t pts_us)
+{
+    int lo = 0;
+    int hi = index->nb_entries;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (index->entries[mid].pts_us < pts_us)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+void ffkfindex_add(FFKeyframeIndex *index, int64_t pts_us, int64_t pos, int contiguous)
+{
+    if (!index || pts_us == AV_NOPTS_VALUE || pos < 0)
+        return;
+
+    SDL_LockMutex(index->mutex);
+    int i = kfindex_lower_bound_l(index, pts_us);
+    if (i < index->nb_entries && index->entries[i].pts_us == pts_us) {
+        if (contiguous && !(index->entries[i].flags & KFINDEX_ENTRY_CONTIGUOUS)) {
+            index->entries[i].flags |= KFINDEX_ENTRY_CONTIGUOUS;
+            index->dirty = 1;
+        }
+        goto end;
+    }
+    if (index->complete || index->nb_entries >= KFINDEX_MAX_ENTRIES)
+        goto end;
+
+    if (index->nb_entries == index->capacity) {
+        int capacity = index->capacity ? index->capacity * 2 : 256;
+        FFKeyframeEntry *entries = av_realloc_array(index->entries, capacity, sizeof(FFKeyframeEntry));
+        if (!entries)
+            goto end;
+        index->entries  = entries;
+        index->capacity = capacity;
+    }
+    memmove(&index->entries[i + 1], &index->entries[i], (index->nb_entries - i) * sizeof(FFKeyframeEntry));
+    index->entries[i].pts_us   = pts_us;
+    index->entries[i].pos      = pos;
+    index->entries[i].flags    = contiguous ? KFINDEX_ENTRY_CONTIGUOUS : 0;
+    index->entries[i].reserved = 0;
+    index->nb_entries++;
+    // a keyframe between two entries proves they weren't neighbours
+    if (i + 1 < index->nb_entries)
+        index->entries[i + 1].flags &= ~KFINDEX_ENTRY_CONTIGUOUS;
+    index->dirty = 1;
+end:
+    SDL_UnlockMutex(index->mutex);
+}
+
+int ffkfindex_lookup(FFKeyframeIndex *index, int64_t target_us, int64_t *pts_us, int64_t *pos)
+{
+    int ret = AVERROR(ENOENT);
+    if (!index)
+        return ret;
+
+    SDL_LockMutex(index->mutex);
+    int i = kfindex_lower_bound_l(index, target_us);
+    if (i < index->nb_entries && index->entries[i].pts_us == target_us)
+        i++;
+    // entries[i - 1] is the last keyframe at or before target_us, it starts the GOP
+    // only if no keyframe can hide between it and the next entry
+    if (i > 0 && (index->complete ||
+                  (i < index->nb_entries && (index->entries[i].flags & KFINDEX_ENTRY_CONTIGUOUS)))) {
+        *pts_us = index->entries[i - 1].pts_us;
+        *pos    = index->entries[i - 1].pos;
+        ret = 0;
+    }
+    SDL_UnlockMutex(index->mutex);
+    return ret;
+}
+
+static int kfindex_prepass_interrupt_cb(void *opaque)
+{
+    FFKeyframeIndex *index = opaque;
+    return index->prepass_abort;
+}
+
+static int kfindex_prepass_thread(void *arg)
+{
+    FFKeyframeIndex *index = arg;
+    AVFormatContext *ic    = avformat_alloc_context();
+    AVPacket        *pkt   = av_packet_alloc();
+    int ret;
+
+    if (!ic || !pkt) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    ic->interrupt_callback.callback = kfindex_prepass_interrupt_cb;
+    ic->interrupt_callback.opaque   = index;
+    ret = avformat_open_input(&ic, index->prepass_url, index->prepass_iformat, &index->prepass_opts);
+    if (ret < 0)
+        goto end;
+
+    int video_index = av_find_best_stream(ic, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (video_index < 0) {
+        ret = video_index;
+        goto end;
+    }
+    for (unsigned int i = 0; i < ic->nb_streams; i++)
+        ic->streams[i]->discard = (int)i == video_index ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+
+    AVRational time_base = ic->streams[video_index]->time_base;
+    int64_t last_pts_us  = AV_NOPTS_VALUE;
+    int     contiguous   = 0;
+    int     monotonic    = 1;
+    while (!index->prepass_abort) {
+        ret = av_read_frame(ic, pkt);
+        if (ret < 0)
+            break;
+        if (pkt->stream_index == video_index && (pkt->flags & AV_PKT_FLAG_KEY)) {
+            int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+            if (ts == AV_NOPTS_VALUE || pkt->pos < 0) {
+                // not indexed, the next keyframe doesn't follow an indexed one
+                contiguous = 0;
+            } else {
+                int64_t pts_us = av_rescale_q(ts, time_base, AV_TIME_BASE_Q);
+                // a timestamp discontinuity, the keyframes around it aren't neighbours by pts
+                if (last_pts_us != AV_NOPTS_VALUE && pts_us <= last_pts_us) {
+                    contiguous = 0;
+                    monotonic  = 0;
+                }
+                ffkfindex_add(index, pts_us, pkt->pos, contiguous);
+                contiguous  = 1;
+                last_pts_us = pts_us;
+            }
+        }
+        av_packet_unref(pkt);
+    }
+
+    SDL_LockMutex(index->mutex);
+    if (ret == AVERROR_EOF && monotonic && index->nb_entries > 0) {
+        index->complete = 1;
+        index->dirty    = 1;
+    }
+    kfindex_save_l(index);
+    av_log(NULL, AV_LOG_INFO, "kfindex: pre-pass %s, %d keyframes\n",
+           index->complete ? "complete" : av_err2str(ret), index->nb_entries);
+    SDL_UnlockMutex(index->mutex);
+end:
+    av_packet_free(&pkt);
+    avformat_close_input(&ic);
+    return ret;
+}
+
+int ffkfindex_start_prepass(FFKeyframeIndex *index, const char *url, AVInputFormat *iformat, AVDictionary *format_opts)
+{
+    if (!index || !url)
+        return AVERROR(EINVAL);
+    if (index->complete || index->prepass_tid)
+        return 0;
+
+    index->prepass_url = av_strdup(url);
+    if (!index->prepass_url)
+        return AVERROR(ENOMEM);
+    index->prepass_iformat = iformat;
+    av_dict_copy(&index->prepass_opts, format_opts, 0);
+    index->prepass_tid = SDL_CreateThreadEx(&index->_prepass_tid, kfindex_prepass_thread, index, "ff_kfindex");
+    if (!index->prepass_tid) {
+        av_freep(&index->prepass_url);
+        av_dict_free(&index->prepass_opts);
+        return AVERROR(ENOMEM);
+    }
+    return 0;
+}
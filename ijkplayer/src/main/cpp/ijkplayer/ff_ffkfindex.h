@@ -0,0 +1,68 @@
+/*
+ * ff_ffkfindex.h
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * keyframe index for containers without a usable seek index (MPEG-TS, raw ES,
+ * MKV without cues): video keyframe (pts, byte position) pairs, filled while
+ * playing or by a demux-only pre-pass, and persisted per file identity
+ */
+
+#ifndef FFPLAY__FF_FFKFINDEX_H
+#define FFPLAY__FF_FFKFINDEX_H
+
+#include <stdint.h>
+#include "libavformat/avformat.h"
+
+typedef struct FFKeyframeIndex FFKeyframeIndex;
+
+/**
+ * @param dir       where the index file lives, NULL keeps the index in memory only
+ * @param url       together with file_size identifies the file
+ * @param file_size avio_size() of the input, <= 0 keeps the index in memory only
+ * @return the index, loaded from dir when an index for this file was saved before
+ */
+FFKeyframeIndex *ffkfindex_open(const char *dir, const char *url, int64_t file_size);
+/* stops the pre-pass and saves the index when it changed */
+void ffkfindex_closep(FFKeyframeIndex **index);
+
+/**
+ * Record a keyframe seen by read_thread.
+ * @param pts_us     keyframe pts in AV_TIME_BASE
+ * @param contiguous 0 for the first keyframe after open or a seek, the index then
+ *                   can't tell whether a keyframe was skipped before this one
+ */
+void ffkfindex_add(FFKeyframeIndex *index, int64_t pts_us, int64_t pos, int contiguous);
+
+/**
+ * Find the GOP holding target_us.
+ * @return 0 and the keyframe starting it when the index covers target_us, AVERROR(ENOENT) otherwise
+ */
+int  ffkfindex_lookup(FFKeyframeIndex *index, int64_t target_us, int64_t *pts_us, int64_t *pos);
+
+/**
+ * Index the whole file in the background with a demux-only pass over a second connection.
+ * @param format_opts copied, the caller keeps ownership
+ */
+int  ffkfindex_start_prepass(FFKeyframeIndex *index, const char *url, AVInputFormat *iformat, AVDictionary *format_opts);
+
+#endif
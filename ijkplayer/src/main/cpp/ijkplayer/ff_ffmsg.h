@@ -54,6 +54,11 @@
 #define FFP_MSG_TIMED_TEXT                  800
 #define FFP_MSG_ACCURATE_SEEK_COMPLETE      900     /* arg1 = current position*/
 #define FFP_MSG_GET_IMG_STATE               1000    /* arg1 = timestamp, arg2 = result code, obj = file name*/
+#define FFP_MSG_CLIP_EXPORT_PROGRESS        1100    /* arg1 = percent */
+#define FFP_MSG_CLIP_EXPORT_COMPLETE        1101    /* arg1 = error, 0 on success, arg2 = 1 if cancelled */
+#define FFP_MSG_SCRUB_FRAME_RENDERED        1200    /* arg1 = frame position, arg2 = milliseconds from the seek request */
+#define FFP_MSG_NEXT_SOURCE_STARTED         1300    /* arg1 = 1 for a gapless loop, 0 for the next data source, arg2 = its duration in ms */
+#define FFP_MSG_RECORD_COMPLETE             1400    /* arg1 = 1 when the recording was written, 0 on failure */
 
 #define FFP_MSG_VIDEO_DECODER_OPEN          10001
 
@@ -108,4 +113,19 @@
 #define FFP_PROP_INT64_SHARE_CACHE_DATA                 20210
 #define FFP_PROP_INT64_IMMEDIATE_RECONNECT              20211
 
+#define FFP_PROP_INT64_VIDEO_DECODER_INPUT_COPY_BYTES   20400
+#define FFP_PROP_INT64_VIDEO_DECODER_INPUT_COPY_SPEED   20401
+#define FFP_PROP_INT64_VIDEO_OVERLAY_FILL_TIME          20402
+#define FFP_PROP_INT64_RECORD_QUEUE_DEPTH               20403
+#define FFP_PROP_INT64_RECORD_ENCODE_FPS                20404
+#define FFP_PROP_INT64_RECORD_DROPPED_FRAMES            20405
+#define FFP_PROP_INT64_THREAD_WAKEUPS                   20406
+#define FFP_PROP_INT64_BUFFERING_STALL_ETA              20407
+#define FFP_PROP_INT64_AUDIO_UNDERRUNS                  20408
+
+/* ms after prepareAsync each startup stage was reached, + FFP_PREPARE_STAGE_* */
+#define FFP_PROP_INT64_PREPARE_STAGE_BASE               20500
+/* audio renderer callbacks that took less than 50 << bucket us, + bucket up to FFP_AUDIO_CALLBACK_HIST_NB */
+#define FFP_PROP_INT64_AUDIO_CALLBACK_HIST_BASE         20600
+
 #endif
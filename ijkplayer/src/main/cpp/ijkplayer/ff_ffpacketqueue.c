@@ -0,0 +1,690 @@
+/*
+ * ff_ffpacketqueue.c
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "ff_ffpacketqueue.h"
+#include <errno.h>
+#include <string.h>
+#include <sched.h>
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "../ijksdl/ijksdl_error.h"
+
+AVPacket flush_pkt;
+AVPacket codec_pkt;
+
+void packet_queue_global_init(void)
+{
+    av_init_packet(&flush_pkt);
+    flush_pkt.data = (uint8_t *)&flush_pkt;
+    av_init_packet(&codec_pkt);
+    codec_pkt.data = (uint8_t *)&codec_pkt;
+}
+
+/*
+ * Back buffer of a PacketQueue: the packets the decoder took out lately, kept
+ * by reference for read_thread_seek_in_buffer().  The decoder pushes from
+ * packet_queue_get(), read_thread takes them back on a seek; a push breaking
+ * the seq run or changing the serial starts the buffer over.
+ */
+MyAVPacketList *packet_back_at(PacketBackBuffer *b, int i)
+{
+    return &b->pkts[(b->head + i) % b->capacity];
+}
+
+void packet_back_drop_front_l(PacketBackBuffer *b)
+{
+    MyAVPacketList *pkt1 = packet_back_at(b, 0);
+
+    b->size -= pkt1->pkt.size + sizeof(*pkt1);
+    av_packet_unref(&pkt1->pkt);
+    b->head = (b->head + 1) % b->capacity;
+    b->count--;
+}
+
+void packet_back_clear_l(PacketBackBuffer *b)
+{
+    while (b->count > 0)
+        packet_back_drop_front_l(b);
+    b->head = 0;
+    b->size = 0;
+}
+
+static int packet_back_grow_l(PacketBackBuffer *b)
+{
+    int capacity = b->capacity ? b->capacity * 2 : 256;
+    MyAVPacketList *pkts = av_malloc_array(capacity, sizeof(MyAVPacketList));
+
+    if (!pkts)
+        return AVERROR(ENOMEM);
+    for (int i = 0; i < b->count; i++)
+        pkts[i] = *packet_back_at(b, i);
+    av_free(b->pkts);
+    b->pkts     = pkts;
+    b->capacity = capacity;
+    b->head     = 0;
+    return 0;
+}
+
+/* takes over pkt1->pkt */
+void packet_back_push_l(PacketBackBuffer *b, MyAVPacketList *pkt1)
+{
+    if (b->max_size <= 0 || pkt1->seq < 0) {
+        av_packet_unref(&pkt1->pkt);
+        return;
+    }
+
+    if (b->count > 0 && (pkt1->serial != b->serial || pkt1->seq != packet_back_at(b, b->count - 1)->seq + 1))
+        packet_back_clear_l(b);
+    if (b->count == b->capacity && packet_back_grow_l(b) < 0) {
+        av_packet_unref(&pkt1->pkt);
+        return;
+    }
+    b->serial = pkt1->serial;
+    *packet_back_at(b, b->count) = *pkt1;
+    b->count++;
+    b->size += pkt1->pkt.size + sizeof(*pkt1);
+    while (b->count > 1 && b->size > b->max_size)
+        packet_back_drop_front_l(b);
+}
+
+static void packet_back_push(PacketQueue *q, MyAVPacketList *pkt1)
+{
+    SDL_LockMutex(q->back.mutex);
+    packet_back_push_l(&q->back, pkt1);
+    SDL_UnlockMutex(q->back.mutex);
+}
+
+/* keep a reference to a packet handed out to the decoder */
+static void packet_back_keep(PacketQueue *q, const MyAVPacketList *pkt1)
+{
+    MyAVPacketList copy;
+
+    if (q->back.max_size <= 0 || pkt1->seq < 0)
+        return;
+
+    memset(&copy, 0, sizeof(copy));
+    av_init_packet(&copy.pkt);
+    if (av_packet_ref(&copy.pkt, &pkt1->pkt) < 0)
+        return;
+    copy.serial = pkt1->serial;
+    copy.seq    = pkt1->seq;
+    packet_back_push(q, &copy);
+}
+
+void packet_back_clear(PacketQueue *q)
+{
+    SDL_LockMutex(q->back.mutex);
+    packet_back_clear_l(&q->back);
+    SDL_UnlockMutex(q->back.mutex);
+}
+
+static int64_t packet_queue_next_seq(PacketQueue *q, const AVPacket *pkt)
+{
+    if (pkt == &flush_pkt || pkt == &codec_pkt || !pkt->data)
+        return -1;
+    return q->put_seq++;
+}
+
+/*
+ * Lock-free SPSC ring variant of PacketQueue.
+ *
+ * read_thread is the only producer, the decoder thread the only consumer.
+ * ring_write is published with release and read with acquire, so is
+ * ring_read. Both sides only touch q->mutex/q->cond when they have to sleep
+ * (ring empty or full), and the other side only takes the mutex to wake them
+ * up when the corresponding PACKET_RING_WAIT_* bit is set; a fence on both
+ * sides keeps that check from missing a sleeper. Flush drains through the
+ * consumer path; ring_read is advanced with a CAS so that a flush racing with
+ * the decoder never hands the same packet out twice.
+ *
+ * The decoder publishes what it took in batches: nb_packets, size and
+ * duration go down and consumed_cb runs once per PACKET_RING_BATCH packets,
+ * or as soon as the ring is empty. A producer waiting for room is only woken
+ * once the ring is half empty, and either side yields once before it sleeps;
+ * otherwise both take turns a packet at a time, which on a busy or single
+ * core costs a context switch per packet.
+ */
+static void packet_ring_account(PacketQueue *q, int nb_packets, int size, int64_t duration)
+{
+    __atomic_add_fetch(&q->nb_packets, nb_packets, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&q->size, size, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&q->duration, duration, __ATOMIC_RELAXED);
+}
+
+static int packet_ring_pkt_size(const MyAVPacketList *pkt1)
+{
+    return pkt1->pkt.size + (int)sizeof(*pkt1);
+}
+
+static int64_t packet_ring_pkt_duration(const MyAVPacketList *pkt1)
+{
+    return FFMAX(pkt1->pkt.duration, MIN_PKT_DURATION);
+}
+
+static int packet_ring_is_empty(PacketQueue *q)
+{
+    return __atomic_load_n(&q->ring_read, __ATOMIC_ACQUIRE) == __atomic_load_n(&q->ring_write, __ATOMIC_ACQUIRE);
+}
+
+int64_t packet_ring_count(PacketQueue *q)
+{
+    return __atomic_load_n(&q->ring_write, __ATOMIC_ACQUIRE) - __atomic_load_n(&q->ring_read, __ATOMIC_ACQUIRE);
+}
+
+static int packet_ring_is_full(PacketQueue *q)
+{
+    return q->ring && packet_ring_count(q) >= q->ring_capacity;
+}
+
+void packet_queue_notify_consumed(PacketQueue *q)
+{
+    if (q->consumed_cb)
+        q->consumed_cb(q->consumed_opaque);
+}
+
+static void packet_ring_wake(PacketQueue *q, int waiter)
+{
+    /* pairs with the fence in packet_ring_wait(): either we see the bit or the sleeper sees the new index */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!(__atomic_load_n(&q->ring_waiters, __ATOMIC_RELAXED) & waiter))
+        return;
+
+    SDL_LockMutex(q->mutex);
+    SDL_CondBroadcast(q->cond);
+    SDL_UnlockMutex(q->mutex);
+}
+
+static void packet_ring_wait(PacketQueue *q, int waiter)
+{
+    SDL_LockMutex(q->mutex);
+    __atomic_fetch_or(&q->ring_waiters, waiter, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!q->abort_request) {
+        if (waiter == PACKET_RING_WAIT_EMPTY && packet_ring_is_empty(q))
+            SDL_CondWait(q->cond, q->mutex);
+        else if (waiter == PACKET_RING_WAIT_FULL && packet_ring_is_full(q))
+            SDL_CondWait(q->cond, q->mutex);
+    }
+    __atomic_fetch_and(&q->ring_waiters, ~waiter, __ATOMIC_RELAXED);
+    SDL_UnlockMutex(q->mutex);
+}
+
+/* keep_serial: src->serial is used as is, otherwise the queue's, bumped first for flush_pkt */
+static int packet_ring_append(PacketQueue *q, const MyAVPacketList *src, int keep_serial)
+{
+    MyAVPacketList *pkt1;
+    int64_t write_index;
+    int yielded = 0;
+
+    while (packet_ring_is_full(q)) {
+        if (q->abort_request)
+            return -1;
+        if (!yielded) {
+            // let the decoder make room before paying for a sleep and a wakeup
+            yielded = 1;
+            sched_yield();
+            continue;
+        }
+        yielded = 0;
+        packet_ring_wait(q, PACKET_RING_WAIT_FULL);
+    }
+    if (q->abort_request)
+        return -1;
+
+    write_index = q->ring_write;
+    pkt1 = &q->ring[write_index & (q->ring_capacity - 1)];
+    *pkt1 = *src;
+    pkt1->next = NULL;
+    if (!keep_serial) {
+        if (src->pkt.data == flush_pkt.data)
+            __atomic_add_fetch(&q->serial, 1, __ATOMIC_RELAXED);
+        pkt1->serial = q->serial;
+    }
+
+    packet_ring_account(q, 1, packet_ring_pkt_size(pkt1), packet_ring_pkt_duration(pkt1));
+    __atomic_store_n(&q->ring_write, write_index + 1, __ATOMIC_RELEASE);
+
+    packet_ring_wake(q, PACKET_RING_WAIT_EMPTY);
+    return 0;
+}
+
+static int packet_ring_put(PacketQueue *q, AVPacket *pkt)
+{
+    MyAVPacketList pkt1;
+
+    pkt1.pkt    = *pkt;
+    pkt1.next   = NULL;
+    pkt1.serial = 0;
+    pkt1.seq    = packet_queue_next_seq(q, pkt);
+    return packet_ring_append(q, &pkt1, 0);
+}
+
+/* take the oldest packet, its accounting is left to the caller */
+static int packet_ring_pop(PacketQueue *q, MyAVPacketList *pkt1)
+{
+    int64_t read_index = __atomic_load_n(&q->ring_read, __ATOMIC_RELAXED);
+
+    for (;;) {
+        if (read_index == __atomic_load_n(&q->ring_write, __ATOMIC_ACQUIRE))
+            return 0;
+        *pkt1 = q->ring[read_index & (q->ring_capacity - 1)];
+        if (__atomic_compare_exchange_n(&q->ring_read, &read_index, read_index + 1, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            return 1;
+        /* lost against a concurrent flush, read_index was reloaded */
+    }
+}
+
+/* pop for a flush or take_all, published right away */
+static int packet_ring_pop_now(PacketQueue *q, MyAVPacketList *pkt1)
+{
+    if (!packet_ring_pop(q, pkt1))
+        return 0;
+    packet_ring_account(q, -1, -packet_ring_pkt_size(pkt1), -packet_ring_pkt_duration(pkt1));
+    packet_ring_wake(q, PACKET_RING_WAIT_FULL);
+    return 1;
+}
+
+/* publish what the decoder took since the last commit */
+static void packet_ring_commit(PacketQueue *q)
+{
+    if (!q->ring_got_packets)
+        return;
+    packet_ring_account(q, -q->ring_got_packets, -q->ring_got_size, -q->ring_got_duration);
+    q->ring_got_packets  = 0;
+    q->ring_got_size     = 0;
+    q->ring_got_duration = 0;
+    if (packet_ring_count(q) * 2 <= q->ring_capacity)
+        packet_ring_wake(q, PACKET_RING_WAIT_FULL);
+    packet_queue_notify_consumed(q);
+}
+
+static int packet_ring_get(PacketQueue *q, AVPacket *pkt, int block, int *serial)
+{
+    MyAVPacketList pkt1;
+    int yielded = 0;
+
+    for (;;) {
+        if (q->abort_request) {
+            packet_ring_commit(q);
+            return -1;
+        }
+        if (packet_ring_pop(q, &pkt1)) {
+            packet_back_keep(q, &pkt1);
+            *pkt = pkt1.pkt;
+            if (serial)
+                *serial = pkt1.serial;
+            q->ring_got_packets++;
+            q->ring_got_size     += packet_ring_pkt_size(&pkt1);
+            q->ring_got_duration += packet_ring_pkt_duration(&pkt1);
+            if (q->ring_got_packets >= PACKET_RING_BATCH || packet_ring_is_empty(q))
+                packet_ring_commit(q);
+            return 1;
+        }
+        packet_ring_commit(q);
+        if (!block)
+            return 0;
+        if (!yielded) {
+            // let the producer catch up before paying for a sleep and a wakeup
+            yielded = 1;
+            sched_yield();
+            continue;
+        }
+        yielded = 0;
+        packet_ring_wait(q, PACKET_RING_WAIT_EMPTY);
+    }
+}
+
+static void packet_ring_flush(PacketQueue *q)
+{
+    MyAVPacketList pkt1;
+
+    while (packet_ring_pop_now(q, &pkt1))
+        av_packet_unref(&pkt1.pkt);
+}
+
+static int packet_queue_append_l(PacketQueue *q, const MyAVPacketList *src, int keep_serial)
+{
+    MyAVPacketList *pkt1;
+
+    if (q->abort_request)
+       return -1;
+
+#ifdef FFP_MERGE
+    pkt1 = av_malloc(sizeof(MyAVPacketList));
+#else
+    pkt1 = q->recycle_pkt;
+    if (pkt1) {
+        q->recycle_pkt = pkt1->next;
+        q->recycle_count++;
+    } else {
+        q->alloc_count++;
+        pkt1 = av_malloc(sizeof(MyAVPacketList));
+    }
+#ifdef FFP_SHOW_PKT_RECYCLE
+    int total_count = q->recycle_count + q->alloc_count;
+    if (!(total_count % 50)) {
+        av_log(ffp, AV_LOG_DEBUG, "pkt-recycle \t%d + \t%d = \t%d\n", q->recycle_count, q->alloc_count, total_count);
+    }
+#endif
+#endif
+    if (!pkt1)
+        return -1;
+    *pkt1 = *src;
+    pkt1->next = NULL;
+    if (!keep_serial) {
+        if (src->pkt.data == flush_pkt.data)
+            q->serial++;
+        pkt1->serial = q->serial;
+    }
+
+    if (!q->last_pkt)
+        q->first_pkt = pkt1;
+    else
+        q->last_pkt->next = pkt1;
+    q->last_pkt = pkt1;
+    q->nb_packets++;
+    q->size += pkt1->pkt.size + sizeof(*pkt1);
+
+    q->duration += FFMAX(pkt1->pkt.duration, MIN_PKT_DURATION);
+
+    /* XXX: should duplicate packet data in DV case */
+    SDL_CondSignal(q->cond);
+    return 0;
+}
+
+static int packet_queue_put_private(PacketQueue *q, AVPacket *pkt)
+{
+    MyAVPacketList pkt1;
+
+    pkt1.pkt    = *pkt;
+    pkt1.next   = NULL;
+    pkt1.serial = 0;
+    pkt1.seq    = packet_queue_next_seq(q, pkt);
+    return packet_queue_append_l(q, &pkt1, 0);
+}
+
+int packet_queue_append(PacketQueue *q, const MyAVPacketList *src, int keep_serial)
+{
+    int ret;
+
+    if (q->ring)
+        return packet_ring_append(q, src, keep_serial);
+
+    SDL_LockMutex(q->mutex);
+    ret = packet_queue_append_l(q, src, keep_serial);
+    SDL_UnlockMutex(q->mutex);
+    return ret;
+}
+
+/* pop everything queued, oldest first, as the consumer would; *pkts is av_malloc'ed */
+int packet_queue_take_all(PacketQueue *q, MyAVPacketList **pkts, int *nb_pkts)
+{
+    MyAVPacketList *array;
+    MyAVPacketList *node, *next;
+    MyAVPacketList pkt1;
+    int count = 0;
+    /* only the consumer can change it meanwhile, and only downwards */
+    int capacity = q->ring ? (int)packet_ring_count(q) : __atomic_load_n(&q->nb_packets, __ATOMIC_SEQ_CST);
+
+    *pkts    = NULL;
+    *nb_pkts = 0;
+    if (capacity <= 0)
+        return 0;
+    array = av_malloc_array(capacity, sizeof(MyAVPacketList));
+    if (!array)
+        return AVERROR(ENOMEM);
+
+    if (q->ring) {
+        while (count < capacity && packet_ring_pop_now(q, &pkt1))
+            array[count++] = pkt1;
+    } else {
+        SDL_LockMutex(q->mutex);
+        for (node = q->first_pkt; node && count < capacity; node = next) {
+            next = node->next;
+            array[count++] = *node;
+            node->next = q->recycle_pkt;
+            q->recycle_pkt = node;
+        }
+        q->first_pkt = NULL;
+        q->last_pkt = NULL;
+        q->nb_packets = 0;
+        q->size = 0;
+        q->duration = 0;
+        SDL_UnlockMutex(q->mutex);
+    }
+    *pkts    = array;
+    *nb_pkts = count;
+    return 0;
+}
+
+int packet_queue_put(PacketQueue *q, AVPacket *pkt)
+{
+    int ret;
+
+    if (q->ring) {
+        ret = packet_ring_put(q, pkt);
+    } else {
+        SDL_LockMutex(q->mutex);
+        ret = packet_queue_put_private(q, pkt);
+        SDL_UnlockMutex(q->mutex);
+    }
+
+    if (pkt != &flush_pkt && pkt != &codec_pkt && ret < 0)
+        av_packet_unref(pkt);
+
+    return ret;
+}
+
+int packet_queue_put_nullpacket(PacketQueue *q, int stream_index)
+{
+    AVPacket pkt1, *pkt = &pkt1;
+    av_init_packet(pkt);
+    pkt->data = NULL;
+    pkt->size = 0;
+    pkt->stream_index = stream_index;
+    return packet_queue_put(q, pkt);
+}
+
+/* packet queue handling */
+int packet_queue_init(PacketQueue *q)
+{
+    memset(q, 0, sizeof(PacketQueue));
+    q->mutex = SDL_CreateMutex();
+    if (!q->mutex) {
+        av_log(NULL, AV_LOG_FATAL, "SDL_CreateMutex(): %s\n", SDL_GetError());
+        return AVERROR(ENOMEM);
+    }
+    q->cond = SDL_CreateCond();
+    if (!q->cond) {
+        av_log(NULL, AV_LOG_FATAL, "SDL_CreateCond(): %s\n", SDL_GetError());
+        return AVERROR(ENOMEM);
+    }
+    q->back.mutex = SDL_CreateMutex();
+    if (!q->back.mutex) {
+        av_log(NULL, AV_LOG_FATAL, "SDL_CreateMutex(): %s\n", SDL_GetError());
+        return AVERROR(ENOMEM);
+    }
+    q->abort_request = 1;
+    return 0;
+}
+
+/* switch an initialized, not yet started queue to the SPSC ring */
+int packet_queue_init_ring(PacketQueue *q, int capacity)
+{
+    int ring_capacity = 1;
+
+    while (ring_capacity < capacity)
+        ring_capacity <<= 1;
+
+    q->ring = av_calloc(ring_capacity, sizeof(MyAVPacketList));
+    if (!q->ring) {
+        av_log(NULL, AV_LOG_FATAL, "packet_queue_init_ring(%d): out of memory\n", ring_capacity);
+        return AVERROR(ENOMEM);
+    }
+    q->ring_capacity = ring_capacity;
+    q->ring_read     = 0;
+    q->ring_write    = 0;
+    q->ring_waiters  = 0;
+    q->ring_got_packets  = 0;
+    q->ring_got_size     = 0;
+    q->ring_got_duration = 0;
+    return 0;
+}
+
+void packet_queue_flush(PacketQueue *q)
+{
+    MyAVPacketList *pkt, *pkt1;
+
+    packet_back_clear(q);
+    if (q->ring) {
+        packet_ring_flush(q);
+        packet_queue_notify_consumed(q);
+        return;
+    }
+
+    SDL_LockMutex(q->mutex);
+    for (pkt = q->first_pkt; pkt; pkt = pkt1) {
+        pkt1 = pkt->next;
+        av_packet_unref(&pkt->pkt);
+#ifdef FFP_MERGE
+        av_freep(&pkt);
+#else
+        pkt->next = q->recycle_pkt;
+        q->recycle_pkt = pkt;
+#endif
+    }
+    q->last_pkt = NULL;
+    q->first_pkt = NULL;
+    q->nb_packets = 0;
+    q->size = 0;
+    q->duration = 0;
+    SDL_UnlockMutex(q->mutex);
+    packet_queue_notify_consumed(q);
+}
+
+void packet_queue_destroy(PacketQueue *q)
+{
+    packet_queue_flush(q);
+
+    SDL_LockMutex(q->mutex);
+    while(q->recycle_pkt) {
+        MyAVPacketList *pkt = q->recycle_pkt;
+        if (pkt)
+            q->recycle_pkt = pkt->next;
+        av_freep(&pkt);
+    }
+    av_freep(&q->ring);
+    q->ring_capacity = 0;
+    SDL_UnlockMutex(q->mutex);
+
+    av_freep(&q->back.pkts);
+    q->back.capacity = 0;
+    SDL_DestroyMutex(q->back.mutex);
+    SDL_DestroyMutex(q->mutex);
+    SDL_DestroyCond(q->cond);
+}
+
+void packet_queue_abort(PacketQueue *q)
+{
+    SDL_LockMutex(q->mutex);
+
+    q->abort_request = 1;
+
+    if (q->ring)
+        SDL_CondBroadcast(q->cond);
+    else
+        SDL_CondSignal(q->cond);
+
+    SDL_UnlockMutex(q->mutex);
+}
+
+void packet_queue_start(PacketQueue *q)
+{
+    SDL_LockMutex(q->mutex);
+    q->abort_request = 0;
+    if (!q->ring)
+        packet_queue_put_private(q, &flush_pkt);
+    SDL_UnlockMutex(q->mutex);
+
+    if (q->ring) {
+        /* no decoder runs yet, what the last one took and did not publish is due now */
+        packet_ring_commit(q);
+        packet_ring_put(q, &flush_pkt);
+    }
+}
+
+/* return < 0 if aborted, 0 if no packet and > 0 if packet.  */
+int packet_queue_get(PacketQueue *q, AVPacket *pkt, int block, int *serial)
+{
+    MyAVPacketList *pkt1;
+    MyAVPacketList taken;
+    int ret;
+
+    if (q->ring)
+        return packet_ring_get(q, pkt, block, serial);
+
+    SDL_LockMutex(q->mutex);
+
+    for (;;) {
+
+        if (q->abort_request) {
+            ret = -1;
+            break;
+        }
+        pkt1 = q->first_pkt;
+        if (pkt1) {
+            q->first_pkt = pkt1->next;
+            if (!q->first_pkt)
+                q->last_pkt = NULL;
+            q->nb_packets--;
+            q->size -= pkt1->pkt.size + sizeof(*pkt1);
+            q->duration -= FFMAX(pkt1->pkt.duration, MIN_PKT_DURATION);
+            taken = *pkt1;
+            *pkt = pkt1->pkt;
+            if (serial)
+                *serial = pkt1->serial;
+#ifdef FFP_MERGE
+            av_free(pkt1);
+#else
+            pkt1->next = q->recycle_pkt;
+            q->recycle_pkt = pkt1;
+#endif
+            ret = 1;
+            break;
+        } else if (!block) {
+            ret = 0;
+            break;
+        } else {
+            SDL_CondWait(q->cond, q->mutex);
+        }
+    }
+    SDL_UnlockMutex(q->mutex);
+
+    if (ret > 0) {
+        packet_back_keep(q, &taken);
+        packet_queue_notify_consumed(q);
+    }
+    return ret;
+}
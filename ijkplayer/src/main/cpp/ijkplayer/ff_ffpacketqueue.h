@@ -0,0 +1,148 @@
+/*
+ * ff_ffpacketqueue.h
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * PacketQueue, the packets read_thread demuxed for a decoder: a linked list
+ * under a mutex, or a lock-free single-producer/single-consumer ring, with
+ * the back buffer of packets the decoder took out lately
+ */
+
+#ifndef FFPLAY__FF_FFPACKETQUEUE_H
+#define FFPLAY__FF_FFPACKETQUEUE_H
+
+#include <stdint.h>
+#include "libavcodec/avcodec.h"
+#include "../ijksdl/ijksdl_mutex.h"
+
+#define MIN_PKT_DURATION 15
+
+#define PACKET_RING_WAIT_EMPTY      (1 << 0)
+#define PACKET_RING_WAIT_FULL       (1 << 1)
+#define PACKET_RING_CAPACITY_MAX    (1 << 16)
+/* packets the ring consumer takes before it publishes them, see packet_ring_commit() */
+#define PACKET_RING_BATCH           16
+
+typedef struct MyAVPacketList {
+    AVPacket pkt;
+    struct MyAVPacketList *next;
+    int serial;
+    int64_t seq;                /* order of the data packets put, -1 for flush and null packets */
+} MyAVPacketList;
+
+/*
+ * Packets recently taken out of a PacketQueue, oldest first, so that a short
+ * backward seek can queue them again instead of seeking the demuxer.
+ * Always a run of consecutive seq of a single serial.
+ */
+typedef struct PacketBackBuffer {
+    SDL_mutex *mutex;
+    MyAVPacketList *pkts;       /* circular */
+    int capacity;
+    int head;
+    int count;
+    int size;
+    int max_size;               /* bytes, 0 disables the back buffer */
+    int serial;
+} PacketBackBuffer;
+
+typedef struct PacketQueue {
+    MyAVPacketList *first_pkt, *last_pkt;
+    int nb_packets;
+    int size;
+    int64_t duration;
+    int abort_request;
+    int serial;
+    SDL_mutex *mutex;
+    SDL_cond *cond;
+    MyAVPacketList *recycle_pkt;
+    int recycle_count;
+    int alloc_count;
+
+    int is_buffer_indicator;
+
+    /*
+     * Bounded single-producer/single-consumer ring, used instead of the
+     * linked list when ring_capacity > 0 (see packet_queue_init_ring()).
+     * read_thread is the only producer and the decoder thread the only
+     * consumer; mutex/cond are only taken when one side has to sleep.
+     */
+    MyAVPacketList *ring;
+    int ring_capacity;          /* power of two */
+    int64_t ring_write;         /* advanced by the producer only */
+    int64_t ring_read;          /* advanced by the consumer or by flush, via CAS */
+    int ring_waiters;           /* PACKET_RING_WAIT_* bits */
+    /* taken by the consumer, not yet off nb_packets/size/duration */
+    int ring_got_packets;
+    int ring_got_size;
+    int64_t ring_got_duration;
+
+    /*
+     * Called on the consumer side after packets left the queue, so that
+     * read_thread can sleep until the queues drain instead of polling.
+     */
+    void (*consumed_cb)(void *opaque);
+    void *consumed_opaque;
+
+    int64_t put_seq;            /* next seq, producer side only */
+    PacketBackBuffer back;
+} PacketQueue;
+
+/* starts a new serial, the decoder flushes when it gets it */
+extern AVPacket flush_pkt;
+/* marks a source switch in audioq or videoq, the decoder drains and reopens with Decoder.next_par */
+extern AVPacket codec_pkt;
+
+/* sets up flush_pkt and codec_pkt, once before any queue is used */
+void packet_queue_global_init(void);
+
+int  packet_queue_init(PacketQueue *q);
+/* switch an initialized, not yet started queue to the SPSC ring */
+int  packet_queue_init_ring(PacketQueue *q, int capacity);
+void packet_queue_destroy(PacketQueue *q);
+void packet_queue_abort(PacketQueue *q);
+/* clears abort_request and puts flush_pkt */
+void packet_queue_start(PacketQueue *q);
+void packet_queue_flush(PacketQueue *q);
+
+/* takes over pkt, which is unreferenced on failure unless it is flush_pkt or codec_pkt */
+int  packet_queue_put(PacketQueue *q, AVPacket *pkt);
+int  packet_queue_put_nullpacket(PacketQueue *q, int stream_index);
+/* keep_serial: src->serial is used as is, otherwise the queue's, bumped first for flush_pkt */
+int  packet_queue_append(PacketQueue *q, const MyAVPacketList *src, int keep_serial);
+/* return < 0 if aborted, 0 if no packet and > 0 if packet */
+int  packet_queue_get(PacketQueue *q, AVPacket *pkt, int block, int *serial);
+/* pop everything queued, oldest first, as the consumer would; *pkts is av_malloc'ed */
+int  packet_queue_take_all(PacketQueue *q, MyAVPacketList **pkts, int *nb_pkts);
+void packet_queue_notify_consumed(PacketQueue *q);
+/* packets in a ring queue */
+int64_t packet_ring_count(PacketQueue *q);
+
+/* back buffer access, the _l functions with b->mutex held or on a private buffer */
+MyAVPacketList *packet_back_at(PacketBackBuffer *b, int i);
+void packet_back_drop_front_l(PacketBackBuffer *b);
+void packet_back_clear_l(PacketBackBuffer *b);
+/* takes over pkt1->pkt */
+void packet_back_push_l(PacketBackBuffer *b, MyAVPacketList *pkt1);
+void packet_back_clear(PacketQueue *q);
+
+#endif
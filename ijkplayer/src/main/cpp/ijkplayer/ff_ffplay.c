@@ -71,6 +71,7 @@
 
 #include "../ijksdl/ijksdl_log.h"
 #include "ijkavformat/ijkavformat.h"
+#include "ijkavutil/ijkaudioutils.h"
 #include "ff_cmdutils.h"
 #include "ff_fferror.h"
 #include "ff_ffpipeline.h"
@@ -80,7 +81,6 @@
 #include "ijkversion.h"
 #include "ijkplayer.h"
 #include <stdatomic.h>
-#include "ijksoundtouch_wrap.h"
 #include <syslog.h>
 #ifndef AV_CODEC_FLAG2_FAST
 #define AV_CODEC_FLAG2_FAST CODEC_FLAG2_FAST
@@ -110,8 +110,6 @@
 // static const AVOption ffp_context_options[] = ...
 #include "ff_ffplay_options.h"
 
-static AVPacket flush_pkt;
-
 #if CONFIG_AVFILTER
 // FFP_MERGE: opt_add_vfilter
 #endif
@@ -144,208 +142,6 @@ int64_t get_valid_channel_layout(int64_t channel_layout, int channels)
 
 static void free_picture(Frame *vp);
 
-static int packet_queue_put_private(PacketQueue *q, AVPacket *pkt)
-{
-    MyAVPacketList *pkt1;
-
-    if (q->abort_request)
-       return -1;
-
-#ifdef FFP_MERGE
-    pkt1 = av_malloc(sizeof(MyAVPacketList));
-#else
-    pkt1 = q->recycle_pkt;
-    if (pkt1) {
-        q->recycle_pkt = pkt1->next;
-        q->recycle_count++;
-    } else {
-        q->alloc_count++;
-        pkt1 = av_malloc(sizeof(MyAVPacketList));
-    }
-#ifdef FFP_SHOW_PKT_RECYCLE
-    int total_count = q->recycle_count + q->alloc_count;
-    if (!(total_count % 50)) {
-        av_log(ffp, AV_LOG_DEBUG, "pkt-recycle \t%d + \t%d = \t%d\n", q->recycle_count, q->alloc_count, total_count);
-    }
-#endif
-#endif
-    if (!pkt1)
-        return -1;
-    pkt1->pkt = *pkt;
-    pkt1->next = NULL;
-    if (pkt == &flush_pkt)
-        q->serial++;
-    pkt1->serial = q->serial;
-
-    if (!q->last_pkt)
-        q->first_pkt = pkt1;
-    else
-        q->last_pkt->next = pkt1;
-    q->last_pkt = pkt1;
-    q->nb_packets++;
-    q->size += pkt1->pkt.size + sizeof(*pkt1);
-
-    q->duration += FFMAX(pkt1->pkt.duration, MIN_PKT_DURATION);
-
-    /* XXX: should duplicate packet data in DV case */
-    SDL_CondSignal(q->cond);
-    return 0;
-}
-
-static int packet_queue_put(PacketQueue *q, AVPacket *pkt)
-{
-    int ret;
-
-    SDL_LockMutex(q->mutex);
-    ret = packet_queue_put_private(q, pkt);
-    SDL_UnlockMutex(q->mutex);
-
-    if (pkt != &flush_pkt && ret < 0)
-        av_packet_unref(pkt);
-
-    return ret;
-}
-
-static int packet_queue_put_nullpacket(PacketQueue *q, int stream_index)
-{
-    AVPacket pkt1, *pkt = &pkt1;
-    av_init_packet(pkt);
-    pkt->data = NULL;
-    pkt->size = 0;
-    pkt->stream_index = stream_index;
-    return packet_queue_put(q, pkt);
-}
-
-/* packet queue handling */
-static int packet_queue_init(PacketQueue *q)
-{
-    memset(q, 0, sizeof(PacketQueue));
-    q->mutex = SDL_CreateMutex();
-    if (!q->mutex) {
-        av_log(NULL, AV_LOG_FATAL, "SDL_CreateMutex(): %s\n", SDL_GetError());
-        return AVERROR(ENOMEM);
-    }
-    q->cond = SDL_CreateCond();
-    if (!q->cond) {
-        av_log(NULL, AV_LOG_FATAL, "SDL_CreateCond(): %s\n", SDL_GetError());
-        return AVERROR(ENOMEM);
-    }
-    q->abort_request = 1;
-    return 0;
-}
-
-static void packet_queue_flush(PacketQueue *q)
-{
-    MyAVPacketList *pkt, *pkt1;
-
-    SDL_LockMutex(q->mutex);
-    for (pkt = q->first_pkt; pkt; pkt = pkt1) {
-        pkt1 = pkt->next;
-        av_packet_unref(&pkt->pkt);
-#ifdef FFP_MERGE
-        av_freep(&pkt);
-#else
-        pkt->next = q->recycle_pkt;
-        q->recycle_pkt = pkt;
-#endif
-    }
-    q->last_pkt = NULL;
-    q->first_pkt = NULL;
-    q->nb_packets = 0;
-    q->size = 0;
-    q->duration = 0;
-    SDL_UnlockMutex(q->mutex);
-}
-
-static void packet_queue_destroy(PacketQueue *q)
-{
-    packet_queue_flush(q);
-
-    SDL_LockMutex(q->mutex);
-    while(q->recycle_pkt) {
-        MyAVPacketList *pkt = q->recycle_pkt;
-        if (pkt)
-            q->recycle_pkt = pkt->next;
-        av_freep(&pkt);
-    }
-    SDL_UnlockMutex(q->mutex);
-
-    SDL_DestroyMutex(q->mutex);
-    SDL_DestroyCond(q->cond);
-}
-
-static void packet_queue_abort(PacketQueue *q)
-{
-    SDL_LockMutex(q->mutex);
-
-    q->abort_request = 1;
-
-    SDL_CondSignal(q->cond);
-
-    SDL_UnlockMutex(q->mutex);
-}
-
-static void packet_queue_start(PacketQueue *q)
-{
-    SDL_LockMutex(q->mutex);
-    q->abort_request = 0;
-    packet_queue_put_private(q, &flush_pkt);
-    SDL_UnlockMutex(q->mutex);
-}
-
-/* return < 0 if aborted, 0 if no packet and > 0 if packet.  */
-static int packet_queue_get(PacketQueue *q, AVPacket *pkt, int block, int *serial)
-{
-
-
-    MyAVPacketList *pkt1;
-    int ret;
-
-    SDL_LockMutex(q->mutex);
-
-    for (;;) {
-
-        if (q->abort_request) {
-            ret = -1;
-            break;
-        }
-        pkt1 = q->first_pkt;
-        if (pkt1) {
-            q->first_pkt = pkt1->next;
-            if (!q->first_pkt)
-                q->last_pkt = NULL;
-            q->nb_packets--;
-            q->size -= pkt1->pkt.size + sizeof(*pkt1);
-            q->duration -= FFMAX(pkt1->pkt.duration, MIN_PKT_DURATION);
-            *pkt = pkt1->pkt;
-            if (serial)
-                *serial = pkt1->serial;
-#ifdef FFP_MERGE
-            av_free(pkt1);
-#else
-            pkt1->next = q->recycle_pkt;
-            q->recycle_pkt = pkt1;
-#endif
-            ret = 1;
-            break;
-        } else if (!block) {
-            ret = 0;
-            break;
-        } else {
-
-            char c[100];
-            sprintf(c,"packet_queue_get SDL_CondWait%d",block);
-
-
-            SDL_CondWait(q->cond, q->mutex);
-        }
-    }
-    SDL_UnlockMutex(q->mutex);
-
-
-    return ret;
-}
-
 static int packet_queue_get_or_buffering(FFPlayer *ffp, PacketQueue *q, AVPacket *pkt, int *serial, int *finished)
 {
     if (!finished) {
@@ -382,11 +178,10 @@ static int packet_queue_get_or_buffering(FFPlayer *ffp, PacketQueue *q, AVPacket
     return 1;
 }
 
-static void decoder_init(Decoder *d, AVCodecContext *avctx, PacketQueue *queue, SDL_cond *empty_queue_cond) {
+static void decoder_init(Decoder *d, AVCodecContext *avctx, PacketQueue *queue) {
     memset(d, 0, sizeof(Decoder));
     d->avctx = avctx;
     d->queue = queue;
-    d->empty_queue_cond = empty_queue_cond;
     d->start_pts = AV_NOPTS_VALUE;
 
     d->first_frame_decoded_time = SDL_GetTickHR();
@@ -584,55 +379,93 @@ fail0:
     return ret;
 }
 
-static void record_video_frame(FFPlayer *ffp, AVFrame *frame)
-{
-    if (frame->format == AV_PIX_FMT_YUV420P && ffp->record_write_data.isInRecord == OHOS_RECORD_STATUS_ON &&
-        ffp->record_write_data.recordFramesQueue && frame->width > 0 && frame->height > 0) {
-        RecordFrameData frData;
-        frData.data0 = (uint8_t *)malloc((size_t)frame->linesize[0] * frame->height);
-        frData.data1 = (uint8_t *)malloc((size_t)frame->linesize[1] * frame->height / DATA_NUM_2);
-        frData.data2 = (uint8_t *)malloc((size_t)frame->linesize[1] * frame->height / DATA_NUM_2);
-        frData.dataNum = FRAME_DATA_NUM_3;
-        frData.frameType = OHOS_FRAME_TYPE_VIDEO;
-        frData.lineSize0 = frame->linesize[DATA_NUM_0];
-        frData.lineSize1 = frame->linesize[DATA_NUM_1];
-        frData.lineSize2 = frame->linesize[DATA_NUM_2];
-        frData.format = frame->format;
-        frData.writeFileStatus = DATA_NUM_0;
-        memcpy(frData.data0, frame->data[DATA_NUM_0], frame->linesize[DATA_NUM_0] * frame->height);
-        memcpy(frData.data1, frame->data[DATA_NUM_1], frame->linesize[DATA_NUM_1] * frame->height / DATA_NUM_2);
-        memcpy(frData.data2, frame->data[DATA_NUM_2], frame->linesize[DATA_NUM_2] * frame->height / DATA_NUM_2);
-        int windex = ffp->record_write_data.windex;
-        ffp->record_write_data.recordFramesQueue[windex] = frData;
-        ffp->record_write_data.windex += DATA_NUM_1;
-        ffp->record_write_data.srcFormat.height = frame->height;
-        ffp->record_write_data.srcFormat.width = frame->width;
-    }
-}
-
-static void record_audio_frame(FFPlayer *ffp, AVFrame *frame)
-{
-    if (ffp->record_write_data.isInRecord == OHOS_RECORD_STATUS_ON && frame->format == AV_SAMPLE_FMT_FLTP &&
-        ffp->record_write_data.recordFramesQueue && frame->linesize[0] > 0) {
-        RecordFrameData frData;
-        frData.data0 = (uint8_t *)av_malloc(frame->linesize[DATA_NUM_0]);
-        memcpy(frData.data0, frame->data[DATA_NUM_0], frame->linesize[DATA_NUM_0]);
-        frData.data1 = (uint8_t *)av_malloc(frame->linesize[DATA_NUM_0]);
-        memcpy(frData.data1, frame->data[DATA_NUM_1], frame->linesize[DATA_NUM_0]);
-        frData.frameType = OHOS_FRAME_TYPE_AUDIO;
-        frData.dataNum = FRAME_DATA_NUM_2;
-        frData.nb_samples = frame->nb_samples;
-        frData.channel_layout = frame->channel_layout;
-        frData.channels = frame->channels;
-        frData.lineSize0 = frame->linesize[DATA_NUM_0];
-        frData.lineSize1 = frame->linesize[DATA_NUM_0];
-        frData.format = frame->format;
-        frData.writeFileStatus = DATA_NUM_0;
-        int windex = ffp->record_write_data.windex;
-        ffp->record_write_data.recordFramesQueue[windex] = frData;
-        ffp->record_write_data.windex += DATA_NUM_1;
-        ffp->record_write_data.sampleRate = frame->sample_rate;
+/* after codec_pkt drained the decoder: reopen it for the codec of the next source, or flush it */
+static int decoder_reopen(FFPlayer *ffp, Decoder *d)
+{
+    VideoState *is = ffp->is;
+    AVCodecParameters *par = __atomic_exchange_n(&d->next_par, NULL, __ATOMIC_SEQ_CST);
+    int video = d == &is->viddec;
+    AVStream *st = video ? is->video_st : is->audio_st;
+    const char *codec_name = video ? ffp->video_codec_name : ffp->audio_codec_name;
+    AVCodecContext *avctx = NULL;
+    AVCodec *codec;
+    AVDictionary *opts = NULL;
+    int lowres = 0;
+    int ret;
+
+    if (!par) {
+        avcodec_flush_buffers(d->avctx);
+        return 0;
+    }
+    avctx = avcodec_alloc_context3(NULL);
+    if (!avctx) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    if ((ret = avcodec_parameters_to_context(avctx, par)) < 0)
+        goto fail;
+    // read_thread_map_packet() rescaled the packets to the stream of is->ic
+    av_codec_set_pkt_timebase(avctx, st->time_base);
+    codec = codec_name ? avcodec_find_decoder_by_name(codec_name) : NULL;
+    if (!codec || codec->id != avctx->codec_id)
+        codec = avcodec_find_decoder(avctx->codec_id);
+    if (!codec) {
+        ret = AVERROR_DECODER_NOT_FOUND;
+        goto fail;
+    }
+    if (ffp->fast)
+        avctx->flags2 |= AV_CODEC_FLAG2_FAST;
+    // what stream_component_open() and trick play set on the video decoder carries over
+    if (video) {
+        lowres = FFMIN(av_codec_get_lowres(d->avctx), av_codec_get_max_lowres(codec));
+        av_codec_set_lowres(avctx, lowres);
+        avctx->skip_frame       = d->avctx->skip_frame;
+        avctx->skip_loop_filter = d->avctx->skip_loop_filter;
+        avctx->skip_idct        = d->avctx->skip_idct;
+    }
+    opts = filter_codec_opts(ffp->codec_opts, avctx->codec_id, is->ic, st, codec);
+    if (!av_dict_get(opts, "threads", NULL, 0))
+        av_dict_set(&opts, "threads", "auto", 0);
+    if (lowres)
+        av_dict_set_int(&opts, "lowres", lowres, 0);
+    av_dict_set(&opts, "refcounted_frames", "1", 0);
+    if ((ret = avcodec_open2(avctx, codec, &opts)) < 0)
+        goto fail;
+    av_dict_free(&opts);
+    avcodec_parameters_free(&par);
+
+    av_log(NULL, AV_LOG_INFO, "%s decoder reopened for %s\n", video ? "video" : "audio", codec->name);
+    avcodec_free_context(&d->avctx);
+    d->avctx = avctx;
+    return 0;
+fail:
+    av_log(NULL, AV_LOG_ERROR, "%s decoder reopen failed: %s\n", video ? "video" : "audio", av_err2str(ret));
+    av_dict_free(&opts);
+    avcodec_free_context(&avctx);
+    avcodec_parameters_free(&par);
+    avcodec_flush_buffers(d->avctx);
+    return ret;
+}
+
+/*
+ * Trick play changes always seek, so the video decoder picks up the rate at
+ * the flush and switches skip_frame itself, avctx is not touched from the
+ * API thread.
+ */
+static void decoder_apply_trick_skip(FFPlayer *ffp, Decoder *d)
+{
+    VideoState *is = ffp->is;
+    int trick = is->trick_rate != 0;
+
+    if (d != &is->viddec || trick == is->trick_skip_applied)
+        return;
+    if (trick) {
+        is->trick_skip_frame = d->avctx->skip_frame;
+        d->avctx->skip_frame = AVDISCARD_NONKEY;
+    } else {
+        d->avctx->skip_frame = is->trick_skip_frame;
     }
+    is->trick_skip_applied = trick;
 }
 
 static int decoder_decode_frame(FFPlayer *ffp, Decoder *d, AVFrame *frame, AVSubtitle *sub) {
@@ -654,7 +487,7 @@ static int decoder_decode_frame(FFPlayer *ffp, Decoder *d, AVFrame *frame, AVSub
                             } else if (!ffp->decoder_reorder_pts) {
                                 frame->pts = frame->pkt_dts;
                             }
-                            record_video_frame(ffp, frame);
+                            RecordPushVideoFrame(ffp, frame);
                         }
                         break;
                     case AVMEDIA_TYPE_AUDIO:
@@ -669,15 +502,24 @@ static int decoder_decode_frame(FFPlayer *ffp, Decoder *d, AVFrame *frame, AVSub
                                 d->next_pts = frame->pts + frame->nb_samples;
                                 d->next_pts_tb = tb;
                             }
-                            record_audio_frame(ffp, frame);
+                            RecordPushAudioFrame(ffp, frame);
                         }
                         break;
                     default:
                         break;
                 }
+                if (ret == AVERROR_EOF && d->reopen) {
+                    // the frames before the source switch are out, the next ones come from the new source
+                    decoder_reopen(ffp, d);
+                    d->reopen   = 0;
+                    d->boundary = 1;
+                    ret = AVERROR(EAGAIN);
+                    break;
+                }
                 if (ret == AVERROR_EOF) {
                     d->finished = d->pkt_serial;
                     avcodec_flush_buffers(d->avctx);
+                    packet_queue_notify_consumed(d->queue);
                     return 0;
                 }
 
@@ -690,7 +532,7 @@ static int decoder_decode_frame(FFPlayer *ffp, Decoder *d, AVFrame *frame, AVSub
         do {
 
             if (d->queue->nb_packets == 0)
-                SDL_CondSignal(d->empty_queue_cond);
+                packet_queue_notify_consumed(d->queue);
             if (d->packet_pending) {
                 av_packet_move_ref(&pkt, &d->pkt);
                 d->packet_pending = 0;
@@ -703,9 +545,15 @@ static int decoder_decode_frame(FFPlayer *ffp, Decoder *d, AVFrame *frame, AVSub
 
         if (pkt.data == flush_pkt.data) {
             avcodec_flush_buffers(d->avctx);
+            decoder_apply_trick_skip(ffp, d);
             d->finished = 0;
+            d->reopen   = 0;
+            d->boundary = 0;
             d->next_pts = d->start_pts;
             d->next_pts_tb = d->start_pts_tb;
+        } else if (pkt.data == codec_pkt.data) {
+            d->reopen = 1;
+            avcodec_send_packet(d->avctx, NULL);
         } else {
             if (d->avctx->codec_type == AVMEDIA_TYPE_SUBTITLE) {
                 int got_frame = 0;
@@ -734,6 +582,7 @@ static int decoder_decode_frame(FFPlayer *ffp, Decoder *d, AVFrame *frame, AVSub
 
 static void decoder_destroy(Decoder *d) {
     av_packet_unref(&d->pkt);
+    avcodec_parameters_free(&d->next_par);
     avcodec_free_context(&d->avctx);
 }
 
@@ -855,6 +704,9 @@ static void frame_queue_next(FrameQueue *f)
     f->size--;
     SDL_CondSignal(f->cond);
     SDL_UnlockMutex(f->mutex);
+    /* an empty frame queue is what a read_thread at EOF waits for */
+    if (frame_queue_nb_remaining(f) == 0)
+        packet_queue_notify_consumed(f->pktq);
 }
 
 /* return the number of undisplayed frames in the queue */
@@ -946,12 +798,63 @@ static size_t parse_ass_subtitle(const char *ass, char *output)
     return 0;
 }
 
+static const char *prepare_stage_names[FFP_PREPARE_STAGE_NB] = {
+    [FFP_PREPARE_STAGE_OPEN_INPUT]                  = "open input",
+    [FFP_PREPARE_STAGE_FIND_STREAM_INFO]            = "find stream info",
+    [FFP_PREPARE_STAGE_VIDEO_DECODER_OPEN]          = "video decoder open",
+    [FFP_PREPARE_STAGE_AUDIO_DECODER_OPEN]          = "audio decoder open",
+    [FFP_PREPARE_STAGE_AUDIO_OUTPUT_OPEN]           = "audio output open",
+    [FFP_PREPARE_STAGE_RENDERER_READY]              = "renderer ready",
+    [FFP_PREPARE_STAGE_PREPARED]                    = "prepared",
+    [FFP_PREPARE_STAGE_FIRST_VIDEO_FRAME_DECODED]   = "first video frame decoded",
+    [FFP_PREPARE_STAGE_FIRST_VIDEO_FRAME_RENDERED]  = "first video frame rendered",
+    [FFP_PREPARE_STAGE_FIRST_AUDIO_FRAME_RENDERED]  = "first audio frame rendered",
+};
+
+/* the stages run on several threads, only the first time one is reached counts */
+static void ffp_prepare_stage(FFPlayer *ffp, int stage)
+{
+    int64_t unset = -1;
+    int64_t ms = (av_gettime_relative() - ffp->stat.prepare_start) / 1000;
+
+    if (__atomic_compare_exchange_n(&ffp->stat.prepare_stage_ms[stage], &unset, ms, 0,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+        av_log(ffp, AV_LOG_INFO, "prepare: %s at %"PRId64" ms\n", prepare_stage_names[stage], ms);
+}
+
+/* fill the overlay of vp from frame, when queued or, for a frame kept by reference, once it is shown */
+static int video_overlay_fill(FFPlayer *ffp, Frame *vp, const AVFrame *frame)
+{
+    int64_t fill_start = av_gettime_relative();
+    int ret;
+
+    SDL_VoutLockYUVOverlay(vp->bmp);
+    // FIXME: set swscale options
+    ret = SDL_VoutFillFrameYUVOverlay(vp->bmp, frame);
+    /* update the bitmap content */
+    SDL_VoutUnlockYUVOverlay(vp->bmp);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Cannot fill the overlay from a %s frame\n", av_get_pix_fmt_name(frame->format));
+        return ret;
+    }
+    ffp_overlay_fill_statistic_l(ffp, av_gettime_relative() - fill_start);
+    vp->uploaded = 1;
+    return 0;
+}
+
 static void video_image_display2(FFPlayer *ffp)
 {
     VideoState *is = ffp->is;
     Frame *vp;
     Frame *sp = NULL;
     vp = frame_queue_peek_last(&is->pictq);
+    if (vp->bmp && !vp->uploaded) {
+        // a frame queued by reference, the overlay links or converts it now
+        int ret = vp->frame->buf[0] ? video_overlay_fill(ffp, vp, vp->frame) : -1;
+        av_frame_unref(vp->frame);
+        if (ret < 0)
+            return;
+    }
     if (vp->bmp) {
         if (is->subtitle_st) {
             if (frame_queue_nb_remaining(&is->subpq) > 0) {
@@ -977,16 +880,16 @@ static void video_image_display2(FFPlayer *ffp)
         if (ffp->render_wait_start && !ffp->start_on_prepared && is->pause_req) {
             if (!ffp->first_video_frame_rendered) {
                 ffp->first_video_frame_rendered = 1;
+                ffp_prepare_stage(ffp, FFP_PREPARE_STAGE_FIRST_VIDEO_FRAME_RENDERED);
                 ffp_notify_msg1(ffp, FFP_MSG_VIDEO_RENDERING_START);
             }
-            while (is->pause_req && !is->abort_request) {
-                SDL_Delay(20);
-            }
+            stream_wait_pause_req(ffp, is);
         }
         SDL_VoutDisplayYUVOverlay(ffp->vout, vp->bmp);
         ffp->stat.vfps = SDL_SpeedSamplerAdd(&ffp->vfps_sampler, FFP_SHOW_VFPS_FFPLAY, "vfps[ffplay]");
         if (!ffp->first_video_frame_rendered) {
             ffp->first_video_frame_rendered = 1;
+            ffp_prepare_stage(ffp, FFP_PREPARE_STAGE_FIRST_VIDEO_FRAME_RENDERED);
             ffp_notify_msg1(ffp, FFP_MSG_VIDEO_RENDERING_START);
         }
 
@@ -1002,6 +905,17 @@ static void video_image_display2(FFPlayer *ffp)
                 }
             }
         }
+
+        if (is->scrub_serial == vp->serial) {
+            // after a gapless switch, the timeline of the source playing, as ffp_seek_to_l() takes it
+            int64_t start_time = is->src_switched ? is->play_src.begin : is->ic->start_time;
+            int64_t pos_ms = (int64_t)(vp->pts * 1000);
+            if (start_time > 0 && start_time != AV_NOPTS_VALUE)
+                pos_ms -= fftime_to_milliseconds(start_time);
+            is->scrub_serial = -1;
+            ffp_notify_msg3(ffp, FFP_MSG_SCRUB_FRAME_RENDERED, (int)pos_ms,
+                            (int)((av_gettime_relative() - is->scrub_seek_req_at) / 1000));
+        }
     }
     else{
     }
@@ -1028,6 +942,9 @@ static void stream_component_close(FFPlayer *ffp, int stream_index)
         swr_free(&is->swr_ctx);
         av_freep(&is->audio_buf1);
         is->audio_buf1_size = 0;
+        av_freep(&is->audio_new_buf);
+        is->audio_new_buf_size = 0;
+        ijk_timestretch_freep(&is->timestretch);
         is->audio_buf = NULL;
 
 #ifdef FFP_MERGE
@@ -1042,6 +959,7 @@ static void stream_component_close(FFPlayer *ffp, int stream_index)
     case AVMEDIA_TYPE_VIDEO:
         decoder_abort(&is->viddec, &is->pictq);
         decoder_destroy(&is->viddec);
+        is->trick_skip_applied = 0;
         break;
     case AVMEDIA_TYPE_SUBTITLE:
         decoder_abort(&is->subdec, &is->subpq);
@@ -1074,10 +992,36 @@ static void stream_close(FFPlayer *ffp)
     VideoState *is = ffp->is;
     /* XXX: use a special url_shutdown call to abort parse cleanly */
     is->abort_request = 1;
+    stream_wakeup_all(is);
     packet_queue_abort(&is->videoq);
     packet_queue_abort(&is->audioq);
+    if (is->reverse_tid) {
+        ffgopcache_abort(is->gop_cache);
+        SDL_LockMutex(is->reverse_mutex);
+        SDL_CondSignal(is->reverse_cond);
+        SDL_UnlockMutex(is->reverse_mutex);
+        av_log(NULL, AV_LOG_DEBUG, "wait for reverse_tid\n");
+        SDL_WaitThread(is->reverse_tid, NULL);
+    }
+    ffgopcache_closep(&is->gop_cache);
     av_log(NULL, AV_LOG_DEBUG, "wait for read_tid\n");
     SDL_WaitThread(is->read_tid, NULL);
+    ffkfindex_closep(&is->kf_index);
+    ffprobecache_closep(&is->probe_cache);
+    ffpreload_closep(&is->preload);
+    ffpreload_closep(&is->preload_draining);
+    if (is->read_src.ic != is->play_src.ic)
+        avformat_close_input(&is->read_src.ic);
+    avformat_close_input(&is->play_src.ic);
+    av_freep(&is->next_url);
+    av_free(is->next_url_req);
+    av_dict_free(&is->src_format_opts);
+    for (int i = 0; i < MAX_AUDIO_STANDBY; i++) {
+        packet_back_clear_l(&is->audio_standby[i].pkts);
+        av_freep(&is->audio_standby[i].pkts.pkts);
+    }
+    packet_back_clear_l(&is->audio_open_pkts.pkts);
+    av_freep(&is->audio_open_pkts.pkts.pkts);
 
     /* close each stream */
     if (is->audio_stream >= 0)
@@ -1087,6 +1031,7 @@ static void stream_close(FFPlayer *ffp)
     if (is->subtitle_stream >= 0)
         stream_component_close(ffp, is->subtitle_stream);
     avformat_close_input(&is->ic);
+    ffcrossfade_freep(&is->xfade);
 
     av_log(NULL, AV_LOG_DEBUG, "wait for video_refresh_tid\n");
     SDL_WaitThread(is->video_refresh_tid, NULL);
@@ -1102,17 +1047,22 @@ static void stream_close(FFPlayer *ffp)
     SDL_DestroyCond(is->audio_accurate_seek_cond);
     SDL_DestroyCond(is->video_accurate_seek_cond);
     SDL_DestroyCond(is->continue_read_thread);
+    SDL_DestroyMutex(is->read_wait_mutex);
+    SDL_DestroyCond(is->pause_cond);
+    SDL_DestroyMutex(is->pause_mutex);
+    ffbuffering_freep(&is->buffering_ctrl);
     SDL_DestroyMutex(is->accurate_seek_mutex);
     SDL_DestroyMutex(is->play_mutex);
+    SDL_DestroyCond(is->reverse_cond);
+    SDL_DestroyMutex(is->reverse_mutex);
+    SDL_DestroyMutex(is->pictq_write_mutex);
+    SDL_DestroyMutex(is->audio_switch_mutex);
 #if !CONFIG_AVFILTER
     sws_freeContext(is->img_convert_ctx);
 #endif
 #ifdef FFP_MERGE
     sws_freeContext(is->sub_convert_ctx);
 #endif
-    if (ffp->soundtouch_enable && is->handle != NULL) {
-        ijk_soundtouch_destroy(is->handle);
-    }
     if (ffp->get_img_info) {
         if (ffp->get_img_info->frame_img_convert_ctx) {
             sws_freeContext(ffp->get_img_info->frame_img_convert_ctx);
@@ -1239,6 +1189,58 @@ static void check_external_clock_speed(VideoState *is) {
    }
 }
 
+static void ffp_count_wakeup(FFPlayer *ffp)
+{
+    __atomic_add_fetch(&ffp->stat.thread_wakeups, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * The read, refresh and render-wait loops sleep until one of these tells
+ * them something changed: a seek, pause/resume, abort, a frame to show or
+ * the packet queues draining, see read_thread_on_consumed().
+ */
+static void read_thread_wakeup(VideoState *is)
+{
+    SDL_LockMutex(is->read_wait_mutex);
+    is->read_wakeup = 1;
+    SDL_CondSignal(is->continue_read_thread);
+    SDL_UnlockMutex(is->read_wait_mutex);
+}
+
+static void video_refresh_wakeup(VideoState *is)
+{
+    SDL_LockMutex(is->pictq.mutex);
+    is->refresh_wakeup = 1;
+    /* the video decoder may be waiting on the same cond for room */
+    SDL_CondBroadcast(is->pictq.cond);
+    SDL_UnlockMutex(is->pictq.mutex);
+}
+
+static void stream_wakeup_pause_waiters(VideoState *is)
+{
+    SDL_LockMutex(is->pause_mutex);
+    SDL_CondBroadcast(is->pause_cond);
+    SDL_UnlockMutex(is->pause_mutex);
+}
+
+static void stream_wakeup_all(VideoState *is)
+{
+    read_thread_wakeup(is);
+    video_refresh_wakeup(is);
+    stream_wakeup_pause_waiters(is);
+}
+
+/* render_wait_start: hold the first frame until playback is started */
+static void stream_wait_pause_req(FFPlayer *ffp, VideoState *is)
+{
+    SDL_LockMutex(is->pause_mutex);
+    while (is->pause_req && !is->abort_request) {
+        SDL_CondWait(is->pause_cond, is->pause_mutex);
+        ffp_count_wakeup(ffp);
+    }
+    SDL_UnlockMutex(is->pause_mutex);
+}
+
 /* seek in the stream */
 static void stream_seek(VideoState *is, int64_t pos, int64_t rel, int seek_by_bytes)
 {
@@ -1249,10 +1251,19 @@ static void stream_seek(VideoState *is, int64_t pos, int64_t rel, int seek_by_by
         if (seek_by_bytes)
             is->seek_flags |= AVSEEK_FLAG_BYTE;
         is->seek_req = 1;
-        SDL_CondSignal(is->continue_read_thread);
+        read_thread_wakeup(is);
     }
 }
 
+/* scrub seeks never wait for the one in flight, the latest target replaces any pending one */
+static void stream_scrub_seek(VideoState *is, int64_t pos)
+{
+    __atomic_store_n(&is->scrub_pos, pos, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&is->scrub_req_at, av_gettime_relative(), __ATOMIC_SEQ_CST);
+    __atomic_store_n(&is->scrub_seek_req, 1, __ATOMIC_SEQ_CST);
+    read_thread_wakeup(is);
+}
+
 /* pause or resume the video */
 static void stream_toggle_pause_l(FFPlayer *ffp, int pause_on)
 {
@@ -1270,12 +1281,17 @@ static void stream_toggle_pause_l(FFPlayer *ffp, int pause_on)
     } else {
     }
     set_clock(&is->extclk, get_clock(&is->extclk), is->extclk.serial);
+    int pause_audio = 0;
     if (is->step && (is->pause_req || is->buffering_on)) {
         is->paused = is->vidclk.paused = is->extclk.paused = pause_on;
     } else {
         is->paused = is->audclk.paused = is->vidclk.paused = is->extclk.paused = pause_on;
-        SDL_AoutPauseAudio(ffp->aout, pause_on);
+        pause_audio = 1;
     }
+    /* before touching aout, whose callback may be parked in stream_wait_pause_req() */
+    stream_wakeup_all(is);
+    if (pause_audio)
+        SDL_AoutPauseAudio(ffp->aout, pause_on);
 }
 
 static void stream_update_pause_l(FFPlayer *ffp)
@@ -1369,6 +1385,18 @@ static double vp_duration(VideoState *is, Frame *vp, Frame *nextvp) {
     }
 }
 
+/* trick play shows keyframes |rate| times faster than their pts step, in either direction */
+static double vp_trick_duration(VideoState *is, Frame *vp, Frame *nextvp) {
+    if (vp->serial == nextvp->serial) {
+        double duration = fabs(nextvp->pts - vp->pts) / fabs(is->trick_rate);
+        if (isnan(duration) || duration <= 0)
+            return 1.0 / TRICK_PLAY_MAX_FPS;
+        return duration;
+    } else {
+        return 0.0;
+    }
+}
+
 static void update_video_pts(VideoState *is, double pts, int64_t pos, int serial) {
     /* update current video pts */
     set_clock(&is->vidclk, pts, serial);
@@ -1420,7 +1448,10 @@ retry:
                 goto display;
 
             /* compute nominal last_duration */
-            last_duration = vp_duration(is, lastvp, vp);
+            if (is->trick_rate != 0)
+                last_duration = vp_trick_duration(is, lastvp, vp);
+            else
+                last_duration = vp_duration(is, lastvp, vp);
             delay = compute_target_delay(ffp, last_duration, is);
 
             time= av_gettime_relative()/1000000.0;
@@ -1443,7 +1474,7 @@ retry:
             if (frame_queue_nb_remaining(&is->pictq) > 1) {
                 Frame *nextvp = frame_queue_peek_next(&is->pictq);
                 duration = vp_duration(is, vp, nextvp);
-                if(!is->step && (ffp->framedrop > 0 || (ffp->framedrop && get_master_sync_type(is) != AV_SYNC_VIDEO_MASTER)) && time > is->frame_timer + duration) {
+                if(!is->step && is->trick_rate == 0 && (ffp->framedrop > 0 || (ffp->framedrop && get_master_sync_type(is) != AV_SYNC_VIDEO_MASTER)) && time > is->frame_timer + duration) {
                     frame_queue_next(&is->pictq);
                     goto retry;
                 }
@@ -1583,10 +1614,12 @@ static void alloc_picture(FFPlayer *ffp, int frame_format)
     SDL_UnlockMutex(is->pictq.mutex);
 }
 
+static int queue_picture_write(FFPlayer *ffp, AVFrame *src_frame, double pts, double duration, int64_t pos, int serial);
+static int queue_picture_write_l(FFPlayer *ffp, AVFrame *src_frame, double pts, double duration, int64_t pos, int serial);
+
 static int queue_picture(FFPlayer *ffp, AVFrame *src_frame, double pts, double duration, int64_t pos, int serial)
 {
     VideoState *is = ffp->is;
-    Frame *vp;
     int video_accurate_seek_fail = 0;
     int64_t video_seek_pos = 0;
     int64_t now = 0;
@@ -1690,6 +1723,25 @@ static int queue_picture(FFPlayer *ffp, AVFrame *src_frame, double pts, double d
            av_get_picture_type_char(src_frame->pict_type), pts);
 #endif
 
+    return queue_picture_write(ffp, src_frame, pts, duration, pos, serial);
+}
+
+/* the video decoder and the reverse thread both produce pictures, one at a time */
+static int queue_picture_write(FFPlayer *ffp, AVFrame *src_frame, double pts, double duration, int64_t pos, int serial)
+{
+    int ret;
+
+    SDL_LockMutex(ffp->is->pictq_write_mutex);
+    ret = queue_picture_write_l(ffp, src_frame, pts, duration, pos, serial);
+    SDL_UnlockMutex(ffp->is->pictq_write_mutex);
+    return ret;
+}
+
+static int queue_picture_write_l(FFPlayer *ffp, AVFrame *src_frame, double pts, double duration, int64_t pos, int serial)
+{
+    VideoState *is = ffp->is;
+    Frame *vp;
+
     if (!(vp = frame_queue_peek_writable(&is->pictq)))
         return -1;
 
@@ -1722,9 +1774,6 @@ static int queue_picture(FFPlayer *ffp, AVFrame *src_frame, double pts, double d
 
     /* if the frame is not skipped, then display it */
     if (vp->bmp) {
-        /* get a pointer on the bitmap */
-        SDL_VoutLockYUVOverlay(vp->bmp);
-
 #ifdef FFP_MERGE
 #if CONFIG_AVFILTER
         // FIXME use direct rendering
@@ -1734,13 +1783,14 @@ static int queue_picture(FFPlayer *ffp, AVFrame *src_frame, double pts, double d
         // sws_getCachedContext(...);
 #endif
 #endif
-        // FIXME: set swscale options
-        if (SDL_VoutFillFrameYUVOverlay(vp->bmp, src_frame) < 0) {
-            av_log(NULL, AV_LOG_FATAL, "Cannot initialize the conversion context\n");
-            exit(1);
+        vp->uploaded = 0;
+        if (!ffp->video_frame_ref || !src_frame->buf[0]) {
+            // planes a hardware decoder only lends until the frame is queued are copied now
+            if (video_overlay_fill(ffp, vp, src_frame) < 0) {
+                av_log(NULL, AV_LOG_FATAL, "Cannot initialize the conversion context\n");
+                exit(1);
+            }
         }
-        /* update the bitmap content */
-        SDL_VoutUnlockYUVOverlay(vp->bmp);
 
         vp->pts = pts;
         vp->duration = duration;
@@ -1750,11 +1800,13 @@ static int queue_picture(FFPlayer *ffp, AVFrame *src_frame, double pts, double d
         vp->bmp->sar_num = vp->sar.num;
         vp->bmp->sar_den = vp->sar.den;
 
-#ifdef FFP_MERGE
-        av_frame_move_ref(vp->frame, src_frame);
-#endif
+        if (!vp->uploaded) {
+            // kept by reference until shown, a frame dropped before that costs no copy
+            av_frame_move_ref(vp->frame, src_frame);
+        }
         frame_queue_push(&is->pictq);
         if (!is->viddec.first_frame_decoded) {
+            ffp_prepare_stage(ffp, FFP_PREPARE_STAGE_FIRST_VIDEO_FRAME_DECODED);
             ffp_notify_msg1(ffp, FFP_MSG_VIDEO_DECODED_START);
             is->viddec.first_frame_decoded_time = SDL_GetTickHR();
             is->viddec.first_frame_decoded = 1;
@@ -1956,10 +2008,18 @@ fail:
     return ret;
 }
 
+/* what audio_open() asks the audio output for, with SoundTouch what it processes */
+static enum AVSampleFormat audio_output_wanted_fmt(FFPlayer *ffp)
+{
+    if (ffp->soundtouch_enable)
+        return ijk_timestretch_sample_fmt();
+    return ffp->audio_float_output ? AV_SAMPLE_FMT_FLT : AV_SAMPLE_FMT_S16;
+}
+
 static int configure_audio_filters(FFPlayer *ffp, const char *afilters, int force_output_format)
 {
     VideoState *is = ffp->is;
-    static const enum AVSampleFormat sample_fmts[] = { AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_NONE };
+    enum AVSampleFormat sample_fmts[] = { AV_SAMPLE_FMT_NONE, AV_SAMPLE_FMT_NONE };
     int sample_rates[2] = { 0, -1 };
     int64_t channel_layouts[2] = { 0, -1 };
     int channels[2] = { 0, -1 };
@@ -2002,6 +2062,8 @@ static int configure_audio_filters(FFPlayer *ffp, const char *afilters, int forc
     if (ret < 0)
         goto end;
 
+    // the sink converts into what the audio output takes, once it is open
+    sample_fmts[0] = force_output_format ? is->audio_tgt.fmt : audio_output_wanted_fmt(ffp);
     if ((ret = av_opt_set_int_list(filt_asink, "sample_fmts", sample_fmts,  AV_SAMPLE_FMT_NONE, AV_OPT_SEARCH_CHILDREN)) < 0)
         goto end;
     if ((ret = av_opt_set_int(filt_asink, "all_channel_counts", 1, AV_OPT_SEARCH_CHILDREN)) < 0)
@@ -2049,6 +2111,67 @@ end:
 }
 #endif  /* CONFIG_AVFILTER */
 
+/*
+ * Crossfade of an audio-only source into the next one: the frames after
+ * xfade_from are held, the decoder boundary codec_pkt marks starts mixing the
+ * frames of the next source into them.
+ * @return 1 when frame was held and is not to be played now
+ */
+static int audio_thread_crossfade(FFPlayer *ffp, AVFrame *frame)
+{
+    VideoState *is = ffp->is;
+    Decoder *d = &is->auddec;
+    int64_t from = is->xfade_from;
+
+    if (is->xfade_state != XFADE_IDLE && is->xfade_serial != d->pkt_serial) {
+        ffcrossfade_reset(is->xfade);
+        is->xfade_state = XFADE_IDLE;
+    }
+    if (d->boundary) {
+        d->boundary = 0;
+        if (is->xfade_state == XFADE_HOLDING) {
+            is->xfade_state = XFADE_MIXING;
+            is->xfade_from  = AV_NOPTS_VALUE;
+        }
+    }
+    if (is->xfade_state == XFADE_MIXING) {
+        if (ffcrossfade_mix(is->xfade, frame) <= 0) {
+            ffcrossfade_reset(is->xfade);
+            is->xfade_state = XFADE_IDLE;
+        }
+        return 0;
+    }
+
+    if (from == AV_NOPTS_VALUE || frame->pts == AV_NOPTS_VALUE || is->xfade_state == XFADE_DRAINING ||
+        av_rescale(2 * frame->pts + frame->nb_samples, AV_TIME_BASE, 2 * frame->sample_rate) < from)
+        return 0;
+    if (ffcrossfade_hold(is->xfade, frame) < 0) {
+        av_log(NULL, AV_LOG_WARNING, "crossfade: could not hold the audio, playing it\n");
+        return 0;
+    }
+    is->xfade_state  = XFADE_HOLDING;
+    is->xfade_serial = d->pkt_serial;
+    av_frame_unref(frame);
+    return 1;
+}
+
+/* the held frames unmixed once the decoder finished without reaching the next source */
+static int audio_thread_crossfade_drain(FFPlayer *ffp, AVFrame *frame)
+{
+    VideoState *is = ffp->is;
+
+    if (is->xfade_state == XFADE_HOLDING && is->xfade_serial == is->auddec.pkt_serial &&
+        is->auddec.finished == is->auddec.pkt_serial)
+        is->xfade_state = XFADE_DRAINING;
+    if (is->xfade_state != XFADE_DRAINING)
+        return 0;
+    if (is->xfade_serial == is->auddec.pkt_serial && ffcrossfade_drain(is->xfade, frame) > 0)
+        return 1;
+    ffcrossfade_reset(is->xfade);
+    is->xfade_state = XFADE_IDLE;
+    return 0;
+}
+
 static int audio_thread(void *arg)
 {
     FFPlayer *ffp = arg;
@@ -2078,8 +2201,12 @@ static int audio_thread(void *arg)
 
     do {
         ffp_audio_statistic_l(ffp);
-        if ((got_frame = decoder_decode_frame(ffp, &is->auddec, frame, NULL)) < 0)
+        if (is->xfade && audio_thread_crossfade_drain(ffp, frame))
+            got_frame = 1;
+        else if ((got_frame = decoder_decode_frame(ffp, &is->auddec, frame, NULL)) < 0)
             goto the_end;
+        else if (got_frame && is->xfade && audio_thread_crossfade(ffp, frame))
+            continue;
 
         if (got_frame) {
                 tb = (AVRational){1, frame->sample_rate};
@@ -2537,6 +2664,46 @@ static int synchronize_audio(VideoState *is, int nb_samples)
     return wanted_nb_samples;
 }
 
+/*
+ * Stream data_size bytes of is->audio_buf, in the format of the audio output,
+ * through the time stretcher at the playback rate. Whatever it has ready comes
+ * out in is->audio_new_buf, nothing while it still needs input.
+ * @return the bytes is->audio_buf holds now
+ */
+static int audio_time_stretch(FFPlayer *ffp, int serial, int data_size)
+{
+    VideoState *is = ffp->is;
+    int frame_size = is->audio_tgt.frame_size;
+    int nb_frames;
+
+    if (is->audio_tgt.fmt != ijk_timestretch_sample_fmt())
+        return data_size;
+    if (is->timestretch && (ijk_timestretch_sample_rate(is->timestretch) != is->audio_tgt.freq ||
+                            ijk_timestretch_channels(is->timestretch) != is->audio_tgt.channels))
+        ijk_timestretch_freep(&is->timestretch);
+    if (!is->timestretch) {
+        if (!(is->timestretch = ijk_timestretch_create(is->audio_tgt.freq, is->audio_tgt.channels)))
+            return AVERROR(ENOMEM);
+        is->timestretch_serial = serial;
+    }
+    if (is->timestretch_serial != serial) {
+        ijk_timestretch_clear(is->timestretch);
+        is->timestretch_serial = serial;
+    }
+
+    ijk_timestretch_set_tempo(is->timestretch, ffp->pf_playback_rate);
+    ijk_timestretch_put(is->timestretch, is->audio_buf, data_size / frame_size);
+    nb_frames = ijk_timestretch_available(is->timestretch);
+    if (nb_frames <= 0)
+        return 0;
+    av_fast_malloc(&is->audio_new_buf, &is->audio_new_buf_size, (size_t)nb_frames * frame_size);
+    if (!is->audio_new_buf)
+        return AVERROR(ENOMEM);
+    nb_frames = ijk_timestretch_receive(is->timestretch, is->audio_new_buf, nb_frames);
+    is->audio_buf = is->audio_new_buf;
+    return nb_frames * frame_size;
+}
+
 /**
  * Decode one audio frame and return its uncompressed size.
  *
@@ -2552,7 +2719,6 @@ static int audio_decode_frame(FFPlayer *ffp)
     av_unused double audio_clock0;
     int wanted_nb_samples;
     Frame *af;
-    int translate_time = 1;
     int format = 0;
 
     if (is->paused || is->step)
@@ -2572,7 +2738,6 @@ static int audio_decode_frame(FFPlayer *ffp)
             return -1;
         }
     }
-reload:
     do {
 #if defined(_WIN32) || defined(__APPLE__)
         while (frame_queue_nb_remaining(&is->sampq) == 0) {
@@ -2672,29 +2837,18 @@ reload:
                 swr_free(&is->swr_ctx);
         }
         is->audio_buf = is->audio_buf1;
-        int bytes_per_sample = av_get_bytes_per_sample(is->audio_tgt.fmt);
-        resampled_data_size = len2 * is->audio_tgt.channels * bytes_per_sample;
-        if (ffp->soundtouch_enable && ffp->pf_playback_rate != 1.0f && !is->abort_request) {
-            av_fast_malloc(&is->audio_new_buf, &is->audio_new_buf_size, out_size * translate_time);
-            for (int i = 0; i < (resampled_data_size / 2); i++)
-            {
-                is->audio_new_buf[i] = (is->audio_buf1[i * 2] | (is->audio_buf1[i * 2 + 1] << 8));
-            }
-
-            int ret_len = ijk_soundtouch_translate(is->handle, is->audio_new_buf, (float)(ffp->pf_playback_rate), (float)(1.0f/ffp->pf_playback_rate),
-                    resampled_data_size / 2, bytes_per_sample, is->audio_tgt.channels, af->frame->sample_rate);
-            if (ret_len > 0) {
-                is->audio_buf = (uint8_t*)is->audio_new_buf;
-                resampled_data_size = ret_len;
-            } else {
-                translate_time++;
-                goto reload;
-            }
-        }
+        resampled_data_size = len2 * is->audio_tgt.frame_size;
     } else {
         is->audio_buf = af->frame->data[0];
         resampled_data_size = data_size;
     }
+    if (ffp->soundtouch_enable && ffp->pf_playback_rate != 1.0f && !is->abort_request) {
+        if ((resampled_data_size = audio_time_stretch(ffp, af->serial, resampled_data_size)) < 0)
+            return resampled_data_size;
+    } else if (is->timestretch && ijk_timestretch_latency(is->timestretch) > 0) {
+        // back at normal speed, what the stretcher still holds is dropped
+        ijk_timestretch_clear(is->timestretch);
+    }
 
     audio_clock0 = is->audio_clock;
     /* update the audio clock with the pts */
@@ -2702,6 +2856,9 @@ reload:
         is->audio_clock = af->pts + (double) af->frame->nb_samples / af->frame->sample_rate;
     else
         is->audio_clock = NAN;
+    // the stretcher is behind the frames it was given
+    if (is->timestretch)
+        is->audio_clock -= (double)ijk_timestretch_latency(is->timestretch) / ijk_timestretch_sample_rate(is->timestretch);
     is->audio_clock_serial = af->serial;
 #ifdef FFP_SHOW_AUDIO_DELAY
     {
@@ -2720,12 +2877,39 @@ reload:
     return resampled_data_size;
 }
 
-/* prepare a new audio buffer */
+/*
+ * Copy len bytes of decoded audio to the output, src NULL for silence. Volume
+ * and mute apply here: the gain moves towards them by at most one full swing
+ * per AUDIO_GAIN_RAMP_MS, so that a change does not click.
+ */
+static void audio_output_copy(FFPlayer *ffp, uint8_t *stream, const uint8_t *src, int len)
+{
+    VideoState *is = ffp->is;
+    float target = is->muted ? 0.0f : (float)is->audio_volume / SDL_MIX_MAXVOLUME;
+    float gain   = is->audio_gain;
+    int nb_frames = len / is->audio_tgt.frame_size;
+    float swing   = (float)nb_frames / (is->audio_tgt.freq * AUDIO_GAIN_RAMP_MS / 1000);
+    float end     = gain + av_clipf(target - gain, -swing, swing);
+
+    is->audio_gain = end;
+    if (!src || (gain == 0.0f && end == 0.0f)) {
+        memset(stream, 0, len);
+    } else if (gain == 1.0f && end == 1.0f) {
+        memcpy(stream, src, len);
+    } else if (is->audio_tgt.fmt == AV_SAMPLE_FMT_FLT) {
+        ijk_audio_apply_gain_f32((float *)stream, (const float *)src, nb_frames, is->audio_tgt.channels, gain, end);
+    } else {
+        ijk_audio_apply_gain_s16((int16_t *)stream, (const int16_t *)src, nb_frames, is->audio_tgt.channels, gain, end);
+    }
+}
+
+/* prepare a new audio buffer */
 static void sdl_audio_callback(void *opaque, Uint8 *stream, int len)
 {
     FFPlayer *ffp = opaque;
     VideoState *is = ffp->is;
     int audio_size, len1;
+    int callback_len = len;
     if (!ffp || !is) {
         memset(stream, 0, len);
         return;
@@ -2752,7 +2936,7 @@ static void sdl_audio_callback(void *opaque, Uint8 *stream, int len)
                is->audio_buf = NULL;
                is->audio_buf_size = SDL_AUDIO_MIN_BUFFER_SIZE / is->audio_tgt.frame_size * is->audio_tgt.frame_size;
            } else {
-               if (is->show_mode != SHOW_MODE_VIDEO)
+               if (is->show_mode != SHOW_MODE_VIDEO && is->audio_tgt.fmt == AV_SAMPLE_FMT_S16)
                    update_sample_display(is, (int16_t *)is->audio_buf, audio_size);
                is->audio_buf_size = audio_size;
            }
@@ -2769,13 +2953,7 @@ static void sdl_audio_callback(void *opaque, Uint8 *stream, int len)
         len1 = is->audio_buf_size - is->audio_buf_index;
         if (len1 > len)
             len1 = len;
-        if (!is->muted && is->audio_buf && is->audio_volume == SDL_MIX_MAXVOLUME)
-            memcpy(stream, (uint8_t *)is->audio_buf + is->audio_buf_index, len1);
-        else {
-            memset(stream, 0, len1);
-            if (!is->muted && is->audio_buf)
-                SDL_MixAudio(stream, (uint8_t *)is->audio_buf + is->audio_buf_index, len1, is->audio_volume);
-        }
+        audio_output_copy(ffp, stream, is->audio_buf ? (uint8_t *)is->audio_buf + is->audio_buf_index : NULL, len1);
         len -= len1;
         stream += len1;
         is->audio_buf_index += len1;
@@ -2783,11 +2961,22 @@ static void sdl_audio_callback(void *opaque, Uint8 *stream, int len)
     is->audio_write_buf_size = is->audio_buf_size - is->audio_buf_index;
     /* Let's assume the audio driver that is used by SDL has two periods. */
     if (!isnan(is->audio_clock)) {
-        set_clock_at(&is->audclk, is->audio_clock - (double)(is->audio_write_buf_size) / is->audio_tgt.bytes_per_sec - SDL_AoutGetLatencySeconds(ffp->aout), is->audio_clock_serial, ffp->audio_callback_time / 1000000.0);
+        double latency;
+        int64_t latency_time;
+        /* a measured latency holds at the time it was measured, an estimate at the callback */
+        if (SDL_AoutGetMeasuredLatency(ffp->aout, &latency, &latency_time) < 0) {
+            latency = SDL_AoutGetLatencySeconds(ffp->aout);
+            latency_time = ffp->audio_callback_time;
+        } else {
+            // the output only counts what it was handed, the buffer this callback fills plays after that
+            latency += (double)callback_len / is->audio_tgt.bytes_per_sec;
+        }
+        set_clock_at(&is->audclk, is->audio_clock - (double)(is->audio_write_buf_size) / is->audio_tgt.bytes_per_sec - latency, is->audio_clock_serial, latency_time / 1000000.0);
         sync_clock_to_slave(&is->extclk, &is->audclk);
     }
     if (!ffp->first_audio_frame_rendered) {
         ffp->first_audio_frame_rendered = 1;
+        ffp_prepare_stage(ffp, FFP_PREPARE_STAGE_FIRST_AUDIO_FRAME_RENDERED);
         ffp_notify_msg1(ffp, FFP_MSG_AUDIO_RENDERING_START);
     }
 
@@ -2802,11 +2991,8 @@ static void sdl_audio_callback(void *opaque, Uint8 *stream, int len)
         }
     }
 
-    if (ffp->render_wait_start && !ffp->start_on_prepared && is->pause_req) {
-        while (is->pause_req && !is->abort_request) {
-            SDL_Delay(20);
-        }
-    }
+    if (ffp->render_wait_start && !ffp->start_on_prepared && is->pause_req)
+        stream_wait_pause_req(ffp, is);
 }
 
 static int audio_open(FFPlayer *opaque, int64_t wanted_channel_layout, int wanted_nb_channels, int wanted_sample_rate, struct AudioParams *audio_hw_params)
@@ -2840,7 +3026,7 @@ static int audio_open(FFPlayer *opaque, int64_t wanted_channel_layout, int wante
     }
     while (next_sample_rate_idx && next_sample_rates[next_sample_rate_idx] >= wanted_spec.freq)
         next_sample_rate_idx--;
-    wanted_spec.format = AUDIO_S16SYS;
+    wanted_spec.format = audio_output_wanted_fmt(ffp) == AV_SAMPLE_FMT_FLT ? AUDIO_F32SYS : AUDIO_S16SYS;
     wanted_spec.silence = 0;
     wanted_spec.samples = FFMAX(SDL_AUDIO_MIN_BUFFER_SIZE, 2 << av_log2(wanted_spec.freq / SDL_AoutGetAudioPerSecondCallBacks(ffp->aout)));
     wanted_spec.callback = sdl_audio_callback;
@@ -2863,7 +3049,7 @@ static int audio_open(FFPlayer *opaque, int64_t wanted_channel_layout, int wante
         }
         wanted_channel_layout = av_get_default_channel_layout(wanted_spec.channels);
     }
-    if (spec.format != AUDIO_S16SYS) {
+    if (spec.format != AUDIO_S16SYS && spec.format != AUDIO_F32SYS) {
         av_log(NULL, AV_LOG_ERROR,
                "SDL advised audio format %d is not supported!\n", spec.format);
         return -1;
@@ -2877,7 +3063,7 @@ static int audio_open(FFPlayer *opaque, int64_t wanted_channel_layout, int wante
         }
     }
 
-    audio_hw_params->fmt = AV_SAMPLE_FMT_S16;
+    audio_hw_params->fmt = spec.format == AUDIO_F32SYS ? AV_SAMPLE_FMT_FLT : AV_SAMPLE_FMT_S16;
     audio_hw_params->freq = spec.freq;
     audio_hw_params->channel_layout = wanted_channel_layout;
     audio_hw_params->channels =  spec.channels;
@@ -2967,6 +3153,8 @@ static int stream_component_open(FFPlayer *ffp, int stream_index)
     if ((ret = avcodec_open2(avctx, codec, &opts)) < 0) {
         goto fail;
     }
+    if (avctx->codec_type == AVMEDIA_TYPE_AUDIO)
+        ffp_prepare_stage(ffp, FFP_PREPARE_STAGE_AUDIO_DECODER_OPEN);
     if ((t = av_dict_get(opts, "", NULL, AV_DICT_IGNORE_SUFFIX))) {
         av_log(NULL, AV_LOG_ERROR, "Option %s not found.\n", t->key);
 #ifdef FFP_MERGE
@@ -3008,6 +3196,7 @@ static int stream_component_open(FFPlayer *ffp, int stream_index)
         /* prepare audio output */
         if ((ret = audio_open(ffp, channel_layout, nb_channels, sample_rate, &is->audio_tgt)) < 0)
             goto fail;
+        ffp_prepare_stage(ffp, FFP_PREPARE_STAGE_AUDIO_OUTPUT_OPEN);
         ffp_set_audio_codec_info(ffp, AVCODEC_MODULE_NAME, avcodec_get_name(avctx->codec_id));
         is->audio_hw_buf_size = ret;
         is->audio_src = is->audio_tgt;
@@ -3024,7 +3213,7 @@ static int stream_component_open(FFPlayer *ffp, int stream_index)
         is->audio_stream = stream_index;
         is->audio_st = ic->streams[stream_index];
 
-        decoder_init(&is->auddec, avctx, &is->audioq, is->continue_read_thread);
+        decoder_init(&is->auddec, avctx, &is->audioq);
         if ((is->ic->iformat->flags & (AVFMT_NOBINSEARCH | AVFMT_NOGENSEARCH | AVFMT_NO_BYTE_SEEK)) && !is->ic->iformat->read_seek) {
             is->auddec.start_pts = is->audio_st->start_time;
             is->auddec.start_pts_tb = is->audio_st->time_base;
@@ -3046,19 +3235,20 @@ static int stream_component_open(FFPlayer *ffp, int stream_index)
                 ret = ffpipeline_config_video_decoder(ffp->pipeline, ffp);
             }
             if (ret || !ffp->node_vdec) {
-                decoder_init(&is->viddec, avctx, &is->videoq, is->continue_read_thread);
+                decoder_init(&is->viddec, avctx, &is->videoq);
                 ffp->node_vdec = ffpipeline_open_video_decoder(ffp->pipeline, ffp);
                 if (!ffp->node_vdec)
                     goto fail;
             }
         } else {
-            decoder_init(&is->viddec, avctx, &is->videoq, is->continue_read_thread);
+            decoder_init(&is->viddec, avctx, &is->videoq);
             ffp->node_vdec = ffpipeline_open_video_decoder(ffp->pipeline, ffp);
             if (!ffp->node_vdec)
                 goto fail;
         }
         if ((ret = decoder_start(&is->viddec, video_thread, ffp, "ff_video_dec")) < 0)
             goto out;
+        ffp_prepare_stage(ffp, FFP_PREPARE_STAGE_VIDEO_DECODER_OPEN);
 
         is->queue_attachments_req = 1;
 
@@ -3099,7 +3289,7 @@ static int stream_component_open(FFPlayer *ffp, int stream_index)
 
         ffp_set_subtitle_codec_info(ffp, AVCODEC_MODULE_NAME, avcodec_get_name(avctx->codec_id));
 
-        decoder_init(&is->subdec, avctx, &is->subtitleq, is->continue_read_thread);
+        decoder_init(&is->subdec, avctx, &is->subtitleq);
         if ((ret = decoder_start(&is->subdec, subtitle_thread, ffp, "ff_subtitle_dec")) < 0)
             goto out;
         break;
@@ -3112,43 +3302,1178 @@ fail:
     avcodec_free_context(&avctx);
 out:
     av_dict_free(&opts);
+    /* a new, empty queue means read_thread has to fill it */
+    read_thread_wakeup(is);
+
+    return ret;
+}
+
+static int decode_interrupt_cb(void *ctx)
+{
+    VideoState *is = ctx;
+    return is->abort_request;
+}
+
+/*
+ * Whether a stream has enough packets queued: more than percent of min_frames,
+ * or a ring at least percent full. Streams not playing, aborted queues and
+ * attached pictures always have enough.
+ */
+static int stream_has_packets_above(AVStream *st, int stream_id, PacketQueue *queue, int min_frames, int percent) {
+    return stream_id < 0 ||
+           !st ||
+           queue->abort_request ||
+           (queue->ring && packet_ring_count(queue) * 100 >= (int64_t)queue->ring_capacity * percent) ||
+           (st->disposition & AV_DISPOSITION_ATTACHED_PIC) ||
+           (int64_t)queue->nb_packets * 100 > (int64_t)min_frames * percent;
+}
+
+/* the "no need to read more" test of read_thread, percent = 100 for the real limits */
+static int read_queues_full(FFPlayer *ffp, VideoState *is, int percent)
+{
+    int64_t size = (int64_t)is->audioq.size + is->videoq.size + is->subtitleq.size;
+
+    return ffp->infinite_buffer < 1 &&
+           (size * 100 > (int64_t)ffp->dcc.max_buffer_size * percent
+            || (   stream_has_packets_above(is->audio_st, is->audio_stream, &is->audioq, MIN_FRAMES, percent)
+                && stream_has_packets_above(is->video_st, is->video_stream, &is->videoq, MIN_FRAMES, percent)
+                && stream_has_packets_above(is->subtitle_st, is->subtitle_stream, &is->subtitleq, MIN_FRAMES, percent)));
+}
+
+static int read_rings_full(VideoState *is, int percent)
+{
+    PacketQueue *queues[] = { &is->videoq, &is->audioq, &is->subtitleq };
+
+    for (size_t i = 0; i < FF_ARRAY_ELEMS(queues); i++) {
+        PacketQueue *q = queues[i];
+        if (q->ring && packet_ring_count(q) * 100 >= (int64_t)q->ring_capacity * percent)
+            return 1;
+    }
+    return 0;
+}
+
+static int read_thread_should_wake(FFPlayer *ffp, VideoState *is, int reason)
+{
+    switch (reason) {
+    case READ_WAIT_QUEUES_FULL:
+        return !read_queues_full(ffp, is, READ_LOW_WATERMARK_PERCENT);
+    case READ_WAIT_RING_FULL:
+        return !read_rings_full(is, READ_LOW_WATERMARK_PERCENT);
+    case READ_WAIT_ANY:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* PacketQueue.consumed_cb, runs on the decoder threads */
+static void read_thread_on_consumed(void *opaque)
+{
+    FFPlayer *ffp = opaque;
+    VideoState *is = ffp->is;
+    int reason;
+
+    if (!is)
+        return;
+    /* pairs with the fence in read_thread_wait(): either we see the reason or it sees our update */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    reason = __atomic_load_n(&is->read_wait_reason, __ATOMIC_SEQ_CST);
+    if (reason != READ_WAIT_NONE && read_thread_should_wake(ffp, is, reason))
+        read_thread_wakeup(is);
+}
+
+/*
+ * Sleep until read_thread_wakeup(), or timeout_ms when >= 0. For
+ * READ_WAIT_QUEUES_FULL / READ_WAIT_RING_FULL the consumers only wake us
+ * once the queues drained below READ_LOW_WATERMARK_PERCENT, so a refill
+ * reads a batch of packets instead of one per wakeup.
+ */
+static void read_thread_wait(FFPlayer *ffp, VideoState *is, int reason, int timeout_ms)
+{
+    SDL_LockMutex(is->read_wait_mutex);
+    __atomic_store_n(&is->read_wait_reason, reason, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!is->read_wakeup && !is->abort_request &&
+        (reason == READ_WAIT_ANY || !read_thread_should_wake(ffp, is, reason))) {
+        if (timeout_ms < 0)
+            SDL_CondWait(is->continue_read_thread, is->read_wait_mutex);
+        else
+            SDL_CondWaitTimeout(is->continue_read_thread, is->read_wait_mutex, timeout_ms);
+        ffp_count_wakeup(ffp);
+    }
+    __atomic_store_n(&is->read_wait_reason, READ_WAIT_NONE, __ATOMIC_SEQ_CST);
+    is->read_wakeup = 0;
+    SDL_UnlockMutex(is->read_wait_mutex);
+}
+
+static int is_realtime(AVFormatContext *s)
+{
+    if(   !strcmp(s->iformat->name, "rtp")
+       || !strcmp(s->iformat->name, "rtsp")
+       || !strcmp(s->iformat->name, "sdp")
+    )
+        return 1;
+
+    if(s->pb && (   !strncmp(s->filename, "rtp:", 4)
+                 || !strncmp(s->filename, "udp:", 4)
+                )
+    )
+        return 1;
+    return 0;
+}
+
+
+/* dir when set, else the directory of the cache_file_path option; av_free() the result */
+static char *read_thread_cache_dir(const char *dir, AVDictionary *open_opts)
+{
+    AVDictionaryEntry *t;
+    char *cache_dir = NULL;
+
+    if (dir) {
+        cache_dir = av_strdup(dir);
+    } else if ((t = av_dict_get(open_opts, "cache_file_path", NULL, AV_DICT_MATCH_CASE)) && t->value[0]) {
+        char *path = av_strdup(t->value);
+        if (path)
+            cache_dir = av_strdup(av_dirname(path));
+        av_free(path);
+    }
+    return cache_dir;
+}
+
+/*
+ * A cached probe result is only used when the first video keyframe is still
+ * where it was when the entry was stored. The packets up to it are read and
+ * the input rewound, a mismatch drops the entry so that the real probe runs.
+ * @return 0 when the input is back at its start
+ */
+static int read_thread_verify_probe_cache(VideoState *is, AVFormatContext *ic)
+{
+    AVPacket pkt;
+    int64_t start_pos = avio_tell(ic->pb);
+    int64_t first_dts = AV_NOPTS_VALUE;
+    int first_stream = -1;
+    int video = av_find_best_stream(ic, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    int i, ret = 0;
+
+    if (!ffprobecache_has_entry(is->probe_cache) || video < 0)
+        return 0;
+    for (i = 0; i < PROBE_CACHE_VERIFY_PACKETS; i++) {
+        if ((ret = av_read_frame(ic, &pkt)) < 0)
+            break;
+        if (first_stream < 0 && pkt.dts != AV_NOPTS_VALUE) {
+            first_stream = pkt.stream_index;
+            first_dts    = pkt.dts;
+        }
+        if (pkt.stream_index == video && (pkt.flags & AV_PKT_FLAG_KEY)) {
+            ffprobecache_check_keyframe(is->probe_cache, pkt.pos);
+            av_packet_unref(&pkt);
+            break;
+        }
+        av_packet_unref(&pkt);
+    }
 
+    ret = -1;
+    if (first_stream >= 0)
+        ret = av_seek_frame(ic, first_stream, first_dts, AVSEEK_FLAG_BACKWARD);
+    if (ret < 0 && !(ic->iformat->flags & AVFMT_NO_BYTE_SEEK))
+        ret = av_seek_frame(ic, -1, start_pos, AVSEEK_FLAG_BYTE);
+    if (ret < 0)
+        av_log(NULL, AV_LOG_WARNING, "%s: could not rewind after the probe cache check\n", is->filename);
+    return ret;
+}
+
+/* containers without a seek index get one from the keyframes read_thread sees */
+static void read_thread_open_kf_index(FFPlayer *ffp, VideoState *is, AVDictionary *open_opts)
+{
+    AVFormatContext *ic = is->ic;
+    char *dir = NULL;
+
+    if (!ffp->keyframe_index || !is->video_st || !ic->pb || !(ic->pb->seekable & AVIO_SEEKABLE_NORMAL) ||
+        (ic->iformat->flags & AVFMT_NO_BYTE_SEEK))
+        return;
+    // a generic index only holds what was demuxed so far, a real one (mp4, mkv cues) needs no help
+    if (!(ic->iformat->flags & AVFMT_GENERIC_INDEX) && is->video_st->nb_index_entries > 1)
+        return;
+
+    dir = read_thread_cache_dir(ffp->keyframe_index_dir, open_opts);
+    is->kf_index          = ffkfindex_open(dir, is->filename, avio_size(ic->pb));
+    is->kf_index_stream   = is->video_stream;
+    is->kf_index_last_pts = AV_NOPTS_VALUE;
+    // ijkio urls share their cache with the player, a second reader would fight over it
+    if (is->kf_index && ffp->keyframe_index_prepass && !av_strstart(is->filename, "ijkio:", NULL))
+        ffkfindex_start_prepass(is->kf_index, is->filename, ic->iformat, open_opts);
+    av_free(dir);
+}
+
+static void read_thread_index_keyframe(VideoState *is, const AVPacket *pkt)
+{
+    if (pkt->stream_index != is->kf_index_stream || !(pkt->flags & AV_PKT_FLAG_KEY))
+        return;
+
+    // a keyframe without a timestamp or a position isn't indexed, the next one doesn't follow an indexed one
+    int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+    if (ts == AV_NOPTS_VALUE || pkt->pos < 0) {
+        is->kf_index_last_pts = AV_NOPTS_VALUE;
+        return;
+    }
+
+    int64_t pts_us = av_rescale_q(ts, is->ic->streams[pkt->stream_index]->time_base, AV_TIME_BASE_Q);
+    // after open, a seek or a timestamp jump nothing says the previous keyframe was the one before
+    int contiguous = is->kf_index_last_pts != AV_NOPTS_VALUE && pts_us > is->kf_index_last_pts;
+    ffkfindex_add(is->kf_index, pts_us, pkt->pos, contiguous);
+    is->kf_index_last_pts = pts_us;
+}
+
+/* byte seek straight to the keyframe starting the GOP of the target when the index knows it */
+static int read_thread_seek_kf_index(VideoState *is, int64_t seek_min, int64_t seek_target, int64_t seek_max)
+{
+    int64_t kf_pts;
+    int64_t kf_pos;
+
+    if (!is->kf_index || (is->seek_flags & AVSEEK_FLAG_BYTE) ||
+        ffkfindex_lookup(is->kf_index, seek_target, &kf_pts, &kf_pos) < 0 ||
+        kf_pts < seek_min || kf_pts > seek_max)
+        return AVERROR(ENOENT);
+
+    int ret = avformat_seek_file(is->ic, -1, kf_pos, kf_pos, kf_pos, AVSEEK_FLAG_BYTE);
+    if (ret >= 0)
+        av_log(NULL, AV_LOG_DEBUG, "kfindex: seek %"PRId64" via keyframe %"PRId64" at %"PRId64"\n",
+               seek_target, kf_pts, kf_pos);
+    return ret;
+}
+
+typedef struct SeekInBufferStream {
+    PacketQueue     *q;
+    AVStream        *st;
+    int              media_type;
+    int              discard;       // attached picture, queue_attachments_req puts it back
+    MyAVPacketList  *queued;        // drained from q, oldest first
+    int              nb_queued;
+    MyAVPacketList **timeline;      // back buffer entries, then the queued ones of the current serial
+    int              nb_timeline;
+    int              nb_back;
+    int              start;         // timeline entry playback restarts from, -1 for none
+    MyAVPacketList  *replay;
+    int              nb_replay;
+} SeekInBufferStream;
+
+static int64_t packet_pts_us(AVStream *st, const AVPacket *pkt)
+{
+    int64_t ts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+
+    return ts == AV_NOPTS_VALUE ? AV_NOPTS_VALUE : av_rescale_q(ts, st->time_base, AV_TIME_BASE_Q);
+}
+
+/* back buffer locked; find where the stream has to restart for seek_target */
+static int seek_in_buffer_plan(SeekInBufferStream *s, int64_t seek_min, int64_t seek_target)
+{
+    PacketBackBuffer *b = &s->q->back;
+    int     serial      = s->q->serial;
+    int64_t next_seq    = s->q->put_seq;
+    int64_t last_pts    = INT64_MIN;
+    int     first_current = -1;
+    int     i;
+
+    s->start = -1;
+    if (s->discard)
+        return 0;
+
+    s->timeline = av_malloc_array(b->count + s->nb_queued + 1, sizeof(*s->timeline));
+    s->replay   = av_malloc_array(b->count + s->nb_queued + 1, sizeof(*s->replay));
+    if (!s->timeline || !s->replay)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < s->nb_queued; i++) {
+        if (s->queued[i].serial == serial && s->queued[i].seq >= 0) {
+            first_current = i;
+            next_seq = s->queued[i].seq;
+            break;
+        }
+    }
+    // what the decoder took lately is only usable when nothing is missing up to the queue
+    if (b->count > 0 && b->serial == serial && packet_back_at(b, b->count - 1)->seq + 1 == next_seq) {
+        for (i = 0; i < b->count; i++)
+            s->timeline[s->nb_timeline++] = packet_back_at(b, i);
+        s->nb_back = b->count;
+    }
+    for (i = first_current; i >= 0 && i < s->nb_queued; i++) {
+        if (s->queued[i].serial == serial && s->queued[i].seq >= 0)
+            s->timeline[s->nb_timeline++] = &s->queued[i];
+    }
+
+    for (i = 0; i < s->nb_timeline; i++) {
+        const AVPacket *pkt = &s->timeline[i]->pkt;
+        int64_t pts = packet_pts_us(s->st, pkt);
+        if (pts == AV_NOPTS_VALUE)
+            continue;
+        last_pts = FFMAX(last_pts, pts);
+
+        switch (s->media_type) {
+        case AVMEDIA_TYPE_VIDEO:
+            if ((pkt->flags & AV_PKT_FLAG_KEY) && pts >= seek_min && pts <= seek_target)
+                s->start = i;
+            break;
+        case AVMEDIA_TYPE_AUDIO:
+            if (pts >= seek_min && pts <= seek_target)
+                s->start = i;
+            break;
+        default:
+            if (s->start < 0 && pts + av_rescale_q(pkt->duration, s->st->time_base, AV_TIME_BASE_Q) >= seek_target)
+                s->start = i;
+            break;
+        }
+    }
+
+    // subtitles are sparse, having none to show is fine
+    if (s->media_type != AVMEDIA_TYPE_SUBTITLE && (s->start < 0 || last_pts < seek_target))
+        return AVERROR(ENOENT);
+    return 0;
+}
+
+/* back buffer locked; split the timeline into what is replayed and what goes to the back buffer */
+static void seek_in_buffer_split(SeekInBufferStream *s)
+{
+    PacketBackBuffer *b = &s->q->back;
+    int end = s->start >= 0 ? s->start : s->nb_timeline;
+    int i;
+
+    if (s->discard) {
+        packet_back_clear_l(b);
+        return;
+    }
+
+    for (i = end; i < s->nb_timeline; i++)
+        s->replay[s->nb_replay++] = *s->timeline[i];
+    for (i = end; i < s->nb_back; i++)
+        b->size -= s->timeline[i]->pkt.size + sizeof(MyAVPacketList);
+    if (!s->nb_back)
+        packet_back_clear_l(b);
+    else if (end < s->nb_back)
+        b->count = end;
+
+    // labelled with the serial the flush_pkt put next gives them
+    b->serial = s->q->serial + 1;
+    for (i = s->nb_back; i < s->nb_timeline; i++) {
+        MyAVPacketList *pkt1 = s->timeline[i];
+        if (i < end) {
+            pkt1->serial = b->serial;
+            packet_back_push_l(b, pkt1);
+        }
+        av_init_packet(&pkt1->pkt);
+        pkt1->pkt.data = NULL;
+        pkt1->pkt.size = 0;
+    }
+}
+
+/*
+ * Serve a seek from packets already read: the queues and the back buffers
+ * are searched for a keyframe before the target, and playback restarts there
+ * without touching the demuxer, which keeps reading where it was.
+ */
+static int read_thread_seek_in_buffer(FFPlayer *ffp, VideoState *is, int64_t seek_min, int64_t seek_target, int64_t seek_max)
+{
+    SeekInBufferStream streams[3];
+    int nb_streams = 0;
+    int ret = 0;
+    int i, j;
+
+    if (!ffp->seek_in_buffer || (is->seek_flags & AVSEEK_FLAG_BYTE) || seek_target > seek_max)
+        return AVERROR(ENOENT);
+    // the buffered packets run across a decoder reopen the replay would miss
+    if (is->read_src.ic != is->play_src.ic && (is->read_src.codec_mark || is->read_src.video_codec_mark))
+        return AVERROR(ENOENT);
+
+    memset(streams, 0, sizeof(streams));
+    if (is->video_stream >= 0) {
+        streams[nb_streams].q          = &is->videoq;
+        streams[nb_streams].st         = is->video_st;
+        streams[nb_streams].media_type = AVMEDIA_TYPE_VIDEO;
+        streams[nb_streams].discard    = !!(is->video_st->disposition & AV_DISPOSITION_ATTACHED_PIC);
+        nb_streams++;
+    }
+    if (is->audio_stream >= 0) {
+        streams[nb_streams].q          = &is->audioq;
+        streams[nb_streams].st         = is->audio_st;
+        streams[nb_streams].media_type = AVMEDIA_TYPE_AUDIO;
+        nb_streams++;
+    }
+    if (is->subtitle_stream >= 0) {
+        streams[nb_streams].q          = &is->subtitleq;
+        streams[nb_streams].st         = is->subtitle_st;
+        streams[nb_streams].media_type = AVMEDIA_TYPE_SUBTITLE;
+        nb_streams++;
+    }
+    if (!nb_streams)
+        return AVERROR(ENOENT);
+
+    for (i = 0; i < nb_streams && ret >= 0; i++)
+        ret = packet_queue_take_all(streams[i].q, &streams[i].queued, &streams[i].nb_queued);
+
+    for (i = 0; i < nb_streams; i++)
+        SDL_LockMutex(streams[i].q->back.mutex);
+    for (i = 0; i < nb_streams && ret >= 0; i++)
+        ret = seek_in_buffer_plan(&streams[i], seek_min, seek_target);
+    if (ret >= 0) {
+        for (i = 0; i < nb_streams; i++)
+            seek_in_buffer_split(&streams[i]);
+    }
+    for (i = nb_streams - 1; i >= 0; i--)
+        SDL_UnlockMutex(streams[i].q->back.mutex);
+
+    for (i = 0; i < nb_streams; i++) {
+        SeekInBufferStream *s = &streams[i];
+
+        if (ret >= 0) {
+            for (j = 0; j < s->nb_queued; j++)
+                av_packet_unref(&s->queued[j].pkt);
+            if (s->media_type == AVMEDIA_TYPE_VIDEO && ffp->node_vdec)
+                ffpipenode_flush(ffp->node_vdec);
+            packet_queue_put(s->q, &flush_pkt);
+            for (j = 0; j < s->nb_replay; j++) {
+                if (packet_queue_append(s->q, &s->replay[j], 0) < 0)
+                    av_packet_unref(&s->replay[j].pkt);
+            }
+        } else {
+            // put everything back as it was
+            for (j = 0; j < s->nb_queued; j++) {
+                if (packet_queue_append(s->q, &s->queued[j], 1) < 0)
+                    av_packet_unref(&s->queued[j].pkt);
+            }
+        }
+        av_free(s->queued);
+        av_free(s->timeline);
+        av_free(s->replay);
+    }
+
+    if (ret >= 0)
+        av_log(NULL, AV_LOG_DEBUG, "seek %"PRId64" served from buffered packets\n", seek_target);
     return ret;
 }
 
-static int decode_interrupt_cb(void *ctx)
+/* rewind: seek to the keyframe before the one shown last */
+static int read_thread_trick_seek_back(VideoState *is)
+{
+    int64_t start_time = is->ic->start_time != AV_NOPTS_VALUE ? is->ic->start_time : 0;
+    int64_t target;
+    int ret;
+
+    if (is->trick_last_pts <= start_time)
+        return AVERROR_EOF;
+
+    target = FFMAX(is->trick_last_pts - is->trick_step, start_time);
+    ret = read_thread_seek_kf_index(is, INT64_MIN, target, target);
+    if (ret < 0)
+        ret = avformat_seek_file(is->ic, -1, INT64_MIN, target, target, 0);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_WARNING, "trick play: seek back to %"PRId64" failed\n", target);
+        return ret;
+    }
+    is->kf_index_last_pts = AV_NOPTS_VALUE;
+    is->trick_kf_wait = 1;
+    is->eof = 0;
+    return 0;
+}
+
+/* the rewind seek found nothing before trick_last_pts, aim further back */
+static void read_thread_trick_no_progress(VideoState *is)
+{
+    int64_t start_time = is->ic->start_time != AV_NOPTS_VALUE ? is->ic->start_time : 0;
+
+    is->trick_kf_wait = 0;
+    if (is->trick_last_pts - is->trick_step <= start_time)
+        is->trick_last_pts = start_time;
+    else
+        is->trick_step *= 2;
+}
+
+/* only keyframes make it to the decoder, at most TRICK_PLAY_MAX_FPS of them per second of playback */
+static void read_thread_trick_packet(VideoState *is, AVPacket *pkt)
+{
+    int64_t spacing = (int64_t)(fabsf(is->trick_rate) * AV_TIME_BASE / TRICK_PLAY_MAX_FPS);
+    int64_t pts;
+
+    if (pkt->stream_index != is->video_stream || !(pkt->flags & AV_PKT_FLAG_KEY)) {
+        av_packet_unref(pkt);
+        return;
+    }
+
+    pts = packet_pts_us(is->video_st, pkt);
+    if (is->trick_rate < 0) {
+        if (!is->trick_kf_wait) {
+            av_packet_unref(pkt);
+            return;
+        }
+        if (pts == AV_NOPTS_VALUE || pts >= is->trick_last_pts) {
+            av_packet_unref(pkt);
+            read_thread_trick_no_progress(is);
+            return;
+        }
+        is->trick_kf_wait = 0;
+        is->trick_step    = spacing;
+        is->trick_last_pts = pts;
+        packet_queue_put(&is->videoq, pkt);
+        // every keyframe is decoded on its own, the null packet drains it out of the decoder
+        packet_queue_put_nullpacket(&is->videoq, is->video_stream);
+    } else {
+        if (pts != AV_NOPTS_VALUE && is->trick_last_pts != AV_NOPTS_VALUE &&
+            pts > is->trick_last_pts && pts - is->trick_last_pts < spacing) {
+            av_packet_unref(pkt);
+            return;
+        }
+        if (pts != AV_NOPTS_VALUE)
+            is->trick_last_pts = pts;
+        packet_queue_put(&is->videoq, pkt);
+    }
+}
+
+/*
+ * Hot-standby audio tracks: up to audio_standby_tracks alternate audio streams
+ * stay demuxed into side buffers of compressed packets, trimmed to the playback
+ * position, so that switching to one primes its decoder from memory instead of
+ * waiting for the queues to refill. Only touched under audio_switch_mutex.
+ */
+static AudioStandby *audio_standby_find(VideoState *is, int stream)
+{
+    if (stream < 0)
+        return NULL;
+    for (int i = 0; i < MAX_AUDIO_STANDBY; i++) {
+        if (is->audio_standby[i].stream == stream)
+            return &is->audio_standby[i];
+    }
+    return NULL;
+}
+
+static void audio_standby_reset(AudioStandby *sb, int stream)
+{
+    packet_back_clear_l(&sb->pkts);
+    sb->stream = stream;
+    sb->seq    = 0;
+}
+
+static void audio_standby_flush(VideoState *is)
+{
+    for (int i = 0; i < MAX_AUDIO_STANDBY; i++)
+        audio_standby_reset(&is->audio_standby[i], is->audio_standby[i].stream);
+}
+
+/* takes over pkt */
+static void audio_standby_put(VideoState *is, AudioStandby *sb, AVPacket *pkt)
+{
+    AVStream *st = is->ic->streams[sb->stream];
+    double clock = get_master_clock(is);
+    MyAVPacketList pkt1;
+    int64_t keep_from, pts;
+
+    pkt1.pkt    = *pkt;
+    pkt1.next   = NULL;
+    pkt1.serial = 0;
+    pkt1.seq    = sb->seq++;
+    packet_back_push_l(&sb->pkts, &pkt1);
+
+    if (isnan(clock))
+        return;
+    // keep the packet the playback position falls into, drop the ones before
+    keep_from = (int64_t)(clock * AV_TIME_BASE) - AUDIO_STANDBY_KEEP_BEHIND;
+    while (sb->pkts.count > 1) {
+        pts = packet_pts_us(st, &packet_back_at(&sb->pkts, 1)->pkt);
+        if (pts == AV_NOPTS_VALUE || pts > keep_from)
+            break;
+        packet_back_drop_front_l(&sb->pkts);
+    }
+}
+
+static void read_thread_open_audio_standby(FFPlayer *ffp, VideoState *is)
+{
+    AVFormatContext *ic = is->ic;
+    int n = 0;
+
+    if (is->audio_stream < 0)
+        return;
+
+    SDL_LockMutex(is->audio_switch_mutex);
+    for (int i = 0; i < ic->nb_streams && n < ffp->audio_standby_tracks; i++) {
+        if (i == is->audio_stream || ic->streams[i]->codecpar->codec_type != AVMEDIA_TYPE_AUDIO)
+            continue;
+        audio_standby_reset(&is->audio_standby[n++], i);
+        ic->streams[i]->discard = AVDISCARD_DEFAULT;
+    }
+    SDL_UnlockMutex(is->audio_switch_mutex);
+    if (n > 0)
+        av_log(ffp, AV_LOG_INFO, "%d audio track(s) on standby\n", n);
+}
+
+/* parallel-prepare: audio decoder and output open here while read_thread opens the video decoder */
+static int audio_open_thread(void *arg)
+{
+    FFPlayer *ffp = arg;
+    VideoState *is = ffp->is;
+
+    if (stream_component_open(ffp, is->audio_open_stream) < 0)
+        av_log(ffp, AV_LOG_WARNING, "audio stream %d failed to open\n", is->audio_open_stream);
+    __atomic_store_n(&is->audio_open_pending, 0, __ATOMIC_SEQ_CST);
+    read_thread_wakeup(is);
+    return 0;
+}
+
+static void read_thread_open_audio(FFPlayer *ffp, VideoState *is, int stream_index)
+{
+    if (ffp->parallel_prepare) {
+        is->audio_open_stream  = stream_index;
+        is->audio_open_pending = 1;
+        audio_standby_reset(&is->audio_open_pkts, stream_index);
+        is->audio_open_tid = SDL_CreateThreadEx(&is->_audio_open_tid, audio_open_thread, ffp, "ff_audio_open");
+        if (is->audio_open_tid)
+            return;
+        av_log(ffp, AV_LOG_WARNING, "SDL_CreateThread(): %s, opening audio in line\n", SDL_GetError());
+        is->audio_open_pending = 0;
+        is->audio_open_pkts.stream = -1;
+    }
+    stream_component_open(ffp, stream_index);
+}
+
+/*
+ * Join audio_open_thread and hand audioq the audio read while it ran.
+ * Without wait only a finished thread is joined.
+ * @return 1 when the thread was joined by this call
+ */
+static int read_thread_join_audio_open(FFPlayer *ffp, VideoState *is, int wait)
+{
+    AudioStandby *held = &is->audio_open_pkts;
+
+    if (!is->audio_open_tid)
+        return 0;
+    if (!wait && __atomic_load_n(&is->audio_open_pending, __ATOMIC_SEQ_CST))
+        return 0;
+    SDL_WaitThread(is->audio_open_tid, NULL);
+    is->audio_open_tid = NULL;
+
+    SDL_LockMutex(is->audio_switch_mutex);
+    for (int i = 0; i < held->pkts.count; i++) {
+        AVPacket *pkt = &packet_back_at(&held->pkts, i)->pkt;
+        if (is->audio_stream == held->stream)
+            packet_queue_put(&is->audioq, pkt);
+        else
+            av_packet_unref(pkt);
+    }
+    held->pkts.count = 0;
+    held->pkts.head  = 0;
+    held->pkts.size  = 0;
+    held->stream     = -1;
+    SDL_UnlockMutex(is->audio_switch_mutex);
+
+    if (is->audio_stream < 0 && is->video_stream >= 0 && is->buffer_indicator_queue == &is->audioq) {
+        is->audioq.is_buffer_indicator = 0;
+        is->videoq.is_buffer_indicator = 1;
+        is->buffer_indicator_queue = &is->videoq;
+    }
+    return 1;
+}
+
+/*
+ * Switch to a standby track: the new decoder gets the buffered packets from
+ * the playback position on, and the track switched away from becomes the
+ * standby one, keeping what audioq still held.
+ * audio_switch_mutex is only held while packets move, the decoder close and
+ * open run without it so that read_thread keeps demuxing; meanwhile the new
+ * track's packets collect in audio_open_pkts.
+ */
+static int stream_switch_audio_standby(FFPlayer *ffp, AudioStandby *sb)
+{
+    VideoState *is = ffp->is;
+    AudioStandby *held = &is->audio_open_pkts;
+    int old_stream = is->audio_stream;
+    int new_stream = sb->stream;
+    AVStream *st = is->ic->streams[new_stream];
+    MyAVPacketList *old_pkts = NULL;
+    int nb_old_pkts = 0;
+    int first = 0;
+    double clock;
+    int64_t pts;
+    AVPacket pkt;
+    int ret;
+
+    SDL_LockMutex(is->audio_switch_mutex);
+    if (old_stream >= 0)
+        packet_queue_take_all(&is->audioq, &old_pkts, &nb_old_pkts);
+    FFSWAP(AudioStandby, *sb, *held);
+    audio_standby_reset(sb, old_stream);
+    for (int i = 0; i < nb_old_pkts; i++) {
+        if (old_stream < 0 || old_pkts[i].seq < 0) {
+            av_packet_unref(&old_pkts[i].pkt);
+            continue;
+        }
+        old_pkts[i].serial = 0;
+        old_pkts[i].seq    = sb->seq++;
+        packet_back_push_l(&sb->pkts, &old_pkts[i]);
+    }
+    av_free(old_pkts);
+    SDL_UnlockMutex(is->audio_switch_mutex);
+
+    if (old_stream >= 0) {
+        stream_component_close(ffp, old_stream);
+        is->ic->streams[old_stream]->discard = AVDISCARD_DEFAULT;
+    }
+    ret = stream_component_open(ffp, new_stream);
+
+    SDL_LockMutex(is->audio_switch_mutex);
+    clock = get_master_clock(is);
+    if (ret >= 0) {
+        for (int i = 0; !isnan(clock) && i < held->pkts.count; i++) {
+            pts = packet_pts_us(st, &packet_back_at(&held->pkts, i)->pkt);
+            if (pts != AV_NOPTS_VALUE && pts <= (int64_t)(clock * AV_TIME_BASE))
+                first = i;
+        }
+        for (int i = first; i < held->pkts.count; i++) {
+            av_packet_move_ref(&pkt, &packet_back_at(&held->pkts, i)->pkt);
+            packet_queue_put(&is->audioq, &pkt);
+        }
+        av_log(ffp, AV_LOG_INFO, "audio switched %d -> %d, %d packet(s) primed\n",
+               old_stream, new_stream, held->pkts.count - first);
+    }
+    audio_standby_reset(held, -1);
+    SDL_UnlockMutex(is->audio_switch_mutex);
+    return ret;
+}
+
+/* reverse mode: nothing read before stays valid, the reverse thread queues frames with the new serial */
+static void read_thread_enter_reverse(FFPlayer *ffp, VideoState *is)
+{
+    if (is->audio_stream >= 0) {
+        packet_queue_flush(&is->audioq);
+        packet_queue_put(&is->audioq, &flush_pkt);
+        SDL_AoutFlushAudio(ffp->aout);
+    }
+    if (is->subtitle_stream >= 0) {
+        packet_queue_flush(&is->subtitleq);
+        packet_queue_put(&is->subtitleq, &flush_pkt);
+    }
+    if (ffp->node_vdec)
+        ffpipenode_flush(ffp->node_vdec);
+    packet_queue_flush(&is->videoq);
+    packet_queue_put(&is->videoq, &flush_pkt);
+    is->eof = 0;
+
+    SDL_LockMutex(is->reverse_mutex);
+    is->reverse_serial = is->videoq.serial;
+    SDL_CondSignal(is->reverse_cond);
+    SDL_UnlockMutex(is->reverse_mutex);
+}
+
+/* a backward step shows one frame, the one before has to be on screen first */
+static int reverse_thread_wait_step(VideoState *is, int serial)
+{
+    int ret;
+
+    SDL_LockMutex(is->pause_mutex);
+    while (is->step && !is->abort_request &&
+           is->reverse_mode == REVERSE_STEP && is->reverse_serial == serial)
+        SDL_CondWait(is->pause_cond, is->pause_mutex);
+    ret = !is->abort_request && is->reverse_mode == REVERSE_STEP && is->reverse_serial == serial;
+    SDL_UnlockMutex(is->pause_mutex);
+    return ret;
+}
+
+/* queues the frames before reverse_pts from the GOP cache, newest first */
+static int reverse_thread(void *arg)
+{
+    FFPlayer *ffp = arg;
+    VideoState *is = ffp->is;
+    AVRational frame_rate = av_guess_frame_rate(is->ic, is->video_st, NULL);
+    double duration = frame_rate.num && frame_rate.den ? av_q2d((AVRational){frame_rate.den, frame_rate.num}) : 0;
+    AVFrame *frame = av_frame_alloc();
+    int64_t from, pts;
+    int serial, mode, stale, ret;
+
+    if (!frame)
+        return AVERROR(ENOMEM);
+
+    for (;;) {
+        SDL_LockMutex(is->reverse_mutex);
+        while (!is->abort_request &&
+               (is->reverse_mode == REVERSE_OFF || is->reverse_serial < 0 ||
+                (is->reverse_mode == REVERSE_STEP && is->reverse_steps <= 0)))
+            SDL_CondWait(is->reverse_cond, is->reverse_mutex);
+        serial = is->reverse_serial;
+        mode   = is->reverse_mode;
+        from   = is->reverse_pts;
+        SDL_UnlockMutex(is->reverse_mutex);
+        if (is->abort_request)
+            break;
+
+        ret = ffgopcache_get_prev(is->gop_cache, from, frame, &pts);
+        if (ret == AVERROR_EXIT)
+            break;
+        if (ret < 0) {
+            SDL_LockMutex(is->reverse_mutex);
+            stale = is->reverse_serial != serial;
+            if (!stale) {
+                is->reverse_steps = 0;
+                is->reverse_mode  = REVERSE_STEP;
+            }
+            SDL_UnlockMutex(is->reverse_mutex);
+            if (ret != AVERROR_EOF)
+                av_log(ffp, AV_LOG_WARNING, "reverse: no frame before %"PRId64": %s\n", from, av_err2str(ret));
+            if (!stale && mode == REVERSE_PLAY) {
+                // stay on the frame shown last, like playback does at the end
+                toggle_pause(ffp, 1);
+                if (ret == AVERROR_EOF)
+                    ffp_notify_msg1(ffp, FFP_MSG_COMPLETED);
+            }
+            continue;
+        }
+
+        if (mode == REVERSE_STEP && !reverse_thread_wait_step(is, serial)) {
+            av_frame_unref(frame);
+            continue;
+        }
+        SDL_LockMutex(is->reverse_mutex);
+        stale = is->reverse_serial != serial;
+        if (!stale) {
+            is->reverse_pts = pts;
+            if (mode == REVERSE_STEP)
+                is->reverse_steps--;
+        }
+        SDL_UnlockMutex(is->reverse_mutex);
+        if (stale) {
+            av_frame_unref(frame);
+            continue;
+        }
+
+        if (mode == REVERSE_STEP) {
+            // unpaused for the step, video_refresh drops what is still queued from before
+            SDL_LockMutex(is->play_mutex);
+            if (is->pause_req)
+                step_to_next_frame_l(ffp);
+            SDL_UnlockMutex(is->play_mutex);
+        }
+        ret = queue_picture_write(ffp, frame, pts / (double)AV_TIME_BASE, duration, frame->pkt_pos, serial);
+        av_frame_unref(frame);
+        if (ret < 0)
+            break;
+    }
+
+    av_frame_free(&frame);
+    return 0;
+}
+
+static AVFormatContext *read_src_ic(VideoState *is)
+{
+    return is->read_src.ic ? is->read_src.ic : is->ic;
+}
+
+/* read_src is read to its end but playback is still in the source before it */
+static int read_src_pending(VideoState *is)
+{
+    return is->read_src.ic != is->play_src.ic;
+}
+
+/* nothing to show but audio, the sources may then change audio codec at their boundaries and crossfade */
+static int read_thread_audio_only(VideoState *is)
+{
+    return is->audio_stream >= 0 &&
+           (is->video_stream < 0 || (is->video_st->disposition & AV_DISPOSITION_ATTACHED_PIC));
+}
+
+static AVCodecParameters *play_source_audio_par(VideoState *is, const PlaySource *src)
+{
+    return src->ic ? src->ic->streams[src->audio_stream]->codecpar : is->audio_st->codecpar;
+}
+
+static AVCodecParameters *play_source_video_par(VideoState *is, const PlaySource *src)
+{
+    return src->ic ? src->ic->streams[src->video_stream]->codecpar : is->video_st->codecpar;
+}
+
+/* where the crossfade out of read_src starts, once the audio thread is done with the one before */
+static void read_thread_arm_crossfade(FFPlayer *ffp, VideoState *is)
+{
+    int64_t fade;
+
+    if (!is->xfade || !is->preload || is->read_src.duration == AV_NOPTS_VALUE || !read_thread_audio_only(is) ||
+        is->xfade_from != AV_NOPTS_VALUE || is->xfade_state != XFADE_IDLE)
+        return;
+    fade = FFMIN((int64_t)ffp->audio_crossfade * 1000, is->read_src.duration / 2);
+    is->xfade_from = is->read_src.begin + is->read_src.duration - fade;
+}
+
+/* the preload worker is done, read_thread may be waiting for it at the end of read_src */
+static void read_thread_on_preloaded(void *opaque)
+{
+    read_thread_wakeup((VideoState *)opaque);
+}
+
+/* takes a next data source request, starts the preload of the source read_src is followed by */
+static void read_thread_update_preload(FFPlayer *ffp, VideoState *is, int at_eof)
+{
+    char *req;
+    double clock;
+
+    // one boundary at a time
+    if (read_src_pending(is))
+        return;
+    if ((req = __atomic_exchange_n(&is->next_url_req, NULL, __ATOMIC_SEQ_CST))) {
+        ffpreload_closep(&is->preload);
+        av_freep(&is->next_url);
+        if (*req)
+            is->next_url = req;
+        else
+            av_free(req);
+    }
+    if (is->preload) {
+        read_thread_arm_crossfade(ffp, is);
+        return;
+    }
+
+    if (!is->next_url) {
+        // a loop restarts from the same file, preloaded once the end is near
+        if (!ffp->gapless_loop || ffp->loop == 1 || is->realtime || ffp->seek_by_bytes ||
+            ffp->start_time != AV_NOPTS_VALUE || ffp->duration != AV_NOPTS_VALUE)
+            return;
+        if (!at_eof) {
+            clock = get_master_clock(is);
+            if (is->read_src.duration == AV_NOPTS_VALUE || isnan(clock) ||
+                clock * AV_TIME_BASE < is->read_src.begin + is->read_src.duration - NEXT_SOURCE_LOOP_AHEAD)
+                return;
+        }
+    }
+    is->preload = ffpreload_open(is->next_url ? is->next_url : is->filename, is->iformat, is->src_format_opts,
+                                 ffp->find_stream_info, is->video_stream >= 0, is->audio_stream >= 0,
+                                 NEXT_SOURCE_READ_AHEAD, read_thread_on_preloaded, is);
+}
+
+static int stream_same_codec(const AVCodecParameters *a, const AVCodecParameters *b)
+{
+    if (a->codec_type != b->codec_type || a->codec_id != b->codec_id || a->format != b->format ||
+        a->extradata_size != b->extradata_size ||
+        (a->extradata_size > 0 && memcmp(a->extradata, b->extradata, a->extradata_size)))
+        return 0;
+    if (a->codec_type == AVMEDIA_TYPE_VIDEO)
+        return a->width == b->width && a->height == b->height;
+    return a->sample_rate == b->sample_rate && a->channels == b->channels;
+}
+
+/*
+ * The open decoders, audio output and surface go on with src when its
+ * streams fit them. A stream encoded otherwise has its decoder reopened at
+ * the boundary (new_codec, new_video_codec); video must keep the codec, the
+ * hardware pipenode only takes new parameter sets and a new size.
+ */
+static int read_thread_source_compatible(VideoState *is, PlaySource *src)
+{
+    AVCodecParameters *par;
+
+    if (is->video_stream >= 0 && !read_thread_audio_only(is)) {
+        if (src->video_stream < 0)
+            return 0;
+        par = src->ic->streams[src->video_stream]->codecpar;
+        if (par->codec_id != is->video_st->codecpar->codec_id)
+            return 0;
+        src->new_video_codec = !stream_same_codec(play_source_video_par(is, &is->read_src), par);
+    }
+    if (is->audio_stream >= 0) {
+        if (src->audio_stream < 0)
+            return 0;
+        // against what the decoder has by then, the source read last
+        src->new_codec = !stream_same_codec(play_source_audio_par(is, &is->read_src),
+                                            src->ic->streams[src->audio_stream]->codecpar);
+    }
+    return 1;
+}
+
+/* put codec_pkt into the queue of d, the decoder reopens with par or just flushes when it is NULL */
+static int read_thread_mark_codec(Decoder *d, const AVCodecParameters *par)
 {
-    VideoState *is = ctx;
-    return is->abort_request;
+    AVCodecParameters *next_par = NULL;
+
+    if (par && (!(next_par = avcodec_parameters_alloc()) || avcodec_parameters_copy(next_par, par) < 0)) {
+        avcodec_parameters_free(&next_par);
+        return AVERROR(ENOMEM);
+    }
+    next_par = __atomic_exchange_n(&d->next_par, next_par, __ATOMIC_SEQ_CST);
+    avcodec_parameters_free(&next_par);
+    return packet_queue_put(d->queue, &codec_pkt);
 }
 
-static int stream_has_enough_packets(AVStream *st, int stream_id, PacketQueue *queue, int min_frames) {
-    return stream_id < 0 ||
-           queue->abort_request ||
-           (st->disposition & AV_DISPOSITION_ATTACHED_PIC) ||
-#ifdef FFP_MERGE
-           queue->nb_packets > MIN_FRAMES && (!queue->duration || av_q2d(st->time_base) * queue->duration > 1.0);
-#endif
-           queue->nb_packets > min_frames;
+/*
+ * At the end of read_src, go on reading from the preloaded source: its
+ * packets are mapped onto the streams of is->ic right after the last one
+ * read, so that the decoders neither flush nor reopen.
+ * @return 0 when switched, AVERROR(EAGAIN) while the preload is not ready,
+ *         another error when playback ends here
+ */
+static int read_thread_next_source(FFPlayer *ffp, VideoState *is)
+{
+    PlaySource src = { 0 };
+    int64_t end = is->read_src_end;
+    int64_t first;
+    int crossfade = 0;
+    int status;
+
+    read_thread_update_preload(ffp, is, 1);
+    if (!is->preload)
+        return AVERROR_EOF;
+    if (read_src_pending(is) || !(status = ffpreload_status(is->preload)))
+        return AVERROR(EAGAIN);
+
+    if (end == AV_NOPTS_VALUE && is->read_src.duration != AV_NOPTS_VALUE)
+        end = is->read_src.begin + is->read_src.duration;
+    if (status > 0 && end != AV_NOPTS_VALUE)
+        src.ic = ffpreload_take_input(is->preload, &src.video_stream, &src.audio_stream);
+    if (!src.ic || !read_thread_source_compatible(is, &src)) {
+        av_log(NULL, AV_LOG_WARNING, "%s: no gapless switch, %s\n", ffpreload_url(is->preload),
+               src.ic ? "its streams do not fit the open decoders" : "it could not be preloaded");
+        avformat_close_input(&src.ic);
+        ffpreload_closep(&is->preload);
+        av_freep(&is->next_url);
+        return AVERROR(EINVAL);
+    }
+
+    src.ic->interrupt_callback.callback = decode_interrupt_cb;
+    src.ic->interrupt_callback.opaque   = is;
+    first = src.ic->start_time != AV_NOPTS_VALUE ? src.ic->start_time : 0;
+    if (src.audio_stream >= 0 &&
+        ffgapless_read_itunsmpb(src.ic, src.audio_stream, &src.trim_delay, &src.trim_end) == 0 &&
+        read_thread_audio_only(is))
+        first += av_rescale(src.trim_delay, AV_TIME_BASE, src.ic->streams[src.audio_stream]->codecpar->sample_rate);
+    // the audio thread holds what plays after xfade_from and mixes the start of src into it
+    if (is->xfade_from != AV_NOPTS_VALUE && is->xfade_from < end) {
+        end       = is->xfade_from;
+        crossfade = 1;
+    } else {
+        // nothing of read_src played after it, it would hold src instead
+        is->xfade_from = AV_NOPTS_VALUE;
+    }
+    src.loop     = !is->next_url;
+    src.begin    = end;
+    src.offset   = end - first;
+    src.duration = src.ic->duration;
+    if ((src.new_codec || crossfade) && is->audio_stream >= 0)
+        src.codec_mark = read_thread_mark_codec(&is->auddec, src.new_codec ?
+                                                src.ic->streams[src.audio_stream]->codecpar : NULL) >= 0;
+    if (src.new_video_codec)
+        src.video_codec_mark = read_thread_mark_codec(&is->viddec, src.ic->streams[src.video_stream]->codecpar) >= 0;
+    if (src.loop && ffp->loop > 1)
+        ffp->loop--;
+    av_log(NULL, AV_LOG_INFO, "%s: gapless switch at %.3f%s%s%s\n", ffpreload_url(is->preload), end / (double)AV_TIME_BASE,
+           src.new_codec ? ", audio decoder reopens" : "", src.new_video_codec ? ", video decoder reopens" : "",
+           crossfade ? ", crossfaded" : "");
+
+    is->read_src     = src;
+    is->read_src_end = AV_NOPTS_VALUE;
+    is->preload_draining = is->preload;
+    is->preload          = NULL;
+    if (!is->src_switched) {
+        // both describe is->ic only
+        ffkfindex_closep(&is->kf_index);
+        ffprobecache_closep(&is->probe_cache);
+        SDL_LockMutex(is->audio_switch_mutex);
+        for (int i = 0; i < MAX_AUDIO_STANDBY; i++)
+            audio_standby_reset(&is->audio_standby[i], -1);
+        SDL_UnlockMutex(is->audio_switch_mutex);
+        is->src_switched = 1;
+    }
+    return 0;
 }
 
-static int is_realtime(AVFormatContext *s)
+/*
+ * A demuxer seek before read_src started playing goes back to the source
+ * playing, the next one preloads again.
+ * *reopen_audio, *reopen_video are set when that decoder may have reopened
+ * for read_src already, read_thread_mark_codec() is then due after the flush
+ */
+static void read_thread_revert_source(FFPlayer *ffp, VideoState *is, int *reopen_audio, int *reopen_video)
 {
-    if(   !strcmp(s->iformat->name, "rtp")
-       || !strcmp(s->iformat->name, "rtsp")
-       || !strcmp(s->iformat->name, "sdp")
-    )
-        return 1;
-
-    if(s->pb && (   !strncmp(s->filename, "rtp:", 4)
-                 || !strncmp(s->filename, "udp:", 4)
-                )
-    )
-        return 1;
-    return 0;
+    *reopen_audio = 0;
+    *reopen_video = 0;
+    if (!read_src_pending(is))
+        return;
+    *reopen_audio = is->read_src.new_codec;
+    *reopen_video = is->read_src.new_video_codec;
+    ffpreload_closep(&is->preload_draining);
+    avformat_close_input(&is->read_src.ic);
+    if (is->read_src.loop && ffp->loop)
+        ffp->loop++;
+    is->read_src     = is->play_src;
+    is->read_src_end = AV_NOPTS_VALUE;
 }
 
+/* playback crossed into read_src, the source before it is done */
+static void read_thread_source_started(FFPlayer *ffp, VideoState *is)
+{
+    double clock;
+
+    if (!read_src_pending(is))
+        return;
+    clock = get_master_clock(is);
+    if (isnan(clock) || clock * AV_TIME_BASE < is->read_src.begin)
+        return;
+    avformat_close_input(&is->play_src.ic);
+    is->play_src = is->read_src;
+    if (!is->play_src.loop)
+        av_freep(&is->next_url);
+    // from here on a seek in buffer would replay audio of the source before
+    if (is->play_src.codec_mark)
+        packet_back_clear(&is->audioq);
+    if (is->play_src.video_codec_mark)
+        packet_back_clear(&is->videoq);
+    ffp_notify_msg3(ffp, FFP_MSG_NEXT_SOURCE_STARTED, is->play_src.loop,
+                    is->play_src.duration != AV_NOPTS_VALUE ? (int)fftime_to_milliseconds(is->play_src.duration) : 0);
+}
+
+static int read_thread_read_frame(VideoState *is, AVPacket *pkt)
+{
+    if (is->preload_draining) {
+        if (ffpreload_read_packet(is->preload_draining, pkt) == 0)
+            return 0;
+        ffpreload_closep(&is->preload_draining);
+    }
+    return av_read_frame(read_src_ic(is), pkt);
+}
 
+/*
+ * Put a packet of read_src on the streams and timeline of is->ic, and track
+ * where read_src ends.
+ * @return < 0 for a packet of a stream not played
+ */
+static int read_thread_map_packet(VideoState *is, AVPacket *pkt)
+{
+    PlaySource *src = &is->read_src;
+    AVFormatContext *ic = read_src_ic(is);
+    AVStream *st;
+    int64_t offset, end;
+    int stream = -1;
+
+    if (src->trim_end > 0 && pkt->stream_index == src->audio_stream)
+        ffgapless_trim_packet(ic->streams[pkt->stream_index], pkt, src->trim_delay, src->trim_end);
+    if (src->ic) {
+        if (pkt->stream_index == src->video_stream)
+            stream = is->video_stream;
+        else if (pkt->stream_index == src->audio_stream)
+            stream = is->audio_stream;
+        if (stream < 0)
+            return AVERROR(EINVAL);
+        st = is->ic->streams[stream];
+        av_packet_rescale_ts(pkt, src->ic->streams[pkt->stream_index]->time_base, st->time_base);
+        offset = av_rescale_q(src->offset, AV_TIME_BASE_Q, st->time_base);
+        if (pkt->pts != AV_NOPTS_VALUE)
+            pkt->pts += offset;
+        if (pkt->dts != AV_NOPTS_VALUE)
+            pkt->dts += offset;
+        pkt->stream_index = stream;
+        pkt->pos = -1;
+    }
+
+    if (pkt->stream_index != is->video_stream && pkt->stream_index != is->audio_stream)
+        return 0;
+    st  = is->ic->streams[pkt->stream_index];
+    end = packet_pts_us(st, pkt);
+    if (end != AV_NOPTS_VALUE) {
+        end += av_rescale_q(pkt->duration, st->time_base, AV_TIME_BASE_Q);
+        if (is->read_src_end == AV_NOPTS_VALUE || end > is->read_src_end)
+            is->read_src_end = end;
+    }
+    return 0;
+}
 
 /* this thread gets the stream from the disk or the network */
 static int read_thread(void *arg)
@@ -3165,19 +4490,15 @@ static int read_thread(void *arg)
     int completed = 0;
     int pkt_in_play_range = 0;
     AVDictionaryEntry *t;
-    SDL_mutex *wait_mutex = SDL_CreateMutex();
     int scan_all_pmts_set = 0;
     int64_t pkt_ts;
     int last_error = 0;
     int64_t prev_io_tick_counter = 0;
     int64_t io_tick_counter = 0;
     int init_ijkmeta = 0;
-
-    if (!wait_mutex) {
-        av_log(NULL, AV_LOG_FATAL, "SDL_CreateMutex(): %s\n", SDL_GetError());
-        ret = AVERROR(ENOMEM);
-        goto fail;
-    }
+    AVDictionary *open_opts = NULL;
+    AudioStandby *standby = NULL;
+    int probe_kf_pending = 0;
 
     memset(st_index, -1, sizeof(st_index));
     is->last_video_stream = is->video_stream = -1;
@@ -3213,6 +4534,8 @@ static int read_thread(void *arg)
 
     if (ffp->iformat_name)
         is->iformat = av_find_input_format(ffp->iformat_name);
+    // avformat_open_input() leaves only the unused options behind
+    av_dict_copy(&open_opts, ffp->format_opts, 0);
             
     err = avformat_open_input(&ic, is->filename, is->iformat, &ffp->format_opts);
             
@@ -3222,6 +4545,7 @@ static int read_thread(void *arg)
         goto fail;
     }
             
+    ffp_prepare_stage(ffp, FFP_PREPARE_STAGE_OPEN_INPUT);
     ffp_notify_msg1(ffp, FFP_MSG_OPEN_INPUT);
 
     if (scan_all_pmts_set)
@@ -3247,11 +4571,24 @@ static int read_thread(void *arg)
     //orig_nb_streams = ic->nb_streams;
 
 
+    if (ffp->find_stream_info && ffp->probe_cache && ic->pb && (ic->pb->seekable & AVIO_SEEKABLE_NORMAL) &&
+        !av_stristart(is->filename, "data:", NULL)) {
+        char *dir = read_thread_cache_dir(ffp->probe_cache_dir, open_opts);
+        is->probe_cache = ffprobecache_open(dir, is->filename, avio_size(ic->pb));
+        av_free(dir);
+    }
+
     if (ffp->find_stream_info) {
         AVDictionary **opts = setup_find_stream_info_opts(ic, ffp->codec_opts);
         int orig_nb_streams = ic->nb_streams;
+        int64_t probe_start = av_gettime_relative();
+        // a cached probe result that still matches the file replaces the probe
+        int probe_cached = read_thread_verify_probe_cache(is, ic) == 0 &&
+                           ffprobecache_apply(is->probe_cache, ic) == 0;
 
         do {
+            if (probe_cached)
+                break;
             if (av_stristart(is->filename, "data:", NULL) && orig_nb_streams > 0) {
                 for (i = 0; i < orig_nb_streams; i++) {
                     if (!ic->streams[i] || !ic->streams[i]->codecpar || ic->streams[i]->codecpar->profile == FF_PROFILE_UNKNOWN) {
@@ -3265,6 +4602,7 @@ static int read_thread(void *arg)
             }
             err = avformat_find_stream_info(ic, opts);
         } while(0);
+        ffp_prepare_stage(ffp, FFP_PREPARE_STAGE_FIND_STREAM_INFO);
         ffp_notify_msg1(ffp, FFP_MSG_FIND_STREAM_INFO);
 
         for (i = 0; i < orig_nb_streams; i++)
@@ -3277,6 +4615,10 @@ static int read_thread(void *arg)
             ret = -1;
             goto fail;
         }
+        if (!probe_cached)
+            ffprobecache_store(is->probe_cache, ic);
+        av_log(ffp, AV_LOG_INFO, "stream info %s in %"PRId64" ms\n",
+               probe_cached ? "from the probe cache" : "probed", (av_gettime_relative() - probe_start) / 1000);
     }
     if (ic->pb)
         ic->pb->eof_reached = 0; // FIXME hack, ffplay maybe should not use avio_feof() to test for the end
@@ -3308,6 +4650,7 @@ static int read_thread(void *arg)
         }
     }
 
+    probe_kf_pending = is->probe_cache && ffp->start_time == AV_NOPTS_VALUE;
     is->realtime = is_realtime(ic);
 
     av_dump_format(ic, 0, is->filename, 0);
@@ -3372,7 +4715,7 @@ static int read_thread(void *arg)
 
     /* open the streams */
     if (st_index[AVMEDIA_TYPE_AUDIO] >= 0) {
-        stream_component_open(ffp, st_index[AVMEDIA_TYPE_AUDIO]);
+        read_thread_open_audio(ffp, is, st_index[AVMEDIA_TYPE_AUDIO]);
     } else {
         ffp->av_sync_type = AV_SYNC_VIDEO_MASTER;
         is->av_sync_type  = ffp->av_sync_type;
@@ -3384,11 +4727,24 @@ static int read_thread(void *arg)
     }
     if (is->show_mode == SHOW_MODE_NONE)
         is->show_mode = ret >= 0 ? SHOW_MODE_VIDEO : SHOW_MODE_RDFT;
+    video_refresh_wakeup(is);
 
     if (st_index[AVMEDIA_TYPE_SUBTITLE] >= 0) {
         stream_component_open(ffp, st_index[AVMEDIA_TYPE_SUBTITLE]);
     }
 
+    // first-frame-early keeps reading while the audio output opens, audio packets are held meanwhile
+    if (!ffp->first_frame_early || ret < 0)
+        read_thread_join_audio_open(ffp, is, 1);
+    if (!is->audio_open_tid)
+        read_thread_open_audio_standby(ffp, is);
+    read_thread_open_kf_index(ffp, is, open_opts);
+    // the next source opens with the same options, minus the cache of this one
+    av_dict_set(&open_opts, "cache_file_path", NULL, 0);
+    av_dict_set(&open_opts, "cache_map_path", NULL, 0);
+    is->src_format_opts = open_opts;
+    open_opts = NULL;
+
     ffp_notify_msg1(ffp, FFP_MSG_COMPONENT_OPEN);
 
     if (!ffp->ijkmeta_delay_init) {
@@ -3409,7 +4765,7 @@ static int read_thread(void *arg)
         ret = -1;
         goto fail;
     }
-    if (is->audio_stream >= 0) {
+    if (is->audio_stream >= 0 || is->audio_open_tid) {
         is->audioq.is_buffer_indicator = 1;
         is->buffer_indicator_queue = &is->audioq;
     } else if (is->video_stream >= 0) {
@@ -3430,12 +4786,10 @@ static int read_thread(void *arg)
         ffp_notify_msg3(ffp, FFP_MSG_SAR_CHANGED, codecpar->sample_aspect_ratio.num, codecpar->sample_aspect_ratio.den);
     }
     ffp->prepared = true;
+    ffp_prepare_stage(ffp, FFP_PREPARE_STAGE_PREPARED);
     ffp_notify_msg1(ffp, FFP_MSG_PREPARED);
-    if (!ffp->render_wait_start && !ffp->start_on_prepared) {
-        while (is->pause_req && !is->abort_request) {
-            SDL_Delay(20);
-        }
-    }
+    if (!ffp->render_wait_start && !ffp->start_on_prepared)
+        stream_wait_pause_req(ffp, is);
     if (ffp->auto_resume) {
         ffp_notify_msg1(ffp, FFP_REQ_START);
         ffp->auto_resume = 0;
@@ -3444,10 +4798,23 @@ static int read_thread(void *arg)
     if (ffp->seek_at_start > 0) {
         ffp_seek_to_l(ffp, (long)(ffp->seek_at_start));
     }
+    is->read_src.begin    = ic->start_time > 0 && ic->start_time != AV_NOPTS_VALUE ? ic->start_time : 0;
+    is->read_src.duration = ic->duration;
+    is->read_src.video_stream = st_index[AVMEDIA_TYPE_VIDEO];
+    is->read_src.audio_stream = st_index[AVMEDIA_TYPE_AUDIO];
+    if (st_index[AVMEDIA_TYPE_AUDIO] >= 0)
+        ffgapless_read_itunsmpb(ic, st_index[AVMEDIA_TYPE_AUDIO], &is->read_src.trim_delay, &is->read_src.trim_end);
+    is->read_src_end      = AV_NOPTS_VALUE;
+    is->play_src          = is->read_src;
 
     for (;;) {
         if (is->abort_request)
             break;
+        // a seek needs the audio packets in audioq
+        if (read_thread_join_audio_open(ffp, is, is->seek_req || is->scrub_seek_req))
+            read_thread_open_audio_standby(ffp, is);
+        read_thread_source_started(ffp, is);
+        read_thread_update_preload(ffp, is, 0);
 #ifdef FFP_MERGE
         if (is->paused != is->last_paused) {
             is->last_paused = is->paused;
@@ -3461,12 +4828,18 @@ static int read_thread(void *arg)
         if (is->paused &&
                 (!strcmp(ic->iformat->name, "rtsp") ||
                  (ic->pb && !strncmp(ffp->input_filename, "mmsh:", 5)))) {
-            /* wait 10 ms to avoid trying to get another packet */
-            /* XXX: horrible */
-            SDL_Delay(10);
+            /* resume wakes us up */
+            read_thread_wait(ffp, is, READ_WAIT_ANY, -1);
             continue;
         }
 #endif
+        if (!is->seek_req && __atomic_exchange_n(&is->scrub_seek_req, 0, __ATOMIC_SEQ_CST)) {
+            is->seek_pos   = __atomic_load_n(&is->scrub_pos, __ATOMIC_SEQ_CST);
+            is->seek_rel   = 0;
+            is->seek_flags &= ~AVSEEK_FLAG_BYTE;
+            is->seek_req   = 1;
+            is->scrub_seek_req_at = __atomic_load_n(&is->scrub_req_at, __ATOMIC_SEQ_CST);
+        }
         if (is->seek_req) {
             int64_t seek_target = is->seek_pos;
             int64_t seek_min    = is->seek_rel > 0 ? seek_target - is->seek_rel + 2: INT64_MIN;
@@ -3474,29 +4847,61 @@ static int read_thread(void *arg)
 // FIXME the +-2 is due to rounding being not done in the correct direction in generation
 //      of the seek_pos/seek_rel variables
 
-            ffp_toggle_buffering(ffp, 1);
-            ffp_notify_msg3(ffp, FFP_MSG_BUFFERING_UPDATE, 0, 0);
-            ret = avformat_seek_file(is->ic, -1, seek_min, seek_target, seek_max, is->seek_flags);
+            // a scrub seek only shows the nearest keyframe, no buffering, audio or accurate seek
+            is->scrub_seeking = is->scrubbing;
+            if (!is->scrub_seeking) {
+                ffp_toggle_buffering(ffp, 1);
+                ffp_notify_msg3(ffp, FFP_MSG_BUFFERING_UPDATE, 0, 0);
+            }
+            int in_buffer = !is->scrub_seeking &&
+                            read_thread_seek_in_buffer(ffp, is, seek_min, seek_target, seek_max) >= 0;
+            int reopen_audio = 0;
+            int reopen_video = 0;
+            if (in_buffer) {
+                ret = 0;
+            } else {
+                int64_t offset;
+
+                is->kf_index_last_pts = AV_NOPTS_VALUE;
+                read_thread_revert_source(ffp, is, &reopen_audio, &reopen_video);
+                offset = is->seek_flags & AVSEEK_FLAG_BYTE ? 0 : is->read_src.offset;
+                ret = read_thread_seek_kf_index(is, seek_min, seek_target, seek_max);
+                if (ret < 0)
+                    ret = avformat_seek_file(read_src_ic(is), -1,
+                                             seek_min == INT64_MIN ? INT64_MIN : seek_min - offset, seek_target - offset,
+                                             seek_max == INT64_MAX ? INT64_MAX : seek_max - offset, is->seek_flags);
+            }
             if (ret < 0) {
                 av_log(NULL, AV_LOG_ERROR,
                        "%s: error while seeking\n", is->ic->filename);
             } else {
                 if (is->audio_stream >= 0) {
-                    packet_queue_flush(&is->audioq);
-                    packet_queue_put(&is->audioq, &flush_pkt);
+                    if (!in_buffer) {
+                        packet_queue_flush(&is->audioq);
+                        packet_queue_put(&is->audioq, &flush_pkt);
+                        if (reopen_audio)
+                            read_thread_mark_codec(&is->auddec, play_source_audio_par(is, &is->play_src));
+                    }
                     // TODO: clear invaild audio data
                     SDL_AoutFlushAudio(ffp->aout);
                 }
-                if (is->subtitle_stream >= 0) {
+                if (is->subtitle_stream >= 0 && !in_buffer) {
                     packet_queue_flush(&is->subtitleq);
                     packet_queue_put(&is->subtitleq, &flush_pkt);
                 }
-                if (is->video_stream >= 0) {
+                if (!in_buffer) {
+                    SDL_LockMutex(is->audio_switch_mutex);
+                    audio_standby_flush(is);
+                    SDL_UnlockMutex(is->audio_switch_mutex);
+                }
+                if (is->video_stream >= 0 && !in_buffer) {
                     if (ffp->node_vdec) {
                         ffpipenode_flush(ffp->node_vdec);
                     }
                     packet_queue_flush(&is->videoq);
                     packet_queue_put(&is->videoq, &flush_pkt);
+                    if (reopen_video)
+                        read_thread_mark_codec(&is->viddec, play_source_video_par(is, &is->play_src));
                 }
                 if (is->seek_flags & AVSEEK_FLAG_BYTE) {
                    set_clock(&is->extclk, NAN, 0);
@@ -3508,7 +4913,15 @@ static int read_thread(void *arg)
                 is->latest_audio_seek_load_serial = is->audioq.serial;
                 is->latest_seek_load_start_at = av_gettime();
             }
-            ffp->dcc.current_high_water_mark_in_ms = ffp->dcc.first_high_water_mark_in_ms;
+            probe_kf_pending = 0;
+            is->scrub_frame_queued = is->video_stream < 0;
+            if (is->trick_rate != 0) {
+                is->trick_last_pts = is->trick_rate < 0 ? seek_target : AV_NOPTS_VALUE;
+                is->trick_step     = (int64_t)(fabsf(is->trick_rate) * AV_TIME_BASE / TRICK_PLAY_MAX_FPS);
+                is->trick_kf_wait  = 0;
+            }
+            is->scrub_serial = is->scrub_seeking && is->video_stream >= 0 ? is->videoq.serial : -1;
+            ffbuffering_reset(is->buffering_ctrl);
             is->seek_req = 0;
             is->queue_attachments_req = 1;
             is->eof = 0;
@@ -3529,7 +4942,7 @@ static int read_thread(void *arg)
                 step_to_next_frame_l(ffp);
             SDL_UnlockMutex(ffp->is->play_mutex);
 
-            if (ffp->enable_accurate_seek) {
+            if (ffp->enable_accurate_seek && !is->scrub_seeking && is->trick_rate == 0) {
                 is->drop_aframe_count = 0;
                 is->drop_vframe_count = 0;
                 SDL_LockMutex(is->accurate_seek_mutex);
@@ -3545,7 +4958,8 @@ static int read_thread(void *arg)
             }
 
             ffp_notify_msg3(ffp, FFP_MSG_SEEK_COMPLETE, (int)fftime_to_milliseconds(seek_target), ret);
-            ffp_toggle_buffering(ffp, 1);
+            if (!is->scrub_seeking)
+                ffp_toggle_buffering(ffp, 1);
         }
         if (is->queue_attachments_req) {
             if (is->video_st && (is->video_st->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
@@ -3558,30 +4972,54 @@ static int read_thread(void *arg)
             is->queue_attachments_req = 0;
         }
 
+        if (is->scrub_seeking && is->scrub_frame_queued) {
+            /* the next scrub target, leaving scrub mode and abort wake us up */
+            read_thread_wait(ffp, is, READ_WAIT_ANY, -1);
+            continue;
+        }
+
+        if (is->reverse_mode != REVERSE_OFF) {
+            if (is->reverse_serial < 0)
+                read_thread_enter_reverse(ffp, is);
+            /* the reverse thread feeds pictq, leaving reverse mode seeks and wakes us up */
+            read_thread_wait(ffp, is, READ_WAIT_ANY, -1);
+            continue;
+        }
+
+        if (is->trick_rate < 0 && !is->trick_kf_wait) {
+            int queued = is->videoq.ring ? (int)packet_ring_count(&is->videoq) : is->videoq.nb_packets;
+            if (queued >= TRICK_PLAY_MAX_QUEUED) {
+                read_thread_wait(ffp, is, READ_WAIT_ANY, 10);
+                continue;
+            }
+            if (read_thread_trick_seek_back(is) < 0) {
+                /* at the start, a rate change or seek wakes us up */
+                read_thread_wait(ffp, is, READ_WAIT_ANY, -1);
+                continue;
+            }
+        }
+
         /* if the queue are full, no need to read more */
-        if (ffp->infinite_buffer<1 && !is->seek_req &&
-#ifdef FFP_MERGE
-              (is->audioq.size + is->videoq.size + is->subtitleq.size > MAX_QUEUE_SIZE
-#else
-              (is->audioq.size + is->videoq.size + is->subtitleq.size > ffp->dcc.max_buffer_size
-#endif
-            || (   stream_has_enough_packets(is->audio_st, is->audio_stream, &is->audioq, MIN_FRAMES)
-                && stream_has_enough_packets(is->video_st, is->video_stream, &is->videoq, MIN_FRAMES)
-                && stream_has_enough_packets(is->subtitle_st, is->subtitle_stream, &is->subtitleq, MIN_FRAMES)))) {
+        if (!is->seek_req && read_queues_full(ffp, is, 100)) {
             if (!is->eof) {
                 ffp_toggle_buffering(ffp, 0);
             }
-            /* wait 10 ms */
-            SDL_LockMutex(wait_mutex);
-            SDL_CondWaitTimeout(is->continue_read_thread, wait_mutex, 10);
-            SDL_UnlockMutex(wait_mutex);
+            // consumption wakes us up, playback crossing into the source read last does not
+            read_thread_wait(ffp, is, READ_WAIT_QUEUES_FULL, read_src_pending(is) ? READ_SRC_PENDING_POLL_MS : -1);
+            continue;
+        }
+        /* a full ring would block packet_queue_put(), keep serving seek/abort requests instead */
+        if (!is->seek_req && read_rings_full(is, 100)) {
+            read_thread_wait(ffp, is, READ_WAIT_RING_FULL, -1);
             continue;
         }
-        if ((!is->paused || completed) &&
-            (!is->audio_st || (is->auddec.finished == is->audioq.serial && frame_queue_nb_remaining(&is->sampq) == 0)) &&
+        if ((!is->paused || completed) && is->trick_rate >= 0 &&
+            (!is->audio_st || (is->auddec.finished == is->audioq.serial && frame_queue_nb_remaining(&is->sampq) == 0 &&
+                               is->xfade_state != XFADE_HOLDING && is->xfade_state != XFADE_DRAINING)) &&
             (!is->video_st || (is->viddec.finished == is->videoq.serial && frame_queue_nb_remaining(&is->pictq) == 0))) {
             if (ffp->loop != 1 && (!ffp->loop || --ffp->loop)) {
-                stream_seek(is, ffp->start_time != AV_NOPTS_VALUE ? ffp->start_time : 0, 0, 0);
+                stream_seek(is, (ffp->start_time != AV_NOPTS_VALUE ? ffp->start_time : 0) +
+                                (is->src_switched ? is->play_src.begin : 0), 0, 0);
             } else if (ffp->autoexit) {
                 ret = AVERROR_EOF;
                 goto fail;
@@ -3589,11 +5027,9 @@ static int read_thread(void *arg)
                 ffp_statistic_l(ffp);
                 if (completed) {
                     av_log(ffp, AV_LOG_INFO, "ffp_toggle_buffering: eof\n");
-                    SDL_LockMutex(wait_mutex);
-                    // infinite wait may block shutdown
+                    /* abort and seek both wake us up */
                     while(!is->abort_request && !is->seek_req)
-                        SDL_CondWaitTimeout(is->continue_read_thread, wait_mutex, 100);
-                    SDL_UnlockMutex(wait_mutex);
+                        read_thread_wait(ffp, is, READ_WAIT_ANY, -1);
                     if (!is->abort_request)
                         continue;
                 } else {
@@ -3614,18 +5050,36 @@ static int read_thread(void *arg)
             }
         }
         pkt->flags = 0;
-        ret = av_read_frame(ic, pkt);
+        ret = read_thread_read_frame(is, pkt);
+        if (ret == AVERROR_EOF && is->trick_rate < 0 && is->trick_kf_wait) {
+            read_thread_trick_no_progress(is);
+            continue;
+        }
         if (ret < 0) {
+            AVFormatContext *read_ic = read_src_ic(is);
             int pb_eof = 0;
             int pb_error = 0;
-            if ((ret == AVERROR_EOF || avio_feof(ic->pb)) && !is->eof) {
+            // the null packets go after the held audio
+            read_thread_join_audio_open(ffp, is, 1);
+            if ((ret == AVERROR_EOF || avio_feof(read_ic->pb)) && !is->eof && is->trick_rate == 0 &&
+                !(read_ic->pb && read_ic->pb->error)) {
+                err = read_thread_next_source(ffp, is);
+                if (err == 0)
+                    continue;
+                if (err == AVERROR(EAGAIN)) {
+                    // the preload worker wakes us when it is done, the decoders don't for a pending source
+                    read_thread_wait(ffp, is, READ_WAIT_ANY, read_src_pending(is) ? READ_SRC_PENDING_POLL_MS : -1);
+                    continue;
+                }
+            }
+            if ((ret == AVERROR_EOF || avio_feof(read_ic->pb)) && !is->eof) {
                 ffp_check_buffering_l(ffp);
                 pb_eof = 1;
                 // check error later
             }
-            if (ic->pb && ic->pb->error) {
+            if (read_ic->pb && read_ic->pb->error) {
                 pb_eof = 1;
-                pb_error = ic->pb->error;
+                pb_error = read_ic->pb->error;
             }
             if (ret == AVERROR_EXIT) {
                 pb_eof = 1;
@@ -3657,16 +5111,46 @@ static int read_thread(void *arg)
             }
             if (is->eof) {
                 ffp_toggle_buffering(ffp, 0);
-                SDL_Delay(100);
+                /* the decoders finishing, a seek or resume wake us up, nothing to retry while paused */
+                read_thread_wait(ffp, is, READ_WAIT_ANY, is->paused ? -1 : READ_EOF_RETRY_MS);
+            } else {
+                read_thread_wait(ffp, is, READ_WAIT_ANY, 10);
             }
-            SDL_LockMutex(wait_mutex);
-            SDL_CondWaitTimeout(is->continue_read_thread, wait_mutex, 10);
-            SDL_UnlockMutex(wait_mutex);
             ffp_statistic_l(ffp);
             continue;
         } else {
             is->eof = 0;
         }
+        if (read_thread_map_packet(is, pkt) < 0) {
+            av_packet_unref(pkt);
+            continue;
+        }
+
+        RecordRemuxPacket(ffp, pkt);
+        if (is->kf_index)
+            read_thread_index_keyframe(is, pkt);
+        // the first keyframe of the file completes a new probe cache entry, a cached one was verified at open
+        if (probe_kf_pending && pkt->stream_index == is->video_stream && (pkt->flags & AV_PKT_FLAG_KEY)) {
+            ffprobecache_check_keyframe(is->probe_cache, pkt->pos);
+            probe_kf_pending = 0;
+        }
+
+        if (is->scrub_seeking) {
+            // the first keyframe is all a scrub seek shows, the null packet drains it out of the decoder
+            if (pkt->stream_index == is->video_stream && (pkt->flags & AV_PKT_FLAG_KEY)) {
+                packet_queue_put(&is->videoq, pkt);
+                packet_queue_put_nullpacket(&is->videoq, is->video_stream);
+                is->scrub_frame_queued = 1;
+            } else {
+                av_packet_unref(pkt);
+            }
+            continue;
+        }
+
+        if (is->trick_rate != 0) {
+            read_thread_trick_packet(is, pkt);
+            continue;
+        }
 
         if (pkt->flags & AV_PKT_FLAG_DISCONTINUITY) {
             if (is->audio_stream >= 0) {
@@ -3683,21 +5167,28 @@ static int read_thread(void *arg)
         /* check if packet is in play range specified by user, then queue, otherwise discard */
         stream_start_time = ic->streams[pkt->stream_index]->start_time;
         pkt_ts = pkt->pts == AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
-        pkt_in_play_range = ffp->duration == AV_NOPTS_VALUE ||
+        pkt_in_play_range = ffp->duration == AV_NOPTS_VALUE || is->src_switched ||
                 (pkt_ts - (stream_start_time != AV_NOPTS_VALUE ? stream_start_time : 0)) *
                 av_q2d(ic->streams[pkt->stream_index]->time_base) -
                 (double)(ffp->start_time != AV_NOPTS_VALUE ? ffp->start_time : 0) / 1000000
                 <= ((double)ffp->duration / 1000000);
-        if (pkt->stream_index == is->audio_stream && pkt_in_play_range) {
+        /* an audio track switch must not slip in between picking the queue and putting */
+        SDL_LockMutex(is->audio_switch_mutex);
+        if (pkt->stream_index == is->audio_open_pkts.stream && pkt_in_play_range) {
+            audio_standby_put(is, &is->audio_open_pkts, pkt);
+        } else if (pkt->stream_index == is->audio_stream && pkt_in_play_range) {
             packet_queue_put(&is->audioq, pkt);
         } else if (pkt->stream_index == is->video_stream && pkt_in_play_range
                    && !(is->video_st && (is->video_st->disposition & AV_DISPOSITION_ATTACHED_PIC))) {
             packet_queue_put(&is->videoq, pkt);
         } else if (pkt->stream_index == is->subtitle_stream && pkt_in_play_range) {
             packet_queue_put(&is->subtitleq, pkt);
+        } else if ((standby = audio_standby_find(is, pkt->stream_index)) && pkt_in_play_range) {
+            audio_standby_put(is, standby, pkt);
         } else {
             av_packet_unref(pkt);
         }
+        SDL_UnlockMutex(is->audio_switch_mutex);
 
         ffp_statistic_l(ffp);
 
@@ -3712,7 +5203,7 @@ static int read_thread(void *arg)
             if ((!ffp->first_video_frame_rendered && is->video_st) || (!ffp->first_audio_frame_rendered && is->audio_st)) {
                 if (abs((int)(io_tick_counter - prev_io_tick_counter)) > FAST_BUFFERING_CHECK_PER_MILLISECONDS) {
                     prev_io_tick_counter = io_tick_counter;
-                    ffp->dcc.current_high_water_mark_in_ms = ffp->dcc.first_high_water_mark_in_ms;
+                    ffbuffering_reset(is->buffering_ctrl);
                     ffp_check_buffering_l(ffp);
                 }
             } else {
@@ -3726,6 +5217,8 @@ static int read_thread(void *arg)
 
     ret = 0;
  fail:
+    read_thread_join_audio_open(ffp, is, 1);
+    av_dict_free(&open_opts);
     if (ic && !is->ic)
         avformat_close_input(&ic);
 
@@ -3733,7 +5226,6 @@ static int read_thread(void *arg)
         ffp->last_error = last_error;
         ffp_notify_msg2(ffp, FFP_MSG_ERROR, last_error);
     }
-    SDL_DestroyMutex(wait_mutex);
     return 0;
 }
 
@@ -3759,9 +5251,6 @@ static VideoState *stream_open(FFPlayer *ffp, const char *filename, AVInputForma
     is->iformat = iformat;
     is->ytop    = 0;
     is->xleft   = 0;
-    if (ffp->soundtouch_enable) {
-        is->handle = ijk_soundtouch_create();
-    }
     /* start video display */
     if (frame_queue_init(&is->pictq, &is->videoq, ffp->pictq_size, 1) < 0)
         goto fail;
@@ -3775,10 +5264,37 @@ static VideoState *stream_open(FFPlayer *ffp, const char *filename, AVInputForma
         packet_queue_init(&is->subtitleq) < 0)
         goto fail;
 
-    if (!(is->continue_read_thread = SDL_CreateCond())) {
+    if (ffp->packet_queue_ring_size > 0) {
+        if (packet_queue_init_ring(&is->videoq, ffp->packet_queue_ring_size) < 0 ||
+            packet_queue_init_ring(&is->audioq, ffp->packet_queue_ring_size) < 0 ||
+            packet_queue_init_ring(&is->subtitleq, ffp->packet_queue_ring_size) < 0)
+            goto fail;
+    }
+    is->videoq.back.max_size    = ffp->back_buffer_size;
+    is->audioq.back.max_size    = ffp->back_buffer_size;
+    is->subtitleq.back.max_size = ffp->back_buffer_size;
+
+    if (!(is->continue_read_thread = SDL_CreateCond()) ||
+        !(is->pause_cond = SDL_CreateCond()) ||
+        !(is->reverse_cond = SDL_CreateCond())) {
         av_log(NULL, AV_LOG_FATAL, "SDL_CreateCond(): %s\n", SDL_GetError());
         goto fail;
     }
+    if (!(is->read_wait_mutex = SDL_CreateMutex()) ||
+        !(is->pause_mutex = SDL_CreateMutex()) ||
+        !(is->pictq_write_mutex = SDL_CreateMutex()) ||
+        !(is->audio_switch_mutex = SDL_CreateMutex()) ||
+        !(is->reverse_mutex = SDL_CreateMutex())) {
+        av_log(NULL, AV_LOG_FATAL, "SDL_CreateMutex(): %s\n", SDL_GetError());
+        goto fail;
+    }
+    is->videoq.consumed_cb = is->audioq.consumed_cb = is->subtitleq.consumed_cb = read_thread_on_consumed;
+    is->videoq.consumed_opaque = is->audioq.consumed_opaque = is->subtitleq.consumed_opaque = ffp;
+
+    is->buffering_ctrl = ffbuffering_create(ffp->buffering_policy, ffp->dcc.first_high_water_mark_in_ms,
+                                            ffp->dcc.next_high_water_mark_in_ms, ffp->dcc.last_high_water_mark_in_ms);
+    if (!is->buffering_ctrl)
+        goto fail;
 
     if (!(is->video_accurate_seek_cond = SDL_CreateCond())) {
         av_log(NULL, AV_LOG_FATAL, "SDL_CreateCond(): %s\n", SDL_GetError());
@@ -3794,6 +5310,18 @@ static VideoState *stream_open(FFPlayer *ffp, const char *filename, AVInputForma
     init_clock(&is->audclk, &is->audioq.serial);
     init_clock(&is->extclk, &is->extclk.serial);
     is->audio_clock_serial = -1;
+    is->scrub_pos = AV_NOPTS_VALUE;
+    is->scrub_serial = -1;
+    is->reverse_serial = -1;
+    for (int i = 0; i < MAX_AUDIO_STANDBY; i++) {
+        is->audio_standby[i].stream        = -1;
+        is->audio_standby[i].pkts.max_size = AUDIO_STANDBY_MAX_SIZE;
+    }
+    is->audio_open_pkts.stream        = -1;
+    is->audio_open_pkts.pkts.max_size = AUDIO_STANDBY_MAX_SIZE;
+    is->xfade_from = AV_NOPTS_VALUE;
+    if (ffp->audio_crossfade > 0)
+        is->xfade = ffcrossfade_create();
     if (ffp->startup_volume < 0)
         av_log(NULL, AV_LOG_WARNING, "-volume=%d < 0, setting to 0\n", ffp->startup_volume);
     if (ffp->startup_volume > 100)
@@ -3802,6 +5330,7 @@ static VideoState *stream_open(FFPlayer *ffp, const char *filename, AVInputForma
     ffp->startup_volume = av_clip(SDL_MIX_MAXVOLUME * ffp->startup_volume / 100, 0, SDL_MIX_MAXVOLUME);
     is->audio_volume = ffp->startup_volume;
     is->muted = 0;
+    is->audio_gain = (float)is->audio_volume / SDL_MIX_MAXVOLUME;
     is->av_sync_type = ffp->av_sync_type;
 
     is->play_mutex = SDL_CreateMutex();
@@ -3825,7 +5354,7 @@ static VideoState *stream_open(FFPlayer *ffp, const char *filename, AVInputForma
     if (ffp->async_init_decoder && !ffp->video_disable && ffp->video_mime_type && strlen(ffp->video_mime_type) > 0
                     && ffp->mediacodec_default_name && strlen(ffp->mediacodec_default_name) > 0) {
         if (ffp->mediacodec_all_videos || ffp->mediacodec_avc || ffp->mediacodec_hevc || ffp->mediacodec_mpeg2) {
-            decoder_init(&is->viddec, NULL, &is->videoq, is->continue_read_thread);
+            decoder_init(&is->viddec, NULL, &is->videoq);
             ffp->node_vdec = ffpipeline_init_video_decoder(ffp->pipeline, ffp);
         }
     }
@@ -3861,15 +5390,43 @@ fail:
 // FFP_MERGE: options
 // FFP_MERGE: show_usage
 // FFP_MERGE: show_help_default
+/* nothing for video_refresh() to do until a frame arrives or the pause state changes */
+static int video_refresh_idle(VideoState *is)
+{
+    if (is->abort_request || is->force_refresh || is->refresh_wakeup)
+        return 0;
+    /* no audio visualization here, video_display2() only ever shows video */
+    if (is->show_mode == SHOW_MODE_NONE || is->paused || !is->video_st)
+        return 1;
+    return frame_queue_nb_remaining(&is->pictq) == 0;
+}
+
 static int video_refresh_thread(void *arg)
 {
     FFPlayer *ffp = arg;
     VideoState *is = ffp->is;
     double remaining_time = 0.0;
+    int idle;
+
+    // EGL setup would otherwise wait for the first frame
+    if (ffp->parallel_prepare && !ffp->display_disable && SDL_VoutWarmUp(ffp->vout) == 0)
+        ffp_prepare_stage(ffp, FFP_PREPARE_STAGE_RENDERER_READY);
     while (!is->abort_request) {
-        if (remaining_time > 0.0)
+        /* frame_queue_push() signals pictq.cond, video_refresh_wakeup() the rest */
+        SDL_LockMutex(is->pictq.mutex);
+        idle = video_refresh_idle(is);
+        while (video_refresh_idle(is)) {
+            SDL_CondWait(is->pictq.cond, is->pictq.mutex);
+            ffp_count_wakeup(ffp);
+        }
+        is->refresh_wakeup = 0;
+        SDL_UnlockMutex(is->pictq.mutex);
+
+        if (!idle && remaining_time > 0.0) {
             av_usleep((int)(int64_t)(remaining_time * 1000000.0));
-        remaining_time = REFRESH_RATE;
+            ffp_count_wakeup(ffp);
+        }
+        remaining_time = REFRESH_MAX_SLEEP;
         if (is->show_mode != SHOW_MODE_NONE && (!is->paused || is->force_refresh))
             video_refresh(ffp, &remaining_time);
     }
@@ -3991,8 +5548,7 @@ void ffp_global_init()
 
     //    av_log_set_callback(ffp_log_callback_brief);
 
-    av_init_packet(&flush_pkt);
-    flush_pkt.data = (uint8_t *)&flush_pkt;
+    packet_queue_global_init();
 
     g_ffmpeg_global_inited = true;
 }
@@ -4108,6 +5664,14 @@ void ffp_destroy(FFPlayer *ffp)
     if (!ffp)
         return;
 
+    /* the encode thread still reads the stream being closed below */
+    if (ffp->record_write_data.recThreadStarted) {
+        ffp_stop_record(ffp);
+        pthread_join(ffp->record_write_data.recThreadid, NULL);
+        ffp->record_write_data.recThreadStarted = 0;
+    }
+    ClipExportDestroy(ffp);
+
     if (ffp->is) {
         av_log(NULL, AV_LOG_WARNING, "ffp_destroy_ffplayer: force stream_close()");
         stream_close(ffp);
@@ -4121,6 +5685,10 @@ void ffp_destroy(FFPlayer *ffp)
     ijkmeta_destroy_p(&ffp->meta);
     ffp_reset_internal(ffp);
 
+    RecordQueueDestroy(&ffp->record_write_data);
+    free(ffp->record_write_data.recordFilePath);
+    ffp->record_write_data.recordFilePath = NULL;
+
     SDL_DestroyMutexP(&ffp->af_mutex);
     SDL_DestroyMutexP(&ffp->vf_mutex);
 
@@ -4289,6 +5857,8 @@ void ffp_set_overlay_format(FFPlayer *ffp, int chroma_fourcc)
         case SDL_FCC_RV16:
         case SDL_FCC_RV24:
         case SDL_FCC_RV32:
+        case SDL_FCC_NV12:
+        case SDL_FCC_NV21:
             ffp->overlay_format = chroma_fourcc;
             break;
 #ifdef __APPLE__
@@ -4407,6 +5977,7 @@ int ffp_prepare_async_l(FFPlayer *ffp, const char *file_name)
     }
 #endif
 
+    ffp->stat.prepare_start = av_gettime_relative();
     VideoState *is = stream_open(ffp, file_name, NULL);
     if (!is) {
         av_log(NULL, AV_LOG_WARNING, "ffp_prepare_async_l: stream_open failed OOM");
@@ -4434,6 +6005,76 @@ int ffp_start_from_l(FFPlayer *ffp, long msec)
     return 0;
 }
 
+static void stream_cancel_accurate_seek(VideoState *is)
+{
+    SDL_LockMutex(is->accurate_seek_mutex);
+    is->video_accurate_seek_req = 0;
+    is->audio_accurate_seek_req = 0;
+    SDL_CondSignal(is->audio_accurate_seek_cond);
+    SDL_CondSignal(is->video_accurate_seek_cond);
+    SDL_UnlockMutex(is->accurate_seek_mutex);
+}
+
+static int stream_enter_reverse_l(FFPlayer *ffp, int mode)
+{
+    VideoState *is = ffp->is;
+    double pts = is->vidclk.pts;
+
+    if (!is->video_st || is->scrubbing || is->trick_rate != 0 || ffp->gop_cache_size <= 0 || is->src_switched)
+        return EIJK_INVALID_STATE;
+    if (is->reverse_mode == REVERSE_OFF && isnan(pts))
+        return EIJK_INVALID_STATE;
+    if (!is->gop_cache) {
+        is->gop_cache = ffgopcache_open(is->filename, is->ic->iformat, ffp->format_opts,
+                                        is->video_stream, ffp->gop_cache_size);
+        if (!is->gop_cache)
+            return EIJK_OUT_OF_MEMORY;
+    }
+    if (!is->reverse_tid) {
+        is->reverse_tid = SDL_CreateThreadEx(&is->_reverse_tid, reverse_thread, ffp, "ff_reverse");
+        if (!is->reverse_tid) {
+            av_log(ffp, AV_LOG_ERROR, "SDL_CreateThread(): %s\n", SDL_GetError());
+            return EIJK_FAILED;
+        }
+    }
+
+    if (is->reverse_mode == REVERSE_OFF) {
+        stream_cancel_accurate_seek(is);
+        is->av_sync_type = AV_SYNC_VIDEO_MASTER;
+    }
+    SDL_LockMutex(is->reverse_mutex);
+    if (is->reverse_mode == REVERSE_OFF) {
+        is->reverse_pts    = (int64_t)(pts * AV_TIME_BASE);
+        is->reverse_serial = -1;
+        is->reverse_steps  = 0;
+    }
+    is->reverse_mode = mode;
+    SDL_CondSignal(is->reverse_cond);
+    SDL_UnlockMutex(is->reverse_mutex);
+    read_thread_wakeup(is);
+    return 0;
+}
+
+/* seek_back: continue forward from the last frame shown backwards, a seek of the caller's follows otherwise */
+static void stream_exit_reverse_l(FFPlayer *ffp, int seek_back)
+{
+    VideoState *is = ffp->is;
+    int64_t pos;
+
+    SDL_LockMutex(is->reverse_mutex);
+    pos = is->reverse_pts;
+    is->reverse_mode   = REVERSE_OFF;
+    is->reverse_serial = -1;
+    is->reverse_steps  = 0;
+    SDL_CondSignal(is->reverse_cond);
+    SDL_UnlockMutex(is->reverse_mutex);
+    stream_wakeup_pause_waiters(is);
+
+    is->av_sync_type = ffp->av_sync_type;
+    if (seek_back)
+        stream_seek(is, pos, 0, 0);
+}
+
 int ffp_start_l(FFPlayer *ffp)
 {
     if (!ffp) {
@@ -4444,6 +6085,9 @@ int ffp_start_l(FFPlayer *ffp)
     if (!is)
         return EIJK_NULL_IS_PTR;
 
+    // after backward steps playback goes on forward, from the frame shown last
+    if (is->reverse_mode == REVERSE_STEP)
+        stream_exit_reverse_l(ffp, 1);
     toggle_pause(ffp, 0);
     return 0;
 }
@@ -4484,6 +6128,7 @@ int ffp_stop_l(FFPlayer *ffp)
     VideoState *is = ffp->is;
     if (is) {
         is->abort_request = 1;
+        /* toggle_pause() wakes every waiter up */
         toggle_pause(ffp, 1);
     }
 
@@ -4528,13 +6173,24 @@ int ffp_seek_to_l(FFPlayer *ffp, long msec)
     if (!is)
         return EIJK_NULL_IS_PTR;
 
+    if (is->reverse_mode != REVERSE_OFF)
+        stream_exit_reverse_l(ffp, 0);
+    if (is->scrubbing) {
+        start_time = is->src_switched ? is->play_src.begin : is->ic->start_time;
+        if (start_time > 0 && start_time != AV_NOPTS_VALUE)
+            seek_pos += start_time;
+        stream_scrub_seek(is, seek_pos);
+        return 0;
+    }
+
     if (duration > 0 && seek_pos >= duration && ffp->enable_accurate_seek) {
         toggle_pause(ffp, 1);
         ffp_notify_msg1(ffp, FFP_MSG_COMPLETED);
         return 0;
     }
 
-    start_time = is->ic->start_time;
+    // after a gapless switch, the timeline of the source playing
+    start_time = is->src_switched ? is->play_src.begin : is->ic->start_time;
     if (start_time > 0 && start_time != AV_NOPTS_VALUE)
         seek_pos += start_time;
 
@@ -4542,6 +6198,11 @@ int ffp_seek_to_l(FFPlayer *ffp, long msec)
     // FIXME: 9 seek out of range
     // FIXME: 9 seekable
     av_log(ffp, AV_LOG_DEBUG, "stream_seek %"PRId64"(%d) + %"PRId64", \n", seek_pos, (int)msec, start_time);
+    // the final seek of a scrub is still pending, this one replaces it
+    if (__atomic_load_n(&is->scrub_seek_req, __ATOMIC_SEQ_CST)) {
+        stream_scrub_seek(is, seek_pos);
+        return 0;
+    }
     stream_seek(is, seek_pos, 0, 0);
     return 0;
 }
@@ -4556,7 +6217,7 @@ long ffp_get_current_position_l(FFPlayer *ffp)
     if (!is || !is->ic)
         return 0;
 
-    int64_t start_time = is->ic->start_time;
+    int64_t start_time = is->src_switched ? is->play_src.begin : is->ic->start_time;
     int64_t start_diff = 0;
     if (start_time > 0 && start_time != AV_NOPTS_VALUE)
         start_diff = fftime_to_milliseconds(start_time);
@@ -4594,7 +6255,7 @@ long ffp_get_duration_l(FFPlayer *ffp)
     if (!is || !is->ic){
         return 0;
     }
-    int64_t duration = fftime_to_milliseconds(is->ic->duration);
+    int64_t duration = fftime_to_milliseconds(is->src_switched ? is->play_src.duration : is->ic->duration);
     if (duration < 0)
         return 0;
     return (long)duration;
@@ -4667,6 +6328,11 @@ int ffp_packet_queue_get_or_buffering(FFPlayer *ffp, PacketQueue *q, AVPacket *p
     return packet_queue_get_or_buffering(ffp, q, pkt, serial, finished);
 }
 
+void ffp_packet_queue_notify_consumed(PacketQueue *q)
+{
+    packet_queue_notify_consumed(q);
+}
+
 int ffp_packet_queue_put(PacketQueue *q, AVPacket *pkt)
 {
     return packet_queue_put(q, pkt);
@@ -4680,6 +6346,14 @@ bool ffp_is_flush_packet(AVPacket *pkt)
     return pkt->data == flush_pkt.data;
 }
 
+bool ffp_is_codec_packet(AVPacket *pkt)
+{
+    if (!pkt)
+        return false;
+
+    return pkt->data == codec_pkt.data;
+}
+
 Frame *ffp_frame_queue_peek_writable(FrameQueue *f)
 {
     return frame_queue_peek_writable(f);
@@ -4773,16 +6447,43 @@ void ffp_video_statistic_l(FFPlayer *ffp)
     ffp_track_statistic_l(ffp, is->video_st, &is->videoq, &ffp->stat.video_cache);
 }
 
+void ffp_overlay_fill_statistic_l(FFPlayer *ffp, int64_t elapsed)
+{
+    ffp->stat.vout_fill_time = elapsed;
+    if (ffp->stat.vout_fill_time_avg <= 0)
+        ffp->stat.vout_fill_time_avg = elapsed;
+    else
+        ffp->stat.vout_fill_time_avg = (ffp->stat.vout_fill_time_avg * 15 + elapsed) / 16;
+}
+
 void ffp_statistic_l(FFPlayer *ffp)
 {
     ffp_audio_statistic_l(ffp);
     ffp_video_statistic_l(ffp);
 }
 
+static void ffp_buffering_sample_l(FFPlayer *ffp, int cached_duration_in_ms, FFBufferingSample *sample)
+{
+    VideoState *is   = ffp->is;
+    long duration_ms = ffp_get_duration_l(ffp);
+
+    memset(sample, 0, sizeof(*sample));
+    sample->now_ms             = (int64_t)SDL_GetTickHR();
+    sample->cached_duration_ms = cached_duration_in_ms;
+    sample->cached_bytes       = is->audioq.size + is->videoq.size;
+    sample->remaining_ms       = -1;
+    if (duration_ms > 0 && cached_duration_in_ms >= 0)
+        sample->remaining_ms = FFMAX(duration_ms - ffp_get_current_position_l(ffp) - cached_duration_in_ms, 0);
+    sample->throughput         = SDL_SpeedSampler2GetSpeed(&ffp->stat.tcp_read_sampler);
+    sample->bit_rate           = ffp->stat.bit_rate;
+    sample->buffering          = is->buffering_on;
+    sample->read_throttled     = read_queues_full(ffp, is, 100);
+}
+
 void ffp_check_buffering_l(FFPlayer *ffp)
 {
     VideoState *is            = ffp->is;
-    int hwm_in_ms             = ffp->dcc.current_high_water_mark_in_ms; // use fast water mark for first loading
+    int hwm_in_ms             = is->buffering_ctrl->hwm_ms; // use fast water mark for first loading
     int buf_size_percent      = -1;
     int buf_time_percent      = -1;
     int hwm_in_bytes          = ffp->dcc.high_water_mark_in_bytes;
@@ -4790,6 +6491,7 @@ void ffp_check_buffering_l(FFPlayer *ffp)
     int audio_time_base_valid = 0;
     int video_time_base_valid = 0;
     int64_t buf_time_position = -1;
+    FFBufferingSample sample  = { .cached_duration_ms = -1, .remaining_ms = -1 };
 
     if(is->audio_st)
         audio_time_base_valid = is->audio_st->time_base.den > 0 && is->audio_st->time_base.num > 0;
@@ -4831,6 +6533,11 @@ void ffp_check_buffering_l(FFPlayer *ffp)
             cached_duration_in_ms = (int)audio_cached_duration;
         }
 
+        ffp_buffering_sample_l(ffp, cached_duration_in_ms, &sample);
+        ffbuffering_update(is->buffering_ctrl, &sample);
+        hwm_in_ms = is->buffering_ctrl->hwm_ms;
+        ffp->stat.buffering_stall_eta_ms = is->buffering_ctrl->stall_eta_ms;
+
         if (cached_duration_in_ms >= 0) {
             buf_time_position = ffp_get_current_position_l(ffp) + cached_duration_in_ms;
             ffp->playable_duration_ms = buf_time_position;
@@ -4879,16 +6586,7 @@ void ffp_check_buffering_l(FFPlayer *ffp)
     }
 
     if (need_start_buffering) {
-        if (hwm_in_ms < ffp->dcc.next_high_water_mark_in_ms) {
-            hwm_in_ms = ffp->dcc.next_high_water_mark_in_ms;
-        } else {
-            hwm_in_ms *= 2;
-        }
-
-        if (hwm_in_ms > ffp->dcc.last_high_water_mark_in_ms)
-            hwm_in_ms = ffp->dcc.last_high_water_mark_in_ms;
-
-        ffp->dcc.current_high_water_mark_in_ms = hwm_in_ms;
+        ffbuffering_on_filled(is->buffering_ctrl, &sample);
 
         if (is->buffer_indicator_queue && is->buffer_indicator_queue->nb_packets > 0) {
             if (   (is->audioq.nb_packets >= MIN_MIN_FRAMES || is->audio_stream < 0 || is->audioq.abort_request)
@@ -4973,10 +6671,12 @@ int ffp_set_stream_selected(FFPlayer *ffp, int stream, int selected)
     VideoState        *is = ffp->is;
     AVFormatContext   *ic = NULL;
     AVCodecParameters *codecpar = NULL;
+    AudioStandby      *standby = NULL;
     if (!is)
         return -1;
     ic = is->ic;
-    if (!ic)
+    // after a gapless switch the streams of is->ic are not read anymore
+    if (!ic || is->src_switched)
         return -1;
 
     if (stream < 0 || stream >= ic->nb_streams) {
@@ -4993,6 +6693,9 @@ int ffp_set_stream_selected(FFPlayer *ffp, int stream, int selected)
                     stream_component_close(ffp, is->video_stream);
                 break;
             case AVMEDIA_TYPE_AUDIO:
+                // audio_open_pkts holds the packets of a switch, it must be free
+                if (stream != is->audio_stream && !is->audio_open_tid && (standby = audio_standby_find(is, stream)))
+                    return stream_switch_audio_standby(ffp, standby);
                 if (stream != is->audio_stream && is->audio_stream >= 0)
                     stream_component_close(ffp, is->audio_stream);
                 break;
@@ -5065,6 +6768,10 @@ void ffp_set_property_float(FFPlayer *ffp, int id, float value)
 
 int64_t ffp_get_property_int64(FFPlayer *ffp, int id, int64_t default_value)
 {
+    if (id >= FFP_PROP_INT64_PREPARE_STAGE_BASE && id < FFP_PROP_INT64_PREPARE_STAGE_BASE + FFP_PREPARE_STAGE_NB)
+        return ffp ? __atomic_load_n(&ffp->stat.prepare_stage_ms[id - FFP_PROP_INT64_PREPARE_STAGE_BASE], __ATOMIC_SEQ_CST) : default_value;
+    if (id >= FFP_PROP_INT64_AUDIO_CALLBACK_HIST_BASE && id < FFP_PROP_INT64_AUDIO_CALLBACK_HIST_BASE + FFP_AUDIO_CALLBACK_HIST_NB)
+        return ffp ? __atomic_load_n(&ffp->stat.audio_callback_hist[id - FFP_PROP_INT64_AUDIO_CALLBACK_HIST_BASE], __ATOMIC_RELAXED) : default_value;
     switch (id) {
         case FFP_PROP_INT64_SELECTED_VIDEO_STREAM:
             if (!ffp || !ffp->is)
@@ -5149,6 +6856,24 @@ int64_t ffp_get_property_int64(FFPlayer *ffp, int id, int64_t default_value)
             if (!ffp)
                 return default_value;
             return ffp->stat.logical_file_size;
+        case FFP_PROP_INT64_VIDEO_DECODER_INPUT_COPY_BYTES:
+            return ffp ? ffp->stat.vdec_input_copy_bytes : default_value;
+        case FFP_PROP_INT64_VIDEO_DECODER_INPUT_COPY_SPEED:
+            return ffp ? SDL_SpeedSampler2GetSpeed(&ffp->stat.vdec_input_copy_sampler) : default_value;
+        case FFP_PROP_INT64_VIDEO_OVERLAY_FILL_TIME:
+            return ffp ? ffp->stat.vout_fill_time_avg : default_value;
+        case FFP_PROP_INT64_RECORD_QUEUE_DEPTH:
+            return ffp ? RecordQueueDepth(&ffp->record_write_data) : default_value;
+        case FFP_PROP_INT64_RECORD_ENCODE_FPS:
+            return ffp ? SDL_SpeedSampler2GetSpeed(&ffp->stat.record_encode_sampler) : default_value;
+        case FFP_PROP_INT64_RECORD_DROPPED_FRAMES:
+            return ffp ? __atomic_load_n(&ffp->stat.record_dropped_frames, __ATOMIC_RELAXED) : default_value;
+        case FFP_PROP_INT64_THREAD_WAKEUPS:
+            return ffp ? __atomic_load_n(&ffp->stat.thread_wakeups, __ATOMIC_RELAXED) : default_value;
+        case FFP_PROP_INT64_BUFFERING_STALL_ETA:
+            return ffp ? ffp->stat.buffering_stall_eta_ms : default_value;
+        case FFP_PROP_INT64_AUDIO_UNDERRUNS:
+            return ffp ? __atomic_load_n(&ffp->stat.audio_underruns, __ATOMIC_RELAXED) : default_value;
         default:
             return default_value;
     }
@@ -5185,30 +6910,224 @@ IjkMediaMeta *ffp_get_meta_l(FFPlayer *ffp)
     return ffp->meta;
 }
 
-int ffp_start_record(FFPlayer *ffp, const char *recordFilePath)
+int ffp_start_record(FFPlayer *ffp, const char *recordFilePath, int mode)
 {
-    ffp->record_write_data.windex = 0;
-    ffp->record_write_data.rindex = 0;
-    ffp->record_write_data.recordFramesQueue = (RecordFrameData*)malloc(OHOS_MAX_DECODE_FRAME_SIZE * sizeof(int));
+    RecordWriteData *rec = &ffp->record_write_data;
+    if (!recordFilePath || __atomic_load_n(&rec->isInRecord, __ATOMIC_ACQUIRE) == OHOS_RECORD_STATUS_ON)
+        return OHOS_RECORD_CALLBACK_STATUS_FAILED;
+    if (rec->recThreadStarted) {
+        // the last recording is still finishing its file, FFP_MSG_RECORD_COMPLETE tells when it is done
+        if (!__atomic_load_n(&rec->recThreadDone, __ATOMIC_ACQUIRE))
+            return OHOS_RECORD_CALLBACK_STATUS_FAILED;
+        pthread_join(rec->recThreadid, NULL);
+        rec->recThreadStarted = 0;
+    }
+    if (RecordQueueInit(rec, ffp->record_queue_size, ffp->record_queue_policy) < 0)
+        return OHOS_RECORD_CALLBACK_STATUS_FAILED;
     char* filePath = (char*)malloc(strlen(recordFilePath) + 1);
+    if (!filePath)
+        return OHOS_RECORD_CALLBACK_STATUS_FAILED;
     memcpy(filePath, recordFilePath, strlen(recordFilePath) + 1);
-    ffp->record_write_data.recordFilePath = filePath;
-    ffp->record_write_data.isInRecord = OHOS_RECORD_STATUS_ON;
+    free(rec->recordFilePath);
+    rec->recordFilePath = filePath;
+    rec->mode = OHOS_RECORD_MODE_TRANSCODE;
+    if (mode == OHOS_RECORD_MODE_REMUX) {
+        if (RecordRemuxStart(ffp, filePath) >= 0)
+            rec->mode = OHOS_RECORD_MODE_REMUX;
+        else
+            av_log(ffp, AV_LOG_WARNING, "record: stream copy not possible, falling back to transcoding\n");
+    }
+    SDL_SpeedSampler2Reset(&ffp->stat.record_encode_sampler, FFP_RECORD_ENCODE_SAMPLE_RANGE);
+    ffp->stat.record_dropped_frames = 0;
+    __atomic_store_n(&rec->isInRecord, OHOS_RECORD_STATUS_ON, __ATOMIC_RELEASE);
+    __atomic_store_n(&rec->recThreadDone, 0, __ATOMIC_RELEASE);
     UpdateRecordStatus(ffp, OHOS_RECORD_STATUS_ON);
-    pthread_create(&(ffp->record_write_data.recThreadid), NULL, WriteRecordFile, (void *)(ffp));
+    if (pthread_create(&rec->recThreadid, NULL, WriteRecordFile, (void *)(ffp)) != 0) {
+        __atomic_store_n(&rec->isInRecord, OHOS_RECORD_STATUS_OFF, __ATOMIC_RELEASE);
+        UpdateRecordStatus(ffp, OHOS_RECORD_STATUS_OFF);
+        return OHOS_RECORD_CALLBACK_STATUS_FAILED;
+    }
+    rec->recThreadStarted = 1;
     return OHOS_RECORD_CALLBACK_STATUS_SUCCESS;
 }
 
+/*
+ * Doesn't wait: the encode thread drains what is queued, finishes the file
+ * and then reports the result with FFP_MSG_RECORD_COMPLETE.
+ */
 int ffp_stop_record(FFPlayer *ffp)
 {
-    ffp->record_write_data.isInRecord = OHOS_RECORD_STATUS_OFF;
+    RecordWriteData *rec = &ffp->record_write_data;
+    if (!rec->recThreadStarted || __atomic_load_n(&rec->isInRecord, __ATOMIC_ACQUIRE) != OHOS_RECORD_STATUS_ON)
+        return OHOS_RECORD_CALLBACK_STATUS_FAILED;
+    __atomic_store_n(&rec->isInRecord, OHOS_RECORD_STATUS_OFF, __ATOMIC_RELEASE);
     UpdateRecordStatus(ffp, OHOS_RECORD_STATUS_OFF);
-    return FindRecordResult(ffp);
+    RecordQueueWakeup(rec);
+    return OHOS_RECORD_CALLBACK_STATUS_SUCCESS;
 }
 
 int ffp_is_record(FFPlayer *ffp)
 {
-    return ffp->record_write_data.isInRecord;
+    return __atomic_load_n(&ffp->record_write_data.isInRecord, __ATOMIC_ACQUIRE);
+}
+
+int ffp_start_clip_export(FFPlayer *ffp, const char *filePath, int64_t start_ms, int64_t end_ms)
+{
+    /* the export opens the source again on its own, playback is left alone */
+    if (!ffp->is || !ffp->is->filename)
+        return AVERROR(EINVAL);
+    return ClipExportStart(ffp, ffp->is->filename, filePath, start_ms, end_ms);
+}
+
+void ffp_cancel_clip_export(FFPlayer *ffp)
+{
+    ClipExportCancel(ffp);
+}
+
+/*
+ * Trick play: rates of TRICK_PLAY_MIN_RATE..TRICK_PLAY_MAX_RATE play forward,
+ * negative ones rewind, 0 returns to normal playback. Only keyframes are read
+ * and decoded, audio is dropped and video becomes the master clock, paced by
+ * the rate. Every change restarts from the current position.
+ */
+int ffp_set_trick_play_rate_l(FFPlayer *ffp, float rate)
+{
+    VideoState *is = ffp->is;
+    long position;
+
+    if (!is)
+        return EIJK_NULL_IS_PTR;
+    if (rate != 0 && (fabsf(rate) < TRICK_PLAY_MIN_RATE || fabsf(rate) > TRICK_PLAY_MAX_RATE))
+        return EIJK_INVALID_STATE;
+    if (!is->video_st || is->scrubbing || is->reverse_mode != REVERSE_OFF || (rate != 0 && is->src_switched))
+        return EIJK_INVALID_STATE;
+    if (is->trick_rate == rate)
+        return 0;
+
+    av_log(ffp, AV_LOG_DEBUG, "trick play rate %f\n", rate);
+    position = ffp_get_current_position_l(ffp);
+    /* the video decoder switches skip_frame at the seek's flush, see decoder_apply_trick_skip() */
+    if (is->trick_rate == 0) {
+        is->av_sync_type = AV_SYNC_VIDEO_MASTER;
+    } else if (rate == 0) {
+        is->av_sync_type = ffp->av_sync_type;
+    }
+    is->trick_rate = rate;
+    return ffp_seek_to_l(ffp, position);
+}
+
+/*
+ * While scrubbing, seeks coalesce to the latest target and show the nearest
+ * keyframe only; playback stays paused. Leaving the mode seeks accurately to
+ * the last target and resumes when the player was playing before.
+ */
+int ffp_set_scrub_mode_l(FFPlayer *ffp, int enable, int playing)
+{
+    VideoState *is = ffp->is;
+
+    if (!is)
+        return EIJK_NULL_IS_PTR;
+    enable = !!enable;
+    if (is->scrubbing == enable)
+        return 0;
+    if (enable && (is->trick_rate != 0 || is->reverse_mode != REVERSE_OFF))
+        return EIJK_INVALID_STATE;
+
+    av_log(ffp, AV_LOG_DEBUG, "scrub mode %d\n", enable);
+    if (enable) {
+        is->scrub_resume = playing;
+        if (playing)
+            toggle_pause(ffp, 1);
+
+        // nothing to wait for once the frames the seek before was after are gone
+        stream_cancel_accurate_seek(is);
+
+        is->scrub_pos = AV_NOPTS_VALUE;
+        is->scrubbing = 1;
+    } else {
+        is->scrubbing = 0;
+        if (is->scrub_pos != AV_NOPTS_VALUE)
+            stream_scrub_seek(is, is->scrub_pos);
+        if (is->scrub_resume && playing)
+            toggle_pause(ffp, 0);
+        is->scrub_resume = 0;
+    }
+    return 0;
+}
+
+/*
+ * Backward stepping: while paused, every call shows the frame before the one
+ * on screen. The GOP holding it is decoded into the GOP cache on a second
+ * demuxer and decoder, so consecutive steps are served from memory.
+ */
+int ffp_step_backward_l(FFPlayer *ffp)
+{
+    VideoState *is = ffp->is;
+    int ret;
+
+    if (!is)
+        return EIJK_NULL_IS_PTR;
+    if (!is->pause_req || is->reverse_mode == REVERSE_PLAY)
+        return EIJK_INVALID_STATE;
+
+    if ((ret = stream_enter_reverse_l(ffp, REVERSE_STEP)) < 0)
+        return ret;
+    SDL_LockMutex(is->reverse_mutex);
+    is->reverse_steps++;
+    SDL_CondSignal(is->reverse_cond);
+    SDL_UnlockMutex(is->reverse_mutex);
+    return 0;
+}
+
+/*
+ * Reverse playback: frames are shown backwards at normal speed from the GOP
+ * cache, audio is dropped and video becomes the master clock. Leaving the
+ * mode seeks to the last frame shown and plays on forward when playing.
+ */
+int ffp_set_reverse_playback_l(FFPlayer *ffp, int enable, int playing)
+{
+    VideoState *is = ffp->is;
+    int ret;
+
+    if (!is)
+        return EIJK_NULL_IS_PTR;
+    enable = !!enable;
+    if (enable == (is->reverse_mode == REVERSE_PLAY))
+        return 0;
+
+    av_log(ffp, AV_LOG_DEBUG, "reverse playback %d\n", enable);
+    if (enable) {
+        if ((ret = stream_enter_reverse_l(ffp, REVERSE_PLAY)) < 0)
+            return ret;
+        toggle_pause(ffp, 0);
+    } else {
+        stream_exit_reverse_l(ffp, 1);
+        toggle_pause(ffp, !playing);
+    }
+    return 0;
+}
+
+/*
+ * The source played after the current one: read_thread preloads it and,
+ * when its streams are encoded like the current ones, switches over at the
+ * end without closing the decoders, FFP_MSG_NEXT_SOURCE_STARTED tells when it
+ * plays. NULL or "" cancels.
+ */
+int ffp_set_next_data_source_l(FFPlayer *ffp, const char *url)
+{
+    VideoState *is = ffp->is;
+    char *req;
+
+    if (!is)
+        return EIJK_NULL_IS_PTR;
+    req = av_strdup(url ? url : "");
+    if (!req)
+        return EIJK_OUT_OF_MEMORY;
+
+    av_log(ffp, AV_LOG_DEBUG, "next data source %s\n", req);
+    av_free(__atomic_exchange_n(&is->next_url_req, req, __ATOMIC_SEQ_CST));
+    read_thread_wakeup(is);
+    return 0;
 }
 
 int ffp_get_current_frame(FFPlayer *ffp, const char *saveFilePath)
@@ -80,8 +80,10 @@ void      ffp_packet_queue_start(PacketQueue *q);
 void      ffp_packet_queue_flush(PacketQueue *q);
 int       ffp_packet_queue_get(PacketQueue *q, AVPacket *pkt, int block, int *serial);
 int       ffp_packet_queue_get_or_buffering(FFPlayer *ffp, PacketQueue *q, AVPacket *pkt, int *serial, int *finished);
+void      ffp_packet_queue_notify_consumed(PacketQueue *q);
 int       ffp_packet_queue_put(PacketQueue *q, AVPacket *pkt);
 bool      ffp_is_flush_packet(AVPacket *pkt);
+bool      ffp_is_codec_packet(AVPacket *pkt);
 
 Frame    *ffp_frame_queue_peek_writable(FrameQueue *f);
 void      ffp_frame_queue_push(FrameQueue *f);
@@ -98,6 +100,7 @@ void      ffp_track_statistic_l(FFPlayer *ffp, AVStream *st, PacketQueue *q, FFT
 void      ffp_audio_statistic_l(FFPlayer *ffp);
 void      ffp_video_statistic_l(FFPlayer *ffp);
 void      ffp_statistic_l(FFPlayer *ffp);
+void      ffp_overlay_fill_statistic_l(FFPlayer *ffp, int64_t elapsed);
 
 int       ffp_video_thread(FFPlayer *ffp);
 
@@ -120,8 +123,15 @@ int convert_image(FFPlayer *ffp, AVFrame *src_frame, int64_t src_frame_pts, int
 // must be freed with free();
 struct IjkMediaMeta *ffp_get_meta_l(FFPlayer *ffp);
 
-int      ffp_start_record(FFPlayer *ffp, const char *recordFilePath);
+int      ffp_start_record(FFPlayer *ffp, const char *recordFilePath, int mode);
 int      ffp_stop_record(FFPlayer *ffp);
 int      ffp_is_record(FFPlayer *ffp);
+int      ffp_start_clip_export(FFPlayer *ffp, const char *filePath, int64_t start_ms, int64_t end_ms);
+void     ffp_cancel_clip_export(FFPlayer *ffp);
+int      ffp_set_scrub_mode_l(FFPlayer *ffp, int enable, int playing);
+int      ffp_set_trick_play_rate_l(FFPlayer *ffp, float rate);
+int      ffp_step_backward_l(FFPlayer *ffp);
+int      ffp_set_reverse_playback_l(FFPlayer *ffp, int enable, int playing);
+int      ffp_set_next_data_source_l(FFPlayer *ffp, const char *url);
 int      ffp_get_current_frame(FFPlayer *ffp, const char *saveFilePath);
 #endif
@@ -62,7 +62,15 @@
 #include "ijkavformat/ijkiomanager.h"
 #include "ijkavformat/ijkioapplication.h"
 #include "ff_ffinc.h"
+#include "ff_ffbuffering.h"
+#include "ff_ffpacketqueue.h"
+#include "ff_ffgopcache.h"
+#include "ff_ffkfindex.h"
 #include "ff_ffmsg_queue.h"
+#include "ff_ffprobecache.h"
+#include "ff_ffpreload.h"
+#include "ff_ffgapless.h"
+#include "ijkavutil/ijktimestretch.h"
 #include "ff_ffpipenode.h"
 #include "ijkmeta.h"
 
@@ -78,12 +86,24 @@
 #define DEFAULT_LAST_HIGH_WATER_MARK_IN_MS      (5 * 1000)
 
 #define BUFFERING_CHECK_PER_BYTES               (512)
-#define BUFFERING_CHECK_PER_MILLISECONDS        (500)
-#define FAST_BUFFERING_CHECK_PER_MILLISECONDS   (50)
 #define MAX_RETRY_CONVERT_IMAGE                 (3)
 
 #define MAX_QUEUE_SIZE (15 * 1024 * 1024)
+#define MAX_BACK_BUFFER_SIZE (64 * 1024 * 1024)
+
+#define TRICK_PLAY_MIN_RATE     2
+#define TRICK_PLAY_MAX_RATE     32
+/* keyframes shown per second at most, the ones in between are skipped */
+#define TRICK_PLAY_MAX_FPS      10
+/* rewind stops seeking back once this many packets wait for the decoder */
+#define TRICK_PLAY_MAX_QUEUED   8
 #define MAX_ACCURATE_SEEK_TIMEOUT (1000)
+
+#define REVERSE_OFF             0
+#define REVERSE_STEP            1   // paused, one frame back per ffp_step_backward_l()
+#define REVERSE_PLAY            2
+#define DEFAULT_GOP_CACHE_SIZE  (64 * 1024 * 1024)
+#define MAX_GOP_CACHE_SIZE      (512 * 1024 * 1024)
 #ifdef FFP_MERGE
 #define MIN_FRAMES 25
 #endif
@@ -101,6 +121,8 @@
 
 /* Step size for volume control */
 #define SDL_VOLUME_STEP (SDL_MIX_MAXVOLUME / 50)
+/* a volume or mute change ramps the output gain over this long instead of stepping it */
+#define AUDIO_GAIN_RAMP_MS 10
 
 /* no AV sync correction is done if below the minimum AV sync threshold */
 #define AV_SYNC_THRESHOLD_MIN 0.04
@@ -122,15 +144,28 @@
 /* we use about AUDIO_DIFF_AVG_NB A-V differences to make the average */
 #define AUDIO_DIFF_AVG_NB   20
 
-/* polls for possible required screen refresh at least this often, should be less than 1/fps */
-#define REFRESH_RATE 0.01
+/* longest the refresh thread sleeps while a frame is pending, with no frame it waits for one */
+#define REFRESH_MAX_SLEEP 0.1
+
+/* a read_thread sleeping on full queues is woken once they drained below this share of the limits */
+#define READ_LOW_WATERMARK_PERCENT 75
+/* upper bound of a read_thread sleep after EOF, so reads are retried while the decoders drain */
+#define READ_EOF_RETRY_MS 100
+/* a read_thread sleeping on full queues checks this often whether playback crossed into the next source */
+#define READ_SRC_PENDING_POLL_MS 40
+/* packets read looking for the first video keyframe before a cached probe result is trusted */
+#define PROBE_CACHE_VERIFY_PACKETS 256
+
+/* what read_thread sleeps on, see read_thread_wait() */
+#define READ_WAIT_NONE          0
+#define READ_WAIT_QUEUES_FULL   1
+#define READ_WAIT_RING_FULL     2
+#define READ_WAIT_ANY           3
 
 /* NOTE: the size must be big enough to compensate the hardware audio buffersize size */
 /* TODO: We assume that a decoded and resampled frame fits into this buffer */
 #define SAMPLE_ARRAY_SIZE (8 * 65536)
 
-#define MIN_PKT_DURATION 15
-
 #ifdef FFP_MERGE
 #define CURSOR_HIDE_DELAY 1000000
 
@@ -157,27 +192,56 @@ typedef struct GetImgInfo {
     struct SwsContext *frame_img_convert_ctx;
 } GetImgInfo;
 
-typedef struct MyAVPacketList {
-    AVPacket pkt;
-    struct MyAVPacketList *next;
-    int serial;
-} MyAVPacketList;
+/*
+ * An alternate audio track kept demuxed while another one plays, so that
+ * switching to it can prime the decoder at once (see ffp_set_stream_selected()).
+ */
+typedef struct AudioStandby {
+    int stream;                 /* -1 for a free slot */
+    int64_t seq;
+    PacketBackBuffer pkts;      /* compressed packets from about the playback position on */
+} AudioStandby;
 
-typedef struct PacketQueue {
-    MyAVPacketList *first_pkt, *last_pkt;
-    int nb_packets;
-    int size;
-    int64_t duration;
-    int abort_request;
-    int serial;
-    SDL_mutex *mutex;
-    SDL_cond *cond;
-    MyAVPacketList *recycle_pkt;
-    int recycle_count;
-    int alloc_count;
+#define MAX_AUDIO_STANDBY           4
+#define AUDIO_STANDBY_MAX_SIZE      (4 * 1024 * 1024)
+/* a standby track drops packets further behind the playback position */
+#define AUDIO_STANDBY_KEEP_BEHIND   (AV_TIME_BASE / 2)
 
-    int is_buffer_indicator;
-} PacketQueue;
+/*
+ * A source read_thread reads from. The first one is is->ic itself, the ones
+ * switched to at its end (see ffp_set_next_data_source_l() and gapless loop)
+ * are mapped onto its streams and timeline.
+ */
+typedef struct PlaySource {
+    AVFormatContext *ic;        /* NULL for is->ic */
+    int video_stream;           /* in ic, -1 for none */
+    int audio_stream;
+    int loop;                   /* a gapless loop of the previous source */
+    int64_t offset;             /* AV_TIME_BASE, added to its timestamps */
+    int64_t begin;              /* AV_TIME_BASE, where it starts on the timeline */
+    int64_t duration;           /* AV_TIME_BASE, AV_NOPTS_VALUE when unknown */
+    int new_codec;              /* its audio needs the decoder reopened */
+    int codec_mark;             /* codec_pkt went into audioq before its first packet */
+    int new_video_codec;        /* same for its video and videoq */
+    int video_codec_mark;
+    int64_t trim_delay;         /* iTunSMPB, in samples of the audio stream, trim_end 0 for none */
+    int64_t trim_end;
+} PlaySource;
+
+/* packets the preload of the next source reads ahead */
+#define NEXT_SOURCE_READ_AHEAD      (1024 * 1024)
+/* a gapless loop preloads its restart this long before the end */
+#define NEXT_SOURCE_LOOP_AHEAD      (10 * AV_TIME_BASE)
+
+/* crossfade of an audio-only source into the next one, see audio_thread_crossfade() */
+#define MAX_AUDIO_CROSSFADE_MS      10000
+#define XFADE_IDLE                  0
+#define XFADE_HOLDING               1   // holding the end of the source playing
+#define XFADE_DRAINING              2   // the next source did not come, the held end plays unmixed
+#define XFADE_MIXING                3   // mixing the start of the next source into it
+
+/* audio decoded ahead of the renderer on a worker thread, see audio-ring-ms */
+#define MAX_AUDIO_RING_MS           1000
 
 // #define VIDEO_PICTURE_QUEUE_SIZE 3
 #define VIDEO_PICTURE_QUEUE_SIZE_MIN        (3)
@@ -259,7 +323,6 @@ typedef struct Decoder {
     int bfsc_ret;
     uint8_t *bfsc_data;
 
-    SDL_cond *empty_queue_cond;
     int64_t start_pts;
     AVRational start_pts_tb;
     int64_t next_pts;
@@ -270,6 +333,11 @@ typedef struct Decoder {
     SDL_Profiler decode_profiler;
     Uint64 first_frame_decoded_time;
     int    first_frame_decoded;
+
+    /* source switch in the packet stream (codec_pkt), audio and video */
+    AVCodecParameters *next_par;    // to reopen with, set by read_thread before queueing codec_pkt
+    int reopen;                     // codec_pkt seen, draining the frames before it
+    int boundary;                   // the next frame is the first one after the switch
 } Decoder;
 
 typedef struct VideoState {
@@ -306,7 +374,8 @@ typedef struct VideoState {
     int audio_stream;
 
     int av_sync_type;
-    void *handle;
+    IjkTimeStretch *timestretch;    /* soundtouch, created on the first stretched frame */
+    int timestretch_serial;
     double audio_clock;
     int audio_clock_serial;
     double audio_diff_cum; /* used for AV difference average computation */
@@ -318,7 +387,7 @@ typedef struct VideoState {
     int audio_hw_buf_size;
     uint8_t *audio_buf;
     uint8_t *audio_buf1;
-    short *audio_new_buf;  /* for soundtouch buf */
+    uint8_t *audio_new_buf;  /* stretched output of timestretch */
     unsigned int audio_buf_size; /* in bytes */
     unsigned int audio_buf1_size;
     unsigned int audio_new_buf_size;
@@ -326,6 +395,7 @@ typedef struct VideoState {
     int audio_write_buf_size;
     int audio_volume;
     int muted;
+    float audio_gain;           // applied at the end of the last callback, ramps towards volume and mute
     struct AudioParams audio_src;
 #if CONFIG_AVFILTER
     struct AudioParams audio_filter_src;
@@ -387,6 +457,16 @@ typedef struct VideoState {
     int last_video_stream, last_audio_stream, last_subtitle_stream;
 
     SDL_cond *continue_read_thread;
+    /* guards read_wakeup, continue_read_thread is waited on with it */
+    SDL_mutex *read_wait_mutex;
+    int read_wakeup;
+    /* READ_WAIT_*, read by the consumers to decide whether to wake read_thread */
+    int read_wait_reason;
+    /* render_wait_start parks the renderers on pause_cond until pause_req clears */
+    SDL_mutex *pause_mutex;
+    SDL_cond *pause_cond;
+    /* set by video_refresh_wakeup(), guarded by pictq.mutex */
+    int refresh_wakeup;
 
     /* extra fields */
     SDL_mutex  *play_mutex; // only guard state, do not block any long operation
@@ -394,6 +474,7 @@ typedef struct VideoState {
     SDL_Thread _video_refresh_tid;
 
     int buffering_on;
+    FFBufferingController *buffering_ctrl;
     int pause_req;
 
     int dropping_frame;
@@ -406,6 +487,70 @@ typedef struct VideoState {
     volatile int latest_audio_seek_load_serial;
     volatile int64_t latest_seek_load_start_at;
 
+    FFProbeCache *probe_cache;
+    FFKeyframeIndex *kf_index;
+    int kf_index_stream;
+    int64_t kf_index_last_pts;
+
+    /* scrub mode, see ffp_set_scrub_mode_l() */
+    int scrubbing;
+    int scrub_resume;               // playback was running when the scrub started
+    volatile int scrub_seek_req;    // scrub_pos waits for read_thread, a newer target replaces it
+    volatile int64_t scrub_pos;
+    volatile int64_t scrub_req_at;  // av_gettime_relative() when scrub_pos was requested
+    int scrub_seeking;              // the last seek read_thread served was a scrub seek
+    int scrub_frame_queued;         // its keyframe is queued, nothing more to read
+    volatile int scrub_serial;      // video serial of that seek until its frame is shown, -1 otherwise
+    int64_t scrub_seek_req_at;
+
+    /* hot-standby audio tracks, read_thread fills them, a switch to one of them empties it */
+    AudioStandby audio_standby[MAX_AUDIO_STANDBY];
+    SDL_mutex *audio_switch_mutex;  // held while read_thread dispatches a packet and while a switch moves packets
+
+    /* parallel prepare: the audio component opens on its own thread while read_thread opens video */
+    SDL_Thread *audio_open_tid;
+    SDL_Thread _audio_open_tid;
+    int audio_open_stream;
+    volatile int audio_open_pending;    // cleared by audio_open_thread when it is done
+    AudioStandby audio_open_pkts;       // audio read before the component was open: first-frame-early or a track switch
+
+    /* gapless switch to the next source, read_thread side only unless noted */
+    PlaySource read_src;            // the source read from
+    PlaySource play_src;            // the source playing, read_src once playback crossed into it
+    volatile int src_switched;      // read from a source after is->ic, read by the app thread
+    int64_t read_src_end;           // AV_TIME_BASE, end of what was read from read_src on the timeline
+    char *next_url;                 // preloaded or to preload after read_src
+    char *volatile next_url_req;    // set by ffp_set_next_data_source_l(), "" cancels
+    FFPreload *preload;
+    FFPreload *preload_draining;    // switched to, its read-ahead packets go first
+    AVDictionary *src_format_opts;  // the format options is->ic was opened with
+
+    /* audio-only crossfade into the next source, audio_thread side unless noted */
+    FFCrossfade *xfade;
+    volatile int64_t xfade_from;           // AV_TIME_BASE on the timeline, set by read_thread, AV_NOPTS_VALUE for none
+    volatile int xfade_state;       // XFADE_*, read by read_thread
+    int xfade_serial;
+
+    /* trick play, see ffp_set_trick_play_rate_l() */
+    volatile float trick_rate;      // 0 for normal playback, negative rewinds
+    int trick_skip_frame;           // viddec skip_frame to restore, video thread only
+    int trick_skip_applied;         // video thread only, viddec skips non-keyframes
+    int64_t trick_last_pts;         // last keyframe queued, AV_TIME_BASE
+    int64_t trick_step;             // rewind: how far before trick_last_pts the next seek aims
+    int trick_kf_wait;              // rewind: seeked back, the next keyframe is the one to show
+
+    /* backward stepping and reverse playback, see ffp_set_reverse_playback_l() */
+    FFGopCache *gop_cache;
+    SDL_Thread *reverse_tid;
+    SDL_Thread _reverse_tid;
+    SDL_mutex *reverse_mutex;
+    SDL_cond *reverse_cond;
+    volatile int reverse_mode;      // REVERSE_*
+    volatile int reverse_serial;    // video serial of the frames the reverse thread queues, -1 until read_thread flushed
+    int reverse_steps;              // backward steps the reverse thread still owes
+    int64_t reverse_pts;            // last frame queued backwards, AV_TIME_BASE
+    SDL_mutex *pictq_write_mutex;   // the video decoder and the reverse thread both queue pictures
+
     int drop_aframe_count;
     int drop_vframe_count;
     int64_t accurate_seek_start_time;
@@ -488,6 +633,24 @@ typedef struct FFTrackCacheStatistic
     int64_t packets;
 } FFTrackCacheStatistic;
 
+/* startup stages timed by FFStatistic, FFP_PROP_INT64_PREPARE_STAGE_BASE + stage reads one */
+enum {
+    FFP_PREPARE_STAGE_OPEN_INPUT = 0,
+    FFP_PREPARE_STAGE_FIND_STREAM_INFO,
+    FFP_PREPARE_STAGE_VIDEO_DECODER_OPEN,
+    FFP_PREPARE_STAGE_AUDIO_DECODER_OPEN,
+    FFP_PREPARE_STAGE_AUDIO_OUTPUT_OPEN,
+    FFP_PREPARE_STAGE_RENDERER_READY,
+    FFP_PREPARE_STAGE_PREPARED,
+    FFP_PREPARE_STAGE_FIRST_VIDEO_FRAME_DECODED,
+    FFP_PREPARE_STAGE_FIRST_VIDEO_FRAME_RENDERED,
+    FFP_PREPARE_STAGE_FIRST_AUDIO_FRAME_RENDERED,
+    FFP_PREPARE_STAGE_NB
+};
+
+/* renderer callback durations counted by FFStatistic, FFP_PROP_INT64_AUDIO_CALLBACK_HIST_BASE + bucket reads one */
+#define FFP_AUDIO_CALLBACK_HIST_NB  8
+
 typedef struct FFStatistic
 {
     int64_t vdec_type;
@@ -515,13 +678,49 @@ typedef struct FFStatistic
     int drop_frame_count;
     int decode_frame_count;
     float drop_frame_rate;
+    /* time spent converting/copying a decoded frame into its overlay, in us */
+    int64_t vout_fill_time;
+    int64_t vout_fill_time_avg;
+    /* bitstream bytes memcpy'd on the way into the hardware video decoder */
+    int64_t vdec_input_copy_bytes;
+    SDL_SpeedSampler2 vdec_input_copy_sampler;
+    /* frames taken off the record queue by the encode thread, and frames the queue had no room for */
+    SDL_SpeedSampler2 record_encode_sampler;
+    int64_t record_dropped_frames;
+    /* times the read, refresh and pause-wait loops woke up, updated atomically */
+    int64_t thread_wakeups;
+    /* predicted ms until the demux cache runs dry, -1 when no stall is expected */
+    int64_t buffering_stall_eta_ms;
+    /* av_gettime_relative() at ffp_prepare_async_l(), and the ms after it each stage was first reached, -1 before */
+    int64_t prepare_start;
+    int64_t prepare_stage_ms[FFP_PREPARE_STAGE_NB];
+    /* audio output, updated atomically from the renderer callback: times it found the PCM ring short, and its durations */
+    int64_t audio_underruns;
+    int64_t audio_callback_hist[FFP_AUDIO_CALLBACK_HIST_NB];
 } FFStatistic;
 
 #define FFP_TCP_READ_SAMPLE_RANGE 2000
+#define FFP_VDEC_COPY_SAMPLE_RANGE 1000
+#define FFP_RECORD_ENCODE_SAMPLE_RANGE 2000
 inline static void ffp_reset_statistic(FFStatistic *dcc)
 {
     memset(dcc, 0, sizeof(FFStatistic));
+    dcc->buffering_stall_eta_ms = -1;
+    for (int i = 0; i < FFP_PREPARE_STAGE_NB; i++)
+        dcc->prepare_stage_ms[i] = -1;
     SDL_SpeedSampler2Reset(&dcc->tcp_read_sampler, FFP_TCP_READ_SAMPLE_RANGE);
+    SDL_SpeedSampler2Reset(&dcc->vdec_input_copy_sampler, FFP_VDEC_COPY_SAMPLE_RANGE);
+    SDL_SpeedSampler2Reset(&dcc->record_encode_sampler, FFP_RECORD_ENCODE_SAMPLE_RANGE);
+}
+
+/* bucket i counts the callbacks shorter than 50 << i us, the last one all longer ones */
+inline static void ffp_statistic_audio_callback(FFStatistic *dcc, int64_t duration_us)
+{
+    int bucket = 0;
+
+    while (bucket < FFP_AUDIO_CALLBACK_HIST_NB - 1 && duration_us >= (50LL << bucket))
+        bucket++;
+    __atomic_add_fetch(&dcc->audio_callback_hist[bucket], 1, __ATOMIC_RELAXED);
 }
 
 typedef struct FFDemuxCacheControl
@@ -533,7 +732,6 @@ typedef struct FFDemuxCacheControl
     int first_high_water_mark_in_ms;
     int next_high_water_mark_in_ms;
     int last_high_water_mark_in_ms;
-    int current_high_water_mark_in_ms;
 } FFDemuxCacheControl;
 
 inline static void ffp_reset_demux_cache_control(FFDemuxCacheControl *dcc)
@@ -545,7 +743,6 @@ inline static void ffp_reset_demux_cache_control(FFDemuxCacheControl *dcc)
     dcc->first_high_water_mark_in_ms    = DEFAULT_FIRST_HIGH_WATER_MARK_IN_MS;
     dcc->next_high_water_mark_in_ms     = DEFAULT_NEXT_HIGH_WATER_MARK_IN_MS;
     dcc->last_high_water_mark_in_ms     = DEFAULT_LAST_HIGH_WATER_MARK_IN_MS;
-    dcc->current_high_water_mark_in_ms  = DEFAULT_FIRST_HIGH_WATER_MARK_IN_MS;
 }
 
 /* ffplayer */
@@ -666,6 +863,7 @@ typedef struct FFPlayer {
     int64_t playable_duration_ms;
 
     int packet_buffering;
+    char *buffering_policy;
     int pictq_size;
     int max_fps;
     int startup_volume;
@@ -686,6 +884,10 @@ typedef struct FFPlayer {
 
     int opensles;
     int soundtouch_enable;
+    int audio_float_output;
+    int audio_ring_ms;
+    int audio_low_latency;
+    int video_frame_ref;
 
     char *iformat_name;
 
@@ -717,6 +919,14 @@ typedef struct FFPlayer {
 
     int enable_accurate_seek;
     int accurate_seek_timeout;
+    int keyframe_index;
+    int keyframe_index_prepass;
+    char *keyframe_index_dir;
+    int probe_cache;
+    char *probe_cache_dir;
+    int seek_in_buffer;
+    int back_buffer_size;
+    int gop_cache_size;
     int mediacodec_sync;
     int skip_calc_frame_rate;
     int get_frame_mode;
@@ -726,9 +936,18 @@ typedef struct FFPlayer {
     char *mediacodec_default_name;
     int ijkmeta_delay_init;
     int render_wait_start;
+    int parallel_prepare;
+    int first_frame_early;
+    int gapless_loop;
+    int audio_crossfade;
     RecordWriteData record_write_data;
+    void *clip_export;
     int is_screenshot;
     char *screen_file_name;
+    int packet_queue_ring_size;
+    int audio_standby_tracks;
+    int record_queue_size;
+    int record_queue_policy;
 } FFPlayer;
 
 #define fftime_to_milliseconds(ts) (av_rescale(ts, 1000, AV_TIME_BASE))
@@ -808,10 +1027,19 @@ inline static void ffp_reset_internal(FFPlayer *ffp)
     ffp->sync_av_start          = 1;
     ffp->enable_accurate_seek   = 0;
     ffp->accurate_seek_timeout  = MAX_ACCURATE_SEEK_TIMEOUT;
+    ffp->keyframe_index         = 1;
+    ffp->keyframe_index_prepass = 0;
+    ffp->keyframe_index_dir     = NULL; // option
+    ffp->probe_cache            = 1;
+    ffp->probe_cache_dir        = NULL; // option
+    ffp->seek_in_buffer         = 1;
+    ffp->back_buffer_size       = 0;
+    ffp->gop_cache_size         = DEFAULT_GOP_CACHE_SIZE;
 
     ffp->playable_duration_ms           = 0;
 
     ffp->packet_buffering               = 1;
+    ffp->buffering_policy               = NULL; // option
     ffp->pictq_size                     = VIDEO_PICTURE_QUEUE_SIZE_DEFAULT; // option
     ffp->max_fps                        = 31; // option
 
@@ -830,6 +1058,10 @@ inline static void ffp_reset_internal(FFPlayer *ffp)
 
     ffp->opensles                       = 0; // option
     ffp->soundtouch_enable              = 0; // option
+    ffp->audio_float_output             = 0; // option
+    ffp->audio_ring_ms                  = 40; // option
+    ffp->audio_low_latency              = 0; // option
+    ffp->video_frame_ref                = 1; // option
 
     ffp->iformat_name                   = NULL; // option
 
@@ -839,6 +1071,14 @@ inline static void ffp_reset_internal(FFPlayer *ffp)
     ffp->mediacodec_default_name        = NULL; // option
     ffp->ijkmeta_delay_init             = 0; // option
     ffp->render_wait_start              = 0;
+    ffp->parallel_prepare               = 0; // option
+    ffp->first_frame_early              = 0; // option
+    ffp->gapless_loop                   = 0; // option
+    ffp->audio_crossfade                = 0; // option
+    ffp->packet_queue_ring_size         = 0; // option
+    ffp->audio_standby_tracks           = 0; // option
+    ffp->record_queue_size              = OHOS_RECORD_QUEUE_SIZE_DEFAULT; // option
+    ffp->record_queue_policy            = OHOS_RECORD_QUEUE_POLICY_DROP; // option
 
     ijkmeta_reset(ffp->meta);
 
@@ -112,6 +112,8 @@ static const AVOption ffp_context_options[] = {
     { "fcc-rv16",                       "", 0, OPTION_CONST(SDL_FCC_RV16), .unit = "overlay-format" },
     { "fcc-rv24",                       "", 0, OPTION_CONST(SDL_FCC_RV24), .unit = "overlay-format" },
     { "fcc-rv32",                       "", 0, OPTION_CONST(SDL_FCC_RV32), .unit = "overlay-format" },
+    { "fcc-nv12",                       "", 0, OPTION_CONST(SDL_FCC_NV12), .unit = "overlay-format" },
+    { "fcc-nv21",                       "", 0, OPTION_CONST(SDL_FCC_NV21), .unit = "overlay-format" },
 
     { "start-on-prepared",                  "automatically start playing on prepared",
         OPTION_OFFSET(start_on_prepared),   OPTION_INT(1, 0, 1) },
@@ -143,6 +145,8 @@ static const AVOption ffp_context_options[] = {
 
     { "packet-buffering",                   "pause output until enough packets have been read after stalling",
         OPTION_OFFSET(packet_buffering),    OPTION_INT(1, 0, 1) },
+    { "buffering-policy",                   "how much to cache before resuming: ladder, bandwidth",
+        OPTION_OFFSET(buffering_policy),    OPTION_STR(NULL) },
     { "sync-av-start",                      "synchronise a/v start time",
         OPTION_OFFSET(sync_av_start),       OPTION_INT(1, 0, 1) },
     { "iformat",                            "force format",
@@ -156,6 +160,22 @@ static const AVOption ffp_context_options[] = {
         OPTION_OFFSET(enable_accurate_seek),       OPTION_INT(0, 0, 1) },
     { "accurate-seek-timeout",                      "accurate seek timeout",
         OPTION_OFFSET(accurate_seek_timeout),       OPTION_INT(MAX_ACCURATE_SEEK_TIMEOUT, 0, MAX_ACCURATE_SEEK_TIMEOUT) },
+    { "keyframe-index",                             "index keyframes of containers without a seek index",
+        OPTION_OFFSET(keyframe_index),              OPTION_INT(1, 0, 1) },
+    { "keyframe-index-prepass",                     "index the whole file in the background with a demux-only pass",
+        OPTION_OFFSET(keyframe_index_prepass),      OPTION_INT(0, 0, 1) },
+    { "keyframe-index-dir",                         "where keyframe indexes are kept, next to cache_file_path by default",
+        OPTION_OFFSET(keyframe_index_dir),          OPTION_STR(NULL) },
+    { "probe-cache",                                "reuse the stream info probed on an earlier open of the same file",
+        OPTION_OFFSET(probe_cache),                 OPTION_INT(1, 0, 1) },
+    { "probe-cache-dir",                            "where probe results are kept, next to cache_file_path by default",
+        OPTION_OFFSET(probe_cache_dir),             OPTION_STR(NULL) },
+    { "seek-in-buffer",                             "serve seeks inside the buffered packets without seeking the demuxer",
+        OPTION_OFFSET(seek_in_buffer),              OPTION_INT(1, 0, 1) },
+    { "back-buffer-size",                           "bytes of played packets kept per stream for backward seeks",
+        OPTION_OFFSET(back_buffer_size),            OPTION_INT(0, 0, MAX_BACK_BUFFER_SIZE) },
+    { "gop-cache-size",                             "bytes of decoded frames kept for backward stepping and reverse playback",
+        OPTION_OFFSET(gop_cache_size),              OPTION_INT(DEFAULT_GOP_CACHE_SIZE, 0, MAX_GOP_CACHE_SIZE) },
     { "skip-calc-frame-rate",                      "don't calculate real frame rate",
         OPTION_OFFSET(skip_calc_frame_rate),       OPTION_INT(0, 0, 1) },
     { "get-frame-mode",                      "warning, this option only for get frame",
@@ -198,6 +218,14 @@ static const AVOption ffp_context_options[] = {
         OPTION_OFFSET(opensles),            OPTION_INT(0, 0, 1) },
     { "soundtouch",                           "SoundTouch: enable",
         OPTION_OFFSET(soundtouch_enable),            OPTION_INT(0, 0, 1) },
+    { "audio-float-output",               "render float samples instead of S16, SoundTouch keeps S16",
+        OPTION_OFFSET(audio_float_output),           OPTION_INT(0, 0, 1) },
+    { "audio-ring-ms",                    "decode audio this many ms ahead of the renderer on a worker thread, 0 to decode in its callback",
+        OPTION_OFFSET(audio_ring_ms),                OPTION_INT(40, 0, MAX_AUDIO_RING_MS) },
+    { "audio-low-latency",                "fast audio output with short callbacks and a small ring, clocked by measured latency",
+        OPTION_OFFSET(audio_low_latency),            OPTION_INT(0, 0, 1) },
+    { "video-frame-ref",                  "queue decoded frames by reference and fill the overlay when shown, 0 to fill it when queued",
+        OPTION_OFFSET(video_frame_ref),              OPTION_INT(1, 0, 1) },
     { "mediacodec-sync",                 "mediacodec: use msg_queue for synchronise",
         OPTION_OFFSET(mediacodec_sync),           OPTION_INT(0, 0, 1) },
     { "mediacodec-default-name",          "mediacodec default name",
@@ -206,6 +234,23 @@ static const AVOption ffp_context_options[] = {
         OPTION_OFFSET(ijkmeta_delay_init),      OPTION_INT(0, 0, 1) },
     { "render-wait-start",          "render wait start",
         OPTION_OFFSET(render_wait_start),      OPTION_INT(0, 0, 1) },
+    { "parallel-prepare",           "open the audio decoder and output while the video decoder opens, warm up the renderer meanwhile",
+        OPTION_OFFSET(parallel_prepare),       OPTION_INT(0, 0, 1) },
+    { "first-frame-early",          "with parallel-prepare, start reading and show the first video frame before the audio output is open",
+        OPTION_OFFSET(first_frame_early),      OPTION_INT(0, 0, 1) },
+    { "gapless-loop",               "loop by switching to a preloaded reopen of the file at its end instead of seeking back",
+        OPTION_OFFSET(gapless_loop),           OPTION_INT(0, 0, 1) },
+    { "audio-crossfade",            "crossfade an audio-only source into the next one over this many ms, 0 for gapless",
+        OPTION_OFFSET(audio_crossfade),        OPTION_INT(0, 0, MAX_AUDIO_CROSSFADE_MS) },
+    { "packet-queue-ring-size",     "use a lock-free ring of this many packets per stream, 0 for linked list",
+        OPTION_OFFSET(packet_queue_ring_size), OPTION_INT(0, 0, PACKET_RING_CAPACITY_MAX) },
+    { "audio-standby-tracks",       "alternate audio tracks kept demuxed for instant track switching",
+        OPTION_OFFSET(audio_standby_tracks), OPTION_INT(0, 0, MAX_AUDIO_STANDBY) },
+    { "record-queue-size",          "frames per stream the recorder may hold before its backpressure policy applies",
+        OPTION_OFFSET(record_queue_size),   OPTION_INT(OHOS_RECORD_QUEUE_SIZE_DEFAULT, 1, OHOS_RECORD_QUEUE_SIZE_MAX) },
+    { "record-queue-policy",        "recorder queue full: 0 drop the frame, 1 block the decoder",
+        OPTION_OFFSET(record_queue_policy), OPTION_INT(OHOS_RECORD_QUEUE_POLICY_DROP,
+                                                       OHOS_RECORD_QUEUE_POLICY_DROP, OHOS_RECORD_QUEUE_POLICY_BLOCK) },
 
     { NULL }
 };
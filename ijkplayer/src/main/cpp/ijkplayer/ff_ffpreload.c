@@ -0,0 +1,258 @@
+/*
+ * ff_ffpreload.c
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "ff_ffpreload.h"
+#include <errno.h>
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "../ijksdl/ijksdl_mutex.h"
+#include "../ijksdl/ijksdl_thread.h"
+
+struct FFPreload {
+    SDL_mutex       *mutex;
+    SDL_Thread      *tid;
+    SDL_Thread       _tid;
+    volatile int     abort;
+
+    char            *url;
+    AVInputFormat   *iformat;
+    AVDictionary    *format_opts;
+    int              find_stream_info;
+    int              want_video;
+    int              want_audio;
+    int64_t          max_bytes;
+    void           (*done_cb)(void *opaque);
+    void            *done_opaque;
+
+    /* worker side until status is set, then the taker's */
+    AVFormatContext *ic;
+    int              video_stream;
+    int              audio_stream;
+    AVPacketList    *first_pkt;
+    AVPacketList    *last_pkt;
+    int64_t          bytes;
+
+    /* protected by mutex */
+    int              status;
+    int              taken;
+};
+
+static int preload_interrupt_cb(void *opaque)
+{
+    FFPreload *preload = opaque;
+    return preload->abort;
+}
+
+static int preload_open_input(FFPreload *preload)
+{
+    AVFormatContext *ic;
+    int ret;
+
+    preload->ic = avformat_alloc_context();
+    if (!preload->ic)
+        return AVERROR(ENOMEM);
+    preload->ic->interrupt_callback.callback = preload_interrupt_cb;
+    preload->ic->interrupt_callback.opaque   = preload;
+    ret = avformat_open_input(&preload->ic, preload->url, preload->iformat, &preload->format_opts);
+    if (ret < 0)
+        return ret;
+    ic = preload->ic;
+    if (preload->find_stream_info && (ret = avformat_find_stream_info(ic, NULL)) < 0)
+        return ret;
+
+    preload->video_stream = preload->want_video ?
+        av_find_best_stream(ic, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0) : -1;
+    preload->audio_stream = preload->want_audio ?
+        av_find_best_stream(ic, AVMEDIA_TYPE_AUDIO, -1, preload->video_stream, NULL, 0) : -1;
+    if (preload->video_stream < 0)
+        preload->video_stream = -1;
+    if (preload->audio_stream < 0)
+        preload->audio_stream = -1;
+    if (preload->video_stream < 0 && preload->audio_stream < 0)
+        return AVERROR_STREAM_NOT_FOUND;
+    for (unsigned int i = 0; i < ic->nb_streams; i++)
+        ic->streams[i]->discard = ((int)i == preload->video_stream || (int)i == preload->audio_stream) ?
+                                  AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    return 0;
+}
+
+static int preload_read_ahead(FFPreload *preload)
+{
+    AVPacket pkt;
+    AVPacketList *pkt1;
+    int ret;
+
+    while (!preload->abort && preload->bytes < preload->max_bytes) {
+        ret = av_read_frame(preload->ic, &pkt);
+        if (ret == AVERROR_EOF)
+            return 0;
+        if (ret < 0)
+            return ret;
+        if (pkt.stream_index != preload->video_stream && pkt.stream_index != preload->audio_stream) {
+            av_packet_unref(&pkt);
+            continue;
+        }
+        pkt1 = av_mallocz(sizeof(AVPacketList));
+        if (!pkt1) {
+            av_packet_unref(&pkt);
+            return AVERROR(ENOMEM);
+        }
+        pkt1->pkt = pkt;
+        if (preload->last_pkt)
+            preload->last_pkt->next = pkt1;
+        else
+            preload->first_pkt = pkt1;
+        preload->last_pkt = pkt1;
+        preload->bytes += pkt.size + sizeof(*pkt1);
+    }
+    return preload->abort ? AVERROR_EXIT : 0;
+}
+
+static int preload_thread(void *arg)
+{
+    FFPreload *preload = arg;
+    int64_t start = av_gettime_relative();
+    int ret;
+
+    ret = preload_open_input(preload);
+    if (ret >= 0)
+        ret = preload_read_ahead(preload);
+    if (ret >= 0)
+        av_log(NULL, AV_LOG_INFO, "preload: %s ready in %"PRId64" ms, %"PRId64" bytes read ahead\n",
+               preload->url, (av_gettime_relative() - start) / 1000, preload->bytes);
+    else if (ret != AVERROR_EXIT)
+        av_log(NULL, AV_LOG_WARNING, "preload: %s failed: %s\n", preload->url, av_err2str(ret));
+
+    SDL_LockMutex(preload->mutex);
+    preload->status = ret < 0 ? ret : 1;
+    SDL_UnlockMutex(preload->mutex);
+    if (preload->done_cb)
+        preload->done_cb(preload->done_opaque);
+    return 0;
+}
+
+FFPreload *ffpreload_open(const char *url, AVInputFormat *iformat, AVDictionary *format_opts,
+                          int find_stream_info, int want_video, int want_audio, int64_t max_bytes,
+                          void (*done_cb)(void *opaque), void *done_opaque)
+{
+    FFPreload *preload = (FFPreload *)av_mallocz(sizeof(FFPreload));
+    if (!preload)
+        return NULL;
+
+    preload->url              = av_strdup(url);
+    preload->iformat          = iformat;
+    preload->find_stream_info = find_stream_info;
+    preload->want_video       = want_video;
+    preload->want_audio       = want_audio;
+    preload->max_bytes        = max_bytes;
+    preload->done_cb          = done_cb;
+    preload->done_opaque      = done_opaque;
+    preload->video_stream     = -1;
+    preload->audio_stream     = -1;
+    av_dict_copy(&preload->format_opts, format_opts, 0);
+    preload->mutex = SDL_CreateMutex();
+    if (!preload->url || !preload->mutex)
+        goto fail;
+    preload->tid = SDL_CreateThreadEx(&preload->_tid, preload_thread, preload, "ff_preload");
+    if (!preload->tid)
+        goto fail;
+    return preload;
+fail:
+    ffpreload_closep(&preload);
+    return NULL;
+}
+
+void ffpreload_closep(FFPreload **ppreload)
+{
+    FFPreload *preload = ppreload ? *ppreload : NULL;
+    AVPacketList *pkt1;
+
+    if (!preload)
+        return;
+
+    if (preload->tid) {
+        preload->abort = 1;
+        SDL_WaitThread(preload->tid, NULL);
+        preload->tid = NULL;
+    }
+    while ((pkt1 = preload->first_pkt)) {
+        preload->first_pkt = pkt1->next;
+        av_packet_unref(&pkt1->pkt);
+        av_free(pkt1);
+    }
+    if (!preload->taken)
+        avformat_close_input(&preload->ic);
+    av_dict_free(&preload->format_opts);
+    av_freep(&preload->url);
+    SDL_DestroyMutex(preload->mutex);
+    av_freep(ppreload);
+}
+
+const char *ffpreload_url(FFPreload *preload)
+{
+    return preload ? preload->url : NULL;
+}
+
+int ffpreload_status(FFPreload *preload)
+{
+    int status;
+
+    if (!preload)
+        return AVERROR(EINVAL);
+    SDL_LockMutex(preload->mutex);
+    status = preload->status;
+    SDL_UnlockMutex(preload->mutex);
+    return status;
+}
+
+AVFormatContext *ffpreload_take_input(FFPreload *preload, int *video_stream, int *audio_stream)
+{
+    if (ffpreload_status(preload) != 1 || preload->taken)
+        return NULL;
+
+    // the worker is done once the status is set
+    SDL_WaitThread(preload->tid, NULL);
+    preload->tid   = NULL;
+    preload->taken = 1;
+    // the interrupt callback points at this preload, which goes away before the input
+    preload->ic->interrupt_callback.callback = NULL;
+    preload->ic->interrupt_callback.opaque   = NULL;
+    *video_stream = preload->video_stream;
+    *audio_stream = preload->audio_stream;
+    return preload->ic;
+}
+
+int ffpreload_read_packet(FFPreload *preload, AVPacket *pkt)
+{
+    AVPacketList *pkt1 = preload ? preload->first_pkt : NULL;
+
+    if (!pkt1 || !preload->taken)
+        return AVERROR_EOF;
+    preload->first_pkt = pkt1->next;
+    if (!preload->first_pkt)
+        preload->last_pkt = NULL;
+    preload->bytes -= pkt1->pkt.size + sizeof(*pkt1);
+    *pkt = pkt1->pkt;
+    av_free(pkt1);
+    return 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * ff_ffpreload.h
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * preload of the source played after the current one: a worker opens and
+ * probes it, picks its video and audio stream and reads their first packets,
+ * so that read_thread can switch over to it at the end of the current one
+ * without a gap
+ */
+
+#ifndef FFPLAY__FF_FFPRELOAD_H
+#define FFPLAY__FF_FFPRELOAD_H
+
+#include <stdint.h>
+#include "libavformat/avformat.h"
+
+typedef struct FFPreload FFPreload;
+
+/**
+ * @param format_opts      copied, the caller keeps ownership
+ * @param find_stream_info probe the streams after opening
+ * @param want_video       pick a video stream
+ * @param want_audio       pick an audio stream
+ * @param max_bytes        packets read ahead, the worker stops when it has that much
+ * @param done_cb          called on the worker once the status is set, may be NULL
+ * @param done_opaque      passed to done_cb
+ * @return the preload, its worker starts opening url right away
+ */
+FFPreload  *ffpreload_open(const char *url, AVInputFormat *iformat, AVDictionary *format_opts,
+                           int find_stream_info, int want_video, int want_audio, int64_t max_bytes,
+                           void (*done_cb)(void *opaque), void *done_opaque);
+/* stops the worker, closes what wasn't taken */
+void        ffpreload_closep(FFPreload **preload);
+
+const char *ffpreload_url(FFPreload *preload);
+
+/* 1 once opened and read ahead, 0 while the worker is still at it, a negative AVERROR when it failed */
+int         ffpreload_status(FFPreload *preload);
+
+/**
+ * Take over the opened input, only once ffpreload_status() returned 1.
+ * @param video_stream receives the picked video stream, -1 for none
+ * @param audio_stream receives the picked audio stream, -1 for none
+ * @return the input, streams other than the picked ones are discarded
+ */
+AVFormatContext *ffpreload_take_input(FFPreload *preload, int *video_stream, int *audio_stream);
+
+/**
+ * The packets read ahead, in order, after ffpreload_take_input().
+ * @return 0, AVERROR_EOF once they are all taken
+ */
+int         ffpreload_read_packet(FFPreload *preload, AVPacket *pkt);
+
+#endif
@@ -0,0 +1,466 @@
+/*
+ * ff_ffprobecache.c
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "ff_ffprobecache.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
+
+#define PROBECACHE_MAGIC            "IJKPROBE"
+#define PROBECACHE_VERSION          1
+#define PROBECACHE_SUFFIX           ".probe"
+#define PROBECACHE_MAX_STREAMS      64
+#define PROBECACHE_MAX_EXTRADATA    (1 << 20)
+
+typedef struct FFProbeCacheHeader {
+    char    magic[8];
+    int32_t version;
+    int32_t nb_streams;
+    int64_t file_size;
+    int64_t mtime;
+    int64_t duration;
+    int64_t start_time;
+    int64_t bit_rate;
+    int64_t keyframe_pos;       /* first video keyframe, -1 until known */
+    char    format_name[32];
+} FFProbeCacheHeader;
+
+typedef struct FFProbeCacheStream {
+    int32_t  codec_type;
+    int32_t  codec_id;
+    uint32_t codec_tag;
+    int32_t  format;
+    int64_t  bit_rate;
+    int32_t  bits_per_coded_sample;
+    int32_t  bits_per_raw_sample;
+    int32_t  profile;
+    int32_t  level;
+    int32_t  width;
+    int32_t  height;
+    int32_t  sar_num, sar_den;
+    int32_t  field_order;
+    int32_t  color_range;
+    int32_t  color_primaries;
+    int32_t  color_trc;
+    int32_t  color_space;
+    int32_t  chroma_location;
+    int32_t  video_delay;
+    int32_t  channels;
+    uint64_t channel_layout;
+    int32_t  sample_rate;
+    int32_t  block_align;
+    int32_t  frame_size;
+    int32_t  initial_padding;
+    int32_t  avg_frame_rate_num, avg_frame_rate_den;
+    int32_t  r_frame_rate_num, r_frame_rate_den;
+    int64_t  duration;
+    int64_t  start_time;
+    int32_t  extradata_size;
+    int32_t  reserved;
+} FFProbeCacheStream;
+
+struct FFProbeCache {
+    char               *path;
+    int64_t             file_size;
+    int64_t             mtime;
+
+    FFProbeCacheHeader  header;
+    FFProbeCacheStream *streams;
+    uint8_t           **extradata;
+    int                 loaded;     /* header, streams and extradata hold an entry */
+    int                 stored;     /* the entry comes from this open's probe */
+    int                 kf_checked;
+    int                 dirty;
+};
+
+static char *probecache_path(const char *dir, const char *url)
+{
+    // FNV-1a, size and mtime stored in the header tell apart files reusing a url
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char *p = (const unsigned char *)url; *p; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+    }
+    return av_asprintf("%s/%016llx%s", dir, (unsigned long long)hash, PROBECACHE_SUFFIX);
+}
+
+/* network protocols tell no modification time, the size has to do for them */
+static int64_t probecache_mtime(const char *url)
+{
+    const char *path = url;
+    struct stat st;
+
+    av_strstart(url, "file:", &path);
+    if (strstr(path, "://") || stat(path, &st) != 0)
+        return 0;
+    return (int64_t)st.st_mtime;
+}
+
+static void probecache_clear(FFProbeCache *cache)
+{
+    if (cache->extradata) {
+        for (int i = 0; i < cache->header.nb_streams; i++)
+            av_freep(&cache->extradata[i]);
+    }
+    av_freep(&cache->extradata);
+    av_freep(&cache->streams);
+    memset(&cache->header, 0, sizeof(cache->header));
+    cache->loaded = 0;
+    cache->stored = 0;
+    cache->dirty  = 0;
+}
+
+/* extradata with the padding decoders expect */
+static uint8_t *probecache_extradata_dup(const uint8_t *data, int size)
+{
+    uint8_t *dup = av_mallocz(size + AV_INPUT_BUFFER_PADDING_SIZE);
+
+    if (dup && size > 0)
+        memcpy(dup, data, size);
+    return dup;
+}
+
+static int probecache_alloc(FFProbeCache *cache, int nb_streams)
+{
+    cache->streams   = av_mallocz_array(nb_streams, sizeof(FFProbeCacheStream));
+    cache->extradata = av_mallocz_array(nb_streams, sizeof(uint8_t *));
+    if (!cache->streams || !cache->extradata) {
+        av_freep(&cache->streams);
+        av_freep(&cache->extradata);
+        return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+static int probecache_load(FFProbeCache *cache)
+{
+    FFProbeCacheHeader header;
+    FILE *fp = fopen(cache->path, "rb");
+    if (!fp)
+        return AVERROR(ENOENT);
+
+    int ret = AVERROR_INVALIDDATA;
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        memcmp(header.magic, PROBECACHE_MAGIC, sizeof(header.magic)) ||
+        header.version != PROBECACHE_VERSION ||
+        header.file_size != cache->file_size ||
+        header.mtime != cache->mtime ||
+        header.nb_streams <= 0 || header.nb_streams > PROBECACHE_MAX_STREAMS)
+        goto end;
+    header.format_name[sizeof(header.format_name) - 1] = '\0';
+
+    if ((ret = probecache_alloc(cache, header.nb_streams)) < 0)
+        goto end;
+    cache->header = header;
+    ret = AVERROR_INVALIDDATA;
+    if (fread(cache->streams, sizeof(FFProbeCacheStream), header.nb_streams, fp) != (size_t)header.nb_streams)
+        goto end;
+    for (int i = 0; i < header.nb_streams; i++) {
+        int size = cache->streams[i].extradata_size;
+        if (size < 0 || size > PROBECACHE_MAX_EXTRADATA)
+            goto end;
+        if (size == 0)
+            continue;
+        if (!(cache->extradata[i] = av_mallocz(size + AV_INPUT_BUFFER_PADDING_SIZE))) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        if (fread(cache->extradata[i], 1, size, fp) != (size_t)size)
+            goto end;
+    }
+    cache->loaded = 1;
+    ret = 0;
+end:
+    fclose(fp);
+    if (ret < 0)
+        probecache_clear(cache);
+    if (ret == AVERROR_INVALIDDATA)
+        av_log(NULL, AV_LOG_WARNING, "probecache: ignore stale or broken %s\n", cache->path);
+    return ret;
+}
+
+static int probecache_save(FFProbeCache *cache)
+{
+    if (!cache->path || !cache->dirty || !cache->loaded)
+        return 0;
+
+    char *tmp_path = av_asprintf("%s.tmp", cache->path);
+    if (!tmp_path)
+        return AVERROR(ENOMEM);
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp) {
+        av_free(tmp_path);
+        return AVERROR(errno);
+    }
+
+    int nb_streams = cache->header.nb_streams;
+    int ok = fwrite(&cache->header, sizeof(cache->header), 1, fp) == 1 &&
+             fwrite(cache->streams, sizeof(FFProbeCacheStream), nb_streams, fp) == (size_t)nb_streams;
+    for (int i = 0; ok && i < nb_streams; i++) {
+        int size = cache->streams[i].extradata_size;
+        ok = size == 0 || fwrite(cache->extradata[i], 1, size, fp) == (size_t)size;
+    }
+    ok = (fclose(fp) == 0) && ok;
+    // write aside and rename, a crash never leaves a torn entry behind
+    if (!ok || rename(tmp_path, cache->path) != 0) {
+        remove(tmp_path);
+        av_free(tmp_path);
+        return AVERROR(EIO);
+    }
+    av_free(tmp_path);
+    cache->dirty = 0;
+    return 0;
+}
+
+static void probecache_drop(FFProbeCache *cache, const char *reason)
+{
+    av_log(NULL, AV_LOG_WARNING, "probecache: %s, drop %s\n", reason, cache->path);
+    probecache_clear(cache);
+    remove(cache->path);
+}
+
+FFProbeCache *ffprobecache_open(const char *dir, const char *url, int64_t file_size)
+{
+    FFProbeCache *cache;
+
+    if (!dir || !strlen(dir) || !url || file_size <= 0)
+        return NULL;
+    cache = (FFProbeCache *)av_mallocz(sizeof(FFProbeCache));
+    if (!cache)
+        return NULL;
+
+    cache->file_size = file_size;
+    cache->mtime     = probecache_mtime(url);
+    cache->path      = probecache_path(dir, url);
+    if (!cache->path) {
+        av_free(cache);
+        return NULL;
+    }
+    if (probecache_load(cache) == 0)
+        av_log(NULL, AV_LOG_INFO, "probecache: %d streams from %s\n", cache->header.nb_streams, cache->path);
+    return cache;
+}
+
+void ffprobecache_closep(FFProbeCache **pcache)
+{
+    if (!pcache || !*pcache)
+        return;
+
+    FFProbeCache *cache = *pcache;
+    probecache_save(cache);
+    probecache_clear(cache);
+    av_freep(&cache->path);
+    av_freep(pcache);
+}
+
+/* what the demuxer found in the header has to agree with the entry */
+static int probecache_match(FFProbeCache *cache, AVFormatContext *ic)
+{
+    if (strcmp(cache->header.format_name, ic->iformat->name) || ic->nb_streams != cache->header.nb_streams)
+        return 0;
+
+    for (int i = 0; i < ic->nb_streams; i++) {
+        const AVCodecParameters *par = ic->streams[i]->codecpar;
+        const FFProbeCacheStream *cs = &cache->streams[i];
+
+        if ((par->codec_type != AVMEDIA_TYPE_UNKNOWN && par->codec_type != cs->codec_type) ||
+            (par->codec_id != AV_CODEC_ID_NONE && par->codec_id != cs->codec_id) ||
+            (par->width && par->width != cs->width) ||
+            (par->height && par->height != cs->height) ||
+            (par->sample_rate && par->sample_rate != cs->sample_rate) ||
+            (par->channels && par->channels != cs->channels))
+            return 0;
+        if (par->extradata_size > 0 &&
+            (par->extradata_size != cs->extradata_size ||
+             memcmp(par->extradata, cache->extradata[i], par->extradata_size)))
+            return 0;
+    }
+    return 1;
+}
+
+int ffprobecache_apply(FFProbeCache *cache, AVFormatContext *ic)
+{
+    if (!cache || !cache->loaded)
+        return AVERROR(ENOENT);
+    if (!probecache_match(cache, ic)) {
+        probecache_drop(cache, "the file changed");
+        return AVERROR_INVALIDDATA;
+    }
+
+    for (int i = 0; i < ic->nb_streams; i++) {
+        AVStream *st = ic->streams[i];
+        AVCodecParameters *par = st->codecpar;
+        const FFProbeCacheStream *cs = &cache->streams[i];
+
+        if (cs->extradata_size > 0 && par->extradata_size != cs->extradata_size) {
+            uint8_t *extradata = probecache_extradata_dup(cache->extradata[i], cs->extradata_size);
+            if (!extradata)
+                return AVERROR(ENOMEM);
+            av_freep(&par->extradata);
+            par->extradata      = extradata;
+            par->extradata_size = cs->extradata_size;
+        }
+        par->codec_type            = cs->codec_type;
+        par->codec_id              = cs->codec_id;
+        par->codec_tag             = cs->codec_tag;
+        par->format                = cs->format;
+        par->bit_rate              = cs->bit_rate;
+        par->bits_per_coded_sample = cs->bits_per_coded_sample;
+        par->bits_per_raw_sample   = cs->bits_per_raw_sample;
+        par->profile               = cs->profile;
+        par->level                 = cs->level;
+        par->width                 = cs->width;
+        par->height                = cs->height;
+        par->sample_aspect_ratio   = (AVRational){cs->sar_num, cs->sar_den};
+        par->field_order           = cs->field_order;
+        par->color_range           = cs->color_range;
+        par->color_primaries       = cs->color_primaries;
+        par->color_trc             = cs->color_trc;
+        par->color_space           = cs->color_space;
+        par->chroma_location       = cs->chroma_location;
+        par->video_delay           = cs->video_delay;
+        par->channels              = cs->channels;
+        par->channel_layout        = cs->channel_layout;
+        par->sample_rate           = cs->sample_rate;
+        par->block_align           = cs->block_align;
+        par->frame_size            = cs->frame_size;
+        par->initial_padding       = cs->initial_padding;
+        st->avg_frame_rate         = (AVRational){cs->avg_frame_rate_num, cs->avg_frame_rate_den};
+        st->r_frame_rate           = (AVRational){cs->r_frame_rate_num, cs->r_frame_rate_den};
+        if (st->duration == AV_NOPTS_VALUE)
+            st->duration = cs->duration;
+        if (st->start_time == AV_NOPTS_VALUE)
+            st->start_time = cs->start_time;
+    }
+    if (ic->duration == AV_NOPTS_VALUE)
+        ic->duration = cache->header.duration;
+    if (ic->start_time == AV_NOPTS_VALUE)
+        ic->start_time = cache->header.start_time;
+    if (ic->bit_rate <= 0)
+        ic->bit_rate = cache->header.bit_rate;
+    return 0;
+}
+
+int ffprobecache_store(FFProbeCache *cache, AVFormatContext *ic)
+{
+    int ret;
+
+    if (!cache)
+        return 0;
+    probecache_clear(cache);
+    if (ic->nb_streams <= 0 || ic->nb_streams > PROBECACHE_MAX_STREAMS)
+        return AVERROR(EINVAL);
+    if ((ret = probecache_alloc(cache, ic->nb_streams)) < 0)
+        return ret;
+
+    memcpy(cache->header.magic, PROBECACHE_MAGIC, sizeof(cache->header.magic));
+    cache->header.version      = PROBECACHE_VERSION;
+    cache->header.nb_streams   = ic->nb_streams;
+    cache->header.file_size    = cache->file_size;
+    cache->header.mtime        = cache->mtime;
+    cache->header.duration     = ic->duration;
+    cache->header.start_time   = ic->start_time;
+    cache->header.bit_rate     = ic->bit_rate;
+    cache->header.keyframe_pos = -1;
+    av_strlcpy(cache->header.format_name, ic->iformat->name, sizeof(cache->header.format_name));
+
+    for (int i = 0; i < ic->nb_streams; i++) {
+        const AVStream *st = ic->streams[i];
+        const AVCodecParameters *par = st->codecpar;
+        FFProbeCacheStream *cs = &cache->streams[i];
+
+        if (par->extradata_size > PROBECACHE_MAX_EXTRADATA) {
+            probecache_clear(cache);
+            return AVERROR(EINVAL);
+        }
+        if (par->extradata_size > 0 &&
+            !(cache->extradata[i] = probecache_extradata_dup(par->extradata, par->extradata_size))) {
+            probecache_clear(cache);
+            return AVERROR(ENOMEM);
+        }
+        cs->extradata_size        = par->extradata_size > 0 ? par->extradata_size : 0;
+        cs->codec_type            = par->codec_type;
+        cs->codec_id              = par->codec_id;
+        cs->codec_tag             = par->codec_tag;
+        cs->format                = par->format;
+        cs->bit_rate              = par->bit_rate;
+        cs->bits_per_coded_sample = par->bits_per_coded_sample;
+        cs->bits_per_raw_sample   = par->bits_per_raw_sample;
+        cs->profile               = par->profile;
+        cs->level                 = par->level;
+        cs->width                 = par->width;
+        cs->height                = par->height;
+        cs->sar_num               = par->sample_aspect_ratio.num;
+        cs->sar_den               = par->sample_aspect_ratio.den;
+        cs->field_order           = par->field_order;
+        cs->color_range           = par->color_range;
+        cs->color_primaries       = par->color_primaries;
+        cs->color_trc             = par->color_trc;
+        cs->color_space           = par->color_space;
+        cs->chroma_location       = par->chroma_location;
+        cs->video_delay           = par->video_delay;
+        cs->channels              = par->channels;
+        cs->channel_layout        = par->channel_layout;
+        cs->sample_rate           = par->sample_rate;
+        cs->block_align           = par->block_align;
+        cs->frame_size            = par->frame_size;
+        cs->initial_padding       = par->initial_padding;
+        cs->avg_frame_rate_num    = st->avg_frame_rate.num;
+        cs->avg_frame_rate_den    = st->avg_frame_rate.den;
+        cs->r_frame_rate_num      = st->r_frame_rate.num;
+        cs->r_frame_rate_den      = st->r_frame_rate.den;
+        cs->duration              = st->duration;
+        cs->start_time            = st->start_time;
+    }
+    cache->loaded     = 1;
+    cache->stored     = 1;
+    cache->dirty      = 1;
+    // a dropped entry was checked at open already, the new one records its keyframe while playing
+    cache->kf_checked = 0;
+    return 0;
+}
+
+int ffprobecache_has_entry(FFProbeCache *cache)
+{
+    return cache && cache->loaded;
+}
+
+int ffprobecache_check_keyframe(FFProbeCache *cache, int64_t pos)
+{
+    if (!cache || cache->kf_checked || !cache->loaded)
+        return 0;
+    cache->kf_checked = 1;
+    if (pos < 0)
+        return 0;
+
+    if (cache->stored || cache->header.keyframe_pos < 0) {
+        cache->header.keyframe_pos = pos;
+        cache->dirty = 1;
+    } else if (cache->header.keyframe_pos != pos) {
+        probecache_drop(cache, "first keyframe moved");
+        return AVERROR_INVALIDDATA;
+    }
+    return 0;
+}
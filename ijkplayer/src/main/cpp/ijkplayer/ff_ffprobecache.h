@@ -0,0 +1,73 @@
+/*
+ * ff_ffprobecache.h
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * probe cache: what avformat_find_stream_info() found out about a file (codec
+ * parameters, extradata, stream layout, duration) and where its first video
+ * keyframe is, persisted per file identity so that reopening it can skip the
+ * probe
+ */
+
+#ifndef FFPLAY__FF_FFPROBECACHE_H
+#define FFPLAY__FF_FFPROBECACHE_H
+
+#include <stdint.h>
+#include "libavformat/avformat.h"
+
+typedef struct FFProbeCache FFProbeCache;
+
+/**
+ * @param dir       where the cache file lives, NULL disables the cache
+ * @param url       together with file_size, and the modification time of a local file, identifies the file
+ * @param file_size avio_size() of the input, <= 0 disables the cache
+ * @return the cache, loaded from dir when this file was probed before
+ */
+FFProbeCache *ffprobecache_open(const char *dir, const char *url, int64_t file_size);
+/* saves the entry when it changed */
+void ffprobecache_closep(FFProbeCache **cache);
+
+/**
+ * Give the streams of a freshly opened ic the cached parameters, after checking
+ * that what the demuxer already knows (format, streams, codecs, header
+ * parameters) agrees with them.
+ * @return 0 when ic needs no probe anymore, AVERROR(ENOENT) without an entry,
+ *         AVERROR_INVALIDDATA when the entry does not match and was dropped
+ */
+int  ffprobecache_apply(FFProbeCache *cache, AVFormatContext *ic);
+
+/* 1 when the cache holds an entry for this file, which ffprobecache_apply() may use */
+int  ffprobecache_has_entry(FFProbeCache *cache);
+
+/* remember the result of a full probe */
+int  ffprobecache_store(FFProbeCache *cache, AVFormatContext *ic);
+
+/**
+ * Check the position of the first video keyframe read after open against the
+ * entry, or record it for an entry just stored. Only the first call with an
+ * entry counts.
+ * @return AVERROR_INVALIDDATA when a cached entry disagrees, it is then dropped
+ *         so that the next open probes again
+ */
+int  ffprobecache_check_keyframe(FFProbeCache *cache, int64_t pos);
+
+#endif
@@ -0,0 +1,199 @@
+/*
+ * ijkaudioutils.c
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "ijkaudioutils.h"
+
+#include <math.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IJK_AUDIO_HAVE_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define IJK_AUDIO_HAVE_SSE2 1
+#endif
+
+#define GAIN_MAX_VECS 8
+
+/*
+ * Per-sample gain offsets of the interleaved samples, 4 to a vector, over the
+ * lcm(4, channels) samples after which the pattern repeats, and what the gain
+ * advances by per repeat. Returns the number of vectors, 0 for a ramp over
+ * more than 8 channels, which takes the plain C path.
+ */
+static int gain_lanes(float lanes[GAIN_MAX_VECS][4], float *advance, int channels, float step)
+{
+    int nb_vecs;
+
+    if (channels <= 0)
+        return 0;
+    if (step == 0.0f)
+        nb_vecs = 1;
+    else if (channels > GAIN_MAX_VECS)
+        return 0;
+    else
+        nb_vecs = channels % 4 == 0 ? channels / 4 : (channels % 2 == 0 ? channels / 2 : channels);
+    for (int v = 0; v < nb_vecs; v++) {
+        for (int k = 0; k < 4; k++)
+            lanes[v][k] = step * ((v * 4 + k) / channels);
+    }
+    *advance = step * (nb_vecs * 4 / channels);
+    return nb_vecs;
+}
+
+#if IJK_AUDIO_HAVE_NEON
+static inline int32x4_t round_s32(float32x4_t f)
+{
+#if defined(__aarch64__)
+    return vcvtnq_s32_f32(f);
+#else
+    float32x4_t half = vbslq_f32(vcltq_f32(f, vdupq_n_f32(0.0f)), vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f));
+    return vcvtq_s32_f32(vaddq_f32(f, half));
+#endif
+}
+#endif
+
+static inline float clip_f32(float v)
+{
+    return v > 1.0f ? 1.0f : (v < -1.0f ? -1.0f : v);
+}
+
+static inline int16_t clip_s16(float v)
+{
+    return v >= 32767.0f ? 32767 : (v <= -32768.0f ? -32768 : (int16_t)lrintf(v));
+}
+
+void ijk_audio_apply_gain_f32(float *dst, const float *src, int nb_frames, int channels,
+                              float gain_start, float gain_end)
+{
+    const int   nb_samples = nb_frames * channels;
+    const float step       = nb_frames > 0 ? (gain_end - gain_start) / nb_frames : 0.0f;
+    float lanes[GAIN_MAX_VECS][4];
+    float advance  = 0.0f;
+    int   nb_vecs;
+    int   i        = 0;
+
+    if (nb_samples <= 0)
+        return;
+    nb_vecs = gain_lanes(lanes, &advance, channels, step);
+    if (nb_vecs) {
+#if IJK_AUDIO_HAVE_NEON
+        float32x4_t g   = vdupq_n_f32(gain_start);
+        float32x4_t adv = vdupq_n_f32(advance);
+        float32x4_t hi  = vdupq_n_f32(1.0f);
+        float32x4_t lo  = vdupq_n_f32(-1.0f);
+        for (int v = 0; i + 4 <= nb_samples; i += 4) {
+            float32x4_t f = vmulq_f32(vld1q_f32(src + i), vaddq_f32(g, vld1q_f32(lanes[v])));
+            vst1q_f32(dst + i, vmaxq_f32(vminq_f32(f, hi), lo));
+            if (++v == nb_vecs) {
+                v = 0;
+                g = vaddq_f32(g, adv);
+            }
+        }
+#elif IJK_AUDIO_HAVE_SSE2
+        __m128 g   = _mm_set1_ps(gain_start);
+        __m128 adv = _mm_set1_ps(advance);
+        __m128 hi  = _mm_set1_ps(1.0f);
+        __m128 lo  = _mm_set1_ps(-1.0f);
+        for (int v = 0; i + 4 <= nb_samples; i += 4) {
+            __m128 f = _mm_mul_ps(_mm_loadu_ps(src + i), _mm_add_ps(g, _mm_loadu_ps(lanes[v])));
+            _mm_storeu_ps(dst + i, _mm_max_ps(_mm_min_ps(f, hi), lo));
+            if (++v == nb_vecs) {
+                v = 0;
+                g = _mm_add_ps(g, adv);
+            }
+        }
+#endif
+    }
+    for (int frame = i / channels, c = i % channels; i < nb_samples; i++) {
+        dst[i] = clip_f32(src[i] * (gain_start + step * frame));
+        if (++c == channels) {
+            c = 0;
+            frame++;
+        }
+    }
+}
+
+void ijk_audio_apply_gain_s16(int16_t *dst, const int16_t *src, int nb_frames, int channels,
+                              float gain_start, float gain_end)
+{
+    const int   nb_samples = nb_frames * channels;
+    const float step       = nb_frames > 0 ? (gain_end - gain_start) / nb_frames : 0.0f;
+    float lanes[GAIN_MAX_VECS][4];
+    float advance  = 0.0f;
+    int   nb_vecs;
+    int   i        = 0;
+
+    if (nb_samples <= 0)
+        return;
+    nb_vecs = gain_lanes(lanes, &advance, channels, step);
+    if (nb_vecs) {
+#if IJK_AUDIO_HAVE_NEON
+        float32x4_t g   = vdupq_n_f32(gain_start);
+        float32x4_t adv = vdupq_n_f32(advance);
+        for (int v = 0; i + 8 <= nb_samples; i += 8) {
+            int16x8_t   s  = vld1q_s16(src + i);
+            float32x4_t f0 = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))), vaddq_f32(g, vld1q_f32(lanes[v])));
+            float32x4_t f1;
+            if (++v == nb_vecs) {
+                v = 0;
+                g = vaddq_f32(g, adv);
+            }
+            f1 = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))), vaddq_f32(g, vld1q_f32(lanes[v])));
+            if (++v == nb_vecs) {
+                v = 0;
+                g = vaddq_f32(g, adv);
+            }
+            // vqmovn saturates
+            vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(round_s32(f0)), vqmovn_s32(round_s32(f1))));
+        }
+#elif IJK_AUDIO_HAVE_SSE2
+        __m128 g   = _mm_set1_ps(gain_start);
+        __m128 adv = _mm_set1_ps(advance);
+        for (int v = 0; i + 8 <= nb_samples; i += 8) {
+            __m128i s  = _mm_loadu_si128((const __m128i *)(src + i));
+            __m128  f0 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16)),
+                                    _mm_add_ps(g, _mm_loadu_ps(lanes[v])));
+            __m128  f1;
+            if (++v == nb_vecs) {
+                v = 0;
+                g = _mm_add_ps(g, adv);
+            }
+            f1 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16)),
+                            _mm_add_ps(g, _mm_loadu_ps(lanes[v])));
+            if (++v == nb_vecs) {
+                v = 0;
+                g = _mm_add_ps(g, adv);
+            }
+            // _mm_packs_epi32 saturates
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(_mm_cvtps_epi32(f0), _mm_cvtps_epi32(f1)));
+        }
+#endif
+    }
+    for (int frame = i / channels, c = i % channels; i < nb_samples; i++) {
+        dst[i] = clip_s16(src[i] * (gain_start + step * frame));
+        if (++c == channels) {
+            c = 0;
+            frame++;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ * ijkaudioutils.h
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * gain kernels of the audio output: volume, mute ramps and clipping in one
+ * pass over interleaved S16 or float samples, NEON / SSE2 when the target has
+ * them, plain C otherwise
+ */
+
+#ifndef IJKAVUTIL_IJKAUDIOUTILS_H
+#define IJKAVUTIL_IJKAUDIOUTILS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * dst = src * gain, saturated to the S16 range. The gain goes linearly from
+ * gain_start at the first frame towards gain_end, reached after the last one.
+ * dst may be src.
+ * @param nb_frames number of sample frames, channels samples each
+ */
+void ijk_audio_apply_gain_s16(int16_t *dst, const int16_t *src, int nb_frames, int channels,
+                              float gain_start, float gain_end);
+
+/**
+ * Like ijk_audio_apply_gain_s16() for float samples, clipped to [-1, 1].
+ */
+void ijk_audio_apply_gain_f32(float *dst, const float *src, int nb_frames, int channels,
+                              float gain_start, float gain_end);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IJKAVUTIL_IJKAUDIOUTILS_H
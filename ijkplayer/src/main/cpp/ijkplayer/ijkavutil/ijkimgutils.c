@@ -0,0 +1,290 @@
+/*
+ * ijkimgutils.c
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "ijkimgutils.h"
+
+#include <string.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/cpu.h"
+#include "libavutil/error.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/mem.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define IJK_IMG_HAVE_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define IJK_IMG_HAVE_SSE2 1
+#if defined(__GNUC__) || defined(__clang__)
+/* built for the target attribute, taken only when the CPU reports AVX2 */
+#include <immintrin.h>
+#define IJK_IMG_HAVE_AVX2 1
+#define IJK_IMG_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+struct IjkImgConverter {
+    AVBufferPool *pool;
+    int           pool_size;
+};
+
+#if IJK_IMG_HAVE_AVX2
+/* packus and unpack work within 128-bit lanes, the permutes put the lanes back in order */
+IJK_IMG_TARGET_AVX2
+static int split_uv_row_avx2(uint8_t *dst_u, uint8_t *dst_v, const uint8_t *src_uv, int width)
+{
+    const __m256i mask = _mm256_set1_epi16(0x00ff);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i lo = _mm256_loadu_si256((const __m256i *)(src_uv + 2 * x));
+        __m256i hi = _mm256_loadu_si256((const __m256i *)(src_uv + 2 * x + 32));
+        __m256i u  = _mm256_packus_epi16(_mm256_and_si256(lo, mask), _mm256_and_si256(hi, mask));
+        __m256i v  = _mm256_packus_epi16(_mm256_srli_epi16(lo, 8), _mm256_srli_epi16(hi, 8));
+        _mm256_storeu_si256((__m256i *)(dst_u + x), _mm256_permute4x64_epi64(u, 0xd8));
+        _mm256_storeu_si256((__m256i *)(dst_v + x), _mm256_permute4x64_epi64(v, 0xd8));
+    }
+    return x;
+}
+
+IJK_IMG_TARGET_AVX2
+static int merge_uv_row_avx2(uint8_t *dst_uv, const uint8_t *src_u, const uint8_t *src_v, int width)
+{
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i u  = _mm256_loadu_si256((const __m256i *)(src_u + x));
+        __m256i v  = _mm256_loadu_si256((const __m256i *)(src_v + x));
+        __m256i lo = _mm256_unpacklo_epi8(u, v);
+        __m256i hi = _mm256_unpackhi_epi8(u, v);
+        _mm256_storeu_si256((__m256i *)(dst_uv + 2 * x),      _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *)(dst_uv + 2 * x + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    return x;
+}
+#endif
+
+static int have_avx2(void)
+{
+#if IJK_IMG_HAVE_AVX2
+    return !!(av_get_cpu_flags() & AV_CPU_FLAG_AVX2);
+#else
+    return 0;
+#endif
+}
+
+static void split_uv_row(uint8_t *dst_u, uint8_t *dst_v, const uint8_t *src_uv, int width, int avx2)
+{
+    int x = 0;
+#if IJK_IMG_HAVE_AVX2
+    if (avx2)
+        x = split_uv_row_avx2(dst_u, dst_v, src_uv, width);
+#endif
+#if IJK_IMG_HAVE_NEON
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x2_t uv = vld2q_u8(src_uv + 2 * x);
+        vst1q_u8(dst_u + x, uv.val[0]);
+        vst1q_u8(dst_v + x, uv.val[1]);
+    }
+#elif IJK_IMG_HAVE_SSE2
+    const __m128i mask = _mm_set1_epi16(0x00ff);
+    for (; x + 16 <= width; x += 16) {
+        __m128i lo = _mm_loadu_si128((const __m128i *)(src_uv + 2 * x));
+        __m128i hi = _mm_loadu_si128((const __m128i *)(src_uv + 2 * x + 16));
+        __m128i u  = _mm_packus_epi16(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+        __m128i v  = _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+        _mm_storeu_si128((__m128i *)(dst_u + x), u);
+        _mm_storeu_si128((__m128i *)(dst_v + x), v);
+    }
+#endif
+    for (; x < width; x++) {
+        dst_u[x] = src_uv[2 * x];
+        dst_v[x] = src_uv[2 * x + 1];
+    }
+}
+
+static void merge_uv_row(uint8_t *dst_uv, const uint8_t *src_u, const uint8_t *src_v, int width, int avx2)
+{
+    int x = 0;
+#if IJK_IMG_HAVE_AVX2
+    if (avx2)
+        x = merge_uv_row_avx2(dst_uv, src_u, src_v, width);
+#endif
+#if IJK_IMG_HAVE_NEON
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x2_t uv;
+        uv.val[0] = vld1q_u8(src_u + x);
+        uv.val[1] = vld1q_u8(src_v + x);
+        vst2q_u8(dst_uv + 2 * x, uv);
+    }
+#elif IJK_IMG_HAVE_SSE2
+    for (; x + 16 <= width; x += 16) {
+        __m128i u = _mm_loadu_si128((const __m128i *)(src_u + x));
+        __m128i v = _mm_loadu_si128((const __m128i *)(src_v + x));
+        _mm_storeu_si128((__m128i *)(dst_uv + 2 * x),      _mm_unpacklo_epi8(u, v));
+        _mm_storeu_si128((__m128i *)(dst_uv + 2 * x + 16), _mm_unpackhi_epi8(u, v));
+    }
+#endif
+    for (; x < width; x++) {
+        dst_uv[2 * x]     = src_u[x];
+        dst_uv[2 * x + 1] = src_v[x];
+    }
+}
+
+void ijk_img_copy_plane(uint8_t *dst, int dst_stride, const uint8_t *src, int src_stride, int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return;
+
+    if (dst_stride == width && src_stride == width) {
+        memcpy(dst, src, (size_t)width * height);
+        return;
+    }
+
+    for (int y = 0; y < height; y++) {
+        memcpy(dst, src, width);
+        dst += dst_stride;
+        src += src_stride;
+    }
+}
+
+void ijk_img_split_uv_plane(uint8_t *dst_u, int dst_stride_u, uint8_t *dst_v, int dst_stride_v,
+                            const uint8_t *src_uv, int src_stride_uv, int width, int height)
+{
+    const int avx2 = have_avx2();
+    for (int y = 0; y < height; y++) {
+        split_uv_row(dst_u, dst_v, src_uv, width, avx2);
+        dst_u  += dst_stride_u;
+        dst_v  += dst_stride_v;
+        src_uv += src_stride_uv;
+    }
+}
+
+void ijk_img_merge_uv_plane(uint8_t *dst_uv, int dst_stride_uv, const uint8_t *src_u, int src_stride_u,
+                            const uint8_t *src_v, int src_stride_v, int width, int height)
+{
+    const int avx2 = have_avx2();
+    for (int y = 0; y < height; y++) {
+        merge_uv_row(dst_uv, src_u, src_v, width, avx2);
+        dst_uv += dst_stride_uv;
+        src_u  += src_stride_u;
+        src_v  += src_stride_v;
+    }
+}
+
+int ijk_img_convert_frame(AVFrame *dst, const AVFrame *src)
+{
+    const int width     = src->width;
+    const int height    = src->height;
+    const int uv_width  = (width + 1) >> 1;
+    const int uv_height = (height + 1) >> 1;
+
+    if (width <= 0 || height <= 0)
+        return AVERROR(EINVAL);
+
+    if (src->format == AV_PIX_FMT_NV12 || src->format == AV_PIX_FMT_NV21) {
+        if (dst->format != AV_PIX_FMT_YUV420P)
+            return AVERROR(EINVAL);
+
+        /* NV21 carries V first, swapping the destinations is all it takes */
+        int u = src->format == AV_PIX_FMT_NV12 ? 1 : 2;
+        int v = 3 - u;
+        ijk_img_copy_plane(dst->data[0], dst->linesize[0], src->data[0], src->linesize[0], width, height);
+        ijk_img_split_uv_plane(dst->data[u], dst->linesize[u], dst->data[v], dst->linesize[v],
+                               src->data[1], src->linesize[1], uv_width, uv_height);
+        return 0;
+    }
+
+    if (src->format == AV_PIX_FMT_YUV420P) {
+        if (dst->format != AV_PIX_FMT_NV12 && dst->format != AV_PIX_FMT_NV21)
+            return AVERROR(EINVAL);
+
+        int u = dst->format == AV_PIX_FMT_NV12 ? 1 : 2;
+        int v = 3 - u;
+        ijk_img_copy_plane(dst->data[0], dst->linesize[0], src->data[0], src->linesize[0], width, height);
+        ijk_img_merge_uv_plane(dst->data[1], dst->linesize[1], src->data[u], src->linesize[u],
+                               src->data[v], src->linesize[v], uv_width, uv_height);
+        return 0;
+    }
+
+    return AVERROR(EINVAL);
+}
+
+IjkImgConverter *ijk_img_converter_create(void)
+{
+    return av_mallocz(sizeof(IjkImgConverter));
+}
+
+void ijk_img_converter_freep(IjkImgConverter **converter)
+{
+    if (!converter || !*converter)
+        return;
+
+    /* frames still out keep the pool alive until they are freed */
+    av_buffer_pool_uninit(&(*converter)->pool);
+    av_freep(converter);
+}
+
+AVFrame *ijk_img_converter_convert(IjkImgConverter *converter, const AVFrame *src, enum AVPixelFormat dst_format)
+{
+    AVFrame *dst = NULL;
+    int size;
+
+    if (!converter || !src)
+        return NULL;
+
+    size = av_image_get_buffer_size(dst_format, src->width, src->height, 1);
+    if (size <= 0)
+        return NULL;
+
+    if (!converter->pool || converter->pool_size != size) {
+        av_buffer_pool_uninit(&converter->pool);
+        converter->pool = av_buffer_pool_init(size, NULL);
+        converter->pool_size = converter->pool ? size : 0;
+        if (!converter->pool)
+            return NULL;
+    }
+
+    dst = av_frame_alloc();
+    if (!dst)
+        return NULL;
+
+    dst->buf[0] = av_buffer_pool_get(converter->pool);
+    if (!dst->buf[0])
+        goto fail;
+
+    if (av_image_fill_arrays(dst->data, dst->linesize, dst->buf[0]->data, dst_format, src->width, src->height, 1) < 0)
+        goto fail;
+
+    dst->format = dst_format;
+    dst->width  = src->width;
+    dst->height = src->height;
+    dst->pts    = src->pts;
+
+    if (ijk_img_convert_frame(dst, src) < 0)
+        goto fail;
+
+    return dst;
+fail:
+    av_frame_free(&dst);
+    return NULL;
+}
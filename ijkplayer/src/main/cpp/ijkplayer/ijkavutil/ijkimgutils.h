@@ -0,0 +1,84 @@
+/*
+ * ijkimgutils.h
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * plane copy and semi-planar <-> planar 4:2:0 conversion kernels,
+ * NEON / SSE2 when the target has them, AVX2 on x86 CPUs that report it,
+ * plain C otherwise
+ */
+
+#ifndef IJKAVUTIL_IJKIMGUTILS_H
+#define IJKAVUTIL_IJKIMGUTILS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "libavutil/frame.h"
+
+/**
+ * Copy a plane of width bytes by height rows, strides may differ.
+ */
+void ijk_img_copy_plane(uint8_t *dst, int dst_stride, const uint8_t *src, int src_stride, int width, int height);
+
+/**
+ * Deinterleave a UV plane into two planes.
+ * @param width  number of chroma samples per row, i.e. half the UV row in bytes
+ * @param height number of chroma rows
+ */
+void ijk_img_split_uv_plane(uint8_t *dst_u, int dst_stride_u, uint8_t *dst_v, int dst_stride_v,
+                            const uint8_t *src_uv, int src_stride_uv, int width, int height);
+
+/**
+ * Interleave two planes into a UV plane, the inverse of ijk_img_split_uv_plane().
+ */
+void ijk_img_merge_uv_plane(uint8_t *dst_uv, int dst_stride_uv, const uint8_t *src_u, int src_stride_u,
+                            const uint8_t *src_v, int src_stride_v, int width, int height);
+
+/**
+ * Convert between AV_PIX_FMT_NV12 / AV_PIX_FMT_NV21 and AV_PIX_FMT_YUV420P.
+ * dst must already carry its planes, only width and height of src are used.
+ * @return 0 on success, AVERROR(EINVAL) for unsupported format pairs
+ */
+int ijk_img_convert_frame(AVFrame *dst, const AVFrame *src);
+
+typedef struct IjkImgConverter IjkImgConverter;
+
+IjkImgConverter *ijk_img_converter_create(void);
+void ijk_img_converter_freep(IjkImgConverter **converter);
+
+/**
+ * Convert src into a new frame of dst_format taken from the converter pool.
+ * The returned frame is refcounted, av_frame_free() hands the buffer back
+ * to the pool, so it may outlive the call and the converter.
+ * @return the frame or NULL on failure
+ */
+AVFrame *ijk_img_converter_convert(IjkImgConverter *converter, const AVFrame *src, enum AVPixelFormat dst_format);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IJKAVUTIL_IJKIMGUTILS_H
@@ -0,0 +1,112 @@
+/*
+ * ijktimestretch.cpp
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "ijktimestretch.h"
+
+#include "SoundTouch.h"
+
+using namespace soundtouch;
+
+struct IjkTimeStretch {
+    SoundTouch stretcher;
+    int        sample_rate;
+    int        channels;
+    float      tempo;
+};
+
+enum AVSampleFormat ijk_timestretch_sample_fmt(void)
+{
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+    return AV_SAMPLE_FMT_FLT;
+#else
+    return AV_SAMPLE_FMT_S16;
+#endif
+}
+
+IjkTimeStretch *ijk_timestretch_create(int sample_rate, int channels)
+{
+    if (sample_rate <= 0 || channels <= 0)
+        return NULL;
+
+    IjkTimeStretch *ts = new IjkTimeStretch();
+    ts->sample_rate = sample_rate;
+    ts->channels    = channels;
+    ts->tempo       = 1.0f;
+    ts->stretcher.setSampleRate(sample_rate);
+    ts->stretcher.setChannels(channels);
+    ts->stretcher.setTempo(1.0f);
+    return ts;
+}
+
+void ijk_timestretch_freep(IjkTimeStretch **ts)
+{
+    if (!ts || !*ts)
+        return;
+    delete *ts;
+    *ts = NULL;
+}
+
+int ijk_timestretch_sample_rate(IjkTimeStretch *ts)
+{
+    return ts->sample_rate;
+}
+
+int ijk_timestretch_channels(IjkTimeStretch *ts)
+{
+    return ts->channels;
+}
+
+void ijk_timestretch_set_tempo(IjkTimeStretch *ts, float tempo)
+{
+    if (tempo == ts->tempo)
+        return;
+    ts->tempo = tempo;
+    ts->stretcher.setTempo(tempo);
+}
+
+void ijk_timestretch_put(IjkTimeStretch *ts, const uint8_t *samples, int nb_frames)
+{
+    if (nb_frames > 0)
+        ts->stretcher.putSamples((const SAMPLETYPE *)samples, (uint)nb_frames);
+}
+
+int ijk_timestretch_available(IjkTimeStretch *ts)
+{
+    return (int)ts->stretcher.numSamples();
+}
+
+int ijk_timestretch_receive(IjkTimeStretch *ts, uint8_t *dst, int max_frames)
+{
+    if (max_frames <= 0)
+        return 0;
+    return (int)ts->stretcher.receiveSamples((SAMPLETYPE *)dst, (uint)max_frames);
+}
+
+int ijk_timestretch_latency(IjkTimeStretch *ts)
+{
+    return (int)(ts->stretcher.numUnprocessedSamples() + ts->stretcher.numSamples() * ts->tempo);
+}
+
+void ijk_timestretch_clear(IjkTimeStretch *ts)
+{
+    ts->stretcher.clear();
+}
@@ -0,0 +1,80 @@
+/*
+ * ijktimestretch.h
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * streaming time stretch of the audio output on SoundTouch: interleaved
+ * samples go in as swr wrote them, whatever the stretcher has ready comes out,
+ * in the sample format the SoundTouch build processes
+ */
+
+#ifndef IJKAVUTIL_IJKTIMESTRETCH_H
+#define IJKAVUTIL_IJKTIMESTRETCH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "libavutil/samplefmt.h"
+
+typedef struct IjkTimeStretch IjkTimeStretch;
+
+/* AV_SAMPLE_FMT_FLT or AV_SAMPLE_FMT_S16, whichever SoundTouch was built for */
+enum AVSampleFormat ijk_timestretch_sample_fmt(void);
+
+IjkTimeStretch *ijk_timestretch_create(int sample_rate, int channels);
+void ijk_timestretch_freep(IjkTimeStretch **ts);
+
+int  ijk_timestretch_sample_rate(IjkTimeStretch *ts);
+int  ijk_timestretch_channels(IjkTimeStretch *ts);
+
+/* speed up or slow down by tempo, the pitch stays */
+void ijk_timestretch_set_tempo(IjkTimeStretch *ts, float tempo);
+
+/* append nb_frames interleaved frames of ijk_timestretch_sample_fmt() */
+void ijk_timestretch_put(IjkTimeStretch *ts, const uint8_t *samples, int nb_frames);
+
+/* frames ready to be received */
+int  ijk_timestretch_available(IjkTimeStretch *ts);
+
+/**
+ * Take up to max_frames of the stretched output.
+ * @return the number of frames written to dst
+ */
+int  ijk_timestretch_receive(IjkTimeStretch *ts, uint8_t *dst, int max_frames);
+
+/**
+ * How far the output lags the input, in input frames: what was put but not
+ * stretched yet plus what was stretched but not received.
+ */
+int  ijk_timestretch_latency(IjkTimeStretch *ts);
+
+/* drop everything buffered, on a seek */
+void ijk_timestretch_clear(IjkTimeStretch *ts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IJKAVUTIL_IJKTIMESTRETCH_H
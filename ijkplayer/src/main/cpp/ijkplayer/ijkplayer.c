@@ -911,9 +911,9 @@ int ijkmp_get_msg(IjkMediaPlayer *mp, AVMessage *msg, int block)
 }
 
 
-int ijkmp_start_record(IjkMediaPlayer *mp, const char *recordFilePath)
+int ijkmp_start_record(IjkMediaPlayer *mp, const char *recordFilePath, int mode)
 {
-    return ffp_start_record(mp->ffplayer, recordFilePath);
+    return ffp_start_record(mp->ffplayer, recordFilePath, mode);
 }
 
 int ijkmp_stop_record(IjkMediaPlayer *mp)
@@ -926,6 +926,122 @@ int ijkmp_is_record(IjkMediaPlayer *mp)
     return ffp_is_record(mp->ffplayer);
 }
 
+int ijkmp_start_clip_export(IjkMediaPlayer *mp, const char *filePath, int64_t start_ms, int64_t end_ms)
+{
+    if (!mp) {
+        LOGE("ijkmp_start_clip_export mp is null\n");
+        return EIJK_FAILED;
+    }
+    MPTRACE("ijkmp_start_clip_export(%"PRId64", %"PRId64")\n", start_ms, end_ms);
+    pthread_mutex_lock(&mp->mutex);
+    int retval = ffp_start_clip_export(mp->ffplayer, filePath, start_ms, end_ms);
+    pthread_mutex_unlock(&mp->mutex);
+    MPTRACE("ijkmp_start_clip_export()=%d\n", retval);
+
+    return retval;
+}
+
+void ijkmp_cancel_clip_export(IjkMediaPlayer *mp)
+{
+    if (!mp) {
+        LOGE("ijkmp_cancel_clip_export mp is null\n");
+        return;
+    }
+    MPTRACE("ijkmp_cancel_clip_export()\n");
+    pthread_mutex_lock(&mp->mutex);
+    ffp_cancel_clip_export(mp->ffplayer);
+    pthread_mutex_unlock(&mp->mutex);
+    MPTRACE("ijkmp_cancel_clip_export()=void\n");
+}
+
+int ijkmp_set_scrub_mode(IjkMediaPlayer *mp, int enable)
+{
+    if (!mp) {
+        LOGE("ijkmp_set_scrub_mode mp is null\n");
+        return EIJK_FAILED;
+    }
+    MPTRACE("ijkmp_set_scrub_mode(%d)\n", enable);
+    pthread_mutex_lock(&mp->mutex);
+    int retval = ikjmp_chkst_seek_l(mp->mp_state);
+    if (retval == 0)
+        retval = ffp_set_scrub_mode_l(mp->ffplayer, enable, mp->mp_state == MP_STATE_STARTED);
+    pthread_mutex_unlock(&mp->mutex);
+    MPTRACE("ijkmp_set_scrub_mode(%d)=%d\n", enable, retval);
+
+    return retval;
+}
+
+int ijkmp_set_trick_play_rate(IjkMediaPlayer *mp, float rate)
+{
+    if (!mp) {
+        LOGE("ijkmp_set_trick_play_rate mp is null\n");
+        return EIJK_FAILED;
+    }
+    MPTRACE("ijkmp_set_trick_play_rate(%f)\n", rate);
+    pthread_mutex_lock(&mp->mutex);
+    int retval = ikjmp_chkst_seek_l(mp->mp_state);
+    if (retval == 0)
+        retval = ffp_set_trick_play_rate_l(mp->ffplayer, rate);
+    pthread_mutex_unlock(&mp->mutex);
+    MPTRACE("ijkmp_set_trick_play_rate(%f)=%d\n", rate, retval);
+
+    return retval;
+}
+
+int ijkmp_step_backward(IjkMediaPlayer *mp)
+{
+    if (!mp) {
+        LOGE("ijkmp_step_backward mp is null\n");
+        return EIJK_FAILED;
+    }
+    MPTRACE("ijkmp_step_backward()\n");
+    pthread_mutex_lock(&mp->mutex);
+    int retval = ikjmp_chkst_seek_l(mp->mp_state);
+    if (retval == 0)
+        retval = ffp_step_backward_l(mp->ffplayer);
+    pthread_mutex_unlock(&mp->mutex);
+    MPTRACE("ijkmp_step_backward()=%d\n", retval);
+
+    return retval;
+}
+
+int ijkmp_set_reverse_playback(IjkMediaPlayer *mp, int enable)
+{
+    if (!mp) {
+        LOGE("ijkmp_set_reverse_playback mp is null\n");
+        return EIJK_FAILED;
+    }
+    MPTRACE("ijkmp_set_reverse_playback(%d)\n", enable);
+    pthread_mutex_lock(&mp->mutex);
+    int retval = ikjmp_chkst_seek_l(mp->mp_state);
+    if (retval == 0)
+        retval = ffp_set_reverse_playback_l(mp->ffplayer, enable, mp->mp_state == MP_STATE_STARTED);
+    // reverse playback plays, pause() and start() work on it as usual
+    if (retval == 0 && enable)
+        ijkmp_change_state_l(mp, MP_STATE_STARTED);
+    pthread_mutex_unlock(&mp->mutex);
+    MPTRACE("ijkmp_set_reverse_playback(%d)=%d\n", enable, retval);
+
+    return retval;
+}
+
+int ijkmp_set_next_data_source(IjkMediaPlayer *mp, const char *url)
+{
+    if (!mp) {
+        LOGE("ijkmp_set_next_data_source mp is null\n");
+        return EIJK_FAILED;
+    }
+    MPTRACE("ijkmp_set_next_data_source(%s)\n", url);
+    pthread_mutex_lock(&mp->mutex);
+    int retval = ikjmp_chkst_seek_l(mp->mp_state);
+    if (retval == 0)
+        retval = ffp_set_next_data_source_l(mp->ffplayer, url);
+    pthread_mutex_unlock(&mp->mutex);
+    MPTRACE("ijkmp_set_next_data_source(%s)=%d\n", url, retval);
+
+    return retval;
+}
+
 int ijkmp_get_current_frame(IjkMediaPlayer *mp, const char *saveFilePath)
 {
     pthread_mutex_lock(&mp->mutex);
@@ -221,8 +221,15 @@ void            ijkmp_set_id(IjkMediaPlayer *mp, char *id);
 int             ijkmp_get_msg(IjkMediaPlayer *mp, AVMessage *msg, int block);
 void            ijkmp_set_frame_at_time(IjkMediaPlayer *mp, const char *path, int64_t start_time, int64_t end_time, int num, int definition);
 
-int             ijkmp_start_record(IjkMediaPlayer *mp, const char *recordFilePath);
+int             ijkmp_start_record(IjkMediaPlayer *mp, const char *recordFilePath, int mode);
 int             ijkmp_stop_record(IjkMediaPlayer *mp);
 int             ijkmp_is_record(IjkMediaPlayer *mp);
+int             ijkmp_start_clip_export(IjkMediaPlayer *mp, const char *filePath, int64_t start_ms, int64_t end_ms);
+void            ijkmp_cancel_clip_export(IjkMediaPlayer *mp);
+int             ijkmp_set_scrub_mode(IjkMediaPlayer *mp, int enable);
+int             ijkmp_set_trick_play_rate(IjkMediaPlayer *mp, float rate);
+int             ijkmp_step_backward(IjkMediaPlayer *mp);
+int             ijkmp_set_reverse_playback(IjkMediaPlayer *mp, int enable);
+int             ijkmp_set_next_data_source(IjkMediaPlayer *mp, const char *url);
 int             ijkmp_get_current_frame(IjkMediaPlayer *mp, const char *saveFilePath);
 #endif
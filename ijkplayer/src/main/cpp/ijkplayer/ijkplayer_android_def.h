@@ -42,6 +42,11 @@ enum media_event_type {
     MEDIA_INFO              = 200,      // arg1, arg2
     MEDIA_AUDIO_INTERRUPT   = 201,      // arg1 = force type, arg2 = interrupt hint
 	MEDIA_AUDIO_DEVICE_CHANGE = 202,    // arg1 = reason
+    MEDIA_CLIP_EXPORT_PROGRESS = 203,   // arg1 = percent
+    MEDIA_CLIP_EXPORT_COMPLETE = 204,   // arg1 = error, 0 on success, arg2 = 1 if cancelled
+    MEDIA_SCRUB_FRAME_RENDERED = 205,   // arg1 = frame position, arg2 = milliseconds from the seek request
+    MEDIA_NEXT_SOURCE_STARTED = 206,    // arg1 = 1 for a gapless loop, arg2 = its duration in ms
+    MEDIA_RECORD_COMPLETE   = 207,      // arg1 = 1 when the recording was written, 0 on failure
 
     MEDIA_SET_VIDEO_SAR     = 10001,    // arg1 = sar.num, arg2 = sar.den
 };
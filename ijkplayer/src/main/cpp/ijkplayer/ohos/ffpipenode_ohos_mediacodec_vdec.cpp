@@ -23,92 +23,173 @@
 #include "ffpipenode_ohos_mediacodec_vdec.h"
 
 #include <chrono>
-#include <unistd.h>
-#include "libswscale/swscale.h"
-#include "ohos_video_decoder_data.h"
-#include "ohos_video_decoder.h"
+#include <memory>
+#include "ohos_video_codec.h"
+#include "ohos_video_codec_pump.h"
+#include "ijkavutil/ijkimgutils.h"
 
-static const int NS_TO_US = 1000;
-static const int MILLISECOND = 7;
+/* the video packet queue as the pump sees it, bitstream filtered for the codec */
+class PlayerPacketSource : public VideoCodecPacketSource {
+public:
+    FFPlayer *ffp {nullptr};
+    AVBSFContext *avbsfContext {nullptr};
+
+    int GetPacket(AVPacket *pkt, int *serial) override
+    {
+        Decoder *d = &ffp->is->viddec;
+        int ret;
+
+        for (;;) {
+            if (av_bsf_receive_packet(avbsfContext, pkt) == 0) {
+                *serial = bsfSerial_;
+                return 1;
+            }
+            if (d->queue->nb_packets == 0) {
+                ffp_packet_queue_notify_consumed(d->queue);
+            }
+            if ((ret = ffp_packet_queue_get_or_buffering(ffp, d->queue, pkt, &d->pkt_serial, &d->finished)) < 0) {
+                return ret;
+            }
+            *serial = d->pkt_serial;
+            if (ffp_is_flush_packet(pkt)) {
+                av_bsf_flush(avbsfContext);
+                return 1;
+            }
+            /* stale and end of stream packets bypass the filter */
+            if (d->queue->serial != d->pkt_serial || (!pkt->data && !pkt->size)) {
+                return 1;
+            }
+            if (ffp_is_codec_packet(pkt)) {
+                ResetFilter();
+                return 1;
+            }
+            if (av_bsf_send_packet(avbsfContext, pkt) < 0) {
+                LOGE("av_bsf_send_packet failed");
+                av_packet_unref(pkt);
+                continue;
+            }
+            bsfSerial_ = d->pkt_serial;
+        }
+    }
+
+    bool IsFlushPacket(const AVPacket *pkt) override
+    {
+        return ffp_is_flush_packet(const_cast<AVPacket *>(pkt));
+    }
+
+    bool IsCodecPacket(const AVPacket *pkt) override
+    {
+        return ffp_is_codec_packet(const_cast<AVPacket *>(pkt));
+    }
+
+    int CurrentSerial() override
+    {
+        return ffp->is->videoq.serial;
+    }
+
+    bool IsAborted() override
+    {
+        return ffp->is->videoq.abort_request;
+    }
+
+    void OnFlush() override
+    {
+        Decoder *d = &ffp->is->viddec;
+        d->finished = 0;
+        d->next_pts = d->start_pts;
+        d->next_pts_tb = d->start_pts_tb;
+    }
+
+    void OnEosLost(int serial) override
+    {
+        /* no EOS picture will come, finish here so that playback still completes */
+        ffp->is->viddec.finished = serial;
+    }
+
+    void OnInputCopied(uint64_t bytes) override
+    {
+        ffp->stat.vdec_input_copy_bytes += bytes;
+        SDL_SpeedSampler2Add(&ffp->stat.vdec_input_copy_sampler, (int)bytes);
+    }
+
+private:
+    /* codec_pkt: the packets after it come from the next source, filter them with its parameter sets */
+    void ResetFilter()
+    {
+        AVCodecParameters *par = __atomic_exchange_n(&ffp->is->viddec.next_par, nullptr, __ATOMIC_SEQ_CST);
+        AVBSFContext *bsf = nullptr;
+
+        if (!par) {
+            av_bsf_flush(avbsfContext);
+            return;
+        }
+        if (av_bsf_alloc(avbsfContext->filter, &bsf) < 0 || avcodec_parameters_copy(bsf->par_in, par) < 0 ||
+            av_bsf_init(bsf) < 0) {
+            LOGE("bitstream filter reset failed");
+            av_bsf_free(&bsf);
+            av_bsf_flush(avbsfContext);
+        } else {
+            av_bsf_free(&avbsfContext);
+            avbsfContext = bsf;
+        }
+        avcodec_parameters_free(&par);
+    }
+
+    int bsfSerial_ {0};
+};
 
 class IJKFF_Pipenode_Opaque {
 public:
     IJKFF_Pipeline *pipeline;
-    FormatInfo formatInfoEntry;
-    CodecData codecData;
-    VideoDecoder decoder;
     FFPlayer *ffp;
     AVCodecParameters *codecpar;
-    AVPacket *pkt;
     SDL_Vout *weakVout;
     const AVBitStreamFilter *aVBitStreamFilter = {nullptr};
     AVBSFContext *avbsfContext {nullptr};
     std::atomic_int64_t frameCount {0};
-    void DecoderInput(AVPacket pkt);
-    void DecoderOutput(AVFrame *frame);
+    std::unique_ptr<VideoCodecInterface> codec;
+    PlayerPacketSource source;
+    std::unique_ptr<VideoCodecPump> pump;
+    /* NV12 -> I420 for screenshots, created on first use */
+    IjkImgConverter *converter {nullptr};
+
+    /* serial of the picture being handed to ffp_queue_picture() */
+    int frameSerial {0};
 };
 
 static void func_destroy(IJKFF_Pipenode *node)
 {
     IJKFF_Pipenode_Opaque *opaque = static_cast<IJKFF_Pipenode_Opaque *>(node->opaque);
-    opaque->decoder.Release();
-}
-void IJKFF_Pipenode_Opaque::DecoderInput(AVPacket pkt)
-{
-    int32_t ret = 0;
-    int inputTime = 30;
-    CodecBufferInfo codecBufferInfo;
-    codecBufferInfo.buff_ = OH_AVBuffer_Create(pkt.size);
-    auto bufferAddr = OH_AVBuffer_GetAddr(codecBufferInfo.buff_);
-    memcpy(bufferAddr, pkt.data, pkt.size);
-    codecBufferInfo.attr.size = pkt.size;
-    codecBufferInfo.attr.pts = pkt.pts;
-    if (pkt.flags == 1) {
-        codecBufferInfo.attr.flags = AVCODEC_BUFFER_FLAGS_CODEC_DATA|AVCODEC_BUFFER_FLAGS_SYNC_FRAME;
-    } else {
-        codecBufferInfo.attr.flags = AVCODEC_BUFFER_FLAGS_NONE;
-    }
-
-    ret = this->codecData.InputData(codecBufferInfo, std::chrono::milliseconds(inputTime));
-    if (ret == 0) {
-        this->decoder.PushInputData(codecBufferInfo);
-    }
-    OH_AVBuffer_Destroy(codecBufferInfo.buff_);
+    if (!opaque) {
+        return;
+    }
+    opaque->pump.reset();
+    opaque->codec.reset();
+    if (opaque->codecpar) {
+        avcodec_parameters_free(&opaque->codecpar);
+    }
+    av_bsf_free(&opaque->avbsfContext);
+    av_bsf_free(&opaque->source.avbsfContext);
+    ijk_img_converter_freep(&opaque->converter);
+    delete opaque;
+    node->opaque = nullptr;
 }
 
-static int qsvenc_get_continuous_buffer(AVFrame *frame, OH_AVFormat *format, CodecBufferInfo*  codecBufferInfoReceive)
+static int FillFrameFromPicture(AVFrame *frame, const VideoCodecPicture &picture)
 {
-    int32_t currentWidth = 0;
-    int32_t currentHeight = 0;
-    int32_t displayWidth = 0;
-    int32_t displayHeight = 0;
-    int index = 0;
-    int pixelFormat[] = {AV_PIX_FMT_NONE, AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12, AV_PIX_FMT_NV21};
-    OH_AVFormat_GetIntValue(format, OH_MD_KEY_PIXEL_FORMAT, &index);
-    OH_AVFormat_GetIntValue(format, OH_MD_KEY_WIDTH, &currentWidth);
-    OH_AVFormat_GetIntValue(format, OH_MD_KEY_HEIGHT, &currentHeight);
-    OH_AVFormat_GetIntValue(format, "display_width", &displayWidth);
-    OH_AVFormat_GetIntValue(format, "display_height", &displayHeight);
-
-    if (index > sizeof(pixelFormat) / sizeof(pixelFormat[0])) {
-        return -1;
-    }
-    uint8_t *bufferAddr = OH_AVBuffer_GetAddr(codecBufferInfoReceive->buff_);
-    frame->pts = codecBufferInfoReceive->attr.pts;
-    frame->pkt_dts = codecBufferInfoReceive->attr.pts;
-    frame->width = displayWidth;
-    frame->height = displayHeight;
-    frame->format = pixelFormat[index];
+    frame->pts = picture.pts;
+    frame->pkt_dts = picture.pts;
+    frame->width = picture.width;
+    frame->height = picture.height;
+    frame->format = picture.pixelFormat;
 
-    int indexY;
     switch (frame->format) {
         case AV_PIX_FMT_NV12:
         case AV_PIX_FMT_NV21:
-            frame->linesize[0] = currentWidth;
-            frame->linesize[1] = currentWidth;
-            indexY = sizeof(uint8_t) * currentWidth * currentHeight;
-            frame->data[0] = bufferAddr;
-            frame->data[1] = bufferAddr + indexY;
+            frame->linesize[0] = picture.stride;
+            frame->linesize[1] = picture.stride;
+            frame->data[0] = picture.data;
+            frame->data[1] = picture.data + (size_t)picture.stride * picture.sliceHeight;
             break;
         case AV_PIX_FMT_YUV420P:
             break;
@@ -116,164 +197,82 @@ static int qsvenc_get_continuous_buffer(AVFrame *frame, OH_AVFormat *format, Cod
             break;
         default:
             LOGE("frame->format failed  = %d\n", frame->format);
-            break;
-    }
-    return 0;
-}
-
-int Nv12ToYuv420p(AVFrame *&yuv420p_frame, AVFrame *&nv12_frame, int width, int height)
-{
-    yuv420p_frame = av_frame_alloc();
-    if (!yuv420p_frame) {
-        LOGE("nv12_to_yuv420p yuv420p_frame av_frame_alloc failed");
-        return -1;
-    }
-    yuv420p_frame->format = AV_PIX_FMT_YUV420P;
-    yuv420p_frame->width = width;
-    yuv420p_frame->height = height;
-    av_image_alloc(yuv420p_frame->data, yuv420p_frame->linesize, width, height, AV_PIX_FMT_YUV420P, 1);
-    struct SwsContext *swsCtx =
-        sws_getContext(width, height, AV_PIX_FMT_NV12, width, height, AV_PIX_FMT_YUV420P, 0, nullptr, nullptr, nullptr);
-    if (!swsCtx) {
-        av_frame_free(&yuv420p_frame);
-        LOGE("nv12_to_yuv420p sws_ctx null");
-        return -1;
+            return -1;
     }
-    sws_scale(swsCtx, nv12_frame->data, nv12_frame->linesize, 0, height, yuv420p_frame->data, yuv420p_frame->linesize);
-    sws_freeContext(swsCtx);
     return 0;
 }
 
-void RecordMediaCodecVideoFrame(FFPlayer *ffp, AVFrame *frame)
+static AVFrame *Nv12ToYuv420p(IJKFF_Pipenode_Opaque *opaque, const AVFrame *nv12_frame)
 {
-    if (frame->format == AV_PIX_FMT_NV12 && ffp->record_write_data.isInRecord == OHOS_RECORD_STATUS_ON &&
-        ffp->record_write_data.recordFramesQueue && frame->width > 0 && frame->height > 0) {
-        AVFrame *yuv420p_frame;
-        int result = Nv12ToYuv420p(yuv420p_frame, frame, frame->width, frame->height);
-        if (result < 0) {
-            return;
+    if (!opaque->converter) {
+        opaque->converter = ijk_img_converter_create();
+        if (!opaque->converter) {
+            LOGE("nv12_to_yuv420p converter alloc failed");
+            return nullptr;
         }
-        RecordFrameData frData;
-        frData.data0 = (uint8_t *)malloc((size_t)yuv420p_frame->linesize[DATA_NUM_0] * yuv420p_frame->height);
-        frData.data1 =
-            (uint8_t *)malloc((size_t)yuv420p_frame->linesize[DATA_NUM_1] * yuv420p_frame->height / DATA_NUM_2);
-        frData.data2 =
-            (uint8_t *)malloc((size_t)yuv420p_frame->linesize[DATA_NUM_1] * yuv420p_frame->height / DATA_NUM_2);
-        frData.dataNum = FRAME_DATA_NUM_3;
-        frData.frameType = OHOS_FRAME_TYPE_VIDEO;
-        frData.lineSize0 = yuv420p_frame->linesize[DATA_NUM_0];
-        frData.lineSize1 = yuv420p_frame->linesize[DATA_NUM_1];
-        frData.lineSize2 = yuv420p_frame->linesize[DATA_NUM_2];
-        frData.format = AV_PIX_FMT_YUV420P;
-        frData.writeFileStatus = DATA_NUM_0;
-        memcpy(frData.data0, yuv420p_frame->data[DATA_NUM_0],
-               yuv420p_frame->linesize[DATA_NUM_0] * yuv420p_frame->height);
-        memcpy(frData.data1, yuv420p_frame->data[DATA_NUM_1],
-               yuv420p_frame->linesize[DATA_NUM_1] * yuv420p_frame->height / DATA_NUM_2);
-        memcpy(frData.data2, yuv420p_frame->data[DATA_NUM_2],
-               yuv420p_frame->linesize[DATA_NUM_2] * yuv420p_frame->height / DATA_NUM_2);
-        int windex = ffp->record_write_data.windex;
-        ffp->record_write_data.recordFramesQueue[windex] = frData;
-        ffp->record_write_data.windex += DATA_NUM_1;
-        ffp->record_write_data.srcFormat.height = yuv420p_frame->height;
-        ffp->record_write_data.srcFormat.width = yuv420p_frame->width;
-        av_freep(yuv420p_frame->data);
-        av_frame_free(&yuv420p_frame);
     }
+    AVFrame *yuv420p_frame = ijk_img_converter_convert(opaque->converter, nv12_frame, AV_PIX_FMT_YUV420P);
+    if (!yuv420p_frame) {
+        LOGE("nv12_to_yuv420p convert failed");
+    }
+    return yuv420p_frame;
 }
 
-void IJKFF_Pipenode_Opaque::DecoderOutput(AVFrame *frame)
+static void HandleFrameSideTasks(FFPlayer *ffp, IJKFF_Pipenode_Opaque *opaque, AVFrame *frame)
 {
-    CodecBufferInfo codecBufferInfoReceive;
-        bool ret = false;
-        ret = this->codecData.OutputData(codecBufferInfoReceive);
-        if (!ret) {
-            return;
-        }
-        OH_AVBuffer_GetBufferAttr(codecBufferInfoReceive.buff_, &codecBufferInfoReceive.attr);
-        OH_AVFormat *format = OH_VideoDecoder_GetOutputDescription(this->decoder.decoder_);
-        if (qsvenc_get_continuous_buffer(frame, format, &codecBufferInfoReceive) < 0) {
-            OH_AVBuffer_Destroy(codecBufferInfoReceive.buff_);
-            OH_AVFormat_Destroy(format);
-            return;
-        }
-        OH_AVFormat_Destroy(format);
-        this->decoder.FreeOutputData(codecBufferInfoReceive.bufferIndex);
-        OH_AVBuffer_Destroy(codecBufferInfoReceive.buff_);
-        if (codecBufferInfoReceive.attr.flags == AVCODEC_BUFFER_FLAGS_EOS) {
-            this->codecData.ShutDown();
-        }
     if (ffp->is_screenshot) {
-        AVFrame *yuv420p_frame;
-        int result = Nv12ToYuv420p(yuv420p_frame, frame, frame->width, frame->height);
-        if (result < 0) {
+        AVFrame *yuv420p_frame = Nv12ToYuv420p(opaque, frame);
+        if (!yuv420p_frame) {
             return;
         }
         ffp->is_screenshot = 0;
         SaveCurrentFramePicture(yuv420p_frame, ffp->screen_file_name);
         free(ffp->screen_file_name);
-        av_freep(yuv420p_frame->data);
         av_frame_free(&yuv420p_frame);
         ffp->screen_file_name = NULL;
     }
-    RecordMediaCodecVideoFrame(ffp, frame);
+    RecordPushVideoFrame(ffp, frame);
 }
 
-
-static int decoder_decode_ohos_frame(FFPlayer *ffp, Decoder *d, AVFrame *frame, IJKFF_Pipenode_Opaque *opaque)
+/* returns 1 with a frame mapped onto *picture, 0 when nothing to show, < 0 on abort */
+static int decoder_decode_ohos_frame(FFPlayer *ffp, Decoder *d, AVFrame *frame, IJKFF_Pipenode_Opaque *opaque,
+    VideoCodecPicture *picture)
 {
-    int ret = AVERROR(EAGAIN);
-    AVPacket pkt;
-    AVFormatContext* fmt_ctx = ffp->is->ic;
-    do {
-        if (d->queue->nb_packets == 0) {
-            SDL_CondSignal(d->empty_queue_cond);
-        }
-
-        if (ffp_packet_queue_get_or_buffering(ffp, d->queue, &pkt, &d->pkt_serial, &d->finished) < 0) {
-            av_packet_unref(&pkt);
+    for (;;) {
+        if (opaque->pump->PopPicture(*picture) < 0) {
             return -1;
         }
-        if (ffp_is_flush_packet(&pkt)) {
-            d->finished = 0;
-            d->next_pts = d->start_pts;
-            d->next_pts_tb = d->start_pts_tb;
-        }
-    } while (d->queue->serial != d->pkt_serial);
-
-    ret = av_bsf_send_packet(opaque->avbsfContext, &pkt);
-    if (ret < 0) {
-        LOGE("av_bsf_send_packet failed");
-    }
-    while (ret >= 0) {
-        ret = av_bsf_receive_packet(opaque->avbsfContext, &pkt);
-        if (ret == AVERROR_EOF) {
-            d->finished = d->pkt_serial;
-            avcodec_flush_buffers(d->avctx);
-            av_packet_unref(&pkt);
-            return 0;
+        if (picture->serial != d->queue->serial) {
+            opaque->codec->ReleaseOutput(*picture);
+            continue;
         }
+        break;
     }
 
-    std::thread DecoderInputThread(&IJKFF_Pipenode_Opaque::DecoderInput, opaque, pkt);
-    DecoderInputThread.join();
-    av_packet_unref(&pkt);
-    std::thread DecoderOutputThread(&IJKFF_Pipenode_Opaque::DecoderOutput, opaque, frame);
-    DecoderOutputThread.detach();
-    usleep(MILLISECOND * NS_TO_US);
-    if (frame->pts < 1) {
+    opaque->frameSerial = picture->serial;
+    if (picture->eos) {
+        d->finished = picture->serial;
+        /* read_thread at EOF waits for this */
+        ffp_packet_queue_notify_consumed(d->queue);
+        opaque->codec->ReleaseOutput(*picture);
         return 0;
     }
+    if (FillFrameFromPicture(frame, *picture) < 0) {
+        opaque->codec->ReleaseOutput(*picture);
+        return 0;
+    }
+    HandleFrameSideTasks(ffp, opaque, frame);
     return 1;
 }
 
-static int get_video_frame(FFPlayer *ffp, AVFrame *frame, IJKFF_Pipenode_Opaque *opaque)
+static int get_video_frame(FFPlayer *ffp, AVFrame *frame, IJKFF_Pipenode_Opaque *opaque,
+    VideoCodecPicture *picture)
 {
     VideoState *is = ffp->is;
     int gotPicture;
 
     ffp_video_statistic_l(ffp);
-    if ((gotPicture = decoder_decode_ohos_frame(ffp, &is->viddec, frame, opaque)) < 0) {
+    if ((gotPicture = decoder_decode_ohos_frame(ffp, &is->viddec, frame, opaque, picture)) < 0) {
         return -1;
     }
 
@@ -290,7 +289,7 @@ static int get_video_frame(FFPlayer *ffp, AVFrame *frame, IJKFF_Pipenode_Opaque
                 double diff = dpts - ffp_get_master_clock(is);
                 if (!isnan(diff) && fabs(diff) < AV_NOSYNC_THRESHOLD &&
                     diff - is->frame_last_filter_delay < 0 &&
-                    is->viddec.pkt_serial == is->vidclk.serial &&
+                    opaque->frameSerial == is->vidclk.serial &&
                     is->videoq.nb_packets) {
                     is->frame_drops_early++;
                     is->continuous_frame_drops_early++;
@@ -303,6 +302,7 @@ static int get_video_frame(FFPlayer *ffp, AVFrame *frame, IJKFF_Pipenode_Opaque
                                 static_cast<float>(ffp->stat.decode_frame_count);
                         }
                         av_frame_unref(frame);
+                        opaque->codec->ReleaseOutput(*picture);
                         gotPicture = 0;
                     }
                 }
@@ -328,6 +328,7 @@ static int ffplay_video_ohos_thread(FFPlayer *ffp, IJKFF_Pipenode_Opaque *opaque
     int retryConvertImage = 0;
     int convertFrameCount = 0;
     int interval = 1000;
+    VideoCodecPicture picture;
 
     ffp_notify_msg2(ffp, FFP_MSG_VIDEO_ROTATION_CHANGED, ffp_get_video_rotate_degrees(ffp));
 
@@ -335,8 +336,9 @@ static int ffplay_video_ohos_thread(FFPlayer *ffp, IJKFF_Pipenode_Opaque *opaque
         return AVERROR(ENOMEM);
     }
 
+    opaque->pump->Start();
     for (;;) {
-        ret = get_video_frame(ffp, frame, opaque);
+        ret = get_video_frame(ffp, frame, opaque, &picture);
         if (ret < 0) {
             goto the_end;
         }
@@ -348,6 +350,7 @@ static int ffplay_video_ohos_thread(FFPlayer *ffp, IJKFF_Pipenode_Opaque *opaque
         if (ffp->get_frame_mode) {
             if (!ffp->get_img_info || ffp->get_img_info->count <= 0) {
                 av_frame_unref(frame);
+                opaque->codec->ReleaseOutput(picture);
                 continue;
             }
 
@@ -374,6 +377,7 @@ static int ffplay_video_ohos_thread(FFPlayer *ffp, IJKFF_Pipenode_Opaque *opaque
 
                 retryConvertImage = 0;
                 if (ret || ffp->get_img_info->count <= 0) {
+                    opaque->codec->ReleaseOutput(picture);
                     if (ret) {
                         av_log(NULL, AV_LOG_ERROR, "convert image abort ret = %d\n", ret);
                         ffp_notify_msg3(ffp, FFP_MSG_GET_IMG_STATE, 0, ret);
@@ -386,20 +390,25 @@ static int ffplay_video_ohos_thread(FFPlayer *ffp, IJKFF_Pipenode_Opaque *opaque
                 dstPts = lastPts;
             }
             av_frame_unref(frame);
+            opaque->codec->ReleaseOutput(picture);
             continue;
         }
 
             duration = (frameRate.num && frameRate.den ? av_q2d((AVRational){frameRate.den, frameRate.num}) : 0);
             pts = (frame->pts == AV_NOPTS_VALUE) ? NAN : frame->pts * av_q2d(tb);
-            ret = ffp_queue_picture(ffp, frame, pts, duration, frame->pkt_pos, is->viddec.pkt_serial);
+            ret = ffp_queue_picture(ffp, frame, pts, duration, frame->pkt_pos, opaque->frameSerial);
             av_frame_unref(frame);
+            opaque->codec->ReleaseOutput(picture);
             if (ret < 0) {
                 goto the_end;
             }
     }
  the_end:
     av_log(NULL, AV_LOG_INFO, "convert image convertFrameCount = %d\n", convertFrameCount);
-    av_bsf_free(&opaque->avbsfContext);
+    /* the input pump may still be blocked on the packet queue */
+    ffp_packet_queue_abort(&is->videoq);
+    opaque->pump->Stop();
+    av_bsf_free(&opaque->source.avbsfContext);
     av_frame_free(&frame);
     return 0;
 }
@@ -442,58 +451,68 @@ IJKFF_Pipenode *ffpipenode_create_video_decoder_from_ohos_mediacodec(FFPlayer *f
     SDL_Vout *vout)
 {
     std::string bsfName;
-    AVStream *st = ffp->is->video_st;
+    const char *mime = nullptr;
+    FormatInfo formatInfo;
     IJKFF_Pipenode *node = ffpipenode_alloc(sizeof(IJKFF_Pipenode_Opaque));
+    if (!node) {
+        return nullptr;
+    }
     IJKFF_Pipenode_Opaque *decoderSample = new IJKFF_Pipenode_Opaque();
+    free(node->opaque);
     node->opaque = decoderSample;
+    node->func_destroy = func_destroy;
+    node->func_run_sync = func_run_sync;
     decoderSample->ffp = ffp;
     decoderSample->pipeline = pipeline;
     decoderSample->weakVout = vout;
     decoderSample->codecpar = avcodec_parameters_alloc();
     if (!decoderSample->codecpar) {
-        return nullptr;
+        goto fail;
     }
 
     if (avcodec_parameters_from_context(decoderSample->codecpar, ffp->is->viddec.avctx) < 0) {
-        return nullptr;
+        goto fail;
     }
 
-    decoderSample->formatInfoEntry.fps = av_q2d(ffp->is->video_st->avg_frame_rate);
-    decoderSample->formatInfoEntry.videoHeight = decoderSample->codecpar->height;
-    decoderSample->formatInfoEntry.videoWidth = decoderSample->codecpar->width;
-    decoderSample->codecData.formatInfo = &decoderSample->formatInfoEntry;
+    formatInfo.fps = av_q2d(ffp->is->video_st->avg_frame_rate);
+    formatInfo.videoHeight = decoderSample->codecpar->height;
+    formatInfo.videoWidth = decoderSample->codecpar->width;
 
     switch (decoderSample->codecpar->codec_id) {
         case AV_CODEC_ID_H264:
             bsfName = "h264_mp4toannexb";
-            decoderSample->decoder.Create(OH_AVCODEC_MIMETYPE_VIDEO_AVC);
+            mime = OH_AVCODEC_MIMETYPE_VIDEO_AVC;
             break;
         case AV_CODEC_ID_HEVC:
             bsfName = "hevc_mp4toannexb";
-            decoderSample->decoder.Create(OH_AVCODEC_MIMETYPE_VIDEO_HEVC);
+            mime = OH_AVCODEC_MIMETYPE_VIDEO_HEVC;
             break;
         default:
             LOGE("codec_id failed = %d\n", decoderSample->codecpar->codec_id);
-            break;
+            goto fail;
     }
 
     if (GetAvbsfContest(bsfName, decoderSample, ffp->is->video_st->codecpar) < 0) {
         LOGE("GetAvbsfContest failed");
-        delete decoderSample->aVBitStreamFilter;
-        av_bsf_free(&decoderSample->avbsfContext);
-        return nullptr;
+        goto fail;
     }
 
-    decoderSample->decoder.Config(&decoderSample->codecData);
-    decoderSample->decoder.Start();
-    decoderSample->codecData.Start();
-
-    if (ffp->get_img_info != nullptr) {
-        GetImgInfo *get_img_info = ffp->get_img_info;
-        int fmt = get_img_info->frame_img_codec_ctx->pix_fmt;
+    {
+        std::unique_ptr<OhosVideoCodec> codec(new OhosVideoCodec());
+        if (codec->Create(mime, formatInfo) != AV_ERR_OK) {
+            LOGE("OhosVideoCodec create failed");
+            goto fail;
+        }
+        decoderSample->codec = std::move(codec);
     }
+    decoderSample->source.ffp = ffp;
+    /* the source replaces it at a source switch */
+    decoderSample->source.avbsfContext = decoderSample->avbsfContext;
+    decoderSample->avbsfContext = nullptr;
+    decoderSample->pump.reset(new VideoCodecPump(decoderSample->codec.get(), &decoderSample->source));
 
-    node->func_destroy = func_destroy;
-    node->func_run_sync = func_run_sync;
     return node;
-}
\ No newline at end of file
+fail:
+    ffpipenode_free_p(&node);
+    return nullptr;
+}
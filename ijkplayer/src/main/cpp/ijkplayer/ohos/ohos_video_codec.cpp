@@ -0,0 +1,169 @@
+/*
+ * ohos_video_codec.cpp
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "ohos_video_codec.h"
+
+#include <cstring>
+#include "hilog/log.h"
+
+extern "C" {
+#include "libavutil/error.h"
+#include "libavutil/pixfmt.h"
+}
+
+OhosVideoCodec::~OhosVideoCodec()
+{
+    Release();
+}
+
+int32_t OhosVideoCodec::Create(const char *mime, const FormatInfo &formatInfo)
+{
+    formatInfo_ = formatInfo;
+    codecData_.formatInfo = &formatInfo_;
+    if (decoder_.Create(mime) != AV_ERR_OK) {
+        return AV_ERR_UNKNOWN;
+    }
+    if (decoder_.Config(&codecData_) != AV_ERR_OK || decoder_.Start() != AV_ERR_OK) {
+        decoder_.Release();
+        return AV_ERR_UNKNOWN;
+    }
+    codecData_.Start();
+    return AV_ERR_OK;
+}
+
+void OhosVideoCodec::Release()
+{
+    codecData_.ShutDown();
+    decoder_.Release();
+}
+
+int32_t OhosVideoCodec::QueueInput(const uint8_t *data, int32_t size, int64_t pts, bool keyFrame, bool eos,
+    std::chrono::milliseconds timeout)
+{
+    CodecBufferInfo codecBufferInfo;
+    codecBufferInfo.attr.size = size;
+    codecBufferInfo.attr.pts = pts;
+    if (eos) {
+        codecBufferInfo.attr.flags = AVCODEC_BUFFER_FLAGS_EOS;
+    } else if (keyFrame) {
+        codecBufferInfo.attr.flags = AVCODEC_BUFFER_FLAGS_CODEC_DATA | AVCODEC_BUFFER_FLAGS_SYNC_FRAME;
+    } else {
+        codecBufferInfo.attr.flags = AVCODEC_BUFFER_FLAGS_NONE;
+    }
+
+    uint32_t bufferIndex = 0;
+    int32_t ret = codecData_.InputData(data, codecBufferInfo.attr, timeout, bufferIndex);
+    if (ret == AV_ERR_TIMEOUT) {
+        return AVERROR(EAGAIN);
+    }
+    if (ret == AV_ERR_NO_MEMORY) {
+        return AVERROR(ENOMEM);
+    }
+    if (ret == AV_ERR_OK) {
+        codecBufferInfo.bufferIndex = bufferIndex;
+        ret = decoder_.PushInputData(codecBufferInfo);
+    }
+    return ret == AV_ERR_OK ? 0 : AVERROR_EXTERNAL;
+}
+
+uint64_t OhosVideoCodec::InputBytesCopied()
+{
+    return codecData_.inputBytesCopied_;
+}
+
+void OhosVideoCodec::UpdateOutputFormat()
+{
+    static const int32_t pixelFormat[] = {AV_PIX_FMT_NONE, AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12, AV_PIX_FMT_NV21};
+    int32_t index = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+    OH_AVFormat *format = OH_VideoDecoder_GetOutputDescription(decoder_.decoder_);
+    if (format == nullptr) {
+        return;
+    }
+    OH_AVFormat_GetIntValue(format, OH_MD_KEY_PIXEL_FORMAT, &index);
+    OH_AVFormat_GetIntValue(format, OH_MD_KEY_WIDTH, &width);
+    OH_AVFormat_GetIntValue(format, OH_MD_KEY_HEIGHT, &height);
+    OH_AVFormat_GetIntValue(format, "display_width", &displayWidth_);
+    OH_AVFormat_GetIntValue(format, "display_height", &displayHeight_);
+    OH_AVFormat_Destroy(format);
+
+    stride_ = width;
+    sliceHeight_ = height;
+    if (index < 0 || index >= static_cast<int32_t>(sizeof(pixelFormat) / sizeof(pixelFormat[0]))) {
+        OH_LOG_Print(LOG_APP, LOG_ERROR, LOG_DOMAIN, "VideoDecoder", "unsupported pixel format %{public}d", index);
+        pixelFormat_ = AV_PIX_FMT_NONE;
+    } else {
+        pixelFormat_ = pixelFormat[index];
+    }
+}
+
+int32_t OhosVideoCodec::DequeueOutput(VideoCodecPicture &picture, std::chrono::milliseconds timeout)
+{
+    CodecBufferInfo info;
+    if (!codecData_.OutputData(info, timeout)) {
+        return AVERROR(EAGAIN);
+    }
+    OH_AVBuffer_GetBufferAttr(info.buff_, &info.attr);
+    if (codecData_.formatChanged_.exchange(false)) {
+        UpdateOutputFormat();
+    }
+
+    picture.data = OH_AVBuffer_GetAddr(info.buff_);
+    picture.width = displayWidth_;
+    picture.height = displayHeight_;
+    picture.stride = stride_;
+    picture.sliceHeight = sliceHeight_;
+    picture.pixelFormat = pixelFormat_;
+    picture.pts = info.attr.pts;
+    picture.eos = (info.attr.flags & AVCODEC_BUFFER_FLAGS_EOS) != 0;
+    picture.index = info.bufferIndex;
+    picture.generation = generation_;
+    return 0;
+}
+
+void OhosVideoCodec::ReleaseOutput(const VideoCodecPicture &picture)
+{
+    /* buffers handed out before the last flush were already reclaimed by the codec */
+    std::unique_lock<std::mutex> lock(releaseMutex_);
+    if (picture.generation != generation_) {
+        return;
+    }
+    decoder_.FreeOutputData(picture.index);
+}
+
+int32_t OhosVideoCodec::Flush()
+{
+    std::unique_lock<std::mutex> lock(releaseMutex_);
+    generation_++;
+    int32_t ret = decoder_.Flush();
+    codecData_.Flush();
+    if (ret == AV_ERR_OK) {
+        ret = decoder_.Start();
+    }
+    return ret == AV_ERR_OK ? 0 : AVERROR_EXTERNAL;
+}
+
+void OhosVideoCodec::Wakeup()
+{
+    codecData_.ShutDown();
+}
@@ -0,0 +1,66 @@
+/*
+ * ohos_video_codec.h
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef OHOS_VIDEO_CODEC_H
+#define OHOS_VIDEO_CODEC_H
+
+#include <atomic>
+#include <mutex>
+#include <multimedia/player_framework/native_averrors.h>
+#include "ohos_video_codec_interface.h"
+#include "ohos_video_decoder.h"
+#include "ohos_video_decoder_data.h"
+#include "ohos_video_decoder_Info.h"
+
+/* VideoCodecInterface backed by the OH_VideoDecoder hardware decoder */
+class OhosVideoCodec : public VideoCodecInterface {
+public:
+    OhosVideoCodec() = default;
+    ~OhosVideoCodec() override;
+    int32_t Create(const char *mime, const FormatInfo &formatInfo);
+    void Release();
+
+    int32_t QueueInput(const uint8_t *data, int32_t size, int64_t pts, bool keyFrame, bool eos,
+        std::chrono::milliseconds timeout) override;
+    int32_t DequeueOutput(VideoCodecPicture &picture, std::chrono::milliseconds timeout) override;
+    void ReleaseOutput(const VideoCodecPicture &picture) override;
+    int32_t Flush() override;
+    void Wakeup() override;
+    uint64_t InputBytesCopied() override;
+
+private:
+    void UpdateOutputFormat();
+
+    FormatInfo formatInfo_;
+    CodecData codecData_;
+    VideoDecoder decoder_;
+    std::atomic_uint32_t generation_ {0};
+    /* a flush recycles the output indexes, a release must not slip in between the check and the free */
+    std::mutex releaseMutex_;
+    int32_t stride_ {0};
+    int32_t sliceHeight_ {0};
+    int32_t displayWidth_ {0};
+    int32_t displayHeight_ {0};
+    int32_t pixelFormat_ {-1};
+};
+
+#endif // OHOS_VIDEO_CODEC_H
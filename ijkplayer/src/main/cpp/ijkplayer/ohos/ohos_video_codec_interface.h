@@ -0,0 +1,69 @@
+/*
+ * ohos_video_codec_interface.h
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef OHOS_VIDEO_CODEC_INTERFACE_H
+#define OHOS_VIDEO_CODEC_INTERFACE_H
+
+#include <chrono>
+#include <cstdint>
+
+/*
+ * Codec facing side of the hardware video pipenode. Only plain types cross
+ * this boundary, so the pipenode can be driven by a software codec as well.
+ */
+struct VideoCodecPicture {
+    uint8_t *data {nullptr};        // first plane, chroma follows at stride * sliceHeight
+    int32_t width {0};              // display size
+    int32_t height {0};
+    int32_t stride {0};
+    int32_t sliceHeight {0};
+    int32_t pixelFormat {-1};       // enum AVPixelFormat
+    int64_t pts {0};
+    bool eos {false};
+    uint32_t index {0};             // codec owned, returned through ReleaseOutput()
+    uint32_t generation {0};        // codec flush generation the picture belongs to
+    int serial {0};                 // packet queue serial, filled in by VideoCodecPump
+};
+
+class VideoCodecInterface {
+public:
+    virtual ~VideoCodecInterface() = default;
+
+    /*
+     * returns 0 on success, AVERROR(EAGAIN) if no input buffer showed up in time,
+     * AVERROR(ENOMEM) if the data doesn't fit the input buffer, which stays queued
+     */
+    virtual int32_t QueueInput(const uint8_t *data, int32_t size, int64_t pts, bool keyFrame, bool eos,
+        std::chrono::milliseconds timeout) = 0;
+    /* returns 0 on success, AVERROR(EAGAIN) if no picture showed up in time */
+    virtual int32_t DequeueOutput(VideoCodecPicture &picture, std::chrono::milliseconds timeout) = 0;
+    /* any thread, also while Flush() runs on another one */
+    virtual void ReleaseOutput(const VideoCodecPicture &picture) = 0;
+    /* drop everything queued in the codec, pictures of older generations become invalid */
+    virtual int32_t Flush() = 0;
+    /* wake up callers blocked in QueueInput()/DequeueOutput() */
+    virtual void Wakeup() = 0;
+    /* total bytes of bitstream copied on the way into the codec */
+    virtual uint64_t InputBytesCopied() = 0;
+};
+
+#endif // OHOS_VIDEO_CODEC_INTERFACE_H
@@ -0,0 +1,291 @@
+/*
+ * ohos_video_codec_pump.cpp
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "ohos_video_codec_pump.h"
+
+#include "../../utils/ohoslog/ohos_log.h"
+
+VideoCodecPump::VideoCodecPump(VideoCodecInterface *codec, VideoCodecPacketSource *source)
+    : codec_(codec), source_(source)
+{
+}
+
+VideoCodecPump::~VideoCodecPump()
+{
+    Stop();
+}
+
+void VideoCodecPump::Start()
+{
+    abortRequest_ = false;
+    inputThread_ = std::thread(&VideoCodecPump::InputLoop, this);
+    outputThread_ = std::thread(&VideoCodecPump::OutputLoop, this);
+}
+
+void VideoCodecPump::Stop()
+{
+    abortRequest_ = true;
+    pictureCond_.notify_all();
+    codec_->Wakeup();
+    if (inputThread_.joinable()) {
+        inputThread_.join();
+    }
+    if (outputThread_.joinable()) {
+        outputThread_.join();
+    }
+    ClearPictures();
+}
+
+int VideoCodecPump::QueueInput(const AVPacket *pkt, bool eos)
+{
+    int serial = pktSerial_;
+    int ret;
+
+    for (;;) {
+        if (abortRequest_ || source_->IsAborted()) {
+            return AVERROR_EXIT;
+        }
+        /* a seek arrived while the codec was full, this packet is stale */
+        if (source_->CurrentSerial() != serial) {
+            return 0;
+        }
+        ret = codec_->QueueInput(eos ? nullptr : pkt->data, eos ? 0 : pkt->size, eos ? 0 : pkt->pts,
+            !eos && (pkt->flags & AV_PKT_FLAG_KEY), eos, std::chrono::milliseconds(INPUT_TIMEOUT_MS));
+        if (ret != AVERROR(EAGAIN)) {
+            break;
+        }
+    }
+    if (ret < 0) {
+        LOGE("QueueInput failed %d\n", ret);
+    }
+    /* ENOMEM: the packet didn't fit and the input buffer went back unused */
+    if (ret != AVERROR(ENOMEM)) {
+        inputPending_ = true;
+    }
+
+    uint64_t copied = codec_->InputBytesCopied();
+    if (copied > inputBytesCopied_) {
+        source_->OnInputCopied(copied - inputBytesCopied_);
+    }
+    inputBytesCopied_ = copied;
+    return ret;
+}
+
+void VideoCodecPump::FlushCodec(int serial)
+{
+    std::unique_lock<std::mutex> lock(flushMutex_);
+    outputSerial_ = serial;
+    ClearPictures();
+    if (inputPending_) {
+        codec_->Flush();
+        inputPending_ = false;
+    }
+    eosQueued_ = false;
+    boundaryEos_ = false;
+    {
+        std::unique_lock<std::mutex> pictureLock(pictureMutex_);
+        eosDrained_ = false;
+    }
+}
+
+/*
+ * At a source switch the codec drains like at the end of stream, then the
+ * first packet of the next source restarts it (RestartAfterEos()), so the
+ * parameter sets it carries start from a clean codec.
+ */
+int VideoCodecPump::QueueBoundaryEos()
+{
+    {
+        std::unique_lock<std::mutex> lock(flushMutex_);
+        boundaryEos_ = true;
+    }
+    int ret = QueueInput(nullptr, true);
+    if (ret < 0) {
+        std::unique_lock<std::mutex> lock(flushMutex_);
+        boundaryEos_ = false;
+    }
+    return ret;
+}
+
+/*
+ * Input after an EOS on the same serial, as rewind does for every keyframe
+ * and a source switch for the packets of the next source:
+ * once the EOS came out and the pictures before it were taken, Flush+Start
+ * so that the codec accepts input again. Returns false when a seek or abort
+ * came first, the packet is stale then.
+ */
+bool VideoCodecPump::RestartAfterEos()
+{
+    {
+        std::unique_lock<std::mutex> lock(pictureMutex_);
+        while (!(eosDrained_ && pictures_.empty())) {
+            if (abortRequest_ || source_->IsAborted() || source_->CurrentSerial() != pktSerial_) {
+                return false;
+            }
+            pictureCond_.wait_for(lock, std::chrono::milliseconds(INPUT_TIMEOUT_MS));
+        }
+    }
+    std::unique_lock<std::mutex> lock(flushMutex_);
+    codec_->Flush();
+    inputPending_ = false;
+    eosQueued_ = false;
+    std::unique_lock<std::mutex> pictureLock(pictureMutex_);
+    eosDrained_ = false;
+    return true;
+}
+
+void VideoCodecPump::InputLoop()
+{
+    AVPacket pkt;
+    int ret;
+
+    while (!abortRequest_) {
+        if (source_->GetPacket(&pkt, &pktSerial_) < 0) {
+            break;
+        }
+        if (source_->IsFlushPacket(&pkt)) {
+            FlushCodec(pktSerial_);
+            source_->OnFlush();
+            continue;
+        }
+        if (source_->CurrentSerial() != pktSerial_) {
+            av_packet_unref(&pkt);
+            continue;
+        }
+        if (source_->IsCodecPacket(&pkt)) {
+            if (eosQueued_) {
+                continue;
+            }
+            ret = QueueBoundaryEos();
+            if (ret == AVERROR_EXIT) {
+                break;
+            }
+            /* without the drain the next source goes in as is */
+            eosQueued_ = ret >= 0;
+            continue;
+        }
+        if (eosQueued_ && !RestartAfterEos()) {
+            av_packet_unref(&pkt);
+            continue;
+        }
+
+        if (!pkt.data && !pkt.size) {
+            /* end of stream, let the codec drain, the EOS picture marks the decoder finished */
+            ret = QueueInput(nullptr, true);
+            if (ret == AVERROR_EXIT) {
+                break;
+            }
+            if (ret < 0) {
+                source_->OnEosLost(pktSerial_);
+                continue;
+            }
+            eosQueued_ = true;
+            continue;
+        }
+
+        ret = QueueInput(&pkt, false);
+        av_packet_unref(&pkt);
+        if (ret == AVERROR_EXIT) {
+            break;
+        }
+        /* a packet the codec refused is dropped, the next keyframe recovers */
+    }
+
+    abortRequest_ = true;
+    pictureCond_.notify_all();
+    codec_->Wakeup();
+}
+
+void VideoCodecPump::OutputLoop()
+{
+    while (!abortRequest_) {
+        VideoCodecPicture picture;
+        bool boundary = false;
+        {
+            std::unique_lock<std::mutex> lock(flushMutex_);
+            if (codec_->DequeueOutput(picture, std::chrono::milliseconds(OUTPUT_TIMEOUT_MS)) != 0) {
+                continue;
+            }
+            picture.serial = outputSerial_;
+            if (picture.eos && boundaryEos_) {
+                boundaryEos_ = false;
+                boundary = true;
+            }
+        }
+        bool eos = picture.eos;
+        int serial = picture.serial;
+        if (boundary) {
+            /* playback goes on with the next source, the video thread must not see an end */
+            codec_->ReleaseOutput(picture);
+        } else {
+            PushPicture(picture);
+        }
+        if (eos) {
+            std::unique_lock<std::mutex> lock(pictureMutex_);
+            if (serial == outputSerial_) {
+                eosDrained_ = true;
+            }
+            pictureCond_.notify_all();
+        }
+    }
+}
+
+void VideoCodecPump::PushPicture(VideoCodecPicture &picture)
+{
+    std::unique_lock<std::mutex> lock(pictureMutex_);
+    pictureCond_.wait(lock, [this, &picture]() {
+        return abortRequest_ || picture.serial != outputSerial_ || pictures_.size() < MAX_PENDING_PICTURES;
+    });
+    if (abortRequest_ || picture.serial != outputSerial_) {
+        lock.unlock();
+        codec_->ReleaseOutput(picture);
+        return;
+    }
+    pictures_.push_back(picture);
+    pictureCond_.notify_all();
+}
+
+int VideoCodecPump::PopPicture(VideoCodecPicture &picture)
+{
+    std::unique_lock<std::mutex> lock(pictureMutex_);
+    pictureCond_.wait(lock, [this]() { return abortRequest_ || !pictures_.empty(); });
+    if (pictures_.empty()) {
+        return -1;
+    }
+    picture = pictures_.front();
+    pictures_.pop_front();
+    pictureCond_.notify_all();
+    return 0;
+}
+
+void VideoCodecPump::ClearPictures()
+{
+    std::deque<VideoCodecPicture> pictures;
+    {
+        std::unique_lock<std::mutex> lock(pictureMutex_);
+        pictures.swap(pictures_);
+        pictureCond_.notify_all();
+    }
+    for (auto &picture : pictures) {
+        codec_->ReleaseOutput(picture);
+    }
+}
@@ -0,0 +1,115 @@
+/*
+ * ohos_video_codec_pump.h
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef OHOS_VIDEO_CODEC_PUMP_H
+#define OHOS_VIDEO_CODEC_PUMP_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+extern "C" {
+#include "libavcodec/avcodec.h"
+#include "libavutil/error.h"
+}
+#include "ohos_video_codec_interface.h"
+
+/*
+ * Where the input pump takes its packets from, the video packet queue in the
+ * player. Packets come out ready for the codec, bitstream filtered.
+ */
+class VideoCodecPacketSource {
+public:
+    virtual ~VideoCodecPacketSource() = default;
+
+    /* blocks for the next packet, returns >= 0 with *pkt and its *serial, < 0 on abort */
+    virtual int GetPacket(AVPacket *pkt, int *serial) = 0;
+    virtual bool IsFlushPacket(const AVPacket *pkt) = 0;
+    /* a source switch, the packets after it carry new parameter sets */
+    virtual bool IsCodecPacket(const AVPacket *pkt) = 0;
+    /* serial of the packets queued now, a packet of another one is stale */
+    virtual int CurrentSerial() = 0;
+    virtual bool IsAborted() = 0;
+    /* a flush packet came through, the codec has been flushed */
+    virtual void OnFlush() = 0;
+    /* the EOS could not go into the codec, no EOS picture will come for serial */
+    virtual void OnEosLost(int serial) = 0;
+    /* bytes the codec copied since the last call */
+    virtual void OnInputCopied(uint64_t bytes) = 0;
+};
+
+/*
+ * Two long-lived workers around a VideoCodecInterface: the input one queues
+ * the packets of a VideoCodecPacketSource into the codec, the output one
+ * stamps decoded pictures with the serial of their packets and hands them to
+ * the video thread through a bounded queue. Pictures taken with PopPicture()
+ * go back to the codec with VideoCodecInterface::ReleaseOutput().
+ */
+class VideoCodecPump {
+public:
+    static const int INPUT_TIMEOUT_MS = 30;
+    static const int OUTPUT_TIMEOUT_MS = 20;
+    static const size_t MAX_PENDING_PICTURES = 4;
+
+    VideoCodecPump(VideoCodecInterface *codec, VideoCodecPacketSource *source);
+    ~VideoCodecPump();
+
+    void Start();
+    /* the source must be aborted first when GetPacket() may block */
+    void Stop();
+    /* blocks for the next picture, returns < 0 once stopped */
+    int PopPicture(VideoCodecPicture &picture);
+
+private:
+    void InputLoop();
+    void OutputLoop();
+    void FlushCodec(int serial);
+    bool RestartAfterEos();
+    int QueueInput(const AVPacket *pkt, bool eos);
+    int QueueBoundaryEos();
+    void PushPicture(VideoCodecPicture &picture);
+    void ClearPictures();
+
+    VideoCodecInterface *codec_;
+    VideoCodecPacketSource *source_;
+    std::thread inputThread_;
+    std::thread outputThread_;
+    std::atomic_bool abortRequest_ {false};
+    std::atomic_int outputSerial_ {0};
+    /* serial of the packet the input pump works on, input side only */
+    int pktSerial_ {0};
+    bool inputPending_ {false};
+    /* an EOS went in, the codec takes no input until it came out and the codec was restarted */
+    bool eosQueued_ {false};
+    bool eosDrained_ {false};
+    /* the EOS queued drains a source switch, its picture is not handed on; under flushMutex_ */
+    bool boundaryEos_ {false};
+    uint64_t inputBytesCopied_ {0};
+    /* held while a picture is taken from the codec and stamped, so a flush can't slip in between */
+    std::mutex flushMutex_;
+    std::mutex pictureMutex_;
+    std::condition_variable pictureCond_;
+    std::deque<VideoCodecPicture> pictures_;
+};
+
+#endif // OHOS_VIDEO_CODEC_PUMP_H
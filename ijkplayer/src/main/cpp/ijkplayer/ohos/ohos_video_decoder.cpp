@@ -110,6 +110,21 @@ int32_t VideoDecoder::FreeOutputData(uint32_t bufferIndex)
     return ret;
 }
 
+int32_t VideoDecoder::Flush()
+{
+    if (decoder_ == nullptr) {
+        OH_LOG_Print(LOG_APP, LOG_ERROR, LOG_DOMAIN, "VideoDecoder", "decoder_ nullptr");
+        return AV_ERR_INVALID_VAL;
+    }
+    int32_t ret = OH_VideoDecoder_Flush(decoder_);
+    if (ret != AV_ERR_OK) {
+        OH_LOG_Print(LOG_APP, LOG_ERROR, LOG_DOMAIN, "VideoDecoder", "OH_VideoDecoder_Flush Failed");
+        return ret;
+    }
+    stat = DecodeStat::STOP;
+    return AV_ERR_OK;
+}
+
 int32_t VideoDecoder::Stop()
 {
     if (decoder_ == nullptr) {
@@ -49,6 +49,7 @@ public:
     int32_t Start();
     int32_t PushInputData(CodecBufferInfo &info);
     int32_t FreeOutputData(uint32_t bufferIndex);
+    int32_t Flush();
     int32_t Stop();
     void Release();
     const DecodeStat &Stat();
@@ -44,10 +44,27 @@ void CodecData::ShutDown()
     outputCond_.notify_all();
 }
 
-int32_t CodecData::InputData(CodecBufferInfo &info, std::chrono::milliseconds time)
+void CodecData::Flush()
 {
-    if (info.buff_ == nullptr || this->formatInfo == nullptr) {
-        OH_LOG_Print(LOG_APP, LOG_ERROR, LOG_DOMAIN, "DecoderData", "info.buff_ or formatInfo nullptr");
+    {
+        std::unique_lock<std::mutex> lock(this->inputMutex_);
+        std::queue<CodecBufferInfo>().swap(this->inputBufferInfoQueue_);
+    }
+    {
+        std::unique_lock<std::mutex> lock(this->outputMutex_);
+        std::queue<CodecBufferInfo>().swap(this->outputBufferInfoQueue_);
+    }
+}
+
+/*
+ * Copies the bitstream straight into the input buffer the codec handed out in
+ * OnNeedInputBuffer(), the only copy on the way into the decoder.
+ */
+int32_t CodecData::InputData(const uint8_t *data, const OH_AVCodecBufferAttr &attr, std::chrono::milliseconds time,
+    uint32_t &bufferIndex)
+{
+    if (this->formatInfo == nullptr || (attr.size > 0 && data == nullptr)) {
+        OH_LOG_Print(LOG_APP, LOG_ERROR, LOG_DOMAIN, "DecoderData", "data or formatInfo nullptr");
         return AV_ERR_UNKNOWN;
     }
     std::unique_lock<std::mutex> lock(this->inputMutex_);
@@ -55,38 +72,48 @@ int32_t CodecData::InputData(CodecBufferInfo &info, std::chrono::milliseconds ti
         this->inputCond_.wait_for(lock, time, [this]() { return !this->inputBufferInfoQueue_.empty();});
 
     if (this->inputBufferInfoQueue_.empty()) {
-        OH_LOG_Print(LOG_APP, LOG_ERROR, LOG_DOMAIN, "DecoderData", "inputBufferInfoQueue_ is empty");
         return AV_ERR_TIMEOUT;
     }
     CodecBufferInfo bufferInfo = this->inputBufferInfoQueue_.front();
     this->inputBufferInfoQueue_.pop();
     this->inputFrameCount_++;
     lock.unlock();
-    auto bufferInfoAddr = OH_AVBuffer_GetAddr(bufferInfo.buff_);
-    auto infoAddr = OH_AVBuffer_GetAddr(info.buff_);
-    if (bufferInfoAddr == nullptr || infoAddr == nullptr) {
-        OH_LOG_Print(LOG_APP, LOG_ERROR, LOG_DOMAIN, "DecoderData", "ABbuffAddr is nullptr");
-        return AV_ERR_IO;
-    }
-    memcpy(bufferInfoAddr, infoAddr, info.attr.size);
-    OH_AVBuffer_SetBufferAttr(bufferInfo.buff_, &info.attr);
-    info.bufferIndex = bufferInfo.bufferIndex;
-    if (bufferInfo.attr.flags & AVCODEC_BUFFER_FLAGS_EOS) {
-        OH_LOG_Print(LOG_APP, LOG_ERROR, LOG_DOMAIN, "DecoderData", "Catch EOS");
-        return AV_ERR_OK;
+
+    bufferIndex = bufferInfo.bufferIndex;
+    if (attr.size > 0) {
+        uint8_t *bufferInfoAddr = OH_AVBuffer_GetAddr(bufferInfo.buff_);
+        if (bufferInfoAddr == nullptr || OH_AVBuffer_GetCapacity(bufferInfo.buff_) < attr.size) {
+            OH_LOG_Print(LOG_APP, LOG_ERROR, LOG_DOMAIN, "DecoderData", "input buffer too small for %{public}d",
+                attr.size);
+            /* nothing was submitted, hand the buffer back so the codec doesn't lose an input slot */
+            lock.lock();
+            this->inputBufferInfoQueue_.push(bufferInfo);
+            this->inputFrameCount_--;
+            return AV_ERR_NO_MEMORY;
+        }
+        memcpy(bufferInfoAddr, data, attr.size);
+        this->inputBytesCopied_ += attr.size;
     }
-    OH_AVBuffer_Destroy(bufferInfo.buff_);
+    OH_AVBuffer_SetBufferAttr(bufferInfo.buff_, &attr);
     return AV_ERR_OK;
 }
 
 bool CodecData::OutputData(CodecBufferInfo &receiveInfo)
+{
+    if (!OutputData(receiveInfo, std::chrono::milliseconds(awaitTime_))) {
+        LOGE("OutputData outputBufferInfoQueue_ is empty");
+        return false;
+    }
+    return true;
+}
+
+bool CodecData::OutputData(CodecBufferInfo &receiveInfo, std::chrono::milliseconds time)
 {
     std::unique_lock<std::mutex> lock(this->outputMutex_);
-    bool ret = this->outputCond_.wait_for(lock, std::chrono::milliseconds(awaitTime_), [this]() {
+    bool ret = this->outputCond_.wait_for(lock, time, [this]() {
                                               return !this->outputBufferInfoQueue_.empty();
                                           });
     if (!ret) {
-        LOGE("OutputData outputBufferInfoQueue_ is empty");
         return false;
     }
 
@@ -116,6 +143,7 @@ void CodecData::DataCallback::OnCodecFormatChange(OH_AVCodec *videoEnc, OH_AVFor
     (void)userData;
     CodecData *codecUserData = static_cast<CodecData *>(userData);
     std::unique_lock<std::mutex> lock(codecUserData->outputMutex_);
+    codecUserData->formatChanged_ = true;
 }
 
 void CodecData::DataCallback::OnNeedInputBuffer(OH_AVCodec *codec, uint32_t index, OH_AVBuffer *buffer,
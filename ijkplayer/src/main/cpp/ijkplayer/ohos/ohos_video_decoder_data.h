@@ -26,6 +26,8 @@
 #include <multimedia/player_framework/native_avcodec_videoencoder.h>
 #include <multimedia/player_framework/native_avbuffer_info.h>
 #include <multimedia/player_framework/native_avformat.h>
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
 #include <queue>
 #include "ohos_video_decoder_Info.h"
@@ -37,6 +39,7 @@ public:
     FormatInfo *formatInfo{nullptr};
     void Start();
     void ShutDown();
+    void Flush();
     class DataCallback {
     public:
         static void OnCodecError(OH_AVCodec *codec, int32_t errorCode, void *userData);
@@ -46,8 +49,12 @@ public:
     };
     uint32_t inputFrameCount_{0};
     uint32_t outputFrameCount_{0};
-    int32_t InputData(CodecBufferInfo &info, std::chrono::milliseconds time);
+    std::atomic_bool formatChanged_{true};
+    std::atomic_uint64_t inputBytesCopied_{0};
+    int32_t InputData(const uint8_t *data, const OH_AVCodecBufferAttr &attr, std::chrono::milliseconds time,
+        uint32_t &bufferIndex);
     bool OutputData(CodecBufferInfo &receiveInfo);
+    bool OutputData(CodecBufferInfo &receiveInfo, std::chrono::milliseconds time);
 private:
     std::mutex inputMutex_;
     std::condition_variable inputCond_;
@@ -0,0 +1,749 @@
+/*
+ * ijkplayer_clip_export.cpp
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * A-B clip export from the current source on its own demuxer, playback is not
+ * touched. Whole GOPs inside the range are stream copied; only the GOP the in
+ * point falls into and the GOP the out point falls into are decoded and
+ * re-encoded, trimmed to the range. Without a matching encoder the cut snaps
+ * outwards to the surrounding keyframes instead.
+ *
+ * Re-encoded H.264/HEVC GOPs carry their own parameter sets in band, they are
+ * rewritten to the length prefixed layout when the container uses avcC/hvcC.
+ */
+
+#include "ijkplayer_record.h"
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ijkplayer_internal.h"
+extern "C" {
+#include "libavutil/pixdesc.h"
+}
+
+enum ClipVideoPhase {
+    CLIP_VIDEO_HEAD,
+    CLIP_VIDEO_COPY,
+    CLIP_VIDEO_DONE,
+};
+
+struct ClipExportContext {
+    FFPlayer *ffp {nullptr};
+    std::string url;
+    std::string path;
+    AVDictionary *formatOpts {nullptr};
+    int64_t startMs {0};
+    int64_t endMs {0};
+    std::atomic_bool cancel {false};
+    std::atomic_bool running {false};
+    std::thread thread;
+};
+
+struct ClipExportJob {
+    ClipExportContext *ctx {nullptr};
+    AVFormatContext *ic {nullptr};
+    AVFormatContext *oc {nullptr};
+    int videoIn {-1};
+    int audioIn {-1};
+    int videoOut {-1};
+    int audioOut {-1};
+    /* range bounds in AV_TIME_BASE, source start time included */
+    int64_t startUs {0};
+    int64_t endUs {0};
+    int64_t lastDts[2] {AV_NOPTS_VALUE, AV_NOPTS_VALUE};
+    ClipVideoPhase phase {CLIP_VIDEO_HEAD};
+    bool headStarted {false};
+    bool audioDone {false};
+    const AVCodec *decoder {nullptr};
+    const AVCodec *encoder {nullptr};
+    AVCodecContext *dec {nullptr};
+    AVCodecContext *enc {nullptr};
+    /* 0 when the output takes Annex B as is */
+    int nalLengthSize {0};
+    /* the GOP being copied, held back until we know whether the out point is in it */
+    std::vector<AVPacket *> gop;
+    int percent {-1};
+};
+
+static ClipExportContext *GetClipExport(FFPlayer *ffp)
+{
+    return static_cast<ClipExportContext *>(ffp->clip_export);
+}
+
+static int ClipInterruptCallback(void *opaque)
+{
+    return static_cast<ClipExportContext *>(opaque)->cancel.load() ? 1 : 0;
+}
+
+static int64_t ClipPacketTs(const AVPacket *pkt)
+{
+    return pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+}
+
+static void ClipDropGop(ClipExportJob *job)
+{
+    for (AVPacket *pkt : job->gop) {
+        av_packet_free(&pkt);
+    }
+    job->gop.clear();
+}
+
+static int ClipNalLengthSize(const AVCodecParameters *par)
+{
+    /* first byte 1 means avcC / hvcC extradata, i.e. length prefixed samples */
+    if (!par->extradata || par->extradata[0] != 1) {
+        return 0;
+    }
+    if (par->codec_id == AV_CODEC_ID_H264 && par->extradata_size >= 7) {
+        return (par->extradata[4] & 0x03) + 1;
+    }
+    if (par->codec_id == AV_CODEC_ID_HEVC && par->extradata_size >= 23) {
+        return (par->extradata[21] & 0x03) + 1;
+    }
+    return 0;
+}
+
+static const uint8_t *ClipFindStartCode(const uint8_t *p, const uint8_t *end, int *codeSize)
+{
+    for (; p + 3 <= end; p++) {
+        if (p[0] == 0 && p[1] == 0 && p[2] == 1) {
+            *codeSize = 3;
+            return p;
+        }
+        if (p + 4 <= end && p[0] == 0 && p[1] == 0 && p[2] == 0 && p[3] == 1) {
+            *codeSize = 4;
+            return p;
+        }
+    }
+    *codeSize = 0;
+    return end;
+}
+
+static int ClipAnnexbToLengthPrefixed(AVPacket *pkt, int lengthSize)
+{
+    const uint8_t *end = pkt->data + pkt->size;
+    int codeSize = 0;
+    const uint8_t *nal = ClipFindStartCode(pkt->data, end, &codeSize);
+    if (nal == end) {
+        /* already length prefixed */
+        return 0;
+    }
+
+    std::vector<std::pair<const uint8_t *, int>> nals;
+    int total = 0;
+    while (nal < end) {
+        const uint8_t *begin = nal + codeSize;
+        const uint8_t *next = ClipFindStartCode(begin, end, &codeSize);
+        const uint8_t *last = next;
+        /* trailing zero bytes belong to the next start code */
+        while (last > begin && last[-1] == 0) {
+            last--;
+        }
+        int size = (int)(last - begin);
+        if (size > 0) {
+            nals.emplace_back(begin, size);
+            total += lengthSize + size;
+        }
+        nal = next;
+    }
+
+    AVPacket *out = av_packet_alloc();
+    if (!out) {
+        return AVERROR(ENOMEM);
+    }
+    int ret = av_new_packet(out, total);
+    if (ret < 0 || (ret = av_packet_copy_props(out, pkt)) < 0) {
+        av_packet_free(&out);
+        return ret;
+    }
+    uint8_t *dst = out->data;
+    for (auto &it : nals) {
+        for (int i = lengthSize - 1; i >= 0; i--) {
+            *dst++ = (uint8_t)(it.second >> (8 * i));
+        }
+        memcpy(dst, it.first, it.second);
+        dst += it.second;
+    }
+    av_packet_unref(pkt);
+    av_packet_move_ref(pkt, out);
+    av_packet_free(&out);
+    return 0;
+}
+
+static int ClipWritePacket(ClipExportJob *job, AVPacket *pkt, int in, AVRational tb)
+{
+    int out = in == job->videoIn ? job->videoOut : job->audioOut;
+    int slot = in == job->videoIn ? 0 : 1;
+    AVStream *st = job->oc->streams[out];
+    int64_t offset = av_rescale_q(job->startUs, AV_TIME_BASE_Q, tb);
+    if (pkt->pts != AV_NOPTS_VALUE) {
+        pkt->pts -= offset;
+    }
+    if (pkt->dts != AV_NOPTS_VALUE) {
+        pkt->dts -= offset;
+    }
+    av_packet_rescale_ts(pkt, tb, st->time_base);
+    /* the seam between re-encoded and copied GOPs can step back when the source has B-frames */
+    if (pkt->dts != AV_NOPTS_VALUE && job->lastDts[slot] != AV_NOPTS_VALUE && pkt->dts <= job->lastDts[slot]) {
+        pkt->dts = job->lastDts[slot] + 1;
+        if (pkt->pts != AV_NOPTS_VALUE && pkt->pts < pkt->dts) {
+            pkt->pts = pkt->dts;
+        }
+    }
+    if (pkt->dts != AV_NOPTS_VALUE) {
+        job->lastDts[slot] = pkt->dts;
+    }
+    pkt->stream_index = out;
+    pkt->pos = -1;
+    return av_interleaved_write_frame(job->oc, pkt);
+}
+
+static void ClipReportProgress(ClipExportJob *job, int64_t tsUs)
+{
+    int64_t range = job->endUs - job->startUs;
+    if (range <= 0 || tsUs == AV_NOPTS_VALUE) {
+        return;
+    }
+    int percent = (int)av_clip64((tsUs - job->startUs) * 100 / range, 0, 99);
+    if (percent > job->percent) {
+        job->percent = percent;
+        ffp_notify_msg2(job->ctx->ffp, FFP_MSG_CLIP_EXPORT_PROGRESS, percent);
+    }
+}
+
+static void ClipCloseEncoder(ClipExportJob *job)
+{
+    avcodec_free_context(&job->enc);
+}
+
+static int ClipOpenEncoder(ClipExportJob *job, const AVFrame *frame)
+{
+    AVStream *in = job->ic->streams[job->videoIn];
+    job->enc = avcodec_alloc_context3(job->encoder);
+    if (!job->enc) {
+        return AVERROR(ENOMEM);
+    }
+    AVCodecContext *enc = job->enc;
+    enc->width = frame->width;
+    enc->height = frame->height;
+    enc->pix_fmt = (AVPixelFormat)frame->format;
+    enc->sample_aspect_ratio = frame->sample_aspect_ratio;
+    enc->time_base = in->time_base;
+    enc->framerate = av_guess_frame_rate(job->ic, in, nullptr);
+    enc->bit_rate = in->codecpar->bit_rate;
+    /* dts == pts keeps the seam to the copied GOPs simple */
+    enc->max_b_frames = 0;
+    enc->gop_size = INT16_MAX;
+    enc->color_range = frame->color_range;
+    enc->color_primaries = frame->color_primaries;
+    enc->color_trc = frame->color_trc;
+    enc->colorspace = frame->colorspace;
+    if (job->encoder->pix_fmts) {
+        bool supported = false;
+        for (const AVPixelFormat *fmt = job->encoder->pix_fmts; *fmt != AV_PIX_FMT_NONE; fmt++) {
+            supported = supported || *fmt == enc->pix_fmt;
+        }
+        if (!supported) {
+            LOGE("clip export: %s can't take %s", job->encoder->name, av_get_pix_fmt_name(enc->pix_fmt));
+            ClipCloseEncoder(job);
+            return AVERROR(ENOSYS);
+        }
+    }
+    AVDictionary *opts = nullptr;
+    av_dict_set(&opts, "preset", "veryfast", 0);
+    int ret = avcodec_open2(enc, job->encoder, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        LOGE("clip export: open encoder failed %s", av_err2str(ret));
+        ClipCloseEncoder(job);
+    }
+    return ret;
+}
+
+static int ClipDrainEncoder(ClipExportJob *job)
+{
+    AVPacket *pkt = av_packet_alloc();
+    if (!pkt) {
+        return AVERROR(ENOMEM);
+    }
+    int ret = 0;
+    while ((ret = avcodec_receive_packet(job->enc, pkt)) >= 0) {
+        if (job->nalLengthSize > 0) {
+            ret = ClipAnnexbToLengthPrefixed(pkt, job->nalLengthSize);
+        }
+        if (ret >= 0) {
+            ret = ClipWritePacket(job, pkt, job->videoIn, job->enc->time_base);
+        }
+        av_packet_unref(pkt);
+        if (ret < 0) {
+            break;
+        }
+    }
+    av_packet_free(&pkt);
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+static int ClipEncodeFrame(ClipExportJob *job, AVFrame *frame)
+{
+    if (!job->enc) {
+        int ret = ClipOpenEncoder(job, frame);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    frame->pict_type = AV_PICTURE_TYPE_NONE;
+    int ret = avcodec_send_frame(job->enc, frame);
+    if (ret < 0) {
+        return ret;
+    }
+    return ClipDrainEncoder(job);
+}
+
+static int ClipFinishEncoder(ClipExportJob *job)
+{
+    if (!job->enc) {
+        return 0;
+    }
+    int ret = avcodec_send_frame(job->enc, nullptr);
+    if (ret >= 0) {
+        ret = ClipDrainEncoder(job);
+    }
+    /* every boundary starts a fresh encoder so it opens on an IDR */
+    ClipCloseEncoder(job);
+    return ret;
+}
+
+/* decode pkt (nullptr flushes) and re-encode the frames that fall inside the range */
+static int ClipTranscode(ClipExportJob *job, const AVPacket *pkt)
+{
+    AVRational tb = job->ic->streams[job->videoIn]->time_base;
+    int64_t start = av_rescale_q(job->startUs, AV_TIME_BASE_Q, tb);
+    int64_t end = av_rescale_q(job->endUs, AV_TIME_BASE_Q, tb);
+    int ret = avcodec_send_packet(job->dec, pkt);
+    if (ret < 0 && ret != AVERROR_EOF) {
+        LOGE("clip export: decode failed %s", av_err2str(ret));
+        return pkt ? 0 : ret;
+    }
+    AVFrame *frame = av_frame_alloc();
+    if (!frame) {
+        return AVERROR(ENOMEM);
+    }
+    while ((ret = avcodec_receive_frame(job->dec, frame)) >= 0) {
+        int64_t pts = frame->best_effort_timestamp;
+        if (pts != AV_NOPTS_VALUE && pts >= start && pts <= end) {
+            frame->pts = pts;
+            ret = ClipEncodeFrame(job, frame);
+        }
+        av_frame_unref(frame);
+        if (ret < 0) {
+            break;
+        }
+    }
+    av_frame_free(&frame);
+    if (ret == AVERROR_EOF) {
+        avcodec_flush_buffers(job->dec);
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+static int ClipCopyGop(ClipExportJob *job)
+{
+    AVRational tb = job->ic->streams[job->videoIn]->time_base;
+    int ret = 0;
+    for (AVPacket *pkt : job->gop) {
+        if (ret >= 0) {
+            ret = ClipWritePacket(job, pkt, job->videoIn, tb);
+        }
+    }
+    ClipDropGop(job);
+    return ret;
+}
+
+/* the GOP holding the out point, decoded from its keyframe and cut at the out point */
+static int ClipFinishTail(ClipExportJob *job)
+{
+    AVRational tb = job->ic->streams[job->videoIn]->time_base;
+    int64_t end = av_rescale_q(job->endUs, AV_TIME_BASE_Q, tb);
+    int64_t maxPts = AV_NOPTS_VALUE;
+    for (AVPacket *pkt : job->gop) {
+        int64_t ts = ClipPacketTs(pkt);
+        if (ts != AV_NOPTS_VALUE && (maxPts == AV_NOPTS_VALUE || ts > maxPts)) {
+            maxPts = ts;
+        }
+    }
+    if (!job->dec || (maxPts != AV_NOPTS_VALUE && maxPts <= end)) {
+        return ClipCopyGop(job);
+    }
+    int ret = 0;
+    for (AVPacket *pkt : job->gop) {
+        if ((ret = ClipTranscode(job, pkt)) < 0) {
+            break;
+        }
+    }
+    ClipDropGop(job);
+    if (ret >= 0) {
+        ret = ClipTranscode(job, nullptr);
+    }
+    int finish = ClipFinishEncoder(job);
+    return ret < 0 ? ret : finish;
+}
+
+static int ClipHandleVideo(ClipExportJob *job, AVPacket *pkt)
+{
+    AVRational tb = job->ic->streams[job->videoIn]->time_base;
+    int64_t start = av_rescale_q(job->startUs, AV_TIME_BASE_Q, tb);
+    int64_t end = av_rescale_q(job->endUs, AV_TIME_BASE_Q, tb);
+    int64_t ts = ClipPacketTs(pkt);
+    bool key = (pkt->flags & AV_PKT_FLAG_KEY) != 0;
+    int ret = 0;
+
+    if (job->phase == CLIP_VIDEO_HEAD) {
+        if (!job->headStarted) {
+            if (!key) {
+                /* the seek may land short of a keyframe, nothing decodable yet */
+                return 0;
+            }
+            job->headStarted = true;
+            if (ts != AV_NOPTS_VALUE && ts >= start) {
+                job->phase = CLIP_VIDEO_COPY;
+            }
+        } else if (key) {
+            /* the first keyframe after the in point ends the head GOP */
+            if (job->dec) {
+                ret = ClipTranscode(job, nullptr);
+                int finish = ClipFinishEncoder(job);
+                ret = ret < 0 ? ret : finish;
+            }
+            job->phase = CLIP_VIDEO_COPY;
+        }
+        if (job->phase == CLIP_VIDEO_HEAD) {
+            if (job->dec) {
+                return ClipTranscode(job, pkt);
+            }
+            return ClipWritePacket(job, pkt, job->videoIn, tb);
+        }
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    if (job->phase != CLIP_VIDEO_COPY) {
+        return 0;
+    }
+    if (key && !job->gop.empty()) {
+        if (ts != AV_NOPTS_VALUE && ts > end) {
+            job->phase = CLIP_VIDEO_DONE;
+            return ClipFinishTail(job);
+        }
+        if ((ret = ClipCopyGop(job)) < 0) {
+            return ret;
+        }
+    }
+    if (key && ts != AV_NOPTS_VALUE && ts > end) {
+        job->phase = CLIP_VIDEO_DONE;
+        return 0;
+    }
+    AVPacket *copy = av_packet_clone(pkt);
+    if (!copy) {
+        return AVERROR(ENOMEM);
+    }
+    job->gop.push_back(copy);
+    return 0;
+}
+
+static int ClipHandleAudio(ClipExportJob *job, AVPacket *pkt)
+{
+    AVRational tb = job->ic->streams[job->audioIn]->time_base;
+    int64_t ts = ClipPacketTs(pkt);
+    if (ts == AV_NOPTS_VALUE) {
+        return 0;
+    }
+    if (ts > av_rescale_q(job->endUs, AV_TIME_BASE_Q, tb)) {
+        job->audioDone = true;
+        return 0;
+    }
+    if (ts < av_rescale_q(job->startUs, AV_TIME_BASE_Q, tb)) {
+        return 0;
+    }
+    return ClipWritePacket(job, pkt, job->audioIn, tb);
+}
+
+static int ClipAddStream(ClipExportJob *job, int index, int *outIndex)
+{
+    if (index < 0) {
+        return 0;
+    }
+    AVCodecParameters *par = job->ic->streams[index]->codecpar;
+    if (avformat_query_codec(job->oc->oformat, par->codec_id, FF_COMPLIANCE_NORMAL) == 0) {
+        LOGE("clip export: %s can't hold %s", job->oc->oformat->name, avcodec_get_name(par->codec_id));
+        return AVERROR(EINVAL);
+    }
+    AVStream *st = avformat_new_stream(job->oc, nullptr);
+    if (!st) {
+        return AVERROR(ENOMEM);
+    }
+    int ret = avcodec_parameters_copy(st->codecpar, par);
+    if (ret < 0) {
+        return ret;
+    }
+    st->codecpar->codec_tag = 0;
+    st->time_base = job->ic->streams[index]->time_base;
+    *outIndex = st->index;
+    return 0;
+}
+
+static void ClipOpenDecoder(ClipExportJob *job)
+{
+    AVCodecParameters *par = job->ic->streams[job->videoIn]->codecpar;
+    job->decoder = avcodec_find_decoder(par->codec_id);
+    job->encoder = avcodec_find_encoder(par->codec_id);
+    if (!job->decoder || !job->encoder) {
+        LOGE("clip export: no codec pair for %s, cutting on keyframes", avcodec_get_name(par->codec_id));
+        return;
+    }
+    job->dec = avcodec_alloc_context3(job->decoder);
+    if (!job->dec || avcodec_parameters_to_context(job->dec, par) < 0) {
+        avcodec_free_context(&job->dec);
+        return;
+    }
+    job->dec->pkt_timebase = job->ic->streams[job->videoIn]->time_base;
+    if (avcodec_open2(job->dec, job->decoder, nullptr) < 0) {
+        LOGE("clip export: open decoder failed, cutting on keyframes");
+        avcodec_free_context(&job->dec);
+    }
+}
+
+static int ClipOpen(ClipExportJob *job)
+{
+    ClipExportContext *ctx = job->ctx;
+    job->ic = avformat_alloc_context();
+    if (!job->ic) {
+        return AVERROR(ENOMEM);
+    }
+    job->ic->interrupt_callback.callback = ClipInterruptCallback;
+    job->ic->interrupt_callback.opaque = ctx;
+    AVDictionary *opts = nullptr;
+    av_dict_copy(&opts, ctx->formatOpts, 0);
+    int ret = avformat_open_input(&job->ic, ctx->url.c_str(), nullptr, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        LOGE("clip export: open input failed %s", av_err2str(ret));
+        return ret;
+    }
+    if ((ret = avformat_find_stream_info(job->ic, nullptr)) < 0) {
+        return ret;
+    }
+    job->videoIn = av_find_best_stream(job->ic, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    job->audioIn = av_find_best_stream(job->ic, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    if (job->videoIn >= 0 && (job->ic->streams[job->videoIn]->disposition & AV_DISPOSITION_ATTACHED_PIC)) {
+        job->videoIn = -1;
+    }
+    if (job->videoIn < 0 && job->audioIn < 0) {
+        return AVERROR_STREAM_NOT_FOUND;
+    }
+
+    int64_t origin = job->ic->start_time != AV_NOPTS_VALUE ? job->ic->start_time : 0;
+    job->startUs = origin + ctx->startMs * 1000;
+    job->endUs = origin + ctx->endMs * 1000;
+    if (job->ic->duration > 0) {
+        job->endUs = FFMIN(job->endUs, origin + job->ic->duration);
+    }
+    if (job->endUs <= job->startUs) {
+        return AVERROR(EINVAL);
+    }
+
+    ret = avformat_alloc_output_context2(&job->oc, nullptr, nullptr, ctx->path.c_str());
+    if (!job->oc) {
+        ret = avformat_alloc_output_context2(&job->oc, nullptr, "mp4", ctx->path.c_str());
+    }
+    if (!job->oc) {
+        return ret < 0 ? ret : AVERROR(ENOMEM);
+    }
+    if ((ret = ClipAddStream(job, job->videoIn, &job->videoOut)) < 0 ||
+        (ret = ClipAddStream(job, job->audioIn, &job->audioOut)) < 0) {
+        return ret;
+    }
+    if (job->videoIn >= 0) {
+        ClipOpenDecoder(job);
+        job->nalLengthSize = ClipNalLengthSize(job->ic->streams[job->videoIn]->codecpar);
+    } else {
+        job->phase = CLIP_VIDEO_DONE;
+    }
+    if (job->audioIn < 0) {
+        job->audioDone = true;
+    }
+
+    /* lands on the keyframe at or before the in point */
+    ret = avformat_seek_file(job->ic, -1, INT64_MIN, job->startUs, job->startUs, 0);
+    if (ret < 0) {
+        LOGE("clip export: seek failed %s, reading from the start", av_err2str(ret));
+    }
+    if (!(job->oc->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open(&job->oc->pb, ctx->path.c_str(), AVIO_FLAG_WRITE);
+        if (ret < 0) {
+            LOGE("clip export: could not open %s", ctx->path.c_str());
+            return ret;
+        }
+    }
+    return avformat_write_header(job->oc, nullptr);
+}
+
+static void ClipClose(ClipExportJob *job, bool writeTrailer)
+{
+    ClipDropGop(job);
+    avcodec_free_context(&job->enc);
+    avcodec_free_context(&job->dec);
+    if (job->oc) {
+        if (writeTrailer) {
+            av_write_trailer(job->oc);
+        }
+        if (!(job->oc->oformat->flags & AVFMT_NOFILE)) {
+            avio_closep(&job->oc->pb);
+        }
+        avformat_free_context(job->oc);
+        job->oc = nullptr;
+    }
+    avformat_close_input(&job->ic);
+}
+
+static int ClipRun(ClipExportJob *job)
+{
+    int ret = ClipOpen(job);
+    if (ret < 0) {
+        return ret;
+    }
+    AVPacket *pkt = av_packet_alloc();
+    if (!pkt) {
+        return AVERROR(ENOMEM);
+    }
+    while (job->phase != CLIP_VIDEO_DONE || !job->audioDone) {
+        if (job->ctx->cancel) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+        ret = av_read_frame(job->ic, pkt);
+        if (ret < 0) {
+            ret = ret == AVERROR_EOF ? 0 : ret;
+            break;
+        }
+        AVRational tb = job->ic->streams[pkt->stream_index]->time_base;
+        if (pkt->stream_index == job->videoIn && job->phase != CLIP_VIDEO_DONE) {
+            ret = ClipHandleVideo(job, pkt);
+        } else if (pkt->stream_index == job->audioIn && !job->audioDone) {
+            ret = ClipHandleAudio(job, pkt);
+        }
+        if ((pkt->stream_index == job->videoIn || job->videoIn < 0) && ClipPacketTs(pkt) != AV_NOPTS_VALUE) {
+            ClipReportProgress(job, av_rescale_q(ClipPacketTs(pkt), tb, AV_TIME_BASE_Q));
+        }
+        av_packet_unref(pkt);
+        if (ret < 0) {
+            break;
+        }
+    }
+    av_packet_free(&pkt);
+    if (ret < 0) {
+        return ret;
+    }
+    /* end of file inside the range */
+    if (job->phase == CLIP_VIDEO_HEAD && job->dec) {
+        ret = ClipTranscode(job, nullptr);
+        int finish = ClipFinishEncoder(job);
+        ret = ret < 0 ? ret : finish;
+    } else if (job->phase == CLIP_VIDEO_COPY) {
+        ret = ClipFinishTail(job);
+    }
+    return ret;
+}
+
+static void ClipExportThread(ClipExportContext *ctx)
+{
+    ClipExportJob job;
+    job.ctx = ctx;
+    int ret = ClipRun(&job);
+    ClipClose(&job, ret >= 0);
+    if (ret < 0) {
+        LOGE("clip export: failed %s", av_err2str(ret));
+        unlink(ctx->path.c_str());
+    } else {
+        ffp_notify_msg2(ctx->ffp, FFP_MSG_CLIP_EXPORT_PROGRESS, 100);
+    }
+    ffp_notify_msg3(ctx->ffp, FFP_MSG_CLIP_EXPORT_COMPLETE, ret < 0 ? ret : 0, ctx->cancel ? 1 : 0);
+    ctx->running = false;
+}
+
+static void ClipExportJoin(ClipExportContext *ctx)
+{
+    if (ctx->thread.joinable()) {
+        ctx->thread.join();
+    }
+    av_dict_free(&ctx->formatOpts);
+}
+
+int ClipExportStart(void *ffp, const char *url, const char *filePath, int64_t startMs, int64_t endMs)
+{
+    FFPlayer *player = (FFPlayer *)ffp;
+    if (!url || !filePath || startMs < 0 || endMs <= startMs) {
+        return AVERROR(EINVAL);
+    }
+    ClipExportContext *ctx = GetClipExport(player);
+    if (!ctx) {
+        ctx = new ClipExportContext();
+        ctx->ffp = player;
+        player->clip_export = ctx;
+    } else if (ctx->running) {
+        return AVERROR(EBUSY);
+    }
+    /* one export at a time, a finished one is only reaped here */
+    ClipExportJoin(ctx);
+    ctx->url = url;
+    ctx->path = filePath;
+    ctx->startMs = startMs;
+    ctx->endMs = endMs;
+    ctx->cancel = false;
+    ctx->running = true;
+    av_dict_copy(&ctx->formatOpts, player->format_opts, 0);
+    ctx->thread = std::thread(ClipExportThread, ctx);
+    return 0;
+}
+
+void ClipExportCancel(void *ffp)
+{
+    ClipExportContext *ctx = GetClipExport((FFPlayer *)ffp);
+    if (ctx) {
+        ctx->cancel = true;
+    }
+}
+
+void ClipExportDestroy(void *ffp)
+{
+    FFPlayer *player = (FFPlayer *)ffp;
+    ClipExportContext *ctx = GetClipExport(player);
+    if (!ctx) {
+        return;
+    }
+    ctx->cancel = true;
+    ClipExportJoin(ctx);
+    delete ctx;
+    player->clip_export = nullptr;
+}
@@ -21,8 +21,10 @@
  */
 
 #include "ijkplayer_record.h"
+#include <ctime>
 #include <unordered_map>
 #include "ijkplayer_internal.h"
+#include "ijkavutil/ijkimgutils.h"
 static std::unordered_map<void *, int> ijkplayerRecordStatusMap;
 static std::unordered_map<void *, int> ijkplayerRecordResultMap;
 
@@ -62,14 +64,16 @@ void handleCodecAudioStream(AVCodecContext *c, OutputStream *ost, AVCodec **code
 }
 
 void handleCodecVideoStream(AVCodecContext *c, OutputStream *ost, enum AVCodecID codec_id,
-                            InputSourceInfo inpSrcInfo, int frameRate)
+                            InputSourceInfo inpSrcInfo, AVRational frameRate, AVRational timeBase)
 {
     c->codec_id = codec_id;
     c->bit_rate = VIDEO_BIT_RATE;
     c->width = inpSrcInfo.width;
     c->height = inpSrcInfo.height;
-    ost->st->time_base = (AVRational){1, frameRate};
+    /* the source time base, so that frames keep their timestamps as they are */
+    ost->st->time_base = timeBase;
     c->time_base = ost->st->time_base;
+    c->framerate = frameRate;
     c->gop_size = DATA_NUM_12;
     c->pix_fmt = STREAM_PIX_FMT;
     if (c->codec_id == AV_CODEC_ID_MPEG2VIDEO) {
@@ -81,7 +85,7 @@ void handleCodecVideoStream(AVCodecContext *c, OutputStream *ost, enum AVCodecID
 }
 
 int AddStream(OutputStream *ost, AVFormatContext *oc, AVCodec **codec, enum AVCodecID codec_id,
-              InputSourceInfo inpSrcInfo, int sampleRate, int frameRate)
+              InputSourceInfo inpSrcInfo, int sampleRate, AVRational frameRate, AVRational timeBase)
 {
     AVCodecContext *c;
     int i;
@@ -105,7 +109,7 @@ int AddStream(OutputStream *ost, AVFormatContext *oc, AVCodec **codec, enum AVCo
             handleCodecAudioStream(c, ost, codec, sampleRate);
             break;
         case AVMEDIA_TYPE_VIDEO:
-            handleCodecVideoStream(c, ost, codec_id, inpSrcInfo, frameRate);
+            handleCodecVideoStream(c, ost, codec_id, inpSrcInfo, frameRate, timeBase);
             break;
         default:
             break;
@@ -346,25 +350,24 @@ int GetRecordStatus(FFPlayer *ffp)
         LOGE("getRecordStatus ffp null");
         return OHOS_RECORD_STATUS_OFF;
     }
-    auto it = ijkplayerRecordStatusMap.find(ffp);
-    if (it != ijkplayerRecordStatusMap.end()) {
-        return it->second;
-    }
-    return OHOS_RECORD_STATUS_OFF;
+    return __atomic_load_n(&ffp->record_write_data.isInRecord, __ATOMIC_ACQUIRE);
 }
 
-
 VideoAudioAvCodec VideoAudioStreamAndAvcodecOpen(RecordWriteData *recordWriteData, FFPlayer *mFFPlayer,
                                                  AVDictionary *opt)
 {
     int haveVideo = 0, haveAudio = 0;
     VideoAudioAvCodec vaAvcodec;
     AVOutputFormat *fmt = recordWriteData->oc->oformat;
-    int frameRate = av_q2d(mFFPlayer->is->video_st->avg_frame_rate);
+    AVRational frameRate = mFFPlayer->is->video_st->avg_frame_rate;
+    if (!frameRate.num || !frameRate.den) {
+        frameRate = (AVRational){STREAM_FRAME_RATE, 1};
+    }
     if (fmt->video_codec != AV_CODEC_ID_NONE) {
         int addStreamResult =
             AddStream(&(recordWriteData->video_st), recordWriteData->oc, &(recordWriteData->video_codec),
-                      fmt->video_codec, recordWriteData->srcFormat, recordWriteData->sampleRate, frameRate);
+                      fmt->video_codec, recordWriteData->srcFormat, recordWriteData->sampleRate, frameRate,
+                      recordWriteData->srcTimeBase);
         if (addStreamResult == 0) {
             UpdateRecordResult(mFFPlayer, OHOS_RECORD_CALLBACK_STATUS_FAILED);
             vaAvcodec.result = OHOS_RECORD_CALLBACK_STATUS_FAILED;
@@ -375,7 +378,8 @@ VideoAudioAvCodec VideoAudioStreamAndAvcodecOpen(RecordWriteData *recordWriteDat
     if (fmt->audio_codec != AV_CODEC_ID_NONE) {
         int addStreamResult =
             AddStream(&(recordWriteData->audio_st), recordWriteData->oc, &recordWriteData->audio_codec,
-                      fmt->audio_codec, recordWriteData->srcFormat, recordWriteData->sampleRate, frameRate);
+                      fmt->audio_codec, recordWriteData->srcFormat, recordWriteData->sampleRate, frameRate,
+                      recordWriteData->srcTimeBase);
         if (addStreamResult == 0) {
             UpdateRecordResult(mFFPlayer, OHOS_RECORD_CALLBACK_STATUS_FAILED);
             vaAvcodec.result = OHOS_RECORD_CALLBACK_STATUS_FAILED;
@@ -401,147 +405,364 @@ VideoAudioAvCodec VideoAudioStreamAndAvcodecOpen(RecordWriteData *recordWriteDat
             return vaAvcodec;
         }
     }
-    vaAvcodec.haveAudio = haveVideo;
+    vaAvcodec.haveVideo = haveVideo;
     vaAvcodec.haveAudio = haveAudio;
     vaAvcodec.result = OHOS_RECORD_CALLBACK_STATUS_SUCCESS;
     return vaAvcodec;
 }
 
-void WriteVideoFrameData(AVFormatContext *oc, RecordFrameData frData, SwsContext *swsContext,
-                         InputSourceInfo inSrcInfo, RecordWriteData *recordWriteData)
-{
-    uint8_t *srcSlice[3];
-    srcSlice[DATA_NUM_0] = frData.data0;
-    srcSlice[DATA_NUM_1] = frData.data1;
-    srcSlice[DATA_NUM_2] = frData.data2;
-    int srcLineSize[3];
-    srcLineSize[DATA_NUM_0] = frData.lineSize0;
-    srcLineSize[DATA_NUM_1] = frData.lineSize1;
-    srcLineSize[DATA_NUM_2] = frData.lineSize2;
-    int dstLineSize[3];
-    dstLineSize[DATA_NUM_0] = inSrcInfo.width;
-    dstLineSize[DATA_NUM_1] = inSrcInfo.width / DATA_NUM_2;
-    dstLineSize[DATA_NUM_2] = inSrcInfo.width / DATA_NUM_2;
-    sws_scale(swsContext, (const uint8_t *const *)srcSlice, srcLineSize, 0, inSrcInfo.height,
-              recordWriteData->video_st.frame->data, recordWriteData->video_st.frame->linesize);
-    recordWriteData->video_st.frame->pts = recordWriteData->video_st.next_pts++;
-    WriteVideoFrame(oc, &recordWriteData->video_st, recordWriteData->video_st.frame);
-}
-
-void FreeFramesQueueIndexFrame(RecordWriteData *recordWriteData, int index)
-{
-    if (recordWriteData->recordFramesQueue[index].dataNum == DATA_NUM_3 ||
-        recordWriteData->recordFramesQueue[index].dataNum == DATA_NUM_2) {
-        if (recordWriteData->recordFramesQueue[index].data0) {
-            free(recordWriteData->recordFramesQueue[index].data0);
-            recordWriteData->recordFramesQueue[index].data0 = NULL;
-        }
-        if (recordWriteData->recordFramesQueue[index].data1) {
-            free(recordWriteData->recordFramesQueue[index].data1);
-            recordWriteData->recordFramesQueue[index].data1 = NULL;
-        }
+static void RecordQueueTimedWait(RecordWriteData *recData, int ms)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_nsec += (long)ms * 1000000L;
+    ts.tv_sec += ts.tv_nsec / 1000000000L;
+    ts.tv_nsec %= 1000000000L;
+    pthread_cond_timedwait(&recData->queueCond, &recData->queueMutex, &ts);
+}
+
+static int RecordRingSize(RecordFrameRing *ring)
+{
+    int64_t windex = __atomic_load_n(&ring->windex, __ATOMIC_ACQUIRE);
+    int64_t rindex = __atomic_load_n(&ring->rindex, __ATOMIC_ACQUIRE);
+    return (int)(windex - rindex);
+}
+
+/* producer side, the slot stays invisible to the encode thread until RecordRingCommitWrite() */
+static AVFrame *RecordRingPeekWrite(RecordFrameRing *ring)
+{
+    if (!ring->frames || RecordRingSize(ring) >= ring->capacity) {
+        return nullptr;
     }
-    if (recordWriteData->recordFramesQueue[index].dataNum == DATA_NUM_3) {
-        if (recordWriteData->recordFramesQueue[index].data2) {
-            free(recordWriteData->recordFramesQueue[index].data2);
-            recordWriteData->recordFramesQueue[index].data2 = NULL;
-        }
+    AVFrame **slot = &ring->frames[ring->windex % ring->capacity];
+    if (!*slot) {
+        *slot = av_frame_alloc();
+    }
+    return *slot;
+}
+
+static void RecordRingCommitWrite(RecordFrameRing *ring)
+{
+    __atomic_store_n(&ring->windex, ring->windex + 1, __ATOMIC_RELEASE);
+}
+
+static AVFrame *RecordRingPeekRead(RecordFrameRing *ring)
+{
+    if (!ring->frames || RecordRingSize(ring) <= 0) {
+        return nullptr;
+    }
+    return ring->frames[ring->rindex % ring->capacity];
+}
+
+static void RecordRingCommitRead(RecordFrameRing *ring)
+{
+    __atomic_store_n(&ring->rindex, ring->rindex + 1, __ATOMIC_RELEASE);
+}
+
+static int RecordRingInit(RecordFrameRing *ring, int capacity)
+{
+    if (ring->frames && ring->capacity == capacity) {
+        __atomic_store_n(&ring->rindex, __atomic_load_n(&ring->windex, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+        return 0;
+    }
+    for (int i = 0; ring->frames && i < ring->capacity; i++) {
+        av_frame_free(&ring->frames[i]);
+    }
+    av_freep(&ring->frames);
+    ring->frames = (AVFrame **)av_mallocz_array(capacity, sizeof(AVFrame *));
+    if (!ring->frames) {
+        ring->capacity = 0;
+        return AVERROR(ENOMEM);
+    }
+    ring->capacity = capacity;
+    ring->windex = 0;
+    ring->rindex = 0;
+    return 0;
+}
+
+static void RecordRingDestroy(RecordFrameRing *ring)
+{
+    for (int i = 0; ring->frames && i < ring->capacity; i++) {
+        av_frame_free(&ring->frames[i]);
     }
+    av_freep(&ring->frames);
+    ring->capacity = 0;
 }
 
-void WriteRecordFrameData(AVFormatContext *oc, RecordWriteData *recordWriteData, OutputStream *audioStPtr, int index,
-                          SwsContext *swsContext, InputSourceInfo inSrcInfo)
+int RecordQueueInit(RecordWriteData *recData, int capacity, int policy)
 {
-    RecordFrameData frData = recordWriteData->recordFramesQueue[index];
-    if (frData.writeFileStatus != 0) {
+    if (!recData->queueInited) {
+        pthread_mutex_init(&recData->queueMutex, NULL);
+        pthread_cond_init(&recData->queueCond, NULL);
+        recData->queueInited = 1;
+    }
+    capacity = av_clip(capacity, 1, OHOS_RECORD_QUEUE_SIZE_MAX);
+    if (RecordRingInit(&recData->videoRing, capacity) < 0 || RecordRingInit(&recData->audioRing, capacity) < 0) {
+        LOGE("record queue alloc failed");
+        return AVERROR(ENOMEM);
+    }
+    recData->queuePolicy = policy;
+    return 0;
+}
+
+void RecordQueueDestroy(RecordWriteData *recData)
+{
+    RecordRemuxDestroy(recData);
+    RecordRingDestroy(&recData->videoRing);
+    RecordRingDestroy(&recData->audioRing);
+    if (recData->queueInited) {
+        pthread_cond_destroy(&recData->queueCond);
+        pthread_mutex_destroy(&recData->queueMutex);
+        recData->queueInited = 0;
+    }
+}
+
+void RecordQueueWakeup(RecordWriteData *recData)
+{
+    if (!recData->queueInited) {
         return;
     }
-    if (frData.frameType == OHOS_FRAME_TYPE_VIDEO) {
-        WriteVideoFrameData(oc, frData, swsContext, inSrcInfo, recordWriteData);
-        FreeFramesQueueIndexFrame(recordWriteData, index);
+    pthread_mutex_lock(&recData->queueMutex);
+    pthread_cond_broadcast(&recData->queueCond);
+    pthread_mutex_unlock(&recData->queueMutex);
+}
+
+int RecordQueueDepth(RecordWriteData *recData)
+{
+    if (recData->mode == OHOS_RECORD_MODE_REMUX) {
+        return RecordRemuxQueueDepth(recData);
+    }
+    if (!recData->queueInited) {
+        return 0;
+    }
+    return RecordRingSize(&recData->videoRing) + RecordRingSize(&recData->audioRing);
+}
+
+/* returns a free slot, or nullptr if the frame has to be dropped */
+static AVFrame *RecordAcquireSlot(FFPlayer *ffp, RecordFrameRing *ring)
+{
+    RecordWriteData *recData = &ffp->record_write_data;
+    AVFrame *slot = RecordRingPeekWrite(ring);
+    if (!slot && recData->queuePolicy == OHOS_RECORD_QUEUE_POLICY_BLOCK) {
+        pthread_mutex_lock(&recData->queueMutex);
+        while (!(slot = RecordRingPeekWrite(ring)) && GetRecordStatus(ffp) == OHOS_RECORD_STATUS_ON) {
+            RecordQueueTimedWait(recData, OHOS_RECORD_QUEUE_WAIT_MS);
+        }
+        pthread_mutex_unlock(&recData->queueMutex);
+    }
+    if (!slot) {
+        __atomic_add_fetch(&ffp->stat.record_dropped_frames, 1, __ATOMIC_RELAXED);
+    }
+    return slot;
+}
+
+static void RecordPublishSlot(FFPlayer *ffp, RecordFrameRing *ring)
+{
+    RecordRingCommitWrite(ring);
+    RecordQueueWakeup(&ffp->record_write_data);
+}
+
+int RecordPushVideoFrame(void *ffp, const AVFrame *frame)
+{
+    FFPlayer *player = (FFPlayer *)ffp;
+    // remux records the packets, nothing drains the frame rings
+    if (player->record_write_data.mode == OHOS_RECORD_MODE_REMUX) {
+        return 0;
+    }
+    if (GetRecordStatus(player) != OHOS_RECORD_STATUS_ON || frame->width <= 0 || frame->height <= 0) {
+        return 0;
+    }
+    if (frame->format != AV_PIX_FMT_YUV420P && frame->format != AV_PIX_FMT_NV12 &&
+        frame->format != AV_PIX_FMT_NV21) {
+        return 0;
+    }
+    AVFrame *slot = RecordAcquireSlot(player, &player->record_write_data.videoRing);
+    if (!slot) {
+        return AVERROR(EAGAIN);
+    }
+    int ret;
+    if (slot->format != AV_PIX_FMT_YUV420P || slot->width != frame->width || slot->height != frame->height) {
+        av_frame_unref(slot);
+        slot->format = AV_PIX_FMT_YUV420P;
+        slot->width = frame->width;
+        slot->height = frame->height;
+        ret = av_frame_get_buffer(slot, DATA_NUM_32);
     } else {
-        if (frData.format == AV_SAMPLE_FMT_FLTP) {
-            AVFrame *tmpFr = audioStPtr->tmp_frame;
-            tmpFr->data[DATA_NUM_0] = (uint8_t *)av_malloc(frData.lineSize0);
-            tmpFr->data[DATA_NUM_1] = (uint8_t *)av_malloc(frData.lineSize1);
-            if (frData.data0 && frData.data1) {
-                memcpy(tmpFr->data[DATA_NUM_0], frData.data0, frData.lineSize0);
-                memcpy(tmpFr->data[DATA_NUM_1], frData.data1, frData.lineSize1);
-                tmpFr->nb_samples = frData.nb_samples;
-                tmpFr->channels = frData.channels;
-                tmpFr->channel_layout = frData.channel_layout;
-                tmpFr->pts = audioStPtr->next_pts;
-                audioStPtr->next_pts += tmpFr->nb_samples;
-                tmpFr->format = frData.format;
-                WriteAudioFrame(oc, audioStPtr, tmpFr);
-                free(tmpFr->data[DATA_NUM_0]);
-                tmpFr->data[DATA_NUM_0] = NULL;
-                free(tmpFr->data[DATA_NUM_1]);
-                tmpFr->data[DATA_NUM_1] = NULL;
-            }
-        } else if (frData.format == AV_SAMPLE_FMT_S16) {
-            AVFrame *tmpFr = audioStPtr->tmp_frame;
-            tmpFr->nb_samples = frData.nb_samples;
-            tmpFr->channels = frData.channels;
-            tmpFr->channel_layout = frData.channel_layout;
-            tmpFr->linesize[DATA_NUM_0] = frData.lineSize0;
-            tmpFr->data[DATA_NUM_0] = (uint8_t *)av_malloc(frData.lineSize0);
-            if (frData.data0) {
-                memcpy(tmpFr->data[DATA_NUM_0], frData.data0, frData.lineSize0);
-                tmpFr->format = frData.format;
-                WriteAudioFrame(oc, audioStPtr, tmpFr);
-                free(tmpFr->data[DATA_NUM_0]);
-                tmpFr->data[DATA_NUM_0] = NULL;
+        ret = av_frame_make_writable(slot);
+    }
+    if (ret < 0) {
+        av_frame_unref(slot);
+        return ret;
+    }
+    if (frame->format == AV_PIX_FMT_YUV420P) {
+        av_image_copy(slot->data, slot->linesize, (const uint8_t **)frame->data, frame->linesize,
+                      AV_PIX_FMT_YUV420P, frame->width, frame->height);
+    } else if ((ret = ijk_img_convert_frame(slot, frame)) < 0) {
+        return ret;
+    }
+    slot->pts = frame->pts;
+    RecordPublishSlot(player, &player->record_write_data.videoRing);
+    return 0;
+}
+
+int RecordPushAudioFrame(void *ffp, const AVFrame *frame)
+{
+    FFPlayer *player = (FFPlayer *)ffp;
+    if (player->record_write_data.mode == OHOS_RECORD_MODE_REMUX) {
+        return 0;
+    }
+    if (GetRecordStatus(player) != OHOS_RECORD_STATUS_ON || frame->format != AV_SAMPLE_FMT_FLTP ||
+        frame->nb_samples <= 0) {
+        return 0;
+    }
+    AVFrame *slot = RecordAcquireSlot(player, &player->record_write_data.audioRing);
+    if (!slot) {
+        return AVERROR(EAGAIN);
+    }
+    int ret;
+    if (slot->format != frame->format || slot->channels != frame->channels ||
+        slot->channel_layout != frame->channel_layout || slot->nb_samples != frame->nb_samples) {
+        av_frame_unref(slot);
+        slot->format = frame->format;
+        slot->channels = frame->channels;
+        slot->channel_layout = frame->channel_layout;
+        slot->nb_samples = frame->nb_samples;
+        ret = av_frame_get_buffer(slot, 0);
+    } else {
+        ret = av_frame_make_writable(slot);
+    }
+    if (ret < 0) {
+        av_frame_unref(slot);
+        return ret;
+    }
+    av_samples_copy(slot->extended_data, frame->extended_data, 0, 0, frame->nb_samples, frame->channels,
+                    (enum AVSampleFormat)frame->format);
+    slot->sample_rate = frame->sample_rate;
+    slot->pts = frame->pts;
+    RecordPublishSlot(player, &player->record_write_data.audioRing);
+    return 0;
+}
+
+void WriteVideoFrameData(AVFormatContext *oc, AVFrame *srcFrame, RecordWriteData *recordWriteData)
+{
+    OutputStream *ost = &recordWriteData->video_st;
+    AVFrame *frame = srcFrame;
+    if (srcFrame->width != ost->frame->width || srcFrame->height != ost->frame->height) {
+        /* the stream changed size since the encoder was opened */
+        ost->sws_ctx = sws_getCachedContext(ost->sws_ctx, srcFrame->width, srcFrame->height, AV_PIX_FMT_YUV420P,
+                                            ost->frame->width, ost->frame->height, AV_PIX_FMT_YUV420P,
+                                            SWS_FAST_BILINEAR, NULL, NULL, NULL);
+        if (!ost->sws_ctx || av_frame_make_writable(ost->frame) < 0) {
+            return;
+        }
+        sws_scale(ost->sws_ctx, (const uint8_t *const *)srcFrame->data, srcFrame->linesize, 0, srcFrame->height,
+                  ost->frame->data, ost->frame->linesize);
+        frame = ost->frame;
+    }
+    /*
+     * keep the source timing, encoders need pts that strictly increase: a frame
+     * that doesn't is dropped rather than pushed later, which would leave video
+     * ahead of audio from there on
+     */
+    int64_t pts = ost->next_pts;
+    if (srcFrame->pts != AV_NOPTS_VALUE) {
+        if (ost->start_pts == AV_NOPTS_VALUE) {
+            ost->start_pts = srcFrame->pts;
+        }
+        pts = av_rescale_q(srcFrame->pts - ost->start_pts, recordWriteData->srcTimeBase, ost->st->codec->time_base);
+        if (pts < ost->next_pts) {
+            return;
+        }
+    }
+    frame->pts = pts;
+    ost->next_pts = pts + 1;
+    WriteVideoFrame(oc, ost, frame);
+}
+
+/* audio starts from the origin of the video, what was decoded before the first video frame is left out */
+void WriteAudioFrameData(AVFormatContext *oc, AVFrame *srcFrame, RecordWriteData *recordWriteData)
+{
+    OutputStream *ost = &recordWriteData->audio_st;
+    int64_t origin = recordWriteData->video_st.start_pts;
+    if (ost->start_pts == AV_NOPTS_VALUE) {
+        if (origin != AV_NOPTS_VALUE && srcFrame->pts != AV_NOPTS_VALUE && srcFrame->sample_rate > 0) {
+            /* the decoder stamps audio frames in 1/sample_rate */
+            AVRational tb = (AVRational){1, ost->st->codec->sample_rate};
+            int64_t offset = av_rescale_q(srcFrame->pts, (AVRational){1, srcFrame->sample_rate}, tb) -
+                             av_rescale_q(origin, recordWriteData->srcTimeBase, tb);
+            if (offset + srcFrame->nb_samples <= 0) {
+                return;
             }
+            ost->samples_count = (int)FFMAX(offset, 0);
         }
-        FreeFramesQueueIndexFrame(recordWriteData, index);
+        ost->start_pts = srcFrame->pts != AV_NOPTS_VALUE ? srcFrame->pts : 0;
     }
-    recordWriteData->recordFramesQueue[index].writeFileStatus = DATA_NUM_1;
+    WriteAudioFrame(oc, ost, srcFrame);
 }
 
 void StartEncoderWrite(AVFormatContext *oc, RecordWriteData *recordWriteData, FFPlayer *mFFPlayer,
                        OutputStream *audioStPtr)
 {
-    InputSourceInfo inSrcInfo = recordWriteData->srcFormat;
-    struct SwsContext *swsContext =
-        sws_getContext(inSrcInfo.width, inSrcInfo.height, AV_PIX_FMT_YUV420P, inSrcInfo.width, inSrcInfo.height,
-                       AV_PIX_FMT_YUV420P, SWS_FAST_BILINEAR, NULL, NULL, NULL);
     while (true) {
-        recordWriteData = &mFFPlayer->record_write_data;
-        int totalFrameIndex = recordWriteData->windex;
-        for (int i = 0; i < totalFrameIndex; i++) {
-            usleep(SLEEP_TIME_100);
-            WriteRecordFrameData(oc, recordWriteData, audioStPtr, i, swsContext, inSrcInfo);
+        int busy = 0;
+        AVFrame *frame = RecordRingPeekRead(&recordWriteData->videoRing);
+        if (frame) {
+            WriteVideoFrameData(oc, frame, recordWriteData);
+            RecordRingCommitRead(&recordWriteData->videoRing);
+            SDL_SpeedSampler2Add(&mFFPlayer->stat.record_encode_sampler, 1);
+            busy = 1;
+        }
+        frame = RecordRingPeekRead(&recordWriteData->audioRing);
+        if (frame) {
+            if (audioStPtr->st) {
+                WriteAudioFrameData(oc, frame, recordWriteData);
+            }
+            RecordRingCommitRead(&recordWriteData->audioRing);
+            busy = 1;
+        }
+        if (busy) {
+            if (recordWriteData->queuePolicy == OHOS_RECORD_QUEUE_POLICY_BLOCK) {
+                RecordQueueWakeup(recordWriteData);
+            }
+            continue;
         }
         if (GetRecordStatus(mFFPlayer) != OHOS_RECORD_STATUS_ON) {
             break;
         }
+        pthread_mutex_lock(&recordWriteData->queueMutex);
+        if (RecordQueueDepth(recordWriteData) == 0 && GetRecordStatus(mFFPlayer) == OHOS_RECORD_STATUS_ON) {
+            RecordQueueTimedWait(recordWriteData, OHOS_RECORD_QUEUE_WAIT_MS);
+        }
+        pthread_mutex_unlock(&recordWriteData->queueMutex);
     }
 }
 
-void ReleaseResources(AVFormatContext *oc, RecordWriteData *recordWriteData, AVOutputFormat *fmt,
-                      int haveVideo, int haveAudio, OutputStream *videoStPtr, OutputStream *audioStPtr)
+/* closes whatever of the output got opened, on success after the trailer was written */
+void ReleaseResources(RecordWriteData *recordWriteData)
 {
-        FreeRecordFrames(recordWriteData);
-        av_write_trailer(oc);
-        if (haveVideo) {
-        CloseStream(oc, videoStPtr);
-        }
-        if (haveAudio) {
-        CloseStream(oc, audioStPtr);
-        }
-        if (!(fmt->flags & AVFMT_NOFILE)) {
+    AVFormatContext *oc = recordWriteData->oc;
+    if (!oc) {
+        return;
+    }
+    if (recordWriteData->video_st.st) {
+        CloseStream(oc, &recordWriteData->video_st);
+    }
+    if (recordWriteData->audio_st.st) {
+        CloseStream(oc, &recordWriteData->audio_st);
+    }
+    if (!(oc->oformat->flags & AVFMT_NOFILE)) {
         avio_closep(&oc->pb);
-        }
-        avformat_free_context(oc);
+    }
+    avformat_free_context(oc);
+    recordWriteData->oc = NULL;
 }
 
-int CheckAVFormatContext(AVFormatContext *oc, FFPlayer *mFFPlayer, const char *fileName)
+int CheckAVFormatContext(AVFormatContext **oc, FFPlayer *mFFPlayer, const char *fileName)
 {
-    if (!oc) {
-        avformat_alloc_output_context2(&oc, NULL, "mp4", fileName);
+    if (!*oc) {
+        avformat_alloc_output_context2(oc, NULL, "mp4", fileName);
     }
-    if (!oc) {
+    if (!*oc) {
         LOGE("oc null");
         UpdateRecordResult(mFFPlayer, OHOS_RECORD_CALLBACK_STATUS_FAILED);
         return OHOS_RECORD_CALLBACK_STATUS_FAILED;
@@ -549,76 +770,99 @@ int CheckAVFormatContext(AVFormatContext *oc, FFPlayer *mFFPlayer, const char *f
     return OHOS_RECORD_CALLBACK_STATUS_SUCCESS;
 }
 
+/* the encoders are opened with the size and sample rate of the first frames that show up */
 RecordWriteData* WaitCacheVideoFrames(FFPlayer *mFFPlayer)
 {
-        RecordWriteData *recordWriteData;
-        while (true) {
-            recordWriteData = &mFFPlayer->record_write_data;
-            if ((&mFFPlayer->record_write_data)->windex > DATA_NUM_50
-                || GetRecordStatus(mFFPlayer) != OHOS_RECORD_STATUS_ON) {
+    RecordWriteData *recordWriteData = &mFFPlayer->record_write_data;
+    int64_t videoTime = 0;
+    pthread_mutex_lock(&recordWriteData->queueMutex);
+    while (GetRecordStatus(mFFPlayer) == OHOS_RECORD_STATUS_ON) {
+        if (RecordRingSize(&recordWriteData->videoRing) > 0) {
+            if (RecordRingSize(&recordWriteData->audioRing) > 0) {
+                break;
+            }
+            if (!videoTime) {
+                videoTime = av_gettime_relative();
+            } else if (av_gettime_relative() - videoTime >= OHOS_RECORD_AUDIO_WAIT_MS * 1000LL) {
                 break;
             }
-            usleep(SLEEP_TIME);
         }
-        return recordWriteData;
+        RecordQueueTimedWait(recordWriteData, OHOS_RECORD_QUEUE_WAIT_MS);
+    }
+    pthread_mutex_unlock(&recordWriteData->queueMutex);
+
+    AVFrame *frame = RecordRingPeekRead(&recordWriteData->videoRing);
+    if (frame) {
+        recordWriteData->srcFormat.width = frame->width;
+        recordWriteData->srcFormat.height = frame->height;
+    }
+    recordWriteData->srcTimeBase = mFFPlayer->is->video_st->time_base;
+    frame = RecordRingPeekRead(&recordWriteData->audioRing);
+    recordWriteData->sampleRate = frame ? frame->sample_rate : 0;
+    return recordWriteData;
 }
 
-int WriteRecordFile(void *recordData)
+static int WriteRecordFileInternal(FFPlayer *mFFPlayer)
 {
-    FFPlayer *mFFPlayer = (FFPlayer *)(recordData);
-    RecordWriteData *recordWriteData = &mFFPlayer->record_write_data;
+    RecordWriteData *recordWriteData = WaitCacheVideoFrames(mFFPlayer);
     const char *fileName = recordWriteData->recordFilePath;
-    recordWriteData = WaitCacheVideoFrames(mFFPlayer);
-    if (recordWriteData->windex == 0) {
+    int result = OHOS_RECORD_CALLBACK_STATUS_FAILED;
+    VideoAudioAvCodec vaAvcodec;
+    AVDictionary *opt = NULL;
+    int ret;
+    memset(&recordWriteData->video_st, 0, sizeof(OutputStream));
+    memset(&recordWriteData->audio_st, 0, sizeof(OutputStream));
+    recordWriteData->video_st.start_pts = AV_NOPTS_VALUE;
+    recordWriteData->audio_st.start_pts = AV_NOPTS_VALUE;
+    if (RecordRingSize(&recordWriteData->videoRing) == 0) {
         LOGE("Error check no frame");
-        UpdateRecordResult(mFFPlayer, OHOS_RECORD_CALLBACK_STATUS_FAILED);
-        return OHOS_RECORD_CALLBACK_STATUS_FAILED;
+        goto end;
     }
-    AVOutputFormat *fmt;
-    OutputStream *videoStPtr;
-    OutputStream *audioStPtr;
-    int ret;
-    AVDictionary *opt = NULL;
     av_dict_set(&opt, "preset", "veryfast", 0);
     av_dict_set(&opt, "tune", "zerolatency", 0);
     avformat_alloc_output_context2(&(recordWriteData->oc), NULL, NULL, fileName);
-    int checkResult = CheckAVFormatContext(recordWriteData->oc, mFFPlayer, fileName);
-    if (!checkResult) {
-        return OHOS_RECORD_CALLBACK_STATUS_FAILED;
+    if (!CheckAVFormatContext(&recordWriteData->oc, mFFPlayer, fileName)) {
+        goto end;
     }
-    auto vaAvcodec = VideoAudioStreamAndAvcodecOpen(recordWriteData, mFFPlayer, opt);
+    vaAvcodec = VideoAudioStreamAndAvcodecOpen(recordWriteData, mFFPlayer, opt);
     if (!vaAvcodec.result) {
-        return OHOS_RECORD_CALLBACK_STATUS_FAILED;
+        goto end;
     }
-    videoStPtr = &recordWriteData->video_st;
-    audioStPtr = &recordWriteData->audio_st;
     av_dump_format(recordWriteData->oc, 0, fileName, 1);
     if (!(recordWriteData->oc->oformat->flags & AVFMT_NOFILE)) {
         ret = avio_open(&recordWriteData->oc->pb, fileName, AVIO_FLAG_WRITE);
         if (ret < 0) {
             LOGE("Could not open %s", fileName);
-            UpdateRecordResult(mFFPlayer, OHOS_RECORD_CALLBACK_STATUS_FAILED);
-            return OHOS_RECORD_CALLBACK_STATUS_FAILED;
+            goto end;
         }
     }
     ret = avformat_write_header(recordWriteData->oc, &opt);
     if (ret < 0) {
         LOGE("Error occurred when opening output file %s", av_err2str(ret));
-        UpdateRecordResult(mFFPlayer, OHOS_RECORD_CALLBACK_STATUS_FAILED);
-        return OHOS_RECORD_CALLBACK_STATUS_FAILED;
+        goto end;
     }
-    StartEncoderWrite(recordWriteData->oc, recordWriteData, mFFPlayer, audioStPtr);
-    ReleaseResources(recordWriteData->oc, recordWriteData, recordWriteData->oc->oformat,
-                     vaAvcodec.haveVideo, vaAvcodec.haveAudio, videoStPtr, audioStPtr);
-    UpdateRecordResult(mFFPlayer, OHOS_RECORD_CALLBACK_STATUS_SUCCESS);
-    return OHOS_RECORD_CALLBACK_STATUS_SUCCESS;
+    StartEncoderWrite(recordWriteData->oc, recordWriteData, mFFPlayer, &recordWriteData->audio_st);
+    av_write_trailer(recordWriteData->oc);
+    result = OHOS_RECORD_CALLBACK_STATUS_SUCCESS;
+end:
+    ReleaseResources(recordWriteData);
+    av_dict_free(&opt);
+    UpdateRecordResult(mFFPlayer, result);
+    return result;
 }
 
-void FreeRecordFrames(RecordWriteData *recData)
+int WriteRecordFile(void *recordData)
 {
-    recData->windex = DATA_NUM_0;
-    free(recData->recordFramesQueue);
-    recData->recordFramesQueue = nullptr;
+    FFPlayer *mFFPlayer = (FFPlayer *)(recordData);
+    int ret = mFFPlayer->record_write_data.mode == OHOS_RECORD_MODE_REMUX ?
+        RecordRemuxWriteFile(mFFPlayer) : WriteRecordFileInternal(mFFPlayer);
+    /* nothing drains the queue any more, stop the decoders from feeding or waiting on it */
+    __atomic_store_n(&mFFPlayer->record_write_data.isInRecord, OHOS_RECORD_STATUS_OFF, __ATOMIC_RELEASE);
+    RecordQueueWakeup(&mFFPlayer->record_write_data);
+    __atomic_store_n(&mFFPlayer->record_write_data.recThreadDone, 1, __ATOMIC_RELEASE);
+    /* ffp_stop_record() doesn't wait for the file, this reports it */
+    ffp_notify_msg2(mFFPlayer, FFP_MSG_RECORD_COMPLETE, ret);
+    return ret;
 }
 
 void UpdateRecordStatus(void *ffp, int status)
@@ -637,16 +881,10 @@ int FindRecordResult(void *ffp)
         LOGE("findRecordResult ffp null");
         return OHOS_RECORD_CALLBACK_STATUS_FAILED;
     }
-    sleep(SLEEP_TIME_2);
+    /* the encode thread is done, its result is final */
     auto it = ijkplayerRecordResultMap.find(ffp);
     if (it != ijkplayerRecordResultMap.end()) {
         return it->second;
-    } else {
-        sleep(SLEEP_TIME_5);
-        auto it = ijkplayerRecordResultMap.find(ffp);
-        if (it != ijkplayerRecordResultMap.end()) {
-            return it->second;
-        }
     }
     LOGE("findRecordResult not find");
     return OHOS_RECORD_CALLBACK_STATUS_FAILED;
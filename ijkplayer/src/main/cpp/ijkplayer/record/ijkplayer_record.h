@@ -49,7 +49,6 @@ extern "C" {
 
 #define OHOS_FRAME_TYPE_VIDEO  0
 #define OHOS_FRAME_TYPE_AUDIO 1
-#define OHOS_MAX_DECODE_FRAME_SIZE 9999999
 #define OHOS_RECORD_STATUS_OFF 0
 #define OHOS_RECORD_STATUS_ON 1
 #define OHOS_RECORD_CALLBACK_STATUS_SUCCESS 1
@@ -77,10 +76,22 @@ extern "C" {
 #define DATA_NUM_110 110.0
 #define OHOS_CALLBACK_RESULT_STATUS_SUCCESS 1
 #define OHOS_CALLBACK_RESULT_STATUS_FAILED 0
+#define OHOS_RECORD_MODE_TRANSCODE 0
+#define OHOS_RECORD_MODE_REMUX 1
+#define OHOS_RECORD_QUEUE_POLICY_DROP 0
+#define OHOS_RECORD_QUEUE_POLICY_BLOCK 1
+#define OHOS_RECORD_QUEUE_SIZE_DEFAULT 16
+#define OHOS_RECORD_QUEUE_SIZE_MAX 256
+#define OHOS_RECORD_QUEUE_WAIT_MS 10
+/* compressed packets the remux mode holds for its writer, it drops up to the next keyframe beyond */
+#define OHOS_RECORD_REMUX_QUEUE_BYTES_MAX (32 * 1024 * 1024)
+#define OHOS_RECORD_AUDIO_WAIT_MS 500
 
 typedef struct OutputStream {
     AVStream *st;
     int64_t next_pts;
+    /* source pts of the first frame written, AV_NOPTS_VALUE until then; the one of video is the origin of both */
+    int64_t start_pts;
     int samples_count;
     AVFrame *frame;
     AVFrame *tmp_frame;
@@ -93,21 +104,17 @@ typedef struct InputSourceInfo {
     int width, height;
 }InputSourceInfo;
 
-typedef struct RecordFrameData {
-    uint8_t* data0;
-    uint8_t* data1;
-    uint8_t* data2;
-    int lineSize0;
-    int lineSize1;
-    int lineSize2;
-    int dataNum;
-    int frameType;
-    int nb_samples;
-    uint64_t channel_layout;
-    int channels;
-    int format;
-    int writeFileStatus;
-}RecordFrameData;
+/*
+ * Single producer / single consumer ring between a decoder thread and the
+ * encode thread. Slots keep their frame buffers across sessions, so a running
+ * recording doesn't allocate per frame.
+ */
+typedef struct RecordFrameRing {
+    AVFrame **frames;
+    int capacity;
+    int64_t windex;
+    int64_t rindex;
+}RecordFrameRing;
 
 typedef struct RecordWriteData {
     OutputStream video_st;
@@ -117,17 +124,28 @@ typedef struct RecordWriteData {
     AVCodec *audio_codec, *video_codec;
     char *recordFilePath;
     InputSourceInfo srcFormat;
-    RecordFrameData *recordFramesQueue;
-    int rindex;
-    int windex;
+    /* time base of the pts of the frames in videoRing, the one of the video stream */
+    AVRational srcTimeBase;
+    RecordFrameRing videoRing;
+    RecordFrameRing audioRing;
+    int queuePolicy;
+    int queueInited;
+    pthread_mutex_t queueMutex;
+    pthread_cond_t queueCond;
     int isInRecord;
+    int recThreadStarted;
+    /* set by the encode thread once the file is finished, it can be joined without waiting then */
+    int recThreadDone;
     pthread_t recThreadid;
     int sampleRate;
+    /* OHOS_RECORD_MODE_*, the one actually in use after a fallback */
+    int mode;
+    void *remux;
 }RecordWriteData;
 
 int AddStream(OutputStream *ost, AVFormatContext *oc,
               AVCodec **codec, enum AVCodecID codec_id,
-              InputSourceInfo inputSrcInfo, int sampleRate, int frameRate);
+              InputSourceInfo inputSrcInfo, int sampleRate, AVRational frameRate, AVRational timeBase);
 int OpenVideo(AVFormatContext *oc, AVCodec *codec, OutputStream *ost, AVDictionary *opt_arg);
 int OpenAudio(AVFormatContext *oc, AVCodec *codec, OutputStream *ost, AVDictionary *opt_arg);
 AVFrame *RecordAllocPicture(enum AVPixelFormat pix_fmt, int width, int height);
@@ -139,7 +157,6 @@ int WriteFrame(AVFormatContext *fmtCtx, const AVRational *time_base, AVStream *s
 void LogPacket(const AVFormatContext *fmtCtx, const AVPacket *pkt);
 int WriteAudioFrame(AVFormatContext* oc, OutputStream* ost, AVFrame* curFr);
 void CloseStream(AVFormatContext *oc, OutputStream *ost);
-void FreeRecordFrames(RecordWriteData* recData);
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -147,6 +164,20 @@ extern "C" {
     void UpdateRecordStatus(void* ffp, int status);
     void UpdateRecordResult(void *ffp, int result);
     int FindRecordResult(void *ffp);
+    int RecordQueueInit(RecordWriteData *recData, int capacity, int policy);
+    void RecordQueueDestroy(RecordWriteData *recData);
+    void RecordQueueWakeup(RecordWriteData *recData);
+    int RecordQueueDepth(RecordWriteData *recData);
+    int RecordPushVideoFrame(void *ffp, const AVFrame *frame);
+    int RecordPushAudioFrame(void *ffp, const AVFrame *frame);
+    int RecordRemuxStart(void *ffp, const char *filePath);
+    void RecordRemuxPacket(void *ffp, const AVPacket *pkt);
+    int RecordRemuxWriteFile(void *ffp);
+    int RecordRemuxQueueDepth(RecordWriteData *recData);
+    void RecordRemuxDestroy(RecordWriteData *recData);
+    int ClipExportStart(void *ffp, const char *url, const char *filePath, int64_t startMs, int64_t endMs);
+    void ClipExportCancel(void *ffp);
+    void ClipExportDestroy(void *ffp);
     void SaveCurrentFramePicture(AVFrame *frame, const char *saveFilePath);
 #ifdef __cplusplus
 }
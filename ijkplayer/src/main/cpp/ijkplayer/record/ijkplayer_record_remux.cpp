@@ -0,0 +1,319 @@
+/*
+ * ijkplayer_record_remux.cpp
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Stream copy recording: packets are tapped in read_thread right after
+ * av_read_frame() and muxed as they are, starting at the next video keyframe.
+ */
+
+#include "ijkplayer_record.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "ijkplayer_internal.h"
+
+static const int REMUX_WAIT_MS = 10;
+
+struct RecordRemuxContext {
+    AVFormatContext *oc {nullptr};
+    /* input stream index -> output stream index, -1 when not recorded */
+    std::vector<int> streamMap;
+    std::vector<AVRational> inTimeBase;
+    std::vector<int64_t> lastDts;
+    int videoIndex {-1};
+    /* dts of the first recorded keyframe in AV_TIME_BASE, everything is rebased on it */
+    int64_t startTime {AV_NOPTS_VALUE};
+    bool active {false};
+    std::atomic_int queued {0};
+    std::atomic<int64_t> queuedBytes {0};
+    /* the queue overflowed, packets are dropped up to the next video keyframe */
+    bool overflowed {false};
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<AVPacket *> packets;
+};
+
+static RecordRemuxContext *GetRemux(FFPlayer *ffp)
+{
+    return static_cast<RecordRemuxContext *>(ffp->record_write_data.remux);
+}
+
+static void RemuxDropPackets(std::deque<AVPacket *> &packets)
+{
+    for (AVPacket *pkt : packets) {
+        av_packet_free(&pkt);
+    }
+    packets.clear();
+}
+
+static void RemuxCloseOutput(RecordRemuxContext *remux, bool writeTrailer)
+{
+    if (!remux->oc) {
+        return;
+    }
+    if (writeTrailer) {
+        av_write_trailer(remux->oc);
+    }
+    if (!(remux->oc->oformat->flags & AVFMT_NOFILE)) {
+        avio_closep(&remux->oc->pb);
+    }
+    avformat_free_context(remux->oc);
+    remux->oc = nullptr;
+}
+
+static int RemuxAddStream(RecordRemuxContext *remux, AVFormatContext *ic, int index)
+{
+    if (index < 0 || index >= (int)ic->nb_streams) {
+        return 0;
+    }
+    AVCodecParameters *par = ic->streams[index]->codecpar;
+    /* 0 means the container can't hold the codec, negative means the muxer doesn't know and we try */
+    if (avformat_query_codec(remux->oc->oformat, par->codec_id, FF_COMPLIANCE_NORMAL) == 0) {
+        LOGE("record remux: %s can't hold %s", remux->oc->oformat->name, avcodec_get_name(par->codec_id));
+        return AVERROR(EINVAL);
+    }
+    AVStream *st = avformat_new_stream(remux->oc, nullptr);
+    if (!st) {
+        return AVERROR(ENOMEM);
+    }
+    int ret = avcodec_parameters_copy(st->codecpar, par);
+    if (ret < 0) {
+        return ret;
+    }
+    st->codecpar->codec_tag = 0;
+    st->time_base = ic->streams[index]->time_base;
+    remux->streamMap[index] = st->index;
+    return 0;
+}
+
+int RecordRemuxStart(void *ffp, const char *filePath)
+{
+    FFPlayer *player = (FFPlayer *)ffp;
+    VideoState *is = player->is;
+    if (!is || !is->ic || (is->video_stream < 0 && is->audio_stream < 0)) {
+        return AVERROR(EINVAL);
+    }
+    RecordRemuxContext *remux = GetRemux(player);
+    if (!remux) {
+        remux = new RecordRemuxContext();
+        player->record_write_data.remux = remux;
+    }
+
+    std::lock_guard<std::mutex> lock(remux->mutex);
+    RemuxDropPackets(remux->packets);
+    remux->queued = 0;
+    remux->queuedBytes = 0;
+    remux->overflowed = false;
+    RemuxCloseOutput(remux, false);
+    AVFormatContext *ic = is->ic;
+    remux->streamMap.assign(ic->nb_streams, -1);
+    remux->lastDts.assign(ic->nb_streams, AV_NOPTS_VALUE);
+    remux->inTimeBase.resize(ic->nb_streams);
+    for (unsigned int i = 0; i < ic->nb_streams; i++) {
+        remux->inTimeBase[i] = ic->streams[i]->time_base;
+    }
+    remux->videoIndex = is->video_stream;
+    remux->startTime = AV_NOPTS_VALUE;
+
+    int ret = avformat_alloc_output_context2(&remux->oc, nullptr, nullptr, filePath);
+    if (!remux->oc) {
+        ret = avformat_alloc_output_context2(&remux->oc, nullptr, "mp4", filePath);
+    }
+    if (!remux->oc) {
+        return ret < 0 ? ret : AVERROR(ENOMEM);
+    }
+    if ((ret = RemuxAddStream(remux, ic, is->video_stream)) < 0 ||
+        (ret = RemuxAddStream(remux, ic, is->audio_stream)) < 0) {
+        RemuxCloseOutput(remux, false);
+        return ret;
+    }
+    if (!(remux->oc->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open(&remux->oc->pb, filePath, AVIO_FLAG_WRITE);
+        if (ret < 0) {
+            LOGE("record remux: could not open %s", filePath);
+            RemuxCloseOutput(remux, false);
+            return ret;
+        }
+    }
+    ret = avformat_write_header(remux->oc, nullptr);
+    if (ret < 0) {
+        LOGE("record remux: write header failed %s", av_err2str(ret));
+        RemuxCloseOutput(remux, false);
+        return ret;
+    }
+    remux->active = true;
+    return 0;
+}
+
+void RecordRemuxPacket(void *ffp, const AVPacket *pkt)
+{
+    FFPlayer *player = (FFPlayer *)ffp;
+    RecordRemuxContext *remux = GetRemux(player);
+    if (!remux || __atomic_load_n(&player->record_write_data.isInRecord, __ATOMIC_ACQUIRE) != OHOS_RECORD_STATUS_ON ||
+        player->record_write_data.mode != OHOS_RECORD_MODE_REMUX) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(remux->mutex);
+    if (!remux->active || pkt->stream_index < 0 || pkt->stream_index >= (int)remux->streamMap.size() ||
+        remux->streamMap[pkt->stream_index] < 0) {
+        return;
+    }
+    int64_t ts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+    if (ts == AV_NOPTS_VALUE) {
+        return;
+    }
+    ts = av_rescale_q(ts, remux->inTimeBase[pkt->stream_index], AV_TIME_BASE_Q);
+    if (remux->startTime == AV_NOPTS_VALUE) {
+        bool startsHere = remux->videoIndex >= 0 ?
+            (pkt->stream_index == remux->videoIndex && (pkt->flags & AV_PKT_FLAG_KEY)) : true;
+        if (!startsHere) {
+            return;
+        }
+        remux->startTime = ts;
+    } else if (ts < remux->startTime) {
+        return;
+    }
+
+    /* the writer fell behind, skip to a point the file can go on from */
+    if (remux->queuedBytes + pkt->size > OHOS_RECORD_REMUX_QUEUE_BYTES_MAX) {
+        if (!remux->overflowed) {
+            LOGE("record remux: queue full, dropping up to the next keyframe");
+        }
+        remux->overflowed = true;
+    } else if (remux->overflowed && (remux->videoIndex < 0 ||
+        (pkt->stream_index == remux->videoIndex && (pkt->flags & AV_PKT_FLAG_KEY)))) {
+        remux->overflowed = false;
+    }
+    if (remux->overflowed) {
+        __atomic_add_fetch(&player->stat.record_dropped_frames, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    AVPacket *copy = av_packet_clone(pkt);
+    if (!copy) {
+        return;
+    }
+    remux->packets.push_back(copy);
+    remux->queued++;
+    remux->queuedBytes += copy->size;
+    remux->cond.notify_one();
+}
+
+int RecordRemuxQueueDepth(RecordWriteData *recData)
+{
+    RecordRemuxContext *remux = static_cast<RecordRemuxContext *>(recData->remux);
+    return remux ? remux->queued.load() : 0;
+}
+
+static void RemuxWritePacket(FFPlayer *ffp, RecordRemuxContext *remux, AVPacket *pkt)
+{
+    int in = pkt->stream_index;
+    int out = remux->streamMap[in];
+    AVStream *st = remux->oc->streams[out];
+    int64_t offset = av_rescale_q(remux->startTime, AV_TIME_BASE_Q, remux->inTimeBase[in]);
+    if (pkt->pts != AV_NOPTS_VALUE) {
+        pkt->pts -= offset;
+    }
+    if (pkt->dts != AV_NOPTS_VALUE) {
+        pkt->dts -= offset;
+    }
+    av_packet_rescale_ts(pkt, remux->inTimeBase[in], st->time_base);
+    /* a seek or a broken source can step back, the muxer only takes increasing dts */
+    if (pkt->dts != AV_NOPTS_VALUE && remux->lastDts[in] != AV_NOPTS_VALUE && pkt->dts <= remux->lastDts[in]) {
+        pkt->dts = remux->lastDts[in] + 1;
+        if (pkt->pts != AV_NOPTS_VALUE && pkt->pts < pkt->dts) {
+            pkt->pts = pkt->dts;
+        }
+    }
+    if (pkt->dts != AV_NOPTS_VALUE) {
+        remux->lastDts[in] = pkt->dts;
+    }
+    pkt->stream_index = out;
+    pkt->pos = -1;
+    if (in == remux->videoIndex) {
+        SDL_SpeedSampler2Add(&ffp->stat.record_encode_sampler, 1);
+    }
+    int ret = av_interleaved_write_frame(remux->oc, pkt);
+    if (ret < 0) {
+        LOGE("record remux: write packet failed %s", av_err2str(ret));
+    }
+}
+
+int RecordRemuxWriteFile(void *ffp)
+{
+    FFPlayer *player = (FFPlayer *)ffp;
+    RecordRemuxContext *remux = GetRemux(player);
+    if (!remux || !remux->oc) {
+        UpdateRecordResult(ffp, OHOS_RECORD_CALLBACK_STATUS_FAILED);
+        return OHOS_RECORD_CALLBACK_STATUS_FAILED;
+    }
+
+    std::deque<AVPacket *> batch;
+    bool wrote = false;
+    while (true) {
+        bool recording = __atomic_load_n(&player->record_write_data.isInRecord, __ATOMIC_ACQUIRE) ==
+            OHOS_RECORD_STATUS_ON;
+        {
+            std::unique_lock<std::mutex> lock(remux->mutex);
+            if (recording && remux->packets.empty()) {
+                remux->cond.wait_for(lock, std::chrono::milliseconds(REMUX_WAIT_MS));
+            }
+            if (!recording) {
+                remux->active = false;
+            }
+            batch.swap(remux->packets);
+        }
+        for (AVPacket *pkt : batch) {
+            int size = pkt->size;
+            RemuxWritePacket(player, remux, pkt);
+            av_packet_free(&pkt);
+            remux->queued--;
+            remux->queuedBytes -= size;
+            wrote = true;
+        }
+        batch.clear();
+        if (!recording) {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(remux->mutex);
+    RemuxCloseOutput(remux, true);
+    UpdateRecordResult(ffp, wrote ? OHOS_RECORD_CALLBACK_STATUS_SUCCESS : OHOS_RECORD_CALLBACK_STATUS_FAILED);
+    return wrote ? OHOS_RECORD_CALLBACK_STATUS_SUCCESS : OHOS_RECORD_CALLBACK_STATUS_FAILED;
+}
+
+void RecordRemuxDestroy(RecordWriteData *recData)
+{
+    RecordRemuxContext *remux = static_cast<RecordRemuxContext *>(recData->remux);
+    if (!remux) {
+        return;
+    }
+    RemuxDropPackets(remux->packets);
+    RemuxCloseOutput(remux, false);
+    delete remux;
+    recData->remux = nullptr;
+}
@@ -40,6 +40,13 @@ static const int MS_TO_S = 1000;
 static const int US_TO_S = 1000000;
 static const int NS_TO_US = 1000;
 static const int MIN_CALC_INTERVAL_TIME = 1000000; /* us */
+static const int AUDIO_RING_MIN_BUFFERS = 2;
+/* audio-low-latency */
+static const int LOW_LATENCY_BUFFERS = 8;
+static const int LOW_LATENCY_BUFLEN = 5;       /* ms */
+static const int LOW_LATENCY_RING_MS = 10;
+static const int LOW_LATENCY_CALC_INTERVAL_TIME = 20000; /* us */
+static const int64_t NO_PLAYED_BASE = INT64_MIN;
 
 static void AoutSetVolume(SDL_Aout *aout, float leftVolume, float rightVolume);
 
@@ -86,15 +93,32 @@ typedef struct SDL_Aout_Opaque {
     volatile int64_t framesWrittenNeedTime; // us
     volatile int64_t lastCalcTime; // us
     volatile int64_t writtenLen;
+    bool             lowLatency;
+    int64_t          playedBase; // us, played time is playedBase + av_gettime_relative(), NO_PLAYED_BASE until measured
 
     uint8_t       * buffer;
     size_t         buffer_capacity;
+
+    /*
+     * PCM ring, with ffp->audio_ring_ms: audio_tid runs spec.callback into it
+     * ahead of time and the renderer callback only copies out of it. The
+     * positions are byte counts, each advanced by one side only; ring_mutex
+     * and ring_cond are only taken when the worker has to sleep.
+     */
+    SDL_mutex     * ring_mutex;
+    SDL_cond      * ring_cond;
+    int             ring_size;      /* bytes in buffer, a multiple of bytes_per_buffer, 0 without ring */
+    int64_t         ring_write;     /* audio_tid */
+    int64_t         ring_read;      /* renderer callback */
+    int64_t         ring_flush;     /* ring_write at the last flush, the renderer callback skips up to it */
+    int64_t         ring_mark;      /* ring_read at the last start or flush, running short there is no underrun */
+    int             ring_waiting;
 } SDL_Aout_Opaque;
 
 static void AudioCalcFramesWrittenNeedTime(OH_AudioRenderer *renderer, SDL_Aout_Opaque *opaque)
 {
     int64_t nowTime = av_gettime_relative();
-    if (nowTime - opaque->lastCalcTime < MIN_CALC_INTERVAL_TIME) {
+    if (nowTime - opaque->lastCalcTime < (opaque->lowLatency ? LOW_LATENCY_CALC_INTERVAL_TIME : MIN_CALC_INTERVAL_TIME)) {
         return;
     }
     int64_t framePosition = 0;
@@ -107,11 +131,13 @@ static void AudioCalcFramesWrittenNeedTime(OH_AudioRenderer *renderer, SDL_Aout_
     nowTime = av_gettime_relative();
     if ((timestamp == 0) || (framePosition == 0)) {
         opaque->framesWrittenNeedTime = 0;
+        __atomic_store_n(&opaque->playedBase, NO_PLAYED_BASE, __ATOMIC_SEQ_CST);
         return;
     }
     int64_t deltaUs = nowTime - timestamp / NS_TO_US;
 
     int64_t audioPlayedTime = framePosition * US_TO_S / opaque->formatPcm.samplesRate;
+    __atomic_store_n(&opaque->playedBase, audioPlayedTime - timestamp / NS_TO_US, __ATOMIC_SEQ_CST);
 
     int64_t nowAudioPlayedTime = audioPlayedTime + deltaUs;
 
@@ -121,6 +147,86 @@ static void AudioCalcFramesWrittenNeedTime(OH_AudioRenderer *renderer, SDL_Aout_
     opaque->lastCalcTime = nowTime;
 }
 
+static bool AudioRingWritable(SDL_Aout_Opaque *opaque)
+{
+    int64_t used = opaque->ring_write - __atomic_load_n(&opaque->ring_read, __ATOMIC_SEQ_CST);
+    return !opaque->abort_request && !opaque->pause_on && used + opaque->bytes_per_buffer <= opaque->ring_size;
+}
+
+static void AudioRingWake(SDL_Aout_Opaque *opaque, bool force)
+{
+    if (!force && !__atomic_load_n(&opaque->ring_waiting, __ATOMIC_SEQ_CST)) {
+        return;
+    }
+    SDL_LockMutex(opaque->ring_mutex);
+    SDL_CondSignal(opaque->ring_cond);
+    SDL_UnlockMutex(opaque->ring_mutex);
+}
+
+static int AudioRingThread(void *arg)
+{
+    SDL_Aout_Opaque *opaque = (SDL_Aout_Opaque *)arg;
+
+    while (!opaque->abort_request) {
+        if (!AudioRingWritable(opaque)) {
+            SDL_LockMutex(opaque->ring_mutex);
+            __atomic_store_n(&opaque->ring_waiting, 1, __ATOMIC_SEQ_CST);
+            if (!AudioRingWritable(opaque) && !opaque->abort_request) {
+                SDL_CondWait(opaque->ring_cond, opaque->ring_mutex);
+            }
+            __atomic_store_n(&opaque->ring_waiting, 0, __ATOMIC_SEQ_CST);
+            SDL_UnlockMutex(opaque->ring_mutex);
+            continue;
+        }
+        // ring_size is a multiple of bytes_per_buffer, a chunk never wraps
+        opaque->spec.callback(opaque->spec.userdata, opaque->buffer + opaque->ring_write % opaque->ring_size,
+                              opaque->bytes_per_buffer);
+        __atomic_store_n(&opaque->ring_write, opaque->ring_write + opaque->bytes_per_buffer, __ATOMIC_SEQ_CST);
+    }
+    return 0;
+}
+
+static void AudioRingRead(SDL_Aout_Opaque *opaque, uint8_t *buffer, int32_t bufferLen)
+{
+    int64_t read = opaque->ring_read;
+    int64_t flush = __atomic_load_n(&opaque->ring_flush, __ATOMIC_SEQ_CST);
+    int64_t write = __atomic_load_n(&opaque->ring_write, __ATOMIC_SEQ_CST);
+    int32_t avail;
+    int32_t copied = 0;
+
+    if (flush > read) {
+        read = flush;
+    }
+    avail = (int32_t)FFMIN(write - read, (int64_t)bufferLen);
+    if (avail < bufferLen && read != __atomic_load_n(&opaque->ring_mark, __ATOMIC_SEQ_CST)) {
+        __atomic_add_fetch(&opaque->ffp->stat.audio_underruns, 1, __ATOMIC_RELAXED);
+    }
+    while (copied < avail) {
+        int offset = (int)(read % opaque->ring_size);
+        int len = FFMIN(avail - copied, opaque->ring_size - offset);
+        memcpy(buffer + copied, opaque->buffer + offset, len);
+        copied += len;
+        read += len;
+    }
+    if (copied < bufferLen) {
+        memset(buffer + copied, 0, bufferLen - copied);
+    }
+    __atomic_store_n(&opaque->ring_read, read, __ATOMIC_SEQ_CST);
+    AudioRingWake(opaque, false);
+}
+
+// 环形缓冲区中尚未被渲染器取走的字节数
+static int64_t AudioRingQueued(SDL_Aout_Opaque *opaque)
+{
+    if (opaque->ring_size <= 0) {
+        return 0;
+    }
+    int64_t queued = __atomic_load_n(&opaque->ring_write, __ATOMIC_SEQ_CST) -
+                     FFMAX(__atomic_load_n(&opaque->ring_read, __ATOMIC_SEQ_CST),
+                           __atomic_load_n(&opaque->ring_flush, __ATOMIC_SEQ_CST));
+    return FFMAX(queued, 0);
+}
+
 static int32_t AudioRendererOnWriteData(OH_AudioRenderer *renderer, void *userData, void *buffer, int32_t bufferLen)
 {
     SDL_Aout_Opaque *opaque = (SDL_Aout_Opaque*)userData;
@@ -132,9 +238,15 @@ static int32_t AudioRendererOnWriteData(OH_AudioRenderer *renderer, void *userDa
     if (audioCallback == NULL) {
         return 0;
     }
+    int64_t startTime = av_gettime_relative();
     AudioCalcFramesWrittenNeedTime(renderer, opaque);
-    audioCallback(opaque->spec.userdata, (uint8_t *)buffer, bufferLen);
+    if (opaque->audio_tid != NULL) {
+        AudioRingRead(opaque, (uint8_t *)buffer, bufferLen);
+    } else {
+        audioCallback(opaque->spec.userdata, (uint8_t *)buffer, bufferLen);
+    }
     opaque->writtenLen += bufferLen;
+    ffp_statistic_audio_callback(&opaque->ffp->stat, av_gettime_relative() - startTime);
     return 0;
 }
 
@@ -181,10 +293,31 @@ static double AoutGetLatencySeconds(SDL_Aout *aout)
         LOGE("audio->AoutOpenAudio opaque NULL");
         return 0;
     }
-    double  latency = (double)aout->opaque->framesWrittenNeedTime / US_TO_S;
+    SDL_Aout_Opaque *opaque = aout->opaque;
+    double  latency = (double)opaque->framesWrittenNeedTime / US_TO_S;
+    latency += (double)AudioRingQueued(opaque) / (opaque->formatPcm.samplesRate * opaque->bytes_per_frame);
     return latency;
 }
 
+// 低时延模式下由渲染器时间戳实测时延
+static int AoutGetMeasuredLatency(SDL_Aout *aout, double *latency, int64_t *timeUs)
+{
+    if ((aout == NULL) || (aout->opaque == NULL)) {
+        return -1;
+    }
+    SDL_Aout_Opaque *opaque = aout->opaque;
+    int64_t playedBase = __atomic_load_n(&opaque->playedBase, __ATOMIC_SEQ_CST);
+    if (!opaque->lowLatency || (playedBase == NO_PLAYED_BASE)) {
+        return -1;
+    }
+    int64_t nowTime = av_gettime_relative();
+    int64_t queuedLen = opaque->writtenLen + AudioRingQueued(opaque);
+    int64_t queuedTime = queuedLen * US_TO_S / (opaque->formatPcm.samplesRate * opaque->bytes_per_frame);
+    *latency = (double)FFMAX(queuedTime - (playedBase + nowTime), 0) / US_TO_S;
+    *timeUs = nowTime;
+    return 0;
+}
+
 static int32_t AudioRendererOnStreamEvent(OH_AudioRenderer *renderer, void *userData, OH_AudioStream_Event event)
 {
     LOGI("AudioRendererOnStreamEvent, event:%d", event);
@@ -195,8 +328,8 @@ static void AoutFillFormatPcm(OHDataFormatPcm *formatPcm, const SDL_AudioSpec *d
 {
     formatPcm->numChannels = desired->channels;
     formatPcm->samplesPerSec = desired->freq * MS_TO_S;
-    formatPcm->bitsPerSample = AUDIO_U16LSB;
-    formatPcm->containerSize = AUDIO_U16LSB;
+    formatPcm->bitsPerSample = SDL_AUDIO_BITSIZE(desired->format);
+    formatPcm->containerSize = SDL_AUDIO_BITSIZE(desired->format);
     formatPcm->samplesRate = desired->freq;
 }
 
@@ -210,13 +343,55 @@ static void AoutSetParams(SDL_Aout *aout, const SDL_AudioSpec *desired)
     // set params and callbacks
     OH_AudioStreamBuilder_SetSamplingRate(opaque->rendererBuilder, desired->freq);
     OH_AudioStreamBuilder_SetChannelCount(opaque->rendererBuilder, desired->channels);
-    OH_AudioStreamBuilder_SetSampleFormat(opaque->rendererBuilder, AUDIOSTREAM_SAMPLE_S16LE);
+    OH_AudioStreamBuilder_SetSampleFormat(opaque->rendererBuilder,
+        desired->format == AUDIO_F32LSB ? AUDIOSTREAM_SAMPLE_F32LE : AUDIOSTREAM_SAMPLE_S16LE);
     OH_AudioStreamBuilder_SetEncodingType(opaque->rendererBuilder, AUDIOSTREAM_ENCODING_TYPE_RAW);
-    OH_AudioStreamBuilder_SetLatencyMode(opaque->rendererBuilder, AUDIOSTREAM_LATENCY_MODE_NORMAL);
+    OH_AudioStreamBuilder_SetLatencyMode(opaque->rendererBuilder,
+        opaque->lowLatency ? AUDIOSTREAM_LATENCY_MODE_FAST : AUDIOSTREAM_LATENCY_MODE_NORMAL);
     // 关键参数，仅OHAudio支持，根据音频用途设置，系统会根据此参数实现音频策略自适应
     OH_AudioStreamBuilder_SetRendererInfo(opaque->rendererBuilder, AUDIOSTREAM_USAGE_MOVIE);
 }
 
+static void AudioRingStop(SDL_Aout_Opaque *opaque)
+{
+    if (opaque->audio_tid == NULL) {
+        return;
+    }
+    opaque->abort_request = true;
+    AudioRingWake(opaque, true);
+    SDL_WaitThread(opaque->audio_tid, NULL);
+    opaque->audio_tid = NULL;
+}
+
+// 在渲染器之前解码，渲染器回调只从环形缓冲区拷贝
+static void AudioRingStart(SDL_Aout_Opaque *opaque)
+{
+    int ringMs = opaque->lowLatency ? FFMIN(opaque->ffp->audio_ring_ms, LOW_LATENCY_RING_MS) : opaque->ffp->audio_ring_ms;
+    int buffers = FFMAX(ringMs / opaque->milli_per_buffer, AUDIO_RING_MIN_BUFFERS);
+
+    free(opaque->buffer);
+    opaque->buffer = NULL;
+    opaque->ring_size = 0;
+    opaque->ring_write = 0;
+    opaque->ring_read = 0;
+    opaque->ring_flush = 0;
+    opaque->ring_mark = 0;
+    if (ringMs <= 0 || opaque->bytes_per_buffer <= 0) {
+        return;
+    }
+    opaque->buffer = (uint8_t *)malloc((size_t)buffers * opaque->bytes_per_buffer);
+    if (opaque->buffer == NULL) {
+        LOGE("audio->AudioRingStart out of memory, callback decodes instead");
+        return;
+    }
+    opaque->ring_size = buffers * opaque->bytes_per_buffer;
+    opaque->audio_tid = SDL_CreateThreadEx(&opaque->_audio_tid, AudioRingThread, opaque, "ff_aout_ring");
+    if (opaque->audio_tid == NULL) {
+        LOGE("audio->AudioRingStart thread failed, callback decodes instead");
+        opaque->ring_size = 0;
+    }
+}
+
 // 音频渲染器初始化
 static int AoutOpenAudio(SDL_Aout *aout, const SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 {
@@ -227,6 +402,7 @@ static int AoutOpenAudio(SDL_Aout *aout, const SDL_AudioSpec *desired, SDL_Audio
         return -1;
     }
     SDL_Aout_Opaque *opaque = aout->opaque;
+    AudioRingStop(opaque);
     if (opaque->audioRendererNormal != NULL) {
         OH_AudioRenderer_Release(opaque->audioRendererNormal);
         OH_AudioStreamBuilder_Destroy(opaque->rendererBuilder);
@@ -239,6 +415,7 @@ static int AoutOpenAudio(SDL_Aout *aout, const SDL_AudioSpec *desired, SDL_Audio
     opaque->spec = *desired;
 
     AoutFillFormatPcm(formatPcm, desired);
+    opaque->lowLatency = opaque->ffp->audio_low_latency != 0;
 
     // create builder
     OH_AudioStreamBuilder_Create(&opaque->rendererBuilder, AUDIOSTREAM_TYPE_RENDERER);
@@ -250,14 +427,19 @@ static int AoutOpenAudio(SDL_Aout *aout, const SDL_AudioSpec *desired, SDL_Audio
     OH_AudioRenderer_Callbacks rendererCallbacks;
 
     opaque->bytes_per_frame = formatPcm->numChannels * formatPcm->bitsPerSample / AUDIO_U8;
-    opaque->milli_per_buffer = OPENSLES_BUFLEN;
+    opaque->milli_per_buffer = opaque->lowLatency ? LOW_LATENCY_BUFLEN : OPENSLES_BUFLEN;
     opaque->frames_per_buffer =
         opaque->milli_per_buffer * formatPcm->samplesPerSec / US_TO_S; // samplesPerSec is in milli
     opaque->bytes_per_buffer = opaque->bytes_per_frame * opaque->frames_per_buffer;
-    opaque->buffer_capacity = OPENSLES_BUFFERS * opaque->bytes_per_buffer;
+    opaque->buffer_capacity = (opaque->lowLatency ? LOW_LATENCY_BUFFERS : OPENSLES_BUFFERS) * opaque->bytes_per_buffer;
     opaque->pause_on = true;
     opaque->abort_request = false;
     opaque->writtenLen = 0;
+    opaque->playedBase = NO_PLAYED_BASE;
+    if (opaque->lowLatency) {
+        // 低时延模式下每次回调只取一个短周期的数据
+        OH_AudioStreamBuilder_SetFrameSizeInCallback(opaque->rendererBuilder, opaque->frames_per_buffer);
+    }
 
     rendererCallbacks.OH_AudioRenderer_OnWriteData = AudioRendererOnWriteData; // 看下数据写入OnWriteData
     rendererCallbacks.OH_AudioRenderer_OnStreamEvent = AudioRendererOnStreamEvent;  // 自定义音频流事件函数
@@ -275,6 +457,7 @@ static int AoutOpenAudio(SDL_Aout *aout, const SDL_AudioSpec *desired, SDL_Audio
     OH_AudioStreamBuilder_GenerateRenderer(opaque->rendererBuilder, &opaque->audioRendererNormal);
     // 设置音频流音量
     AoutSetVolume(aout, aout->opaque->left_volume, aout->opaque->right_volume);
+    AudioRingStart(opaque);
     
     if (obtained != NULL) {
         *obtained = *desired;
@@ -303,6 +486,11 @@ static void AoutPauseAudio(SDL_Aout *aout, int pauseOn)
     } else {
         aout->opaque->framesWrittenNeedTime = 0;
         aout->opaque->lastCalcTime = av_gettime_relative();
+        __atomic_store_n(&opaque->playedBase, NO_PLAYED_BASE, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&opaque->ring_mark, __atomic_load_n(&opaque->ring_read, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+        if (opaque->audio_tid != NULL) {
+            AudioRingWake(opaque, true);
+        }
         OH_AudioRenderer_Start(opaque->audioRendererNormal);
     }
     return;
@@ -321,6 +509,7 @@ static void AudioRendererStop(SDL_Aout *aout)
     }
     opaque->abort_request = true;
     OH_AudioRenderer_Stop(opaque->audioRendererNormal);
+    AudioRingStop(opaque);
 }
 
 static void AudioRendererFlush(SDL_Aout *aout)
@@ -336,10 +525,17 @@ static void AudioRendererFlush(SDL_Aout *aout)
         return;
     }
     OH_AudioRenderer_Flush(opaque->audioRendererNormal); // 丢弃已经写入的音频数据
+    if (opaque->ring_size > 0) {
+        // 环形缓冲区由渲染器回调在下次读取时跳过
+        int64_t write = __atomic_load_n(&opaque->ring_write, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&opaque->ring_mark, write, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&opaque->ring_flush, write, __ATOMIC_SEQ_CST);
+    }
     // 清除音频时延所有参数
     opaque->writtenLen = 0;
     opaque->framesWrittenNeedTime = 0;
     opaque->lastCalcTime = av_gettime_relative();
+    __atomic_store_n(&opaque->playedBase, NO_PLAYED_BASE, __ATOMIC_SEQ_CST);
 }
 
 static void AudioRendererRelease(SDL_Aout *aout)
@@ -355,6 +551,9 @@ static void AudioRendererRelease(SDL_Aout *aout)
         OH_AudioRenderer_Release(opaque->audioRendererNormal);
         opaque->audioRendererNormal = NULL;
     }
+    free(opaque->buffer);
+    SDL_DestroyCond(opaque->ring_cond);
+    SDL_DestroyMutex(opaque->ring_mutex);
     SDL_Aout_FreeInternal(aout);
 }
 
@@ -385,6 +584,14 @@ SDL_Aout *SDLAoutCreateForOpenSLES(FFPlayer *ffp) // 实现音频播放功能；
 
     SDL_Aout_Opaque *opaque = aout->opaque;
     opaque->ffp = ffp;
+    opaque->ring_mutex = SDL_CreateMutex();
+    opaque->ring_cond = SDL_CreateCond();
+    if ((opaque->ring_mutex == NULL) || (opaque->ring_cond == NULL)) {
+        SDL_DestroyCond(opaque->ring_cond);
+        SDL_DestroyMutex(opaque->ring_mutex);
+        SDL_Aout_FreeInternal(aout);
+        return NULL;
+    }
 
     aout->free_l = AudioRendererRelease;
     aout->opaque_class = &g_opensles_class;
@@ -395,6 +602,7 @@ SDL_Aout *SDLAoutCreateForOpenSLES(FFPlayer *ffp) // 实现音频播放功能；
     aout->close_audio = AudioRendererStop; // 关闭音频
     aout->set_volume = AoutSetVolume;       // 设置音量
     aout->func_get_latency_seconds = AoutGetLatencySeconds;
+    aout->func_get_measured_latency = AoutGetMeasuredLatency;
 
     return aout;
 }
@@ -174,6 +174,7 @@ static int func_fill_frame(SDL_VoutOverlay *overlay, const AVFrame *frame)
 
     int need_swap_uv = 0;
     int use_linked_frame = 0;
+    int copy_frame = 0;
     enum AVPixelFormat dst_format = AV_PIX_FMT_NONE;
     switch (overlay->format) {
         case SDL_FCC_YV12:
@@ -199,6 +200,17 @@ static int func_fill_frame(SDL_VoutOverlay *overlay, const AVFrame *frame)
                 dst_format = AV_PIX_FMT_YUV444P10LE;
             }
             break;
+        case SDL_FCC_NV12:
+        case SDL_FCC_NV21:
+            dst_format = overlay->format == SDL_FCC_NV12 ? AV_PIX_FMT_NV12 : AV_PIX_FMT_NV21;
+            if (frame->format == dst_format) {
+                // hardware decoder planes are only borrowed until the frame is queued, copy them
+                if (frame->buf[0])
+                    use_linked_frame = 1;
+                else
+                    copy_frame = 1;
+            }
+            break;
         case SDL_FCC_RV32:
             dst_format = AV_PIX_FMT_0BGR32;
             break;
@@ -259,6 +271,10 @@ static int func_fill_frame(SDL_VoutOverlay *overlay, const AVFrame *frame)
      */
     if (use_linked_frame) {
         // do nothing
+    } else if (copy_frame) {
+        av_image_copy(swscale_dst_pic.data, swscale_dst_pic.linesize,
+                      (const uint8_t **) frame->data, frame->linesize,
+                      frame->format, frame->width, frame->height);
     } else if (ijk_image_convert(frame->width, frame->height,
                                  dst_format, swscale_dst_pic.data, swscale_dst_pic.linesize,
                                  frame->format, (const uint8_t**) frame->data, frame->linesize)) {
@@ -297,6 +313,12 @@ SDL_VoutOverlay *SDL_VoutFFmpeg_CreateOverlay(int width, int height, int frame_f
                 case AV_PIX_FMT_YUV444P10LE:
                     overlay_format = SDL_FCC_I444P10LE;
                     break;
+                case AV_PIX_FMT_NV12:
+                    overlay_format = SDL_FCC_NV12;
+                    break;
+                case AV_PIX_FMT_NV21:
+                    overlay_format = SDL_FCC_NV21;
+                    break;
                 case AV_PIX_FMT_YUV420P:
                 case AV_PIX_FMT_YUVJ420P:
                 default:
@@ -374,6 +396,13 @@ SDL_VoutOverlay *SDL_VoutFFmpeg_CreateOverlay(int width, int height, int frame_f
         opaque->planes = 3;
         break;
     }
+    case SDL_FCC_NV12:
+    case SDL_FCC_NV21: {
+        ff_format = overlay_format == SDL_FCC_NV12 ? AV_PIX_FMT_NV12 : AV_PIX_FMT_NV21;
+        buf_width = IJKALIGN(width, 16); // 1 bytes per pixel for Y-plane, 2 per UV pair
+        opaque->planes = 2;
+        break;
+    }
     case SDL_FCC_RV16: {
         ff_format = AV_PIX_FMT_RGB565;
         buf_width = IJKALIGN(width, 8); // 2 bytes per pixel
@@ -114,6 +114,16 @@ void SDL_AoutSetPlaybackVolume(SDL_Aout *aout, float volume)
     }
 }
 
+int SDL_AoutGetMeasuredLatency(SDL_Aout *aout, double *latency_seconds, int64_t *time_us)
+{
+    if (aout) {
+        if (aout->func_get_measured_latency) {
+            return aout->func_get_measured_latency(aout, latency_seconds, time_us);
+        }
+    }
+    return -1;
+}
+
 int SDL_AoutGetAudioSessionId(SDL_Aout *aout)
 {
     if (aout) {
@@ -52,6 +52,7 @@ struct SDL_Aout {
     void   (*func_set_playback_rate)(SDL_Aout *aout, float playbackRate);
     void   (*func_set_playback_volume)(SDL_Aout *aout, float playbackVolume);
     int    (*func_get_audio_persecond_callbacks)(SDL_Aout *aout);
+    int    (*func_get_measured_latency)(SDL_Aout *aout, double *latency, int64_t *time_us);
 
     // Android only
     int    (*func_get_audio_session_id)(SDL_Aout *aout);
@@ -72,6 +73,11 @@ int    SDL_AoutGetAudioPerSecondCallBacks(SDL_Aout *aout);
 // optional
 void   SDL_AoutSetPlaybackRate(SDL_Aout *aout, float playbackRate);
 void   SDL_AoutSetPlaybackVolume(SDL_Aout *aout, float volume);
+/*
+ * latency measured by the output and the av_gettime_relative() it holds at, -1 without a measurement;
+ * it covers what the output was handed, not the buffer a running audio callback is filling
+ */
+int    SDL_AoutGetMeasuredLatency(SDL_Aout *aout, double *latency_seconds, int64_t *time_us);
 
 // android only
 int    SDL_AoutGetAudioSessionId(SDL_Aout *aout);
@@ -417,6 +417,19 @@ EGLBoolean IJK_EGL_display(IJK_EGL* egl, EGLNativeWindowType window, SDL_VoutOve
     return ret;
 }
 
+EGLBoolean IJK_EGL_warmUp(IJK_EGL* egl, EGLNativeWindowType window)
+{
+    if (!egl || !egl->opaque)
+        return EGL_FALSE;
+
+    if (!IJK_EGL_makeCurrent(egl, window))
+        return EGL_FALSE;
+
+    eglMakeCurrent(egl->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglReleaseThread();
+    return EGL_TRUE;
+}
+
 void IJK_EGL_releaseWindow(IJK_EGL* egl)
 {
     if (!egl || !egl->opaque || !egl->opaque->renderer)
@@ -61,6 +61,8 @@ void        IJK_EGL_free(IJK_EGL *egl);
 void        IJK_EGL_freep(IJK_EGL **egl);
 
 EGLBoolean  IJK_EGL_display(IJK_EGL* egl, EGLNativeWindowType window, SDL_VoutOverlay *overlay);
+/* create display, surface and context for window ahead of the first IJK_EGL_display() */
+EGLBoolean  IJK_EGL_warmUp(IJK_EGL* egl, EGLNativeWindowType window);
 void        IJK_EGL_terminate(IJK_EGL* egl);
 
 #endif
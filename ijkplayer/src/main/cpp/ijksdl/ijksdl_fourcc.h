@@ -57,6 +57,7 @@
 #define SDL_FCC_YVYU    SDL_FOURCC('Y', 'V', 'Y', 'U')  /**< bpp=16, Packed mode: Y0+V0+Y1+U0 (1 plane) */
 
 #define SDL_FCC_NV12    SDL_FOURCC('N', 'V', '1', '2')
+#define SDL_FCC_NV21    SDL_FOURCC('N', 'V', '2', '1')
 
 // RGB formats
 #define SDL_FCC_RV16    SDL_FOURCC('R', 'V', '1', '6')    /**< bpp=16, RGB565 */
@@ -58,6 +58,14 @@ int SDL_VoutDisplayYUVOverlay(SDL_Vout *vout, SDL_VoutOverlay *overlay)
     return -1;
 }
 
+int SDL_VoutWarmUp(SDL_Vout *vout)
+{
+    if (vout && vout->warm_up)
+        return vout->warm_up(vout);
+
+    return -1;
+}
+
 int SDL_VoutSetOverlayFormat(SDL_Vout *vout, Uint32 overlay_format)
 {
     if (!vout)
@@ -67,6 +67,7 @@ struct SDL_Vout {
     SDL_VoutOverlay *(*create_overlay)(int width, int height, int frame_format, SDL_Vout *vout);
     void (*free_l)(SDL_Vout *vout);
     int (*display_overlay)(SDL_Vout *vout, SDL_VoutOverlay *overlay);
+    int (*warm_up)(SDL_Vout *vout);
 
     Uint32 overlay_format;
 };
@@ -74,6 +75,8 @@ struct SDL_Vout {
 void SDL_VoutFree(SDL_Vout *vout);
 void SDL_VoutFreeP(SDL_Vout **pvout);
 int  SDL_VoutDisplayYUVOverlay(SDL_Vout *vout, SDL_VoutOverlay *overlay);
+/* set up what the first display needs before there is a frame, -1 when the vout can't yet */
+int  SDL_VoutWarmUp(SDL_Vout *vout);
 int  SDL_VoutSetOverlayFormat(SDL_Vout *vout, Uint32 overlay_format);
 
 SDL_VoutOverlay *SDL_Vout_CreateOverlay(int width, int height, int frame_format, SDL_Vout *vout);
@@ -40,7 +40,56 @@ static const char g_shader[] = IJK_GLES_STRING(
     }
 );
 
+/* GLES3 without GL_RG_EXT: chroma is uploaded as GL_LUMINANCE_ALPHA, U in .r, V in .a */
+static const char g_shader_nv12[] = IJK_GLES_STRING(
+    precision highp float;
+    varying   highp vec2 vv2_Texcoord;
+    uniform         mat3 um3_ColorConversion;
+    uniform   lowp  sampler2D us2_SamplerX;
+    uniform   lowp  sampler2D us2_SamplerY;
+
+    void main()
+    {
+        mediump vec3 yuv;
+        lowp    vec3 rgb;
+
+        yuv.x  = (texture2D(us2_SamplerX,  vv2_Texcoord).r  - (16.0 / 255.0));
+        yuv.yz = (texture2D(us2_SamplerY,  vv2_Texcoord).ra - vec2(0.5, 0.5));
+        rgb = um3_ColorConversion * yuv;
+        gl_FragColor = vec4(rgb, 1);
+    }
+);
+
+static const char g_shader_nv21[] = IJK_GLES_STRING(
+    precision highp float;
+    varying   highp vec2 vv2_Texcoord;
+    uniform         mat3 um3_ColorConversion;
+    uniform   lowp  sampler2D us2_SamplerX;
+    uniform   lowp  sampler2D us2_SamplerY;
+
+    void main()
+    {
+        mediump vec3 yuv;
+        lowp    vec3 rgb;
+
+        yuv.x  = (texture2D(us2_SamplerX,  vv2_Texcoord).r  - (16.0 / 255.0));
+        yuv.yz = (texture2D(us2_SamplerY,  vv2_Texcoord).ar - vec2(0.5, 0.5));
+        rgb = um3_ColorConversion * yuv;
+        gl_FragColor = vec4(rgb, 1);
+    }
+);
+
 const char *IJK_GLES2_getFragmentShader_yuv420sp()
 {
     return g_shader;
 }
+
+const char *IJK_GLES2_getFragmentShader_yuv420sp_nv12()
+{
+    return g_shader_nv12;
+}
+
+const char *IJK_GLES2_getFragmentShader_yuv420sp_nv21()
+{
+    return g_shader_nv21;
+}
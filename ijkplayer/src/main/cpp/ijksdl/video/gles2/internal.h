@@ -86,6 +86,8 @@ const char *IJK_GLES2_getVertexShader_default();
 const char *IJK_GLES2_getFragmentShader_yuv420p();
 const char *IJK_GLES2_getFragmentShader_yuv444p10le();
 const char *IJK_GLES2_getFragmentShader_yuv420sp();
+const char *IJK_GLES2_getFragmentShader_yuv420sp_nv12();
+const char *IJK_GLES2_getFragmentShader_yuv420sp_nv21();
 const char *IJK_GLES2_getFragmentShader_rgb();
 
 const GLfloat *IJK_GLES2_getColorMatrix_bt709();
@@ -95,6 +97,7 @@ IJK_GLES2_Renderer *IJK_GLES2_Renderer_create_base(const char *fragment_shader_s
 IJK_GLES2_Renderer *IJK_GLES2_Renderer_create_yuv420p();
 IJK_GLES2_Renderer *IJK_GLES2_Renderer_create_yuv444p10le();
 IJK_GLES2_Renderer *IJK_GLES2_Renderer_create_yuv420sp();
+IJK_GLES2_Renderer *IJK_GLES2_Renderer_create_yuv420sp_nv21();
 IJK_GLES2_Renderer *IJK_GLES2_Renderer_create_yuv420sp_vtb(SDL_VoutOverlay *overlay);
 IJK_GLES2_Renderer *IJK_GLES2_Renderer_create_rgb565();
 IJK_GLES2_Renderer *IJK_GLES2_Renderer_create_rgb888();
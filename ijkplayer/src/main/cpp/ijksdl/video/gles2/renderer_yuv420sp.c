@@ -67,11 +67,18 @@ static GLboolean yuv420sp_uploadTexture(IJK_GLES2_Renderer *renderer, SDL_VoutOv
         return GL_FALSE;
 
     const GLsizei widths[2]    = { overlay->pitches[0], overlay->pitches[1] / 2 };
-    const GLsizei heights[2]   = { overlay->h,          overlay->h / 2 };
+    const GLsizei heights[2]   = { overlay->h,          (overlay->h + 1) / 2 };
     const GLubyte *pixels[2]   = { overlay->pixels[0],  overlay->pixels[1] };
+#ifdef __APPLE__
+    const GLenum formats[2]    = { GL_RED_EXT,          GL_RG_EXT };
+#else
+    const GLenum formats[2]    = { GL_LUMINANCE,        GL_LUMINANCE_ALPHA };
+#endif
 
     switch (overlay->format) {
         case SDL_FCC__VTB:
+        case SDL_FCC_NV12:
+        case SDL_FCC_NV21:
             break;
         default:
             ALOGE("[yuv420sp] unexpected format %x\n", overlay->format);
@@ -81,31 +88,31 @@ static GLboolean yuv420sp_uploadTexture(IJK_GLES2_Renderer *renderer, SDL_VoutOv
     glBindTexture(GL_TEXTURE_2D, renderer->plane_textures[0]);
     glTexImage2D(GL_TEXTURE_2D,
                  0,
-                 GL_RED_EXT,
+                 formats[0],
                  widths[0],
                  heights[0],
                  0,
-                 GL_RED_EXT,
+                 formats[0],
                  GL_UNSIGNED_BYTE,
                  pixels[0]);
 
     glBindTexture(GL_TEXTURE_2D, renderer->plane_textures[1]);
     glTexImage2D(GL_TEXTURE_2D,
                  0,
-                 GL_RG_EXT,
+                 formats[1],
                  widths[1],
                  heights[1],
                  0,
-                 GL_RG_EXT,
+                 formats[1],
                  GL_UNSIGNED_BYTE,
                  pixels[1]);
 
     return GL_TRUE;
 }
 
-IJK_GLES2_Renderer *IJK_GLES2_Renderer_create_yuv420sp()
+static IJK_GLES2_Renderer *yuv420sp_create(const char *fragment_shader_source)
 {
-    IJK_GLES2_Renderer *renderer = IJK_GLES2_Renderer_create_base(IJK_GLES2_getFragmentShader_yuv420sp());
+    IJK_GLES2_Renderer *renderer = IJK_GLES2_Renderer_create_base(fragment_shader_source);
     if (!renderer)
         goto fail;
 
@@ -123,3 +130,17 @@ fail:
     IJK_GLES2_Renderer_free(renderer);
     return NULL;
 }
+
+IJK_GLES2_Renderer *IJK_GLES2_Renderer_create_yuv420sp()
+{
+#ifdef __APPLE__
+    return yuv420sp_create(IJK_GLES2_getFragmentShader_yuv420sp());
+#else
+    return yuv420sp_create(IJK_GLES2_getFragmentShader_yuv420sp_nv12());
+#endif
+}
+
+IJK_GLES2_Renderer *IJK_GLES2_Renderer_create_yuv420sp_nv21()
+{
+    return yuv420sp_create(IJK_GLES2_getFragmentShader_yuv420sp_nv21());
+}
@@ -131,6 +131,8 @@ static int func_display_overlay_l(SDL_Vout * vout, SDL_VoutOverlay * overlay)
         }
         case SDL_FCC_RV24:
         case SDL_FCC_I420:
+        case SDL_FCC_NV12:
+        case SDL_FCC_NV21:
         case SDL_FCC_I444P10LE: {
             // only GLES support
             if (opaque->egl)
@@ -161,6 +163,18 @@ static int func_display_overlay(SDL_Vout * vout, SDL_VoutOverlay * overlay)
     return retval;
 }
 
+static int func_warm_up(SDL_Vout * vout)
+{
+    SDL_Vout_Opaque * opaque = vout->opaque;
+    int retval = -1;
+
+    SDL_LockMutex(vout->mutex);
+    if (opaque->native_window && opaque->egl && IJK_EGL_warmUp(opaque->egl, opaque->native_window))
+        retval = 0;
+    SDL_UnlockMutex(vout->mutex);
+    return retval;
+}
+
 static SDL_Class g_nativewindow_class = {
     .name = "ANativeWindow_Vout",
 };
@@ -186,6 +200,7 @@ SDL_Vout * SDL_VoutAndroid_CreateForANativeWindow()
     vout->create_overlay = func_create_overlay;
     vout->free_l = func_free_l;
     vout->display_overlay = func_display_overlay;
+    vout->warm_up = func_warm_up;
     return vout;
     fail:
     func_free_l(vout);
@@ -694,18 +694,22 @@ napi_value IJKPlayerNapi::JsConstructor(napi_env env, napi_callback_info info) {
 napi_value IJKPlayerNapi::startRecord(napi_env env, napi_callback_info info)
 {
     LOGI("napi-->startRecord");
-    size_t argc = PARAM_COUNT_2;
-    napi_value args[PARAM_COUNT_2] = {nullptr};
+    size_t argc = PARAM_COUNT_3;
+    napi_value args[PARAM_COUNT_3] = {nullptr};
     napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
     std::string xcomponentId;
     NapiUtil::JsValueToString(env, args[INDEX_0], STR_DEFAULT_SIZE, xcomponentId);
     std::string filePath;
     NapiUtil::JsValueToString(env, args[INDEX_1], STR_DEFAULT_SIZE, filePath);
+    std::string mode;
+    if (argc > INDEX_2) {
+        NapiUtil::JsValueToString(env, args[INDEX_2], STR_DEFAULT_SIZE, mode);
+    }
     if (xcomponentId == "") {
         xcomponentId = IJKPlayerNapi::getXComponentId(env, info);
     }
     int result = IJKPlayerNapi::getInstance(xcomponentId)->ijkPlayerNapiProxy_
-    ->IjkMediaPlayer_startRecord(filePath.c_str());
+    ->IjkMediaPlayer_startRecord(filePath.c_str(), mode.empty() ? 0 : NapiUtil::StringToInt(mode));
     return NapiUtil::SetNapiCallInt32(env, result);
 }
 
@@ -766,6 +770,130 @@ napi_value IJKPlayerNapi::isRecord(napi_env env, napi_callback_info info)
     return NapiUtil::SetNapiCallInt32(env, result);
 }
 
+napi_value IJKPlayerNapi::startClipExport(napi_env env, napi_callback_info info)
+{
+    LOGI("napi-->startClipExport");
+    size_t argc = PARAM_COUNT_4;
+    napi_value args[PARAM_COUNT_4] = {nullptr};
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    std::string xcomponentId;
+    NapiUtil::JsValueToString(env, args[INDEX_0], STR_DEFAULT_SIZE, xcomponentId);
+    std::string filePath;
+    NapiUtil::JsValueToString(env, args[INDEX_1], STR_DEFAULT_SIZE, filePath);
+    std::string startMs;
+    NapiUtil::JsValueToString(env, args[INDEX_2], STR_DEFAULT_SIZE, startMs);
+    std::string endMs;
+    NapiUtil::JsValueToString(env, args[INDEX_3], STR_DEFAULT_SIZE, endMs);
+    if (xcomponentId == "") {
+        xcomponentId = IJKPlayerNapi::getXComponentId(env, info);
+    }
+    int result = IJKPlayerNapi::getInstance(xcomponentId)->ijkPlayerNapiProxy_->IjkMediaPlayer_startClipExport(
+        filePath.c_str(), NapiUtil::StringToLong(startMs), NapiUtil::StringToLong(endMs));
+    return NapiUtil::SetNapiCallInt32(env, result);
+}
+
+napi_value IJKPlayerNapi::cancelClipExport(napi_env env, napi_callback_info info)
+{
+    LOGI("napi-->cancelClipExport");
+    size_t argc = PARAM_COUNT_1;
+    napi_value args[PARAM_COUNT_1] = {nullptr};
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    std::string xcomponentId;
+    NapiUtil::JsValueToString(env, args[INDEX_0], STR_DEFAULT_SIZE, xcomponentId);
+    if (xcomponentId == "") {
+        xcomponentId = IJKPlayerNapi::getXComponentId(env, info);
+    }
+    IJKPlayerNapi::getInstance(xcomponentId)->ijkPlayerNapiProxy_->IjkMediaPlayer_cancelClipExport();
+    return nullptr;
+}
+
+napi_value IJKPlayerNapi::setScrubMode(napi_env env, napi_callback_info info)
+{
+    LOGI("napi-->setScrubMode");
+    size_t argc = PARAM_COUNT_2;
+    napi_value args[PARAM_COUNT_2] = {nullptr};
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    std::string xcomponentId;
+    NapiUtil::JsValueToString(env, args[INDEX_0], STR_DEFAULT_SIZE, xcomponentId);
+    std::string enable;
+    NapiUtil::JsValueToString(env, args[INDEX_1], STR_DEFAULT_SIZE, enable);
+    if (xcomponentId == "") {
+        xcomponentId = IJKPlayerNapi::getXComponentId(env, info);
+    }
+    int result = IJKPlayerNapi::getInstance(xcomponentId)->ijkPlayerNapiProxy_->IjkMediaPlayer_setScrubMode(
+        NapiUtil::StringToInt(enable));
+    return NapiUtil::SetNapiCallInt32(env, result);
+}
+
+napi_value IJKPlayerNapi::setTrickPlayRate(napi_env env, napi_callback_info info)
+{
+    LOGI("napi-->setTrickPlayRate");
+    size_t argc = PARAM_COUNT_2;
+    napi_value args[PARAM_COUNT_2] = {nullptr};
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    std::string xcomponentId;
+    NapiUtil::JsValueToString(env, args[INDEX_0], STR_DEFAULT_SIZE, xcomponentId);
+    std::string rate;
+    NapiUtil::JsValueToString(env, args[INDEX_1], STR_DEFAULT_SIZE, rate);
+    if (xcomponentId == "") {
+        xcomponentId = IJKPlayerNapi::getXComponentId(env, info);
+    }
+    int result = IJKPlayerNapi::getInstance(xcomponentId)->ijkPlayerNapiProxy_->IjkMediaPlayer_setTrickPlayRate(
+        NapiUtil::StringToFloat(rate));
+    return NapiUtil::SetNapiCallInt32(env, result);
+}
+
+napi_value IJKPlayerNapi::stepBackward(napi_env env, napi_callback_info info)
+{
+    LOGI("napi-->stepBackward");
+    size_t argc = PARAM_COUNT_1;
+    napi_value args[PARAM_COUNT_1] = {nullptr};
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    std::string xcomponentId;
+    NapiUtil::JsValueToString(env, args[INDEX_0], STR_DEFAULT_SIZE, xcomponentId);
+    if (xcomponentId == "") {
+        xcomponentId = IJKPlayerNapi::getXComponentId(env, info);
+    }
+    int result = IJKPlayerNapi::getInstance(xcomponentId)->ijkPlayerNapiProxy_->IjkMediaPlayer_stepBackward();
+    return NapiUtil::SetNapiCallInt32(env, result);
+}
+
+napi_value IJKPlayerNapi::setReversePlayback(napi_env env, napi_callback_info info)
+{
+    LOGI("napi-->setReversePlayback");
+    size_t argc = PARAM_COUNT_2;
+    napi_value args[PARAM_COUNT_2] = {nullptr};
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    std::string xcomponentId;
+    NapiUtil::JsValueToString(env, args[INDEX_0], STR_DEFAULT_SIZE, xcomponentId);
+    std::string enable;
+    NapiUtil::JsValueToString(env, args[INDEX_1], STR_DEFAULT_SIZE, enable);
+    if (xcomponentId == "") {
+        xcomponentId = IJKPlayerNapi::getXComponentId(env, info);
+    }
+    int result = IJKPlayerNapi::getInstance(xcomponentId)->ijkPlayerNapiProxy_->IjkMediaPlayer_setReversePlayback(
+        NapiUtil::StringToInt(enable));
+    return NapiUtil::SetNapiCallInt32(env, result);
+}
+
+napi_value IJKPlayerNapi::setNextDataSource(napi_env env, napi_callback_info info)
+{
+    LOGI("napi-->setNextDataSource");
+    size_t argc = PARAM_COUNT_2;
+    napi_value args[PARAM_COUNT_2] = {nullptr};
+    napi_get_cb_info(env, info, &argc, args, nullptr, nullptr);
+    std::string xcomponentId;
+    NapiUtil::JsValueToString(env, args[INDEX_0], STR_DEFAULT_SIZE, xcomponentId);
+    std::string url;
+    NapiUtil::JsValueToString(env, args[INDEX_1], STR_DEFAULT_SIZE, url);
+    if (xcomponentId == "") {
+        xcomponentId = IJKPlayerNapi::getXComponentId(env, info);
+    }
+    int result = IJKPlayerNapi::getInstance(xcomponentId)->ijkPlayerNapiProxy_->IjkMediaPlayer_setNextDataSource(
+        url.c_str());
+    return NapiUtil::SetNapiCallInt32(env, result);
+}
+
 napi_value IJKPlayerNapi::getCurrentFrame(napi_env env, napi_callback_info info)
 {
     LOGI("napi-->getCurrentFrame");
@@ -1010,6 +1138,13 @@ napi_value IJKPlayerNapi::Export(napi_env env, napi_value exports) {
         DECLARE_NAPI_FUNCTION("_startRecord", IJKPlayerNapi::startRecord),
         DECLARE_NAPI_FUNCTION("_stopRecord", IJKPlayerNapi::stopRecord),
         DECLARE_NAPI_FUNCTION("_isRecord", IJKPlayerNapi::isRecord),
+        DECLARE_NAPI_FUNCTION("_startClipExport", IJKPlayerNapi::startClipExport),
+        DECLARE_NAPI_FUNCTION("_cancelClipExport", IJKPlayerNapi::cancelClipExport),
+        DECLARE_NAPI_FUNCTION("_setScrubMode", IJKPlayerNapi::setScrubMode),
+        DECLARE_NAPI_FUNCTION("_setTrickPlayRate", IJKPlayerNapi::setTrickPlayRate),
+        DECLARE_NAPI_FUNCTION("_stepBackward", IJKPlayerNapi::stepBackward),
+        DECLARE_NAPI_FUNCTION("_setReversePlayback", IJKPlayerNapi::setReversePlayback),
+        DECLARE_NAPI_FUNCTION("_setNextDataSource", IJKPlayerNapi::setNextDataSource),
         DECLARE_NAPI_FUNCTION("_getCurrentFrame", IJKPlayerNapi::getCurrentFrame),
     };
     NAPI_CALL(env, napi_define_properties(env, exports, sizeof(desc) / sizeof(desc[0]), desc));
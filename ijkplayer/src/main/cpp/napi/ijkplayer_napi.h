@@ -61,6 +61,13 @@ class IJKPlayerNapi {
     static napi_value startRecord(napi_env env, napi_callback_info info);
     static napi_value stopRecord(napi_env env, napi_callback_info info);
     static napi_value isRecord(napi_env env, napi_callback_info info);
+    static napi_value startClipExport(napi_env env, napi_callback_info info);
+    static napi_value cancelClipExport(napi_env env, napi_callback_info info);
+    static napi_value setScrubMode(napi_env env, napi_callback_info info);
+    static napi_value setTrickPlayRate(napi_env env, napi_callback_info info);
+    static napi_value stepBackward(napi_env env, napi_callback_info info);
+    static napi_value setReversePlayback(napi_env env, napi_callback_info info);
+    static napi_value setNextDataSource(napi_env env, napi_callback_info info);
     static napi_value getCurrentFrame(napi_env env, napi_callback_info info);
 
     ////////////////////////XComponent////////////////////////////
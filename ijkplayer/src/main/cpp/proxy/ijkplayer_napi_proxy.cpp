@@ -154,6 +154,25 @@ static void message_loop_n(IjkMediaPlayer *mp) {
                 MPTRACE("FFP_MSG_AUDIO_DEVICE_CHANGE:\n");
                 post_event(MEDIA_AUDIO_DEVICE_CHANGE, msg.arg1, msg.arg2, nullptr, idStr);
                 break;
+            case FFP_MSG_CLIP_EXPORT_PROGRESS:
+                post_event(MEDIA_CLIP_EXPORT_PROGRESS, msg.arg1, msg.arg2, nullptr, idStr);
+                break;
+            case FFP_MSG_CLIP_EXPORT_COMPLETE:
+                MPTRACE("FFP_MSG_CLIP_EXPORT_COMPLETE: %d\n", msg.arg1);
+                post_event(MEDIA_CLIP_EXPORT_COMPLETE, msg.arg1, msg.arg2, nullptr, idStr);
+                break;
+            case FFP_MSG_SCRUB_FRAME_RENDERED:
+                MPTRACE("FFP_MSG_SCRUB_FRAME_RENDERED: %d in %d ms\n", msg.arg1, msg.arg2);
+                post_event(MEDIA_SCRUB_FRAME_RENDERED, msg.arg1, msg.arg2, nullptr, idStr);
+                break;
+            case FFP_MSG_NEXT_SOURCE_STARTED:
+                MPTRACE("FFP_MSG_NEXT_SOURCE_STARTED: loop %d, %d ms\n", msg.arg1, msg.arg2);
+                post_event(MEDIA_NEXT_SOURCE_STARTED, msg.arg1, msg.arg2, nullptr, idStr);
+                break;
+            case FFP_MSG_RECORD_COMPLETE:
+                MPTRACE("FFP_MSG_RECORD_COMPLETE: %d\n", msg.arg1);
+                post_event(MEDIA_RECORD_COMPLETE, msg.arg1, msg.arg2, nullptr, idStr);
+                break;
             default:
                 ALOGE("unknown FFP_MSG_xxx(%d)\n", msg.what);
                 break;
@@ -650,12 +669,12 @@ void IJKPlayerNapiProxy::IjkMediaPlayer_native_openlog() {
     open_custom_ffmpeg_log_print();
 }
 
-int IJKPlayerNapiProxy::IjkMediaPlayer_startRecord(const char *recordFilePath)
+int IJKPlayerNapiProxy::IjkMediaPlayer_startRecord(const char *recordFilePath, int mode)
 {
     IjkMediaPlayer *mp = IJKPlayerNapiProxy::get_media_player(id_);
     int retval = 0;
     if (mp) {
-        retval = ijkmp_start_record(mp, recordFilePath);
+        retval = ijkmp_start_record(mp, recordFilePath, mode);
     }
     ijkmp_dec_ref_p(&mp);
     return retval;
@@ -682,6 +701,81 @@ int IJKPlayerNapiProxy::IjkMediaPlayer_isRecord()
     return retval;
 }
 
+int IJKPlayerNapiProxy::IjkMediaPlayer_startClipExport(const char *filePath, int64_t startMs, int64_t endMs)
+{
+    IjkMediaPlayer *mp = IJKPlayerNapiProxy::get_media_player(id_);
+    int retval = -1;
+    if (mp) {
+        retval = ijkmp_start_clip_export(mp, filePath, startMs, endMs);
+    }
+    ijkmp_dec_ref_p(&mp);
+    return retval;
+}
+
+void IJKPlayerNapiProxy::IjkMediaPlayer_cancelClipExport()
+{
+    IjkMediaPlayer *mp = IJKPlayerNapiProxy::get_media_player(id_);
+    if (mp) {
+        ijkmp_cancel_clip_export(mp);
+    }
+    ijkmp_dec_ref_p(&mp);
+}
+
+int IJKPlayerNapiProxy::IjkMediaPlayer_setScrubMode(int enable)
+{
+    IjkMediaPlayer *mp = IJKPlayerNapiProxy::get_media_player(id_);
+    int retval = -1;
+    if (mp) {
+        retval = ijkmp_set_scrub_mode(mp, enable);
+    }
+    ijkmp_dec_ref_p(&mp);
+    return retval;
+}
+
+int IJKPlayerNapiProxy::IjkMediaPlayer_setTrickPlayRate(float rate)
+{
+    IjkMediaPlayer *mp = IJKPlayerNapiProxy::get_media_player(id_);
+    int retval = -1;
+    if (mp) {
+        retval = ijkmp_set_trick_play_rate(mp, rate);
+    }
+    ijkmp_dec_ref_p(&mp);
+    return retval;
+}
+
+int IJKPlayerNapiProxy::IjkMediaPlayer_stepBackward()
+{
+    IjkMediaPlayer *mp = IJKPlayerNapiProxy::get_media_player(id_);
+    int retval = -1;
+    if (mp) {
+        retval = ijkmp_step_backward(mp);
+    }
+    ijkmp_dec_ref_p(&mp);
+    return retval;
+}
+
+int IJKPlayerNapiProxy::IjkMediaPlayer_setReversePlayback(int enable)
+{
+    IjkMediaPlayer *mp = IJKPlayerNapiProxy::get_media_player(id_);
+    int retval = -1;
+    if (mp) {
+        retval = ijkmp_set_reverse_playback(mp, enable);
+    }
+    ijkmp_dec_ref_p(&mp);
+    return retval;
+}
+
+int IJKPlayerNapiProxy::IjkMediaPlayer_setNextDataSource(const char *url)
+{
+    IjkMediaPlayer *mp = IJKPlayerNapiProxy::get_media_player(id_);
+    int retval = -1;
+    if (mp) {
+        retval = ijkmp_set_next_data_source(mp, url);
+    }
+    ijkmp_dec_ref_p(&mp);
+    return retval;
+}
+
 int IJKPlayerNapiProxy::IjkMediaPlayer_getCurrentFrame(const char *saveFilePath)
 {
     IjkMediaPlayer *mp = IJKPlayerNapiProxy::get_media_player(id_);
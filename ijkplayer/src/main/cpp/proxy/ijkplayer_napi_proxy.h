@@ -67,9 +67,16 @@ class IJKPlayerNapiProxy {
     IjkMediaPlayer *get_media_player(std::string id);
     void delete_media_player(std::string id);
     
-    int IjkMediaPlayer_startRecord(const char *recordFilePath);
+    int IjkMediaPlayer_startRecord(const char *recordFilePath, int mode);
     int IjkMediaPlayer_stopRecord();
     int IjkMediaPlayer_isRecord();
+    int IjkMediaPlayer_startClipExport(const char *filePath, int64_t startMs, int64_t endMs);
+    void IjkMediaPlayer_cancelClipExport();
+    int IjkMediaPlayer_setScrubMode(int enable);
+    int IjkMediaPlayer_setTrickPlayRate(float rate);
+    int IjkMediaPlayer_stepBackward();
+    int IjkMediaPlayer_setReversePlayback(int enable);
+    int IjkMediaPlayer_setNextDataSource(const char *url);
     int IjkMediaPlayer_getCurrentFrame(const char *saveFilePath);
   public:
     std::string id_;
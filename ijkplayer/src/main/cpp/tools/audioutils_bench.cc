@@ -0,0 +1,197 @@
+/*
+ * audioutils_bench.cc
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+ * ijkaudioutils gain kernels against what the audio callback did before
+ * them: the decoded samples brought to S16 (what swr does for a float source,
+ * written out scalar here so the host needs no libswresample), then a silent
+ * buffer mixed with them at the volume, the way SDL_MixAudio does for S16.
+ * Arguments are the channel count and the frames per callback. The Ramp cases
+ * run a mute fade, which the old path could not do at all.
+ */
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+#include "ijkavutil/ijkaudioutils.h"
+}
+
+static const int kMixMaxVolume = 128; // SDL_MIX_MAXVOLUME
+static const int kMixVolume = 64;
+
+static std::vector<int16_t> MakeS16(int count)
+{
+    std::vector<int16_t> samples(count);
+    for (int i = 0; i < count; i++) {
+        samples[i] = static_cast<int16_t>((i * 7919) % 65536 - 32768);
+    }
+    return samples;
+}
+
+static std::vector<float> MakeF32(int count)
+{
+    std::vector<float> samples(count);
+    for (int i = 0; i < count; i++) {
+        samples[i] = std::sin(i * 0.37f);
+    }
+    return samples;
+}
+
+/* SDL_MixAudio for AUDIO_S16SYS: dst += src * volume / SDL_MIX_MAXVOLUME, clipped */
+static void MixAudioS16(int16_t *dst, const int16_t *src, int count, int volume)
+{
+    for (int i = 0; i < count; i++) {
+        int mixed = dst[i] + src[i] * volume / kMixMaxVolume;
+        if (mixed > 32767) {
+            mixed = 32767;
+        } else if (mixed < -32768) {
+            mixed = -32768;
+        }
+        dst[i] = static_cast<int16_t>(mixed);
+    }
+}
+
+/* swr FLT -> S16, round to nearest and saturate */
+static void FloatToS16(int16_t *dst, const float *src, int count)
+{
+    for (int i = 0; i < count; i++) {
+        dst[i] = static_cast<int16_t>(lrintf(std::fmin(std::fmax(src[i] * 32768.0f, -32768.0f), 32767.0f)));
+    }
+}
+
+static void BM_MixAudioS16(benchmark::State &state)
+{
+    const int count = static_cast<int>(state.range(0) * state.range(1));
+    std::vector<int16_t> src = MakeS16(count);
+    std::vector<int16_t> dst(count);
+
+    for (auto _ : state) {
+        memset(dst.data(), 0, count * sizeof(int16_t));
+        MixAudioS16(dst.data(), src.data(), count, kMixVolume);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void BM_ConvertMixAudioF32(benchmark::State &state)
+{
+    const int count = static_cast<int>(state.range(0) * state.range(1));
+    std::vector<float> src = MakeF32(count);
+    std::vector<int16_t> converted(count);
+    std::vector<int16_t> dst(count);
+
+    for (auto _ : state) {
+        FloatToS16(converted.data(), src.data(), count);
+        memset(dst.data(), 0, count * sizeof(int16_t));
+        MixAudioS16(dst.data(), converted.data(), count, kMixVolume);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void GainS16(benchmark::State &state, float gainStart, float gainEnd)
+{
+    const int channels = static_cast<int>(state.range(0));
+    const int frames = static_cast<int>(state.range(1));
+    const int count = channels * frames;
+    std::vector<int16_t> src = MakeS16(count);
+    std::vector<int16_t> dst(count);
+    std::vector<int16_t> ref(count);
+
+    // the flat gain is the old path's volume, the output has to match it
+    if (gainStart == gainEnd) {
+        MixAudioS16(ref.data(), src.data(), count, kMixVolume);
+        ijk_audio_apply_gain_s16(dst.data(), src.data(), frames, channels, gainStart, gainEnd);
+        for (int i = 0; i < count; i++) {
+            if (std::abs(dst[i] - ref[i]) > 1) {
+                state.SkipWithError("ijk_audio_apply_gain_s16 differs from the SDL_MixAudio path");
+                return;
+            }
+        }
+    }
+
+    for (auto _ : state) {
+        ijk_audio_apply_gain_s16(dst.data(), src.data(), frames, channels, gainStart, gainEnd);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void GainF32(benchmark::State &state, float gainStart, float gainEnd)
+{
+    const int channels = static_cast<int>(state.range(0));
+    const int frames = static_cast<int>(state.range(1));
+    const int count = channels * frames;
+    std::vector<float> src = MakeF32(count);
+    std::vector<float> dst(count);
+
+    for (auto _ : state) {
+        ijk_audio_apply_gain_f32(dst.data(), src.data(), frames, channels, gainStart, gainEnd);
+        benchmark::DoNotOptimize(dst.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+static void BM_GainS16(benchmark::State &state)
+{
+    GainS16(state, static_cast<float>(kMixVolume) / kMixMaxVolume, static_cast<float>(kMixVolume) / kMixMaxVolume);
+}
+
+static void BM_GainS16Ramp(benchmark::State &state)
+{
+    GainS16(state, 1.0f, 0.0f);
+}
+
+static void BM_GainF32(benchmark::State &state)
+{
+    GainF32(state, static_cast<float>(kMixVolume) / kMixMaxVolume, static_cast<float>(kMixVolume) / kMixMaxVolume);
+}
+
+static void BM_GainF32Ramp(benchmark::State &state)
+{
+    GainF32(state, 1.0f, 0.0f);
+}
+
+static void CallbackArgs(benchmark::internal::Benchmark *b)
+{
+    b->ArgNames({"channels", "frames"});
+    for (int channels : {1, 2, 6}) {
+        b->Args({channels, 1024});
+    }
+}
+
+BENCHMARK(BM_MixAudioS16)->Apply(CallbackArgs);
+BENCHMARK(BM_GainS16)->Apply(CallbackArgs);
+BENCHMARK(BM_GainS16Ramp)->Apply(CallbackArgs);
+BENCHMARK(BM_ConvertMixAudioF32)->Apply(CallbackArgs);
+BENCHMARK(BM_GainF32)->Apply(CallbackArgs);
+BENCHMARK(BM_GainF32Ramp)->Apply(CallbackArgs);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,266 @@
+/*
+ * buffering_sim.c
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Replays recorded throughput traces against the buffering policies and
+ * reports startup delay and rebuffering, e.g.
+ *   buffering_sim -b 2000000 -d 120000 traces/wifi_flaky.txt
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/mem.h"
+#include "ff_ffbuffering.h"
+
+#define SIMULATE_STEP_MS    (10)
+
+/* one step of a recorded throughput trace */
+typedef struct TracePoint {
+    int64_t duration_ms;
+    int64_t throughput;             // bytes per second
+} TracePoint;
+
+typedef struct SimResult {
+    int     rebuffer_count;         // stalls after the first frame
+    int64_t startup_delay_ms;       // -1 when playback never started
+    int64_t rebuffer_ms;
+    int64_t played_ms;
+} SimResult;
+
+/*
+ * One "duration_ms bytes_per_second" pair per line, '#' starts a comment.
+ * @return number of points, negative AVERROR on failure; free *points with av_freep()
+ */
+static int trace_load(const char *path, TracePoint **points)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return AVERROR(errno);
+
+    TracePoint *array = NULL;
+    int  count    = 0;
+    int  capacity = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        long long duration_ms = 0;
+        long long throughput  = 0;
+        char *comment = strchr(line, '#');
+        if (comment)
+            *comment = '\0';
+        if (sscanf(line, "%lld %lld", &duration_ms, &throughput) != 2 || duration_ms <= 0 || throughput < 0)
+            continue;
+
+        if (count == capacity) {
+            int new_capacity = capacity ? capacity * 2 : 64;
+            TracePoint *new_array = av_realloc_array(array, new_capacity, sizeof(*array));
+            if (!new_array) {
+                av_free(array);
+                fclose(fp);
+                return AVERROR(ENOMEM);
+            }
+            array    = new_array;
+            capacity = new_capacity;
+        }
+        array[count].duration_ms = duration_ms;
+        array[count].throughput  = throughput;
+        count++;
+    }
+    fclose(fp);
+
+    *points = array;
+    return count;
+}
+
+/*
+ * Replay a trace with the same check cadence as read_thread. The link is idle
+ * while max_buffer_ms of media is cached, the run ends when the trace or the
+ * media runs out.
+ * @param media_duration_ms 0 for an endless stream
+ */
+static int simulate(const char *policy_name, int first_hwm_ms, int next_hwm_ms, int last_hwm_ms,
+                    int64_t bit_rate, int64_t media_duration_ms, int64_t max_buffer_ms,
+                    const TracePoint *points, int nb_points, SimResult *result)
+{
+    FFBufferingController *ctrl = ffbuffering_create(policy_name, first_hwm_ms, next_hwm_ms, last_hwm_ms);
+    if (!ctrl)
+        return AVERROR(ENOMEM);
+
+    memset(result, 0, sizeof(*result));
+    result->startup_delay_ms = -1;
+
+    double  byte_rate     = bit_rate / 8.0;
+    double  cached_ms     = 0;
+    double  downloaded_ms = 0;
+    double  played_ms     = 0;
+    int     buffering     = 1;
+    int64_t now_ms        = 0;
+    int64_t next_check_ms = 0;
+    int64_t stall_at_ms   = 0;
+
+    for (int i = 0; i < nb_points; i++) {
+        for (int64_t offset_ms = 0; offset_ms < points[i].duration_ms; offset_ms += SIMULATE_STEP_MS) {
+            int64_t step_ms  = FFMIN(SIMULATE_STEP_MS, points[i].duration_ms - offset_ms);
+            int complete     = media_duration_ms > 0 && downloaded_ms >= media_duration_ms;
+            int throttled    = cached_ms >= max_buffer_ms;
+            int64_t throughput = 0;
+
+            if (!complete && !throttled) {
+                double got_ms = points[i].throughput * step_ms / byte_rate;
+                if (media_duration_ms > 0)
+                    got_ms = FFMIN(got_ms, media_duration_ms - downloaded_ms);
+                cached_ms     += got_ms;
+                downloaded_ms += got_ms;
+                throughput     = points[i].throughput;
+            }
+
+            if (!buffering) {
+                double play_ms = FFMIN((double)step_ms, cached_ms);
+                cached_ms -= play_ms;
+                played_ms += play_ms;
+                if (media_duration_ms > 0 && played_ms >= media_duration_ms)
+                    goto end;
+                if (cached_ms <= 0) {
+                    buffering   = 1;
+                    stall_at_ms = now_ms + step_ms;
+                    result->rebuffer_count++;
+                }
+            }
+            now_ms += step_ms;
+
+            if (now_ms < next_check_ms)
+                continue;
+            // read_thread also restarts from the first mark until the first frame
+            if (result->startup_delay_ms < 0) {
+                ffbuffering_reset(ctrl);
+                next_check_ms = now_ms + FAST_BUFFERING_CHECK_PER_MILLISECONDS;
+            } else {
+                next_check_ms = now_ms + BUFFERING_CHECK_PER_MILLISECONDS;
+            }
+
+            FFBufferingSample sample = {
+                .now_ms             = now_ms,
+                .cached_duration_ms = (int64_t)cached_ms,
+                .cached_bytes       = (int64_t)(cached_ms * byte_rate / 1000),
+                .remaining_ms       = media_duration_ms > 0 ? (int64_t)FFMAX(media_duration_ms - played_ms - cached_ms, 0) : -1,
+                .throughput         = throughput,
+                .bit_rate           = bit_rate,
+                .buffering          = buffering,
+                .read_throttled     = throttled,
+            };
+            ffbuffering_update(ctrl, &sample);
+            complete = media_duration_ms > 0 && downloaded_ms >= media_duration_ms;
+            if (cached_ms < ctrl->hwm_ms && !complete)
+                continue;
+
+            ffbuffering_on_filled(ctrl, &sample);
+            if (buffering) {
+                buffering = 0;
+                if (result->startup_delay_ms < 0)
+                    result->startup_delay_ms = now_ms;
+                else
+                    result->rebuffer_ms += now_ms - stall_at_ms;
+            }
+        }
+    }
+
+end:
+    if (buffering && result->startup_delay_ms >= 0)
+        result->rebuffer_ms += now_ms - stall_at_ms;
+    result->played_ms = (int64_t)played_ms;
+    ffbuffering_freep(&ctrl);
+    return 0;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options] trace...\n"
+            "  -p policy    %s, %s or all (default all)\n"
+            "  -b bit_rate  media bits per second (default 2000000)\n"
+            "  -d ms        media duration, 0 for an endless stream (default 0)\n"
+            "  -m ms        most media cached before reading pauses (default 60000)\n"
+            "  -f ms -n ms -l ms  first, next and last high water mark (default 100, 1000, 5000)\n",
+            name, FFP_BUFFERING_POLICY_LADDER, FFP_BUFFERING_POLICY_BANDWIDTH);
+}
+
+int main(int argc, char **argv)
+{
+    static const char *all_policies[] = { FFP_BUFFERING_POLICY_LADDER, FFP_BUFFERING_POLICY_BANDWIDTH };
+    const char *policy      = "all";
+    int64_t bit_rate        = 2000000;
+    int64_t duration_ms     = 0;
+    int64_t max_buffer_ms   = 60000;
+    int     first_hwm_ms    = 100;
+    int     next_hwm_ms     = 1000;
+    int     last_hwm_ms     = 5000;
+    int     opt;
+
+    while ((opt = getopt(argc, argv, "p:b:d:m:f:n:l:h")) != -1) {
+        switch (opt) {
+        case 'p': policy        = optarg; break;
+        case 'b': bit_rate      = strtoll(optarg, NULL, 10); break;
+        case 'd': duration_ms   = strtoll(optarg, NULL, 10); break;
+        case 'm': max_buffer_ms = strtoll(optarg, NULL, 10); break;
+        case 'f': first_hwm_ms  = atoi(optarg); break;
+        case 'n': next_hwm_ms   = atoi(optarg); break;
+        case 'l': last_hwm_ms   = atoi(optarg); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind >= argc || bit_rate <= 0 || duration_ms < 0 || max_buffer_ms <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    printf("%-32s %-10s %10s %10s %12s %10s\n", "trace", "policy", "startup_ms", "rebuffers", "rebuffer_ms", "played_ms");
+    for (int i = optind; i < argc; i++) {
+        TracePoint *points = NULL;
+        int nb_points = trace_load(argv[i], &points);
+        if (nb_points <= 0) {
+            fprintf(stderr, "%s: %s\n", argv[i], nb_points < 0 ? av_err2str(nb_points) : "no trace points");
+            av_freep(&points);
+            return 1;
+        }
+
+        for (size_t j = 0; j < FF_ARRAY_ELEMS(all_policies); j++) {
+            SimResult result;
+            if (strcmp(policy, "all") && strcmp(policy, all_policies[j]))
+                continue;
+            if (simulate(all_policies[j], first_hwm_ms, next_hwm_ms, last_hwm_ms, bit_rate, duration_ms,
+                         max_buffer_ms, points, nb_points, &result) < 0) {
+                av_freep(&points);
+                return 1;
+            }
+            printf("%-32s %-10s %10"PRId64" %10d %12"PRId64" %10"PRId64"\n", argv[i], all_policies[j],
+                   result.startup_delay_ms, result.rebuffer_count, result.rebuffer_ms, result.played_ms);
+        }
+        av_freep(&points);
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * host_log.c
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/* utils/ohoslog/ohos_log.cpp for the host tools: stderr instead of hilog */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include "../utils/ohoslog/ohos_log.h"
+
+bool OHOS_LOG_ON = false;
+
+static void host_log_vprint(const char *tag, const char *fmt, va_list arg)
+{
+    fprintf(stderr, "%s: ", tag);
+    vfprintf(stderr, fmt, arg);
+    fputc('\n', stderr);
+}
+
+void __ohos_log_print(enum ijkplayerLogLevel level, const char *tag, const char *fmt, ...)
+{
+    va_list arg;
+
+    if (!OHOS_LOG_ON && level < IL_WARN)
+        return;
+    va_start(arg, fmt);
+    host_log_vprint(tag, fmt, arg);
+    va_end(arg);
+}
+
+void __ohos_log_print_debug(enum ijkplayerLogLevel level, const char *tag, const char *file, int line,
+                            const char *fmt, ...)
+{
+    va_list arg;
+
+    if (!OHOS_LOG_ON && level < IL_WARN)
+        return;
+    fprintf(stderr, "%s:%d ", file, line);
+    va_start(arg, fmt);
+    host_log_vprint(tag, fmt, arg);
+    va_end(arg);
+}
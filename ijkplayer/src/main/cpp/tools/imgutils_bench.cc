@@ -0,0 +1,237 @@
+/*
+ * imgutils_bench.cc
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+ * ijkimgutils kernels against swscale on the conversions the OHOS pipenode
+ * does for screenshots and recording, at 1080p and 4K. Arguments are width,
+ * height and, for the kernels, whether AVX2 may be used. The *PerFrame case
+ * is what Nv12ToYuv420p did before the converter: a SwsContext and an image
+ * allocated for every frame.
+ */
+
+#include <benchmark/benchmark.h>
+#include <cstring>
+
+extern "C" {
+#include "libavutil/cpu.h"
+#include "libavutil/frame.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/mem.h"
+#include "libswscale/swscale.h"
+#include "ijkavutil/ijkimgutils.h"
+}
+
+static AVFrame *AllocFrame(AVPixelFormat format, int width, int height)
+{
+    AVFrame *frame = av_frame_alloc();
+    if (!frame) {
+        return nullptr;
+    }
+    frame->format = format;
+    frame->width = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 32) < 0) {
+        av_frame_free(&frame);
+        return nullptr;
+    }
+    for (int i = 0; i < AV_NUM_DATA_POINTERS && frame->data[i]; i++) {
+        int rows = i ? (height + 1) / 2 : height;
+        for (int y = 0; y < rows; y++) {
+            uint8_t *row = frame->data[i] + (size_t)y * frame->linesize[i];
+            for (int x = 0; x < frame->linesize[i]; x++) {
+                row[x] = (uint8_t)(x * 7 + y * 13 + i);
+            }
+        }
+    }
+    return frame;
+}
+
+static SwsContext *CreateSws(const AVFrame *src, AVPixelFormat dstFormat)
+{
+    return sws_getContext(src->width, src->height, (AVPixelFormat)src->format, src->width, src->height, dstFormat,
+                          SWS_POINT, nullptr, nullptr, nullptr);
+}
+
+static bool SamePlanes(const AVFrame *a, const AVFrame *b)
+{
+    for (int i = 0; i < 3 && a->data[i]; i++) {
+        int rows = i ? (a->height + 1) / 2 : a->height;
+        int bytes = av_image_get_linesize((AVPixelFormat)a->format, a->width, i);
+        for (int y = 0; y < rows; y++) {
+            if (memcmp(a->data[i] + (size_t)y * a->linesize[i], b->data[i] + (size_t)y * b->linesize[i], bytes)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/* AVX2 off leaves the SSE2 rows */
+static void ForceAvx2(bool enable)
+{
+    av_force_cpu_flags(-1);
+    if (!enable) {
+        av_force_cpu_flags(av_get_cpu_flags() & ~AV_CPU_FLAG_AVX2);
+    }
+}
+
+static void SetProcessed(benchmark::State &state, int width, int height)
+{
+    state.SetBytesProcessed(state.iterations() * ((int64_t)width * height * 3 / 2));
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_Convert_Ijk(benchmark::State &state, AVPixelFormat srcFormat, AVPixelFormat dstFormat)
+{
+    const int width = static_cast<int>(state.range(0));
+    const int height = static_cast<int>(state.range(1));
+    AVFrame *src = AllocFrame(srcFormat, width, height);
+    AVFrame *dst = AllocFrame(dstFormat, width, height);
+    AVFrame *ref = AllocFrame(dstFormat, width, height);
+    SwsContext *sws = src ? CreateSws(src, dstFormat) : nullptr;
+
+    ForceAvx2(state.range(2));
+    if (!dst || !ref || !sws) {
+        state.SkipWithError("alloc failed");
+    } else {
+        // both sides must produce the same picture for the timings to mean anything
+        sws_scale(sws, src->data, src->linesize, 0, height, ref->data, ref->linesize);
+        if (ijk_img_convert_frame(dst, src) < 0 || !SamePlanes(dst, ref)) {
+            state.SkipWithError("ijk_img_convert_frame differs from swscale");
+        }
+    }
+    for (auto _ : state) {
+        ijk_img_convert_frame(dst, src);
+        benchmark::ClobberMemory();
+    }
+    SetProcessed(state, width, height);
+    ForceAvx2(true);
+
+    sws_freeContext(sws);
+    av_frame_free(&ref);
+    av_frame_free(&dst);
+    av_frame_free(&src);
+}
+
+static void BM_Convert_Sws(benchmark::State &state, AVPixelFormat srcFormat, AVPixelFormat dstFormat)
+{
+    const int width = static_cast<int>(state.range(0));
+    const int height = static_cast<int>(state.range(1));
+    AVFrame *src = AllocFrame(srcFormat, width, height);
+    AVFrame *dst = AllocFrame(dstFormat, width, height);
+    SwsContext *sws = src ? CreateSws(src, dstFormat) : nullptr;
+
+    if (!dst || !sws) {
+        state.SkipWithError("alloc failed");
+    }
+    for (auto _ : state) {
+        sws_scale(sws, src->data, src->linesize, 0, height, dst->data, dst->linesize);
+        benchmark::ClobberMemory();
+    }
+    SetProcessed(state, width, height);
+
+    sws_freeContext(sws);
+    av_frame_free(&dst);
+    av_frame_free(&src);
+}
+
+static void BM_Nv12ToI420_SwsPerFrame(benchmark::State &state)
+{
+    const int width = static_cast<int>(state.range(0));
+    const int height = static_cast<int>(state.range(1));
+    AVFrame *src = AllocFrame(AV_PIX_FMT_NV12, width, height);
+
+    if (!src) {
+        state.SkipWithError("alloc failed");
+    }
+    for (auto _ : state) {
+        uint8_t *data[4];
+        int linesize[4];
+        SwsContext *sws = CreateSws(src, AV_PIX_FMT_YUV420P);
+        if (!sws || av_image_alloc(data, linesize, width, height, AV_PIX_FMT_YUV420P, 1) < 0) {
+            sws_freeContext(sws);
+            state.SkipWithError("alloc failed");
+            break;
+        }
+        sws_scale(sws, src->data, src->linesize, 0, height, data, linesize);
+        benchmark::ClobberMemory();
+        av_freep(&data[0]);
+        sws_freeContext(sws);
+    }
+    SetProcessed(state, width, height);
+
+    av_frame_free(&src);
+}
+
+/* the pipenode path: a pooled frame per conversion */
+static void BM_Nv12ToI420_Converter(benchmark::State &state)
+{
+    const int width = static_cast<int>(state.range(0));
+    const int height = static_cast<int>(state.range(1));
+    AVFrame *src = AllocFrame(AV_PIX_FMT_NV12, width, height);
+    IjkImgConverter *converter = ijk_img_converter_create();
+
+    ForceAvx2(state.range(2));
+    if (!src || !converter) {
+        state.SkipWithError("alloc failed");
+    }
+    for (auto _ : state) {
+        AVFrame *dst = ijk_img_converter_convert(converter, src, AV_PIX_FMT_YUV420P);
+        if (!dst) {
+            state.SkipWithError("ijk_img_converter_convert failed");
+            break;
+        }
+        benchmark::DoNotOptimize(dst->data[0]);
+        av_frame_free(&dst);
+    }
+    SetProcessed(state, width, height);
+    ForceAvx2(true);
+
+    ijk_img_converter_freep(&converter);
+    av_frame_free(&src);
+}
+
+static void KernelArgs(benchmark::internal::Benchmark *b)
+{
+    b->ArgNames({"w", "h", "avx2"});
+    for (int avx2 = 0; avx2 <= 1; avx2++) {
+        b->Args({1920, 1080, avx2});
+        b->Args({3840, 2160, avx2});
+    }
+}
+
+static void SwsArgs(benchmark::internal::Benchmark *b)
+{
+    b->ArgNames({"w", "h"});
+    b->Args({1920, 1080});
+    b->Args({3840, 2160});
+}
+
+BENCHMARK_CAPTURE(BM_Convert_Ijk, nv12_to_i420, AV_PIX_FMT_NV12, AV_PIX_FMT_YUV420P)->Apply(KernelArgs);
+BENCHMARK_CAPTURE(BM_Convert_Sws, nv12_to_i420, AV_PIX_FMT_NV12, AV_PIX_FMT_YUV420P)->Apply(SwsArgs);
+BENCHMARK_CAPTURE(BM_Convert_Ijk, i420_to_nv12, AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12)->Apply(KernelArgs);
+BENCHMARK_CAPTURE(BM_Convert_Sws, i420_to_nv12, AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12)->Apply(SwsArgs);
+BENCHMARK(BM_Nv12ToI420_Converter)->Apply(KernelArgs);
+BENCHMARK(BM_Nv12ToI420_SwsPerFrame)->Apply(SwsArgs);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,99 @@
+/*
+ * packet_queue_bench.cc
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * PacketQueue between a producer and a consumer thread, as read_thread and a
+ * decoder use it: the linked list against the SPSC ring of a few capacities.
+ * The argument is the ring capacity, 0 for the linked list. Packets are
+ * queued by reference, so their payload size doesn't matter.
+ */
+
+#include <benchmark/benchmark.h>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "ff_ffpacketqueue.h"
+}
+
+static const int kPacketsPerRun = 100000;
+static const int kPacketBytes = 188;
+
+static void BM_PacketQueue(benchmark::State &state)
+{
+    const int ringCapacity = static_cast<int>(state.range(0));
+    std::vector<uint8_t> payload(kPacketBytes);
+
+    packet_queue_global_init();
+    for (auto _ : state) {
+        PacketQueue q;
+        if (packet_queue_init(&q) < 0 || (ringCapacity > 0 && packet_queue_init_ring(&q, ringCapacity) < 0)) {
+            state.SkipWithError("packet_queue_init failed");
+            break;
+        }
+        packet_queue_start(&q);
+
+        std::thread producer([&q, &payload]() {
+            for (int i = 0; i < kPacketsPerRun; i++) {
+                AVPacket pkt;
+                av_init_packet(&pkt);
+                pkt.data     = payload.data();
+                pkt.size     = static_cast<int>(payload.size());
+                pkt.pts      = i;
+                pkt.duration = 1;
+                if (packet_queue_put(&q, &pkt) < 0) {
+                    break;
+                }
+            }
+        });
+
+        // the flush_pkt packet_queue_start() put comes first
+        int serial = 0;
+        for (int got = 0; got < kPacketsPerRun + 1; got++) {
+            AVPacket pkt;
+            if (packet_queue_get(&q, &pkt, 1, &serial) <= 0) {
+                state.SkipWithError("packet_queue_get failed");
+                break;
+            }
+            benchmark::DoNotOptimize(pkt.pts);
+            if (pkt.data != flush_pkt.data) {
+                av_packet_unref(&pkt);
+            }
+        }
+
+        producer.join();
+        packet_queue_abort(&q);
+        packet_queue_destroy(&q);
+    }
+    state.SetItemsProcessed(state.iterations() * kPacketsPerRun);
+}
+
+BENCHMARK(BM_PacketQueue)
+    ->ArgName("ring")
+    ->Arg(0)
+    ->Arg(64)
+    ->Arg(256)
+    ->Arg(4096)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,236 @@
+/*
+ * probe_startup.c
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Startup of sample files with and without the probe cache: the time from
+ * avformat_open_input() to the stream info, and on to the first video
+ * keyframe, the way read_thread gets there, e.g.
+ *   probe_startup -n 10 movie.mp4 clip.mkv
+ * The "cache" runs verify the keyframe, apply the entry and only probe when
+ * that fails, like read_thread_verify_probe_cache() and ffprobecache_apply().
+ * Without -d the entries go to a temporary directory removed at exit.
+ */
+
+#include <dirent.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "libavformat/avformat.h"
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/time.h"
+#include "ff_ffprobecache.h"
+
+#define MAX_RUNS            (100)
+#define VERIFY_PACKETS      (256)   // PROBE_CACHE_VERIFY_PACKETS of ff_ffplay_def.h
+
+typedef struct StartupRun {
+    int64_t stream_info_ms;
+    int64_t first_keyframe_ms;
+    int     cached;                 // the entry was applied, no probe
+} StartupRun;
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-n runs] [-d cache_dir] file...\n"
+            "  -n  runs per mode, %d at most (default 5)\n"
+            "  -d  where the probe cache entries go (default a temporary directory)\n",
+            name, MAX_RUNS);
+}
+
+/* read_thread_verify_probe_cache(): check the first video keyframe against the entry, then rewind */
+static int verify_keyframe(FFProbeCache *cache, AVFormatContext *ic)
+{
+    AVPacket pkt;
+    int64_t start_pos = avio_tell(ic->pb);
+    int64_t first_dts = AV_NOPTS_VALUE;
+    int first_stream = -1;
+    int video = av_find_best_stream(ic, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    int ret = 0;
+
+    if (!ffprobecache_has_entry(cache) || video < 0)
+        return 0;
+    for (int i = 0; i < VERIFY_PACKETS; i++) {
+        if (av_read_frame(ic, &pkt) < 0)
+            break;
+        if (first_stream < 0 && pkt.dts != AV_NOPTS_VALUE) {
+            first_stream = pkt.stream_index;
+            first_dts    = pkt.dts;
+        }
+        if (pkt.stream_index == video && (pkt.flags & AV_PKT_FLAG_KEY)) {
+            ret = ffprobecache_check_keyframe(cache, pkt.pos);
+            av_packet_unref(&pkt);
+            break;
+        }
+        av_packet_unref(&pkt);
+    }
+    if (ret < 0)
+        return ret;
+
+    ret = -1;
+    if (first_stream >= 0)
+        ret = av_seek_frame(ic, first_stream, first_dts, AVSEEK_FLAG_BACKWARD);
+    if (ret < 0 && !(ic->iformat->flags & AVFMT_NO_BYTE_SEEK))
+        ret = av_seek_frame(ic, -1, start_pos, AVSEEK_FLAG_BYTE);
+    return ret;
+}
+
+/* one open up to the first video keyframe, through the cache in cache_dir when it is set */
+static int startup_run(const char *path, const char *cache_dir, StartupRun *run)
+{
+    AVFormatContext *ic = NULL;
+    FFProbeCache *cache = NULL;
+    AVPacket pkt;
+    int64_t start = av_gettime_relative();
+    int video;
+    int ret;
+
+    memset(run, 0, sizeof(*run));
+    if ((ret = avformat_open_input(&ic, path, NULL, NULL)) < 0)
+        return ret;
+    if (cache_dir)
+        cache = ffprobecache_open(cache_dir, path, avio_size(ic->pb));
+
+    run->cached = verify_keyframe(cache, ic) == 0 && ffprobecache_apply(cache, ic) == 0;
+    if (!run->cached) {
+        if ((ret = avformat_find_stream_info(ic, NULL)) < 0)
+            goto end;
+        ffprobecache_store(cache, ic);
+    }
+    run->stream_info_ms = (av_gettime_relative() - start) / 1000;
+
+    video = av_find_best_stream(ic, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    while ((ret = av_read_frame(ic, &pkt)) >= 0) {
+        int keyframe = video < 0 || (pkt.stream_index == video && (pkt.flags & AV_PKT_FLAG_KEY));
+        // read_thread records the keyframe of a fresh entry, or checks it when verify had no video
+        if (keyframe && video >= 0)
+            ffprobecache_check_keyframe(cache, pkt.pos);
+        av_packet_unref(&pkt);
+        if (keyframe)
+            break;
+    }
+    run->first_keyframe_ms = (av_gettime_relative() - start) / 1000;
+
+end:
+    ffprobecache_closep(&cache);
+    avformat_close_input(&ic);
+    return ret < 0 && ret != AVERROR_EOF ? ret : 0;
+}
+
+static int compare_int64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void print_stats(const char *path, const char *mode, const StartupRun *runs, int nb_runs)
+{
+    int64_t stream_info[MAX_RUNS];
+    int64_t first_keyframe[MAX_RUNS];
+    int cached = 0;
+
+    for (int i = 0; i < nb_runs; i++) {
+        stream_info[i]    = runs[i].stream_info_ms;
+        first_keyframe[i] = runs[i].first_keyframe_ms;
+        cached           += runs[i].cached;
+    }
+    qsort(stream_info, nb_runs, sizeof(*stream_info), compare_int64);
+    qsort(first_keyframe, nb_runs, sizeof(*first_keyframe), compare_int64);
+    printf("%-32s %-6s %6d/%-3d %10"PRId64" %10"PRId64" %10"PRId64" %10"PRId64"\n", path, mode, cached, nb_runs,
+           stream_info[0], stream_info[nb_runs / 2], first_keyframe[0], first_keyframe[nb_runs / 2]);
+}
+
+static void remove_dir(const char *path)
+{
+    DIR *dir = opendir(path);
+    struct dirent *entry;
+    char file[4096];
+
+    if (!dir)
+        return;
+    while ((entry = readdir(dir))) {
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+            continue;
+        snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        unlink(file);
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+int main(int argc, char **argv)
+{
+    static StartupRun runs[MAX_RUNS];
+    char temp_dir[] = "/tmp/probe_startup.XXXXXX";
+    const char *cache_dir = NULL;
+    int nb_runs = 5;
+    int ret = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:d:h")) != -1) {
+        switch (opt) {
+        case 'n': nb_runs   = atoi(optarg); break;
+        case 'd': cache_dir = optarg; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind >= argc || nb_runs <= 0 || nb_runs > MAX_RUNS) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!cache_dir && !(cache_dir = mkdtemp(temp_dir))) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    av_log_set_level(AV_LOG_ERROR);
+    printf("%-32s %-6s %10s %10s %10s %10s %10s\n", "file", "mode", "cached",
+           "info_min", "info_med", "key_min", "key_med");
+    for (int i = optind; i < argc && !ret; i++) {
+        StartupRun warmup;
+        // the first open only warms the page cache and writes the entry, both modes then read from memory
+        if ((ret = startup_run(argv[i], cache_dir, &warmup)) < 0)
+            break;
+        for (int j = 0; j < nb_runs && !ret; j++)
+            ret = startup_run(argv[i], NULL, &runs[j]);
+        if (ret < 0)
+            break;
+        print_stats(argv[i], "probe", runs, nb_runs);
+        for (int j = 0; j < nb_runs && !ret; j++)
+            ret = startup_run(argv[i], cache_dir, &runs[j]);
+        if (ret < 0)
+            break;
+        print_stats(argv[i], "cache", runs, nb_runs);
+    }
+    if (ret < 0)
+        fprintf(stderr, "%s\n", av_err2str(ret));
+    if (cache_dir == temp_dir)
+        remove_dir(temp_dir);
+    return ret < 0;
+}
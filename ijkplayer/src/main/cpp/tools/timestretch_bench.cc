@@ -0,0 +1,233 @@
+/*
+ * timestretch_bench.cc
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+ * The streaming time stretcher against the speed path audio_decode_frame had
+ * before it, at 1.25x, 1.5x, 1.75x and 2x. One iteration is one decoded frame
+ * of 1024 stereo 44.1 kHz samples, or as many as the old path pulled before it
+ * returned. Besides the time, each run reports:
+ *   latency_ms    input the stretcher holds after a step, what the audio clock
+ *                 is behind by, averaged over the steps
+ *   first_out_ms  input put before the first output, on a fresh stretcher
+ *   out_in_ratio  output frames per input frame, 1 / tempo when nothing is lost
+ */
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "SoundTouch.h"
+
+extern "C" {
+#include "ijkavutil/ijktimestretch.h"
+}
+
+using namespace soundtouch;
+
+static const int kSampleRate = 44100;
+static const int kChannels = 2;
+static const int kFrameSamples = 1024;
+
+/* a second of a 440 Hz tone, handed out one decoded frame at a time */
+class ToneSource {
+public:
+    ToneSource() : samples_(kSampleRate * kChannels)
+    {
+        for (int i = 0; i < kSampleRate; i++) {
+            double v = std::sin(2.0 * M_PI * 440.0 * i / kSampleRate) * 0.5;
+            for (int c = 0; c < kChannels; c++) {
+#ifdef SOUNDTOUCH_FLOAT_SAMPLES
+                samples_[i * kChannels + c] = static_cast<SAMPLETYPE>(v);
+#else
+                samples_[i * kChannels + c] = static_cast<SAMPLETYPE>(v * 32767.0);
+#endif
+            }
+        }
+    }
+
+    const SAMPLETYPE *Next()
+    {
+        const SAMPLETYPE *frame = samples_.data() + (size_t)offset_ * kChannels;
+        offset_ += kFrameSamples;
+        if (offset_ + kFrameSamples > kSampleRate) {
+            offset_ = 0;
+        }
+        return frame;
+    }
+
+private:
+    std::vector<SAMPLETYPE> samples_;
+    int offset_ = 0;
+};
+
+/*
+ * ijk_soundtouch_translate of the prebuilt wrapper: reconfigured on every call,
+ * then drained into the buffer the input came in, one receive over the other.
+ */
+static int LegacyTranslate(SoundTouch &handle, SAMPLETYPE *data, float speed, float pitch, int len, int channels,
+    int sampleRate)
+{
+    int received;
+    int size = 0;
+
+    handle.setPitch(pitch);
+    handle.setRate(speed);
+    handle.setSampleRate(sampleRate);
+    handle.setChannels(channels);
+    handle.putSamples(data, len / channels);
+    do {
+        received = static_cast<int>(handle.receiveSamples(data, sampleRate / channels));
+        size += received;
+    } while (received != 0);
+    return size;
+}
+
+struct LegacyPath {
+    SoundTouch handle;
+    /* audio_new_buf; the wrapper may drain up to sampleRate / channels frames into it */
+    std::vector<SAMPLETYPE> newBuf;
+};
+
+/* one audio_decode_frame with the rate != 1: repack the frame, translate, goto reload while nothing came out */
+static int LegacyDecodeFrame(LegacyPath &path, ToneSource &source, float rate, int &framesIn)
+{
+    const int samples = kFrameSamples * kChannels;
+    int translateTime = 1;
+
+    for (;;) {
+        const SAMPLETYPE *frame = source.Next();
+        size_t wanted = std::max<size_t>((size_t)samples * translateTime, kSampleRate);
+        if (path.newBuf.size() < wanted) {
+            path.newBuf.resize(wanted);
+        }
+        for (int i = 0; i < samples; i++) {
+            path.newBuf[i] = frame[i];
+        }
+        framesIn += kFrameSamples;
+        int out = LegacyTranslate(path.handle, path.newBuf.data(), rate, 1.0f / rate, samples, kChannels, kSampleRate);
+        if (out > 0) {
+            return out;
+        }
+        translateTime++;
+    }
+}
+
+/* audio_time_stretch: put the frame, receive whatever is ready in one go */
+static int StreamDecodeFrame(IjkTimeStretch *ts, ToneSource &source, std::vector<SAMPLETYPE> &newBuf)
+{
+    ijk_timestretch_put(ts, reinterpret_cast<const uint8_t *>(source.Next()), kFrameSamples);
+    int available = ijk_timestretch_available(ts);
+    if (available <= 0) {
+        return 0;
+    }
+    if (newBuf.size() < (size_t)available * kChannels) {
+        newBuf.resize((size_t)available * kChannels);
+    }
+    return ijk_timestretch_receive(ts, reinterpret_cast<uint8_t *>(newBuf.data()), available);
+}
+
+static double FramesToMs(double frames)
+{
+    return frames * 1000.0 / kSampleRate;
+}
+
+static void BM_Legacy(benchmark::State &state)
+{
+    const float rate = state.range(0) / 100.0f;
+    ToneSource source;
+    double firstOutMs;
+    {
+        LegacyPath fresh;
+        int framesIn = 0;
+        LegacyDecodeFrame(fresh, source, rate, framesIn);
+        firstOutMs = FramesToMs(framesIn);
+    }
+
+    LegacyPath path;
+    int64_t framesIn = 0;
+    int64_t framesOut = 0;
+    double heldFrames = 0;
+    for (auto _ : state) {
+        int in = 0;
+        framesOut += LegacyDecodeFrame(path, source, rate, in);
+        framesIn += in;
+        heldFrames += path.handle.numUnprocessedSamples() + path.handle.numSamples() * rate;
+        benchmark::DoNotOptimize(path.newBuf.data());
+    }
+    state.SetItemsProcessed(framesIn);
+    state.counters["latency_ms"] = benchmark::Counter(FramesToMs(heldFrames), benchmark::Counter::kAvgIterations);
+    state.counters["first_out_ms"] = firstOutMs;
+    state.counters["out_in_ratio"] = framesIn ? static_cast<double>(framesOut) / framesIn : 0.0;
+}
+
+static void BM_Stream(benchmark::State &state)
+{
+    const float rate = state.range(0) / 100.0f;
+    ToneSource source;
+    std::vector<SAMPLETYPE> newBuf;
+
+    if (ijk_timestretch_sample_fmt() != (sizeof(SAMPLETYPE) == 2 ? AV_SAMPLE_FMT_S16 : AV_SAMPLE_FMT_FLT)) {
+        state.SkipWithError("ijk_timestretch_sample_fmt() does not match the SoundTouch build");
+        return;
+    }
+    IjkTimeStretch *ts = ijk_timestretch_create(kSampleRate, kChannels);
+    if (!ts) {
+        state.SkipWithError("ijk_timestretch_create failed");
+        return;
+    }
+    ijk_timestretch_set_tempo(ts, rate);
+    int framesToFirst = 0;
+    do {
+        framesToFirst += kFrameSamples;
+    } while (StreamDecodeFrame(ts, source, newBuf) == 0);
+    ijk_timestretch_clear(ts);
+
+    int64_t framesIn = 0;
+    int64_t framesOut = 0;
+    double heldFrames = 0;
+    for (auto _ : state) {
+        framesOut += StreamDecodeFrame(ts, source, newBuf);
+        framesIn += kFrameSamples;
+        heldFrames += ijk_timestretch_latency(ts);
+        benchmark::DoNotOptimize(newBuf.data());
+    }
+    ijk_timestretch_freep(&ts);
+    state.SetItemsProcessed(framesIn);
+    state.counters["latency_ms"] = benchmark::Counter(FramesToMs(heldFrames), benchmark::Counter::kAvgIterations);
+    state.counters["first_out_ms"] = FramesToMs(framesToFirst);
+    state.counters["out_in_ratio"] = framesIn ? static_cast<double>(framesOut) / framesIn : 0.0;
+}
+
+static void TempoArgs(benchmark::internal::Benchmark *b)
+{
+    b->ArgNames({"tempo%"});
+    for (int tempo : {125, 150, 175, 200}) {
+        b->Arg(tempo);
+    }
+}
+
+BENCHMARK(BM_Legacy)->Apply(TempoArgs);
+BENCHMARK(BM_Stream)->Apply(TempoArgs);
+
+BENCHMARK_MAIN();
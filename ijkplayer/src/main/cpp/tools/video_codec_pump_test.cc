@@ -0,0 +1,386 @@
+/*
+ * video_codec_pump_test.cc
+ *
+ * Copyright (C) 2024 Huawei Device Co.,Ltd.
+ *
+ * This file is part of ijkPlayer.
+ *
+ * ijkPlayer is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * ijkPlayer is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with ijkPlayer; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+
+/*
+ * VideoCodecPump, the input path of the OHOS video pipenode, against a mock
+ * codec and a mock packet queue: ordering, EOS restart, flush on seek,
+ * source switches and packets the codec refuses.
+ */
+
+#include <gtest/gtest.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "ohos/ohos_video_codec_pump.h"
+
+static uint8_t kFlushData;
+static uint8_t kCodecData;
+static uint8_t kPayload[8192];
+
+/* one picture per input, an EOS picture per EOS; no input after an EOS until Flush() */
+class MockCodec : public VideoCodecInterface {
+public:
+    explicit MockCodec(int32_t maxInputSize = sizeof(kPayload)) : maxInputSize_(maxInputSize) {}
+
+    int32_t QueueInput(const uint8_t * /* data */, int32_t size, int64_t pts, bool /* keyFrame */, bool eos,
+        std::chrono::milliseconds timeout) override
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (eosQueued_) {
+            cond_.wait_for(lock, timeout);
+            return AVERROR(EAGAIN);
+        }
+        if (size > maxInputSize_) {
+            return AVERROR(ENOMEM);
+        }
+        VideoCodecPicture picture;
+        picture.pts = pts;
+        picture.eos = eos;
+        picture.index = nextIndex_++;
+        picture.generation = generation_;
+        outputs_.push_back(picture);
+        eosQueued_ = eos;
+        bytesCopied_ += size;
+        cond_.notify_all();
+        return 0;
+    }
+
+    int32_t DequeueOutput(VideoCodecPicture &picture, std::chrono::milliseconds timeout) override
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!cond_.wait_for(lock, timeout, [this]() { return !outputs_.empty(); })) {
+            return AVERROR(EAGAIN);
+        }
+        picture = outputs_.front();
+        outputs_.pop_front();
+        outstanding_++;
+        return 0;
+    }
+
+    void ReleaseOutput(const VideoCodecPicture & /* picture */) override
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        outstanding_--;
+    }
+
+    int32_t Flush() override
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        outputs_.clear();
+        eosQueued_ = false;
+        generation_++;
+        flushCount_++;
+        cond_.notify_all();
+        return 0;
+    }
+
+    void Wakeup() override
+    {
+        cond_.notify_all();
+    }
+
+    uint64_t InputBytesCopied() override
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return bytesCopied_;
+    }
+
+    int FlushCount()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return flushCount_;
+    }
+
+    /* pictures dequeued and not released yet */
+    int Outstanding()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return outstanding_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<VideoCodecPicture> outputs_;
+    int32_t maxInputSize_;
+    bool eosQueued_ {false};
+    uint32_t nextIndex_ {0};
+    uint32_t generation_ {0};
+    int flushCount_ {0};
+    int outstanding_ {0};
+    uint64_t bytesCopied_ {0};
+};
+
+/* the video packet queue: packets and flush markers with the serial they were queued at */
+class MockSource : public VideoCodecPacketSource {
+public:
+    /* packet_queue_start() puts a flush packet first */
+    MockSource()
+    {
+        PutFlush();
+    }
+
+    void Put(int64_t pts, int size = 100)
+    {
+        AVPacket pkt;
+        av_init_packet(&pkt);
+        pkt.data = kPayload;
+        pkt.size = size;
+        pkt.pts = pts;
+        pkt.flags = AV_PKT_FLAG_KEY;
+        Push(pkt);
+    }
+
+    void PutEos()
+    {
+        AVPacket pkt;
+        av_init_packet(&pkt);
+        pkt.data = nullptr;
+        pkt.size = 0;
+        Push(pkt);
+    }
+
+    /* codec_pkt, a gapless switch to a source encoded otherwise */
+    void PutCodec()
+    {
+        AVPacket pkt;
+        av_init_packet(&pkt);
+        pkt.data = &kCodecData;
+        Push(pkt);
+    }
+
+    /* as packet_queue_flush() and the flush_pkt a seek puts */
+    void Seek()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            packets_.clear();
+            serial_++;
+        }
+        PutFlush();
+    }
+
+    void Abort()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        aborted_ = true;
+        cond_.notify_all();
+    }
+
+    int GetPacket(AVPacket *pkt, int *serial) override
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this]() { return aborted_ || !packets_.empty(); });
+        if (aborted_) {
+            return -1;
+        }
+        *pkt = packets_.front().first;
+        *serial = packets_.front().second;
+        packets_.pop_front();
+        return 1;
+    }
+
+    bool IsFlushPacket(const AVPacket *pkt) override
+    {
+        return pkt->data == &kFlushData;
+    }
+
+    bool IsCodecPacket(const AVPacket *pkt) override
+    {
+        return pkt->data == &kCodecData;
+    }
+
+    int CurrentSerial() override
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return serial_;
+    }
+
+    bool IsAborted() override
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return aborted_;
+    }
+
+    void OnFlush() override
+    {
+        flushes++;
+    }
+
+    void OnEosLost(int /* serial */) override
+    {
+        eosLost++;
+    }
+
+    void OnInputCopied(uint64_t bytes) override
+    {
+        bytesCopied += bytes;
+    }
+
+    std::atomic_int flushes {0};
+    std::atomic_int eosLost {0};
+    std::atomic_uint64_t bytesCopied {0};
+
+private:
+    void PutFlush()
+    {
+        AVPacket pkt;
+        av_init_packet(&pkt);
+        pkt.data = &kFlushData;
+        Push(pkt);
+    }
+
+    void Push(const AVPacket &pkt)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        packets_.push_back({pkt, serial_});
+        cond_.notify_all();
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<std::pair<AVPacket, int>> packets_;
+    int serial_ {1};
+    bool aborted_ {false};
+};
+
+class VideoCodecPumpTest : public ::testing::Test {
+protected:
+    void TearDown() override
+    {
+        source.Abort();
+        pump.Stop();
+        EXPECT_EQ(codec.Outstanding(), 0);
+    }
+
+    /* as the video thread does: pictures of an older serial are dropped, stops at the EOS picture */
+    std::vector<int64_t> PopUntilEos()
+    {
+        std::vector<int64_t> pts;
+        VideoCodecPicture picture;
+        while (pump.PopPicture(picture) == 0) {
+            bool current = picture.serial == source.CurrentSerial();
+            bool eos = picture.eos;
+            if (current && !eos) {
+                pts.push_back(picture.pts);
+            }
+            codec.ReleaseOutput(picture);
+            if (current && eos) {
+                break;
+            }
+        }
+        return pts;
+    }
+
+    MockCodec codec {1000};
+    MockSource source;
+    VideoCodecPump pump {&codec, &source};
+};
+
+TEST_F(VideoCodecPumpTest, PicturesComeOutInOrder)
+{
+    pump.Start();
+    for (int i = 0; i < 20; i++) {
+        source.Put(i);
+    }
+    source.PutEos();
+
+    std::vector<int64_t> expected;
+    for (int i = 0; i < 20; i++) {
+        expected.push_back(i);
+    }
+    EXPECT_EQ(PopUntilEos(), expected);
+    EXPECT_EQ(source.bytesCopied, 20u * 100);
+}
+
+TEST_F(VideoCodecPumpTest, InputAfterEosRestartsTheCodec)
+{
+    pump.Start();
+    for (int i = 0; i < 3; i++) {
+        source.Put(i);
+    }
+    source.PutEos();
+    EXPECT_EQ(PopUntilEos(), (std::vector<int64_t> {0, 1, 2}));
+
+    // rewind queues a keyframe after every EOS without a flush packet
+    source.Put(3);
+    source.PutEos();
+    EXPECT_EQ(PopUntilEos(), (std::vector<int64_t> {3}));
+    source.Put(4);
+    source.PutEos();
+    EXPECT_EQ(PopUntilEos(), (std::vector<int64_t> {4}));
+    EXPECT_EQ(codec.FlushCount(), 2);
+    EXPECT_EQ(source.eosLost, 0);
+}
+
+TEST_F(VideoCodecPumpTest, SeekDropsPicturesOfTheOldSerial)
+{
+    pump.Start();
+    for (int i = 0; i < 10; i++) {
+        source.Put(i);
+    }
+    VideoCodecPicture picture;
+    ASSERT_EQ(pump.PopPicture(picture), 0);
+    EXPECT_EQ(picture.pts, 0);
+    codec.ReleaseOutput(picture);
+
+    source.Seek();
+    for (int i = 100; i < 103; i++) {
+        source.Put(i);
+    }
+    source.PutEos();
+    EXPECT_EQ(PopUntilEos(), (std::vector<int64_t> {100, 101, 102}));
+    EXPECT_EQ(source.flushes, 2);
+    EXPECT_EQ(codec.FlushCount(), 1);
+}
+
+TEST_F(VideoCodecPumpTest, PacketTheCodecRefusesIsDropped)
+{
+    pump.Start();
+    source.Put(0);
+    source.Put(1, 5000);
+    source.Put(2);
+    source.PutEos();
+    EXPECT_EQ(PopUntilEos(), (std::vector<int64_t> {0, 2}));
+    EXPECT_EQ(codec.FlushCount(), 0);
+}
+
+TEST_F(VideoCodecPumpTest, SourceSwitchDrainsWithoutEndingPlayback)
+{
+    pump.Start();
+    for (int i = 0; i < 3; i++) {
+        source.Put(i);
+    }
+    source.PutCodec();
+    for (int i = 3; i < 5; i++) {
+        source.Put(i);
+    }
+    source.PutEos();
+
+    // no EOS picture at the switch, the codec restarts once for the next source
+    EXPECT_EQ(PopUntilEos(), (std::vector<int64_t> {0, 1, 2, 3, 4}));
+    EXPECT_EQ(codec.FlushCount(), 1);
+    EXPECT_EQ(source.eosLost, 0);
+}
@@ -40,6 +40,7 @@ export declare class newIjkPlayerAudio {
   _setVolume(xcomponentId: string, leftVolume: string, rightVolume: string): void;
   _setLoopCount(xcomponentId: string, loopCount: string): void;
   _getLoopCount(xcomponentId: string): number;
+  _setNextDataSource(xcomponentId: string, url: string): number;
   _setStreamSelected(xcomponentId: string, stream: string, select: string): void;
   _getVideoCodecInfo(xcomponentId: string): string;
   _getAudioCodecInfo(xcomponentId: string): string;